@@ -10,6 +10,7 @@
 #include <Windows.h>
 #include "aviutl2_sdk/output2.h"
 #include "aviutl2_sdk/logger2.h"
+#include "aviutl2_sdk/plugin2.h"
 
 import std;
 import mfop;
@@ -33,10 +34,45 @@ auto func_output(OUTPUT_INFO *oip) noexcept
 		*oip,
 		mfop::output_configuration
 		{
-			get<video_quality>(),
-			get<audio_bit_rate>(),
-			get<is_hevc_preferable>(),
-			get<is_accelerated>()
+			.video_quality = get<video_quality>(),
+			.audio_bit_rate = get<audio_bit_rate>(),
+			.is_hevc_preferable = get<is_hevc_preferable>(),
+			.is_accelerated = get<is_accelerated>(),
+			.keeps_partial_file = get<keeps_partial_file>(),
+			.uses_segment_cache = get<uses_segment_cache>(),
+			.segment_cache_size = get<segment_cache_size>(),
+			.uses_checkpoints = get<uses_checkpoints>(),
+			.checkpoint_interval = get<checkpoint_interval>(),
+			.extra_outputs = get_extra_outputs(),
+			.output_width = get<output_width>(),
+			.output_height = get<output_height>(),
+			.scaling_filter = get<scaling_filter>(),
+			.output_rate = get<output_rate>(),
+			.output_scale = get<output_scale>(),
+			.exported_streams = get<exported_streams>(),
+			.uses_pipe = get<uses_pipe>(),
+			.pipe_command = get_pipe_command(),
+			.uses_frame_server = get<uses_frame_server>(),
+			.frame_server_slots = get<frame_server_slots>(),
+			.frame_server_name = get_frame_server_name(),
+			.uses_encoder_host = get<uses_encoder_host>(),
+			.uses_spill = get<uses_spill>(),
+			.spill_wait = get<spill_wait>(),
+			.spill_memory = get<spill_memory>(),
+			.spill_disk = get<spill_disk>(),
+			.cpu_cores = get<cpu_cores>(),
+			.cpu_percent = get<cpu_percent>(),
+			.cpu_priority = get<cpu_priority>(),
+			.pins_cpu = get<pins_cpu>(),
+			.detects_scene_cuts = get<detects_scene_cuts>(),
+			.gop_length = get<gop_length>(),
+			.scene_threshold = get<scene_threshold>(),
+			.segment_duration = get<segment_duration>(),
+			.uses_stream = get<uses_stream>(),
+			.stream_address = get_stream_address(),
+			.is_stream_realtime = get<is_stream_realtime>(),
+			.uses_passthrough = get<uses_passthrough>(),
+			.writes_digest = get<writes_digest>()
 		},
 		*aviutl_logger
 	) };
@@ -47,7 +83,7 @@ auto func_output(OUTPUT_INFO *oip) noexcept
 		return false;
 	}
 
-	aviutl_logger->info(aviutl_logger, L"Output completed successfully.");
+	aviutl_logger->info(aviutl_logger, *result == S_FALSE ? L"Output completed. The file is being finalized in the background." : L"Output completed successfully.");
 
 	return true;
 }
@@ -65,12 +101,24 @@ extern "C"
 		aviutl_logger = logger;
 	}
 
+	__declspec(dllexport) auto UninitializePlugin() noexcept
+	{
+		mfop::wait_for_pending_outputs();
+		mfop::session::release();
+	}
+
+	// rundll32 "MFOutput.auo2",RunEncoderHost <name> <process ID> starts the worker of the encoder host.
+	__declspec(dllexport) void CALLBACK RunEncoderHostW(HWND, HINSTANCE, LPWSTR arguments, int) noexcept
+	{
+		mfop::run_encoder_host(arguments);
+	}
+
 	__declspec(dllexport) auto GetOutputPluginTable() noexcept
 	{
 		static OUTPUT_PLUGIN_TABLE constexpr output_plugin_table{
 			OUTPUT_PLUGIN_TABLE::FLAG_VIDEO | OUTPUT_PLUGIN_TABLE::FLAG_AUDIO, //	フラグ
 			L"Media Foundation 出力",					// プラグインの名前
-			L"MP4 (*.mp4)\0*.mp4\0Advanced Systems Format (*.wmv)\0*.wmv\0",					// 出力ファイルのフィルタ
+			L"MP4 (*.mp4)\0*.mp4\0Advanced Systems Format (*.wmv)\0*.wmv\0MPEG-4 Audio (*.m4a)\0*.m4a\0Windows Media Audio (*.wma)\0*.wma\0YUV4MPEG2 + WAV (*.y4m)\0*.y4m\0WAV (*.wav)\0*.wav\0HLS (*.m3u8)\0*.m3u8\0MPEG-DASH (*.mpd)\0*.mpd\0",					// 出力ファイルのフィルタ
 			L"MFOutput (" __DATE__ ") by MonogoiNoobs",	// プラグインの情報
 			func_output,									// 出力時に呼ばれる関数へのポインタ
 			func_config,									// 出力設定のダイアログを要求された時に呼ばれる関数へのポインタ (nullptrなら呼ばれません)
@@ -78,4 +126,14 @@ extern "C"
 		};
 		return &output_plugin_table;
 	}
+
+	// Loaded as MFOutput.aux2, the plugin registers itself and gets to look at the timeline, which passthrough needs.
+	__declspec(dllexport) auto RegisterPlugin(HOST_APP_TABLE *host) noexcept
+	{
+		host->register_output_plugin(const_cast<OUTPUT_PLUGIN_TABLE *>(GetOutputPluginTable()));
+
+		if (auto const handle{ host->create_edit_handle() })
+			mfop::timeline::attach(*handle);
+		host->register_change_scene_handler([](EDIT_SECTION *section) { mfop::timeline::update(*section); });
+	}
 }
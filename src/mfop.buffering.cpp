@@ -0,0 +1,111 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module mfop.buffering;
+
+import std;
+
+using namespace std;
+
+namespace mfop
+{
+	namespace buffering
+	{
+		auto const constinit min_video_depth{ 2 };
+		auto const constinit default_video_depth{ 8 };
+		auto const constinit max_video_depth{ 64 };
+		auto const constinit window_length{ 32 };
+
+		using milliseconds_t = chrono::duration<double, milli>;
+
+		auto constexpr get_audio_depth(int32_t const &video) noexcept
+		{
+			// Audio blocks are tiny next to frames, so they are allowed to run a little deeper.
+			return clamp(video, 4, 32);
+		}
+
+		depth_controller::depth_controller(uint64_t const &frame_bytes, uint64_t const &memory_budget) noexcept :
+			frame_bytes{ max<uint64_t>(frame_bytes, 1) },
+			max_video{ static_cast<int32_t>(clamp<uint64_t>(memory_budget / max<uint64_t>(frame_bytes, 1), min_video_depth, max_video_depth)) },
+			current_video{ min(default_video_depth, max_video) },
+			window_frames{},
+			window_fetch{},
+			window_consume{},
+			window_peak_fetch{}
+		{
+		}
+
+		depth depth_controller::initial() const
+		{
+			return depth
+			{
+				current_video,
+				get_audio_depth(current_video),
+				format(L"{:.1f} MiB per frame allows up to {} frames", static_cast<double>(frame_bytes) / (1 << 20), max_video)
+			};
+		}
+
+		void depth_controller::record(chrono::nanoseconds const &fetch_time, chrono::nanoseconds const &consume_time) noexcept
+		{
+			++window_frames;
+			window_fetch += fetch_time;
+			window_consume += consume_time;
+			window_peak_fetch = max(window_peak_fetch, fetch_time);
+		}
+
+		optional<depth> depth_controller::update()
+		{
+			if (window_frames < window_length) return nullopt;
+
+			milliseconds_t const mean_fetch{ window_fetch / window_frames };
+			milliseconds_t const mean_consume{ window_consume / window_frames };
+			milliseconds_t const peak_fetch{ window_peak_fetch };
+			auto const stall_ratio{ window_fetch.count() / static_cast<double>(max<int64_t>((window_fetch + window_consume).count(), 1)) };
+
+			window_frames = 0;
+			window_fetch = window_consume = window_peak_fetch = {};
+
+			auto next_video{ current_video };
+			wstring reason{};
+
+			if (stall_ratio > 0.2 && peak_fetch > mean_fetch * 2)
+			{
+				// A burst only stalls us if it outlasts the frames already queued, so queue enough to ride it out.
+				auto const burst_frames{ static_cast<int32_t>(ceil(peak_fetch / max(mean_consume, milliseconds_t{ 0.1 }))) };
+				next_video = current_video + max(burst_frames, 1);
+				reason = L"host rendering is bursty";
+			}
+			else if (stall_ratio > 0.2)
+				reason = L"host rendering is the bottleneck; a deeper queue would not help";
+			else if (stall_ratio < 0.02)
+			{
+				next_video = current_video - max(current_video / 4, 1);
+				reason = L"host keeps up; releasing memory";
+			}
+
+			next_video = clamp(next_video, min_video_depth, max_video);
+			if (next_video == current_video) return nullopt;
+
+			current_video = next_video;
+
+			return depth
+			{
+				current_video,
+				get_audio_depth(current_video),
+				format
+				(
+					L"{}: waited {:.2f} ms per frame (peak {:.2f} ms, {:.0f}% of the time), consumed in {:.2f} ms, memory cap {} frames",
+					reason,
+					mean_fetch.count(),
+					peak_fetch.count(),
+					stall_ratio * 100,
+					mean_consume.count(),
+					max_video
+				)
+			};
+		}
+	}
+}
@@ -0,0 +1,44 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+export module mfop.buffering;
+
+import std;
+
+namespace mfop
+{
+	namespace buffering
+	{
+		export
+		{
+			struct depth
+			{
+				std::int32_t video;
+				std::int32_t audio;
+				std::wstring reason;
+			};
+
+			// Picks how many frames the host should render ahead, from how long we wait on it versus how long we spend per frame.
+			struct depth_controller
+			{
+				depth_controller(std::uint64_t const &frame_bytes, std::uint64_t const &memory_budget) noexcept;
+
+				depth initial() const;
+				void record(std::chrono::nanoseconds const &fetch_time, std::chrono::nanoseconds const &consume_time) noexcept;
+				std::optional<depth> update();
+
+			private:
+				std::uint64_t frame_bytes;
+				std::int32_t max_video;
+				std::int32_t current_video;
+				std::int32_t window_frames;
+				std::chrono::nanoseconds window_fetch;
+				std::chrono::nanoseconds window_consume;
+				std::chrono::nanoseconds window_peak_fetch;
+			};
+		}
+	}
+}
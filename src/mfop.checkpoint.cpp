@@ -0,0 +1,144 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#define STRICT
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+
+module mfop.checkpoint;
+
+import std;
+
+using namespace std;
+
+namespace mfop
+{
+	namespace checkpoint
+	{
+		auto const constinit journal_version{ 2 };
+
+		auto read_string(wchar_t const *key, wchar_t const *path, wchar_t const *section = L"journal")
+		{
+			array<wchar_t, 64> buffer{};
+			GetPrivateProfileStringW(section, key, L"", buffer.data(), static_cast<DWORD>(buffer.size()), path);
+			return wstring{ buffer.data() };
+		}
+
+		auto get_fingerprint_key(int32_t const &index)
+		{
+			return format(L"{:06}", index);
+		}
+
+		auto write_parameters(wchar_t const *path, parameters const &value) noexcept
+		{
+			WritePrivateProfileStringW(L"journal", L"version", to_wstring(journal_version).c_str(), path);
+			WritePrivateProfileStringW(L"journal", L"settings", format(L"{:016x}", value.settings).c_str(), path);
+			WritePrivateProfileStringW(L"journal", L"segmentLength", to_wstring(value.segment_length).c_str(), path);
+			WritePrivateProfileStringW(L"journal", L"frames", to_wstring(value.frame_count).c_str(), path);
+			WritePrivateProfileStringW(L"journal", L"audioSamples", to_wstring(value.audio_sample_count).c_str(), path);
+			WritePrivateProfileStringW(L"journal", L"sealed", L"0", path);
+		}
+
+		auto is_same_export(wchar_t const *path, parameters const &value)
+		{
+			return GetPrivateProfileIntW(L"journal", L"version", 0, path) == journal_version
+				&& read_string(L"settings", path) == format(L"{:016x}", value.settings)
+				&& GetPrivateProfileIntW(L"journal", L"segmentLength", 0, path) == value.segment_length
+				&& GetPrivateProfileIntW(L"journal", L"frames", 0, path) == value.frame_count
+				&& GetPrivateProfileIntW(L"journal", L"audioSamples", 0, path) == value.audio_sample_count;
+		}
+
+		journal::journal(filesystem::path &&directory, parameters const &identity) :
+			directory{ move(directory) },
+			sealed_count{}
+		{
+			error_code ignored{};
+			auto const journal_path{ (this->directory / L"journal.ini").wstring() };
+
+			if (!is_same_export(journal_path.c_str(), identity))
+			{
+				// A journal for other settings or another timeline describes segments that would not fit; start over.
+				filesystem::remove_all(this->directory, ignored);
+				filesystem::create_directories(this->directory, ignored);
+				write_parameters(journal_path.c_str(), identity);
+				return;
+			}
+
+			// The journal is written after the rename, so a segment it counts is complete; one it does not count may not be.
+			// Whether it still shows what the timeline renders is for the caller to check against its fingerprint.
+			auto const recorded{ static_cast<int32_t>(GetPrivateProfileIntW(L"journal", L"sealed", 0, journal_path.c_str())) };
+			while (sealed_count < recorded && filesystem::exists(get_path(sealed_count), ignored))
+				++sealed_count;
+
+			for (auto const &entry : filesystem::directory_iterator{ this->directory, ignored })
+				if (entry.path().native().ends_with(L".partial.mp4"))
+					filesystem::remove(entry.path(), ignored);
+		}
+
+		int32_t journal::get_sealed_count() const noexcept
+		{
+			return sealed_count;
+		}
+
+		filesystem::path journal::get_path(int32_t const &index) const
+		{
+			return directory / format(L"{:06}.mp4", index);
+		}
+
+		filesystem::path journal::get_partial_path(int32_t const &index) const
+		{
+			return directory / format(L"{:06}.partial.mp4", index);
+		}
+
+		bool journal::seal(int32_t const &index, uint64_t const &fingerprint)
+		{
+			error_code error{};
+			filesystem::rename(get_partial_path(index), get_path(index), error);
+			if (error) return false;
+
+			auto const journal_path{ (directory / L"journal.ini").wstring() };
+
+			// Before the count, so that every segment it counts has a fingerprint to be checked against.
+			if (!WritePrivateProfileStringW(L"fingerprints", get_fingerprint_key(index).c_str(), format(L"{:016x}", fingerprint).c_str(), journal_path.c_str())) return false;
+
+			sealed_count = index + 1;
+			return WritePrivateProfileStringW(L"journal", L"sealed", to_wstring(sealed_count).c_str(), journal_path.c_str());
+		}
+
+		optional<uint64_t> journal::get_fingerprint(int32_t const &index) const
+		{
+			auto const text{ read_string(get_fingerprint_key(index).c_str(), (directory / L"journal.ini").c_str(), L"fingerprints") };
+
+			wchar_t *end{};
+			auto const fingerprint{ wcstoull(text.c_str(), &end, 16) };
+			if (text.size() != 16 || end != text.c_str() + text.size()) return nullopt;
+			return fingerprint;
+		}
+
+		void journal::unseal_from(int32_t const &index)
+		{
+			if (index >= sealed_count) return;
+
+			// The count goes first; a crash between the two leaves files it no longer counts, which are overwritten when sealed again.
+			WritePrivateProfileStringW(L"journal", L"sealed", to_wstring(index).c_str(), (directory / L"journal.ini").c_str());
+
+			error_code ignored{};
+			for (auto i{ index }; i < sealed_count; ++i)
+				filesystem::remove(get_path(i), ignored);
+
+			sealed_count = index;
+		}
+
+		void journal::remove() noexcept
+		{
+			error_code ignored{};
+			filesystem::remove_all(directory, ignored);
+		}
+	}
+}
@@ -0,0 +1,46 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+export module mfop.checkpoint;
+
+import std;
+
+namespace mfop
+{
+	namespace checkpoint
+	{
+		export
+		{
+			struct parameters
+			{
+				std::uint64_t settings;
+				std::int32_t segment_length;
+				std::int32_t frame_count;
+				std::int32_t audio_sample_count;
+			};
+
+			// Sealed segments of one export and the journal.ini that says which of them can be trusted.
+			struct journal
+			{
+				journal(std::filesystem::path &&directory, parameters const &identity);
+
+				std::int32_t get_sealed_count() const noexcept;
+				std::filesystem::path get_path(std::int32_t const &index) const;
+				std::filesystem::path get_partial_path(std::int32_t const &index) const;
+				// fingerprint is of the frames sampled from the segment, which a later export renders again before trusting it.
+				bool seal(std::int32_t const &index, std::uint64_t const &fingerprint);
+				std::optional<std::uint64_t> get_fingerprint(std::int32_t const &index) const;
+				// Forgets index and every segment after it, when the timeline no longer renders them as it did.
+				void unseal_from(std::int32_t const &index);
+				void remove() noexcept;
+
+			private:
+				std::filesystem::path directory;
+				std::int32_t sealed_count;
+			};
+		}
+	}
+}
@@ -47,6 +47,68 @@ namespace mfop
 				return to_underlying(audio_bit_rates::kbps_192);
 			if (is_same<Key, is_accelerated>::value)
 				return BST_UNCHECKED;
+			if (is_same<Key, keeps_partial_file>::value)
+				return FALSE;
+			if (is_same<Key, uses_segment_cache>::value)
+				return FALSE;
+			if (is_same<Key, segment_cache_size>::value)
+				return 4096;
+			if (is_same<Key, uses_checkpoints>::value)
+				return FALSE;
+			if (is_same<Key, checkpoint_interval>::value)
+				return 10;
+			if (is_same<Key, output_width>::value)
+				return 0;
+			if (is_same<Key, output_height>::value)
+				return 0;
+			if (is_same<Key, scaling_filter>::value)
+				return 2;
+			if (is_same<Key, output_rate>::value)
+				return 0;
+			if (is_same<Key, output_scale>::value)
+				return 1;
+			if (is_same<Key, exported_streams>::value)
+				return 0;
+			if (is_same<Key, uses_pipe>::value)
+				return FALSE;
+			if (is_same<Key, uses_frame_server>::value)
+				return FALSE;
+			if (is_same<Key, frame_server_slots>::value)
+				return 8;
+			if (is_same<Key, uses_encoder_host>::value)
+				return FALSE;
+			if (is_same<Key, uses_spill>::value)
+				return FALSE;
+			if (is_same<Key, spill_wait>::value)
+				return 100;
+			if (is_same<Key, spill_memory>::value)
+				return 1024;
+			if (is_same<Key, spill_disk>::value)
+				return 4096;
+			if (is_same<Key, cpu_cores>::value)
+				return 0;
+			if (is_same<Key, cpu_percent>::value)
+				return 100;
+			if (is_same<Key, cpu_priority>::value)
+				return 0;
+			if (is_same<Key, pins_cpu>::value)
+				return FALSE;
+			if (is_same<Key, detects_scene_cuts>::value)
+				return FALSE;
+			if (is_same<Key, gop_length>::value)
+				return 0;
+			if (is_same<Key, scene_threshold>::value)
+				return 24;
+			if (is_same<Key, segment_duration>::value)
+				return 6;
+			if (is_same<Key, uses_stream>::value)
+				return FALSE;
+			if (is_same<Key, is_stream_realtime>::value)
+				return TRUE;
+			if (is_same<Key, uses_passthrough>::value)
+				return FALSE;
+			if (is_same<Key, writes_digest>::value)
+				return FALSE;
 
 			if (is_same<Key, is_hevc_preferable>::value)
 				return FALSE;
@@ -63,6 +125,92 @@ namespace mfop
 				return GetPrivateProfileIntW(L"general", L"audioBitRate", get_default<Key>(), configuration_ini_path);
 			if (is_same<Key, is_accelerated>::value)
 				return GetPrivateProfileIntW(L"general", L"useHardware", get_default<Key>(), configuration_ini_path) == BST_CHECKED;
+			if (is_same<Key, keeps_partial_file>::value)
+				return GetPrivateProfileIntW(L"general", L"keepPartialFile", get_default<Key>(), configuration_ini_path) == TRUE;
+			if (is_same<Key, exported_streams>::value)
+				return GetPrivateProfileIntW(L"general", L"streams", get_default<Key>(), configuration_ini_path);
+
+			if (is_same<Key, uses_segment_cache>::value)
+				return GetPrivateProfileIntW(L"cache", L"enabled", get_default<Key>(), configuration_ini_path) == TRUE;
+			if (is_same<Key, segment_cache_size>::value)
+				return GetPrivateProfileIntW(L"cache", L"sizeLimit", get_default<Key>(), configuration_ini_path);
+
+			if (is_same<Key, uses_checkpoints>::value)
+				return GetPrivateProfileIntW(L"checkpoint", L"enabled", get_default<Key>(), configuration_ini_path) == TRUE;
+			if (is_same<Key, checkpoint_interval>::value)
+				return GetPrivateProfileIntW(L"checkpoint", L"interval", get_default<Key>(), configuration_ini_path);
+
+			if (is_same<Key, output_width>::value)
+				return GetPrivateProfileIntW(L"scale", L"width", get_default<Key>(), configuration_ini_path);
+			if (is_same<Key, output_height>::value)
+				return GetPrivateProfileIntW(L"scale", L"height", get_default<Key>(), configuration_ini_path);
+			if (is_same<Key, scaling_filter>::value)
+				return GetPrivateProfileIntW(L"scale", L"filter", get_default<Key>(), configuration_ini_path);
+
+			if (is_same<Key, output_rate>::value)
+				return GetPrivateProfileIntW(L"rate", L"rate", get_default<Key>(), configuration_ini_path);
+			if (is_same<Key, output_scale>::value)
+				return GetPrivateProfileIntW(L"rate", L"scale", get_default<Key>(), configuration_ini_path);
+
+			if (is_same<Key, uses_pipe>::value)
+				return GetPrivateProfileIntW(L"pipe", L"enabled", get_default<Key>(), configuration_ini_path) == TRUE;
+
+			if (is_same<Key, uses_frame_server>::value)
+				return GetPrivateProfileIntW(L"frameServer", L"enabled", get_default<Key>(), configuration_ini_path) == TRUE;
+
+			if (is_same<Key, frame_server_slots>::value)
+				return GetPrivateProfileIntW(L"frameServer", L"slots", get_default<Key>(), configuration_ini_path);
+
+			if (is_same<Key, uses_encoder_host>::value)
+				return GetPrivateProfileIntW(L"host", L"enabled", get_default<Key>(), configuration_ini_path) == TRUE;
+
+			if (is_same<Key, uses_spill>::value)
+				return GetPrivateProfileIntW(L"spill", L"enabled", get_default<Key>(), configuration_ini_path) == TRUE;
+
+			if (is_same<Key, spill_wait>::value)
+				return GetPrivateProfileIntW(L"spill", L"wait", get_default<Key>(), configuration_ini_path);
+
+			if (is_same<Key, spill_memory>::value)
+				return GetPrivateProfileIntW(L"spill", L"memory", get_default<Key>(), configuration_ini_path);
+
+			if (is_same<Key, spill_disk>::value)
+				return GetPrivateProfileIntW(L"spill", L"disk", get_default<Key>(), configuration_ini_path);
+
+			if (is_same<Key, cpu_cores>::value)
+				return GetPrivateProfileIntW(L"cpu", L"cores", get_default<Key>(), configuration_ini_path);
+
+			if (is_same<Key, cpu_percent>::value)
+				return GetPrivateProfileIntW(L"cpu", L"percent", get_default<Key>(), configuration_ini_path);
+
+			if (is_same<Key, cpu_priority>::value)
+				return GetPrivateProfileIntW(L"cpu", L"priority", get_default<Key>(), configuration_ini_path);
+
+			if (is_same<Key, pins_cpu>::value)
+				return GetPrivateProfileIntW(L"cpu", L"pinned", get_default<Key>(), configuration_ini_path) == TRUE;
+
+			if (is_same<Key, detects_scene_cuts>::value)
+				return GetPrivateProfileIntW(L"gop", L"sceneDetection", get_default<Key>(), configuration_ini_path) == TRUE;
+
+			if (is_same<Key, gop_length>::value)
+				return GetPrivateProfileIntW(L"gop", L"maxLength", get_default<Key>(), configuration_ini_path);
+
+			if (is_same<Key, scene_threshold>::value)
+				return GetPrivateProfileIntW(L"gop", L"threshold", get_default<Key>(), configuration_ini_path);
+
+			if (is_same<Key, segment_duration>::value)
+				return GetPrivateProfileIntW(L"package", L"duration", get_default<Key>(), configuration_ini_path);
+
+			if (is_same<Key, uses_stream>::value)
+				return GetPrivateProfileIntW(L"stream", L"enabled", get_default<Key>(), configuration_ini_path) == TRUE;
+
+			if (is_same<Key, is_stream_realtime>::value)
+				return GetPrivateProfileIntW(L"stream", L"realtime", get_default<Key>(), configuration_ini_path) == TRUE;
+
+			if (is_same<Key, uses_passthrough>::value)
+				return GetPrivateProfileIntW(L"passthrough", L"enabled", get_default<Key>(), configuration_ini_path) == TRUE;
+
+			if (is_same<Key, writes_digest>::value)
+				return GetPrivateProfileIntW(L"digest", L"enabled", get_default<Key>(), configuration_ini_path) == TRUE;
 
 			if (is_same<Key, is_hevc_preferable>::value)
 				return GetPrivateProfileIntW(L"mp4", L"videoFormat", get_default<Key>(), configuration_ini_path) == TRUE;
@@ -79,6 +227,92 @@ namespace mfop
 				return WritePrivateProfileStringW(L"general", L"videoQuality", to_wstring(value).c_str(), configuration_ini_path);
 			if (is_same<Key, is_accelerated>::value)
 				return WritePrivateProfileStringW(L"general", L"useHardware", value == BST_CHECKED ? L"1" : L"0", configuration_ini_path);
+			if (is_same<Key, keeps_partial_file>::value)
+				return WritePrivateProfileStringW(L"general", L"keepPartialFile", value ? L"1" : L"0", configuration_ini_path);
+			if (is_same<Key, exported_streams>::value)
+				return WritePrivateProfileStringW(L"general", L"streams", to_wstring(value).c_str(), configuration_ini_path);
+
+			if (is_same<Key, uses_segment_cache>::value)
+				return WritePrivateProfileStringW(L"cache", L"enabled", value ? L"1" : L"0", configuration_ini_path);
+			if (is_same<Key, segment_cache_size>::value)
+				return WritePrivateProfileStringW(L"cache", L"sizeLimit", to_wstring(value).c_str(), configuration_ini_path);
+
+			if (is_same<Key, uses_checkpoints>::value)
+				return WritePrivateProfileStringW(L"checkpoint", L"enabled", value ? L"1" : L"0", configuration_ini_path);
+			if (is_same<Key, checkpoint_interval>::value)
+				return WritePrivateProfileStringW(L"checkpoint", L"interval", to_wstring(value).c_str(), configuration_ini_path);
+
+			if (is_same<Key, output_width>::value)
+				return WritePrivateProfileStringW(L"scale", L"width", to_wstring(value).c_str(), configuration_ini_path);
+			if (is_same<Key, output_height>::value)
+				return WritePrivateProfileStringW(L"scale", L"height", to_wstring(value).c_str(), configuration_ini_path);
+			if (is_same<Key, scaling_filter>::value)
+				return WritePrivateProfileStringW(L"scale", L"filter", to_wstring(value).c_str(), configuration_ini_path);
+
+			if (is_same<Key, output_rate>::value)
+				return WritePrivateProfileStringW(L"rate", L"rate", to_wstring(value).c_str(), configuration_ini_path);
+			if (is_same<Key, output_scale>::value)
+				return WritePrivateProfileStringW(L"rate", L"scale", to_wstring(value).c_str(), configuration_ini_path);
+
+			if (is_same<Key, uses_pipe>::value)
+				return WritePrivateProfileStringW(L"pipe", L"enabled", value ? L"1" : L"0", configuration_ini_path);
+
+			if (is_same<Key, uses_frame_server>::value)
+				return WritePrivateProfileStringW(L"frameServer", L"enabled", value ? L"1" : L"0", configuration_ini_path);
+
+			if (is_same<Key, frame_server_slots>::value)
+				return WritePrivateProfileStringW(L"frameServer", L"slots", to_wstring(value).c_str(), configuration_ini_path);
+
+			if (is_same<Key, uses_encoder_host>::value)
+				return WritePrivateProfileStringW(L"host", L"enabled", value ? L"1" : L"0", configuration_ini_path);
+
+			if (is_same<Key, uses_spill>::value)
+				return WritePrivateProfileStringW(L"spill", L"enabled", value ? L"1" : L"0", configuration_ini_path);
+
+			if (is_same<Key, spill_wait>::value)
+				return WritePrivateProfileStringW(L"spill", L"wait", to_wstring(value).c_str(), configuration_ini_path);
+
+			if (is_same<Key, spill_memory>::value)
+				return WritePrivateProfileStringW(L"spill", L"memory", to_wstring(value).c_str(), configuration_ini_path);
+
+			if (is_same<Key, spill_disk>::value)
+				return WritePrivateProfileStringW(L"spill", L"disk", to_wstring(value).c_str(), configuration_ini_path);
+
+			if (is_same<Key, cpu_cores>::value)
+				return WritePrivateProfileStringW(L"cpu", L"cores", to_wstring(value).c_str(), configuration_ini_path);
+
+			if (is_same<Key, cpu_percent>::value)
+				return WritePrivateProfileStringW(L"cpu", L"percent", to_wstring(value).c_str(), configuration_ini_path);
+
+			if (is_same<Key, cpu_priority>::value)
+				return WritePrivateProfileStringW(L"cpu", L"priority", to_wstring(value).c_str(), configuration_ini_path);
+
+			if (is_same<Key, pins_cpu>::value)
+				return WritePrivateProfileStringW(L"cpu", L"pinned", value ? L"1" : L"0", configuration_ini_path);
+
+			if (is_same<Key, detects_scene_cuts>::value)
+				return WritePrivateProfileStringW(L"gop", L"sceneDetection", value ? L"1" : L"0", configuration_ini_path);
+
+			if (is_same<Key, gop_length>::value)
+				return WritePrivateProfileStringW(L"gop", L"maxLength", to_wstring(value).c_str(), configuration_ini_path);
+
+			if (is_same<Key, scene_threshold>::value)
+				return WritePrivateProfileStringW(L"gop", L"threshold", to_wstring(value).c_str(), configuration_ini_path);
+
+			if (is_same<Key, segment_duration>::value)
+				return WritePrivateProfileStringW(L"package", L"duration", to_wstring(value).c_str(), configuration_ini_path);
+
+			if (is_same<Key, uses_stream>::value)
+				return WritePrivateProfileStringW(L"stream", L"enabled", value ? L"1" : L"0", configuration_ini_path);
+
+			if (is_same<Key, is_stream_realtime>::value)
+				return WritePrivateProfileStringW(L"stream", L"realtime", value ? L"1" : L"0", configuration_ini_path);
+
+			if (is_same<Key, uses_passthrough>::value)
+				return WritePrivateProfileStringW(L"passthrough", L"enabled", value ? L"1" : L"0", configuration_ini_path);
+
+			if (is_same<Key, writes_digest>::value)
+				return WritePrivateProfileStringW(L"digest", L"enabled", value ? L"1" : L"0", configuration_ini_path);
 
 			if (is_same<Key, is_hevc_preferable>::value)
 				return WritePrivateProfileStringW(L"mp4", L"videoFormat", to_wstring(value).c_str(), configuration_ini_path);
@@ -86,6 +320,126 @@ namespace mfop
 			unreachable();
 		}
 
+		// Keys without a dialog control are only read by the output path, so they have to be instantiated here.
+		template underlying_type<keeps_partial_file>::type get<keeps_partial_file>() noexcept;
+		template bool set<keeps_partial_file>(int32_t &&value) noexcept;
+		template underlying_type<uses_segment_cache>::type get<uses_segment_cache>() noexcept;
+		template bool set<uses_segment_cache>(int32_t &&value) noexcept;
+		template underlying_type<segment_cache_size>::type get<segment_cache_size>() noexcept;
+		template bool set<segment_cache_size>(int32_t &&value) noexcept;
+		template underlying_type<uses_checkpoints>::type get<uses_checkpoints>() noexcept;
+		template bool set<uses_checkpoints>(int32_t &&value) noexcept;
+		template underlying_type<checkpoint_interval>::type get<checkpoint_interval>() noexcept;
+		template bool set<checkpoint_interval>(int32_t &&value) noexcept;
+		template underlying_type<output_width>::type get<output_width>() noexcept;
+		template bool set<output_width>(int32_t &&value) noexcept;
+		template underlying_type<output_height>::type get<output_height>() noexcept;
+		template bool set<output_height>(int32_t &&value) noexcept;
+		template underlying_type<scaling_filter>::type get<scaling_filter>() noexcept;
+		template bool set<scaling_filter>(int32_t &&value) noexcept;
+		template underlying_type<output_rate>::type get<output_rate>() noexcept;
+		template bool set<output_rate>(int32_t &&value) noexcept;
+		template underlying_type<output_scale>::type get<output_scale>() noexcept;
+		template bool set<output_scale>(int32_t &&value) noexcept;
+		template underlying_type<exported_streams>::type get<exported_streams>() noexcept;
+		template bool set<exported_streams>(int32_t &&value) noexcept;
+		template underlying_type<uses_pipe>::type get<uses_pipe>() noexcept;
+		template bool set<uses_pipe>(int32_t &&value) noexcept;
+		template underlying_type<uses_frame_server>::type get<uses_frame_server>() noexcept;
+		template bool set<uses_frame_server>(int32_t &&value) noexcept;
+		template underlying_type<frame_server_slots>::type get<frame_server_slots>() noexcept;
+		template bool set<frame_server_slots>(int32_t &&value) noexcept;
+		template underlying_type<uses_encoder_host>::type get<uses_encoder_host>() noexcept;
+		template bool set<uses_encoder_host>(int32_t &&value) noexcept;
+		template underlying_type<uses_spill>::type get<uses_spill>() noexcept;
+		template bool set<uses_spill>(int32_t &&value) noexcept;
+		template underlying_type<spill_wait>::type get<spill_wait>() noexcept;
+		template bool set<spill_wait>(int32_t &&value) noexcept;
+		template underlying_type<spill_memory>::type get<spill_memory>() noexcept;
+		template bool set<spill_memory>(int32_t &&value) noexcept;
+		template underlying_type<spill_disk>::type get<spill_disk>() noexcept;
+		template bool set<spill_disk>(int32_t &&value) noexcept;
+		template underlying_type<cpu_cores>::type get<cpu_cores>() noexcept;
+		template bool set<cpu_cores>(int32_t &&value) noexcept;
+		template underlying_type<cpu_percent>::type get<cpu_percent>() noexcept;
+		template bool set<cpu_percent>(int32_t &&value) noexcept;
+		template underlying_type<cpu_priority>::type get<cpu_priority>() noexcept;
+		template bool set<cpu_priority>(int32_t &&value) noexcept;
+		template underlying_type<pins_cpu>::type get<pins_cpu>() noexcept;
+		template bool set<pins_cpu>(int32_t &&value) noexcept;
+		template underlying_type<detects_scene_cuts>::type get<detects_scene_cuts>() noexcept;
+		template bool set<detects_scene_cuts>(int32_t &&value) noexcept;
+		template underlying_type<gop_length>::type get<gop_length>() noexcept;
+		template bool set<gop_length>(int32_t &&value) noexcept;
+		template underlying_type<scene_threshold>::type get<scene_threshold>() noexcept;
+		template bool set<scene_threshold>(int32_t &&value) noexcept;
+		template underlying_type<segment_duration>::type get<segment_duration>() noexcept;
+		template bool set<segment_duration>(int32_t &&value) noexcept;
+		template underlying_type<uses_stream>::type get<uses_stream>() noexcept;
+		template bool set<uses_stream>(int32_t &&value) noexcept;
+		template underlying_type<is_stream_realtime>::type get<is_stream_realtime>() noexcept;
+		template bool set<is_stream_realtime>(int32_t &&value) noexcept;
+		template underlying_type<uses_passthrough>::type get<uses_passthrough>() noexcept;
+		template bool set<uses_passthrough>(int32_t &&value) noexcept;
+		template underlying_type<writes_digest>::type get<writes_digest>() noexcept;
+		template bool set<writes_digest>(int32_t &&value) noexcept;
+
+		vector<extra_output> get_extra_outputs() noexcept
+		{
+			static auto const constinit max_outputs{ 4 };
+
+			vector<extra_output> outputs{};
+
+			for (auto i{ 2 }; i <= max_outputs; ++i)
+			{
+				auto const section{ format(L"output{}", i) };
+
+				array<wchar_t, MAX_PATH> suffix{}, extension{};
+				GetPrivateProfileStringW(section.c_str(), L"suffix", L"", suffix.data(), static_cast<DWORD>(suffix.size()), configuration_ini_path);
+				if (!suffix.front()) continue;
+				GetPrivateProfileStringW(section.c_str(), L"extension", L"", extension.data(), static_cast<DWORD>(extension.size()), configuration_ini_path);
+
+				// Anything left out follows the main output.
+				outputs.push_back(extra_output
+				{
+					suffix.data(),
+					extension.data(),
+					GetPrivateProfileIntW(section.c_str(), L"videoQuality", get<video_quality>(), configuration_ini_path),
+					GetPrivateProfileIntW(section.c_str(), L"audioBitRate", get<audio_bit_rate>(), configuration_ini_path),
+					GetPrivateProfileIntW(section.c_str(), L"videoFormat", get<is_hevc_preferable>(), configuration_ini_path) == TRUE,
+					GetPrivateProfileIntW(section.c_str(), L"useHardware", get<is_accelerated>(), configuration_ini_path) == BST_CHECKED
+				});
+			}
+
+			return outputs;
+		}
+
+		wstring get_pipe_command() noexcept
+		{
+			array<wchar_t, 4096> command{};
+			GetPrivateProfileStringW(L"pipe", L"command", L"", command.data(), static_cast<DWORD>(command.size()), configuration_ini_path);
+			return command.data();
+		}
+
+		wstring get_frame_server_name() noexcept
+		{
+			array<wchar_t, MAX_PATH> name{};
+			GetPrivateProfileStringW(L"frameServer", L"name", L"MFOutput", name.data(), static_cast<DWORD>(name.size()), configuration_ini_path);
+			return name.data();
+		}
+
+		wstring get_stream_address() noexcept
+		{
+			array<wchar_t, 1024> address{};
+			GetPrivateProfileStringW(L"stream", L"address", L"udp://127.0.0.1:1234", address.data(), static_cast<DWORD>(address.size()), configuration_ini_path);
+			return address.data();
+		}
+
+		filesystem::path get_data_path(wstring_view file_name) noexcept
+		{
+			return filesystem::path{ configuration_ini_path }.replace_filename(file_name);
+		}
+
 		auto on_init_dialog(HWND dialog, HWND, intptr_t) noexcept
 		{
 			ComboBox_AddString(GetDlgItem(dialog, IDC_COMBO2), L"H.264");
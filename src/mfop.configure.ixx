@@ -27,9 +27,62 @@ namespace mfop
 			enum struct audio_bit_rate : std::uint32_t {};
 			enum struct is_hevc_preferable : bool {};
 			enum struct is_accelerated : bool {};
+			enum struct keeps_partial_file : bool {};
+			enum struct uses_segment_cache : bool {};
+			enum struct segment_cache_size : std::uint32_t {};
+			enum struct uses_checkpoints : bool {};
+			enum struct checkpoint_interval : std::uint32_t {};
+			enum struct output_width : std::uint32_t {};
+			enum struct output_height : std::uint32_t {};
+			enum struct scaling_filter : std::uint32_t {};
+			enum struct output_rate : std::uint32_t {};
+			enum struct output_scale : std::uint32_t {};
+			enum struct exported_streams : std::uint32_t {};
+			enum struct uses_pipe : bool {};
+			enum struct uses_frame_server : bool {};
+			enum struct frame_server_slots : std::uint32_t {};
+			enum struct uses_encoder_host : bool {};
+			enum struct uses_spill : bool {};
+			enum struct spill_wait : std::uint32_t {};
+			enum struct spill_memory : std::uint32_t {};
+			enum struct spill_disk : std::uint32_t {};
+			enum struct cpu_cores : std::uint32_t {};
+			enum struct cpu_percent : std::uint32_t {};
+			enum struct cpu_priority : std::uint32_t {};
+			enum struct pins_cpu : bool {};
+			enum struct detects_scene_cuts : bool {};
+			enum struct gop_length : std::uint32_t {};
+			enum struct scene_threshold : std::uint32_t {};
+			enum struct segment_duration : std::uint32_t {};
+			enum struct uses_stream : bool {};
+			enum struct is_stream_realtime : bool {};
+			enum struct uses_passthrough : bool {};
+			enum struct writes_digest : bool {};
 
 			template<typename Key> std::underlying_type<Key>::type get() noexcept;
 			template<typename Key> bool set(std::int32_t &&value) noexcept;
+
+			struct extra_output
+			{
+				std::wstring suffix;
+				std::wstring extension;
+				std::uint32_t video_quality;
+				std::uint32_t audio_bit_rate;
+				bool is_hevc_preferable;
+				bool is_accelerated;
+			};
+
+			// [output2] to [output4] in the ini; each one is written next to the main output with its suffix appended.
+			std::vector<extra_output> get_extra_outputs() noexcept;
+
+			// [pipe] command; a string, so it does not fit get().
+			std::wstring get_pipe_command() noexcept;
+			// [frameServer] name; the mapping is created as Local\<name>.
+			std::wstring get_frame_server_name() noexcept;
+			// [stream] address, such as udp://127.0.0.1:1234 or tcp://[::1]:5000.
+			std::wstring get_stream_address() noexcept;
+
+			std::filesystem::path get_data_path(std::wstring_view file_name) noexcept;
 		}
 	}
 }
@@ -16,14 +16,17 @@ module;
 #include <mfapi.h>
 #include <mfreadwrite.h>
 #include <codecapi.h>
+#include <strmif.h>
 #include <wmcodecdsp.h>
+#include <Shlwapi.h>
+#include <Psapi.h>
 #include "aviutl2_sdk/output2.h"
 #include "aviutl2_sdk/logger2.h"
 
 #pragma comment(lib, "Mfplat")
+#pragma comment(lib, "Shlwapi")
 #pragma comment(lib, "Mfreadwrite")
 #pragma comment(lib, "Mfuuid")
-#pragma comment(lib, "d3d11")
 #pragma comment(lib, "d3d12")
 
 #pragma warning(default: 4557 5266)
@@ -33,6 +36,30 @@ module;
 module mfop.core;
 
 import std;
+import mfop.session;
+import mfop.probe;
+import mfop.buffering;
+import mfop.spill;
+import mfop.schedule;
+import mfop.scene;
+import mfop.frame;
+import mfop.timebase;
+import mfop.hash;
+import mfop.segment;
+import mfop.checkpoint;
+import mfop.scale;
+import mfop.raw;
+import mfop.pipe;
+import mfop.ring;
+import mfop.protocol;
+import mfop.package;
+import mfop.stream;
+import mfop.transport;
+import mfop.network;
+import mfop.remux;
+import mfop.timeline;
+import mfop.digest;
+import mfop.configure;
 
 using namespace std;
 using namespace wil;
@@ -42,6 +69,8 @@ static LOG_HANDLE *aviutl_logger;
 namespace mfop
 {
 	auto const constinit audio_bits_per_sample{ 16 };
+	auto const constinit prefetch_budget{ 256u << 20 };
+	auto const constinit max_prefetch_frames{ 8u };
 
 	using nv12_ptr = unique_ptr<uint8_t[]>;
 	using resolution_t = pair<int32_t const, int32_t const>;
@@ -50,6 +79,95 @@ namespace mfop
 	using IMFMediaTypes = pair<com_ptr_nothrow<IMFMediaType>, com_ptr_nothrow<IMFMediaType>>;
 	using sink_writer_with_indices_t = pair<com_ptr_nothrow<IMFSinkWriter>, stream_indices_t const>;
 
+	enum struct stream_selection : uint32_t
+	{
+		both,
+		video_only,
+		audio_only
+	};
+
+	struct encoding_plan
+	{
+		GUID input_video_format;
+		bool is_accelerated;
+		int32_t width;
+		int32_t height;
+		int32_t rate;
+		int32_t scale;
+		int32_t frame_count;
+		bool has_audio;
+		shared_ptr<scale::frame_scaler const> scaler;
+		// What the export may take from the machine, and the worker threads each of its encoders is told to use out of that.
+		schedule::cpu_budget budget;
+		uint32_t encoder_thread_count;
+	};
+
+	struct prefetched_samples
+	{
+		vector<com_ptr_nothrow<IMFMediaBuffer>> video;
+		com_ptr_nothrow<IMFMediaBuffer> audio;
+		int64_t audio_duration;
+		// One for each video buffer, only when scene cuts are looked for.
+		vector<scene::thumbnail> thumbnails;
+	};
+
+	struct keyframe_control
+	{
+		optional<scene::gop_planner> planner;
+		// Null when only the sample can be marked; the encoder is then trusted to honour that alone.
+		com_ptr_nothrow<ICodecAPI> encoder;
+	};
+
+	struct finalization_registry
+	{
+		mutex lock;
+		set<wstring> paths;
+		// A finalizer still runs plugin code after it takes its path off, destroying what it owned, so it is joined rather than waited for.
+		list<pair<wstring, jthread>> threads;
+	};
+
+	static finalization_registry pending_finalizations{};
+
+	// Filled by make_output_byte_stream; the writer owns the file, so one that is released before it is finalized takes its handle with it.
+	struct digest_registry
+	{
+		mutex lock;
+		map<wstring, weak_ptr<digest::digest_file>> files;
+	};
+
+	static digest_registry pending_digests{};
+
+	struct probe_trial
+	{
+		wstring encoder;
+		bool is_hardware;
+		uint32_t profile;
+		double init_milliseconds;
+	};
+
+	struct fanout_sample
+	{
+		DWORD index;
+		com_ptr_nothrow<IMFMediaBuffer> buffer;
+		int64_t time;
+		int64_t duration;
+		bool is_keyframe;
+	};
+
+	struct fanout_sink
+	{
+		wstring path;
+		encoding_plan plan;
+		IMFMediaTypes input_media_types;
+		com_ptr_nothrow<IMFSinkWriter> sink_writer;
+		DWORD video_index;
+		DWORD audio_index;
+		unique_ptr<spill::queue<fanout_sample>> queue;
+		future<HRESULT> writer;
+		chrono::nanoseconds blocked_time;
+		com_ptr_nothrow<ICodecAPI> keyframe_encoder;
+	};
+
 	auto yuy2_to_nv12(uint8_t const yuy2[], resolution_t &&resolution)
 	{
 		__assume(resolution.first % 2 == 0 && resolution.second % 2 == 0);
@@ -86,22 +204,34 @@ namespace mfop
 		return is_accelerated ? MFVideoFormat_NV12 : MFVideoFormat_YUY2;
 	}
 
-	auto get_average_time_per_frame(IMFMediaType &media_type) noexcept
+	auto get_video_clock(IMFMediaType &media_type) noexcept
 	{
 		uint32_t rate{}, scale{};
 		MFGetAttributeRatio(&media_type, MF_MT_FRAME_RATE, &rate, &scale);
-		uint64_t result{};
-		MFFrameRateToAverageTimePerFrame(rate, scale, &result);
-		return result;
+		return timebase::clock{ rate, scale };
 	}
 
 	auto get_suitable_output_video_format_guid(filesystem::path &&extension, bool const &is_hevc_preferable) noexcept
 	{
 		if (extension == L".mp4") return is_hevc_preferable ? MFVideoFormat_HEVC : MFVideoFormat_H264;
-		if (extension == L".wmv") return MFVideoFormat_WVC1;
+		if (extension == L".wmv" || extension == L".wma") return MFVideoFormat_WVC1;
 		return MFVideoFormat_H264;
 	}
 
+	auto get_stream_selection(OUTPUT_INFO const &oip, output_configuration const &configuration) noexcept
+	{
+		// A project without sound or without a picture leaves nothing for that stream to encode.
+		if (!(oip.flag & OUTPUT_INFO::FLAG_VIDEO)) return stream_selection::audio_only;
+		if (!(oip.flag & OUTPUT_INFO::FLAG_AUDIO)) return stream_selection::video_only;
+		return static_cast<stream_selection>(clamp<uint32_t>(configuration.exported_streams, 0, to_underlying(stream_selection::audio_only)));
+	}
+
+	auto get_stream_selection(OUTPUT_INFO const &oip, output_configuration const &configuration, filesystem::path const &extension) noexcept
+	{
+		if (extension == L".m4a" || extension == L".wma" || extension == L".wav") return stream_selection::audio_only;
+		return get_stream_selection(oip, configuration);
+	}
+
 	auto add_windows_media_qvba_activation_media_attributes(IMFAttributes &attributes, uint32_t const &quality) noexcept
 	{
 		attributes.SetUINT32(MFPKEY_VBRENABLED.fmtid, true);
@@ -136,13 +266,11 @@ namespace mfop
 		}
 	}
 
-	auto make_input_video_media_type(resolution_t &&resolution, fps_t &&fps, bool const &is_accelerated) noexcept
+	auto make_input_video_media_type(resolution_t &&resolution, fps_t &&fps, GUID const &video_format, bool const &is_accelerated) noexcept
 	{
 		auto const [width, height] { resolution };
 		auto const [rate, scale] { fps };
 
-		auto const video_format{ get_suitable_input_video_format_guid(is_accelerated) };
-
 		uint32_t image_size{};
 		MFCalculateImageSize(video_format, width, height, &image_size);
 
@@ -187,86 +315,69 @@ namespace mfop
 		return input_audio_media_type;
 	}
 
-	auto make_input_media_types(OUTPUT_INFO const &oip, GUID const &output_video_format, bool const &is_accelerated) noexcept
+	auto make_input_media_types(OUTPUT_INFO const &oip, GUID const &output_video_format, encoding_plan const &plan) noexcept
 	{
 		return IMFMediaTypes
 		{
-			make_input_video_media_type({ oip.w, oip.h }, { oip.rate, oip.scale }, is_accelerated),
-			make_input_audio_media_type(oip.audio_ch, oip.audio_rate, output_video_format)
+			make_input_video_media_type({ plan.width, plan.height }, { plan.rate, plan.scale }, plan.input_video_format, plan.is_accelerated),
+			plan.has_audio ? make_input_audio_media_type(oip.audio_ch, oip.audio_rate, output_video_format) : nullptr
 		};
 	}
 
-	auto write_sample_to_sink_writer(IMFSinkWriter &sink_writer, DWORD const &index, IMFMediaBuffer &buffer, int64_t const &time, int64_t const &duration) noexcept
+	auto write_sample_to_sink_writer(IMFSinkWriter &sink_writer, DWORD const &index, IMFMediaBuffer &buffer, int64_t const &time, int64_t const &duration, bool const &is_keyframe = false, ICodecAPI *const encoder = nullptr) noexcept
 	{
 		auto sample{ com_ptr_nothrow<IMFSample>{} };
 		MFCreateSample(out_ptr(sample));
 		sample->AddBuffer(&buffer);
 		sample->SetSampleTime(time);
 		sample->SetSampleDuration(duration);
-		return sink_writer.WriteSample(index, sample.get());
-	}
 
-	expected<com_ptr_nothrow<IMFDXGIDeviceManager>, error> make_dxgi_device_manager() noexcept
-	{
-		static auto const constinit d3d_feature_levels{ to_array(
+		if (is_keyframe)
 		{
-			D3D_FEATURE_LEVEL_11_1,
-			D3D_FEATURE_LEVEL_11_0,
-			D3D_FEATURE_LEVEL_10_1,
-			D3D_FEATURE_LEVEL_10_0,
-			D3D_FEATURE_LEVEL_9_3,
-			D3D_FEATURE_LEVEL_9_2,
-			D3D_FEATURE_LEVEL_9_1
-		}) };
-
-		aviutl_logger->info(aviutl_logger, L"Preparing DirectX Video Acceleration...");
-		com_ptr_nothrow<ID3D11Device> directx_device{};
-
-		UNEXPECT_IF_FAILED(D3D11CreateDevice
-		(
-			nullptr,
-			D3D_DRIVER_TYPE_HARDWARE,
-			nullptr,
-			D3D11_CREATE_DEVICE_VIDEO_SUPPORT,
-			d3d_feature_levels.data(),
-			static_cast<uint32_t>(d3d_feature_levels.size()),
-			D3D11_SDK_VERSION,
-			&directx_device,
-			nullptr,
-			nullptr
-		));
+			sample->SetUINT32(MFSampleExtension_VideoEncodePictureType, eAVEncH264PictureType_IDR);
 
-		com_ptr_nothrow<IMFDXGIDeviceManager> dxgi_device_manager{};
-		uint32_t reset_token{};
-		MFCreateDXGIDeviceManager(&reset_token, out_ptr(dxgi_device_manager));
-		UNEXPECT_IF_FAILED(dxgi_device_manager->ResetDevice(directx_device.get(), reset_token));
+			// Applies to the next frame the encoder takes in, which for a synchronous one is the frame about to be written.
+			if (encoder)
+			{
+				VARIANT value{};
+				value.vt = VT_UI4;
+				value.ulVal = 1;
+				encoder->SetValue(&CODECAPI_AVEncVideoForceKeyFrame, &value);
+			}
+		}
 
-		return dxgi_device_manager;
+		return sink_writer.WriteSample(index, sample.get());
 	}
 
-	expected<com_ptr_nothrow<IMFSinkWriter>, error> make_sink_writer(wstring_view output_name, IMFAttributes &media_type, GUID const &output_video_format) noexcept
+	expected<com_ptr_nothrow<IMFSinkWriter>, error> make_sink_writer(wstring_view output_name, IMFAttributes &media_type, GUID const &output_video_format, bool const &is_throttled = false, IMFByteStream *const byte_stream = nullptr, GUID const &container_type = GUID_NULL) noexcept
 	{
 		auto sink_writer_attributes{ com_ptr_nothrow<IMFAttributes>{} };
 		MFCreateAttributes(out_ptr(sink_writer_attributes), 3);
 
-		sink_writer_attributes->SetUINT32(MF_SINK_WRITER_DISABLE_THROTTLING, true);
+		sink_writer_attributes->SetUINT32(MF_SINK_WRITER_DISABLE_THROTTLING, !is_throttled);
 
-		if (output_video_format == MFVideoFormat_H264)
+		if (container_type != GUID_NULL)
+			sink_writer_attributes->SetGUID(MF_TRANSCODE_CONTAINERTYPE, container_type);
+		else if (output_video_format == MFVideoFormat_H264)
 		{
 			sink_writer_attributes->SetGUID(MF_TRANSCODE_CONTAINERTYPE, MFTranscodeContainerType_FMPEG4);
 			sink_writer_attributes->SetUINT32(MF_MPEG4SINK_MOOV_BEFORE_MDAT, true);
 		}
+		else if (byte_stream)
+			// There is no extension to go by then, so the container the URL would have chosen is named.
+			sink_writer_attributes->SetGUID(MF_TRANSCODE_CONTAINERTYPE, output_video_format == MFVideoFormat_WVC1 ? MFTranscodeContainerType_ASF : MFTranscodeContainerType_MPEG4);
 
 		uint32_t d3d_resource_version{};
 		if (SUCCEEDED(media_type.GetUINT32(MF_MT_D3D_RESOURCE_VERSION, &d3d_resource_version)))
-			if (auto const d3d_manager{ make_dxgi_device_manager() })
+			if (auto const d3d_manager{ session::get_dxgi_device_manager(*aviutl_logger) })
 			{
 				sink_writer_attributes->SetUINT32(MF_READWRITE_ENABLE_HARDWARE_TRANSFORMS, true);
 				sink_writer_attributes->SetUnknown(MF_SINK_WRITER_D3D_MANAGER, d3d_manager->get());
 			}
 
 		auto sink_writer{ com_ptr_nothrow<IMFSinkWriter>{} };
-		UNEXPECT_IF_FAILED(MFCreateSinkWriterFromURL(output_name.data(), nullptr, sink_writer_attributes.get(), out_ptr(sink_writer)));
+		// Given a byte stream, the container comes from the attributes alone.
+		UNEXPECT_IF_FAILED(MFCreateSinkWriterFromURL(byte_stream ? nullptr : output_name.data(), byte_stream, sink_writer_attributes.get(), out_ptr(sink_writer)));
 
 		return sink_writer;
 	}
@@ -329,7 +440,7 @@ namespace mfop
 		return audio_index;
 	}
 
-	expected<HRESULT, error> configure_video_input(IMFSinkWriter &sink_writer, DWORD const &index, uint32_t const &quality, GUID const &output_video_format, IMFMediaType &input_media_type) noexcept
+	expected<HRESULT, error> configure_video_input(IMFSinkWriter &sink_writer, DWORD const &index, uint32_t const &quality, GUID const &output_video_format, IMFMediaType &input_media_type, uint32_t const &thread_count, uint32_t const &gop_size) noexcept
 	{
 		__assume(quality <= 100);
 
@@ -346,7 +457,8 @@ namespace mfop
 			encoder_attributes->SetUINT32(CODECAPI_AVEncMPVDefaultBPictureCount, 2);
 			encoder_attributes->SetUINT32(CODECAPI_AVEncCommonRateControlMode, eAVEncCommonRateControlMode_Quality);
 			encoder_attributes->SetUINT32(CODECAPI_AVEncCommonQuality, quality);
-			encoder_attributes->SetUINT32(CODECAPI_AVEncNumWorkerThreads, 0);
+			encoder_attributes->SetUINT32(CODECAPI_AVEncNumWorkerThreads, thread_count);
+			if (gop_size) encoder_attributes->SetUINT32(CODECAPI_AVEncMPVGOPSize, gop_size);
 			break;
 		case FCC('WVC1'):
 			encoder_attributes->SetUINT32(MFPKEY_COMPRESSIONOPTIMIZATIONTYPE.fmtid, 1);
@@ -374,11 +486,12 @@ namespace mfop
 		return S_OK;
 	}
 
-	expected<DWORD, error> configure_video_stream(IMFSinkWriter &sink_writer, uint32_t const &quality, IMFMediaType &input_media_type, GUID const &output_video_format) noexcept
+	// thread_count is the encoder's share of the export's budget, and gop_size its [video] gopLength unless the caller needs keyframes of its own; 0 leaves either to the encoder.
+	expected<DWORD, error> configure_video_stream(IMFSinkWriter &sink_writer, uint32_t const &quality, IMFMediaType &input_media_type, GUID const &output_video_format, uint32_t const &thread_count, uint32_t const &gop_size) noexcept
 	{
 		auto const index{ configure_video_output(sink_writer, input_media_type, output_video_format) };
 		if (!index) [[unlikely]] return unexpected{ index.error() };
-		auto const result{ configure_video_input(sink_writer, *index, quality, output_video_format, input_media_type) };
+		auto const result{ configure_video_input(sink_writer, *index, quality, output_video_format, input_media_type, thread_count, gop_size) };
 		if (!result) [[unlikely]] return unexpected{ result.error() };
 		return *index;
 	}
@@ -392,22 +505,24 @@ namespace mfop
 		return *index;
 	}
 
-	expected<stream_indices_t, error> configure_streams(IMFSinkWriter &sink_writer, uint32_t const &quality, uint32_t const &output_bit_rate, IMFMediaTypes const &input_media_types, GUID const &output_video_format) noexcept
+	expected<stream_indices_t, error> configure_streams(IMFSinkWriter &sink_writer, uint32_t const &quality, uint32_t const &output_bit_rate, IMFMediaTypes const &input_media_types, GUID const &output_video_format, uint32_t const &thread_count, uint32_t const &gop_size) noexcept
 	{
-		auto const video_index{ configure_video_stream(sink_writer, quality, *input_media_types.first, output_video_format) };
+		auto const video_index{ configure_video_stream(sink_writer, quality, *input_media_types.first, output_video_format, thread_count, gop_size) };
 		if (!video_index) [[unlikely]] return unexpected{ video_index.error() };
 
+		if (!input_media_types.second) return stream_indices_t{ move(*video_index), MF_SINK_WRITER_INVALID_STREAM_INDEX };
+
 		auto const audio_index{ configure_audio_stream(sink_writer, output_bit_rate, quality, *input_media_types.second, output_video_format) };
 		if (!audio_index) [[unlikely]] return unexpected{ audio_index.error() };
 
 		return stream_indices_t{ move(*video_index), move(*audio_index) };
 	}
 
-	expected<sink_writer_with_indices_t, error> make_initialized_sink_writer(OUTPUT_INFO const &oip, GUID const &output_video_format, uint32_t const &video_quality, uint32_t const &audio_bit_rate, IMFMediaTypes const &media_types) noexcept
+	expected<sink_writer_with_indices_t, error> make_initialized_sink_writer(wstring_view output_name, GUID const &output_video_format, uint32_t const &video_quality, uint32_t const &audio_bit_rate, IMFMediaTypes const &media_types, uint32_t const &thread_count, uint32_t const &gop_size, bool const &is_throttled = false, IMFByteStream *const byte_stream = nullptr, GUID const &container_type = GUID_NULL) noexcept
 	{
-		auto const sink_writer{ make_sink_writer(oip.savefile, *media_types.first, output_video_format) };
+		auto const sink_writer{ make_sink_writer(output_name, *media_types.first, output_video_format, is_throttled, byte_stream, container_type) };
 		if (!sink_writer) [[unlikely]] return unexpected{ sink_writer.error() };
-		auto const indices{ configure_streams(**sink_writer, video_quality, audio_bit_rate, media_types, output_video_format) };
+		auto const indices{ configure_streams(**sink_writer, video_quality, audio_bit_rate, media_types, output_video_format, thread_count, gop_size) };
 		if (!indices) [[unlikely]] return unexpected{ indices.error() };
 
 		UNEXPECT_IF_FAILED((*sink_writer)->BeginWriting());
@@ -415,15 +530,350 @@ namespace mfop
 		return sink_writer_with_indices_t{ move(*sink_writer), move(*indices) };
 	}
 
-	auto write_video_sample(OUTPUT_INFO const &oip, IMFSinkWriter &sink_writer, int32_t const &f, DWORD const &index, IMFMediaType &input_media_type, bool const &is_accelerated, int64_t const &time_stamp) noexcept
+	auto enumerate_video_encoders(GUID const &output_video_format, bool const &is_accelerated) noexcept
 	{
-		if (oip.func_is_abort()) return E_ABORT;
+		MFT_REGISTER_TYPE_INFO const output_type{ MFMediaType_Video, output_video_format };
+
+		IMFActivate **activates{};
+		uint32_t activate_count{};
+		MFTEnumEx(MFT_CATEGORY_VIDEO_ENCODER, (is_accelerated ? MFT_ENUM_FLAG_HARDWARE : MFT_ENUM_FLAG_SYNCMFT | MFT_ENUM_FLAG_ASYNCMFT) | MFT_ENUM_FLAG_SORTANDFILTER, nullptr, &output_type, &activates, &activate_count);
+
+		wstring names{};
+		for (auto const &activate : span{ activates, activate_count })
+		{
+			unique_cotaskmem_string name{};
+			uint32_t length{};
+			if (SUCCEEDED(activate->GetAllocatedString(MFT_FRIENDLY_NAME_Attribute, name.put(), &length)))
+				names += (names.empty() ? L"" : L"|") + wstring{ name.get() };
+			activate->Release();
+		}
+		CoTaskMemFree(activates);
+
+		return names;
+	}
 
-		oip.func_rest_time_disp(f, oip.n);
+	// The encoder MFT the writer put on the stream, or null when it cannot tell.
+	auto get_video_encoder_transform(IMFSinkWriter &sink_writer, DWORD const &index) noexcept
+	{
+		auto const sink_writer_ex{ com_ptr_nothrow<IMFSinkWriter>{ &sink_writer }.try_query<IMFSinkWriterEx>() };
+		if (!sink_writer_ex) return com_ptr_nothrow<IMFTransform>{};
 
-		auto const frame_image{ static_cast<uint8_t *>(oip.func_get_video(f, FCC('YUY2'))) };
+		GUID category{};
+		com_ptr_nothrow<IMFTransform> transform{};
+		for (DWORD i{}; SUCCEEDED(sink_writer_ex->GetTransformForStream(index, i, &category, transform.put())); ++i)
+			if (category == MFT_CATEGORY_VIDEO_ENCODER) return transform;
 
-		com_ptr_nothrow<IMFMediaBuffer> video_buffer{};
+		return com_ptr_nothrow<IMFTransform>{};
+	}
+
+	auto find_video_encoder(IMFSinkWriter &sink_writer, DWORD const &index) noexcept
+	{
+		auto result{ pair<wstring, bool>{} };
+
+		auto const transform{ get_video_encoder_transform(sink_writer, index) };
+		if (!transform) return result;
+
+		com_ptr_nothrow<IMFAttributes> transform_attributes{};
+		if (FAILED(transform->GetAttributes(transform_attributes.put()))) return result;
+
+		uint32_t length{};
+		result.second = SUCCEEDED(transform_attributes->GetStringLength(MFT_ENUM_HARDWARE_URL_Attribute, &length));
+
+		unique_cotaskmem_string name{};
+		if (SUCCEEDED(transform_attributes->GetAllocatedString(MFT_FRIENDLY_NAME_Attribute, name.put(), &length)))
+			result.first = name.get();
+
+		return result;
+	}
+
+	auto find_keyframe_encoder(IMFSinkWriter &sink_writer, DWORD const &index) noexcept
+	{
+		auto const transform{ get_video_encoder_transform(sink_writer, index) };
+		if (!transform) return com_ptr_nothrow<ICodecAPI>{};
+
+		// An asynchronous encoder queues frames on its own, so forcing "the next frame" would land somewhere later.
+		com_ptr_nothrow<IMFAttributes> transform_attributes{};
+		if (FAILED(transform->GetAttributes(transform_attributes.put())) || MFGetAttributeUINT32(transform_attributes.get(), MF_TRANSFORM_ASYNC, FALSE)) return com_ptr_nothrow<ICodecAPI>{};
+
+		auto codec_api{ transform.try_query<ICodecAPI>() };
+		if (!codec_api || codec_api->IsSupported(&CODECAPI_AVEncVideoForceKeyFrame) != S_OK) return com_ptr_nothrow<ICodecAPI>{};
+
+		return codec_api;
+	}
+
+	// What the encoder settled on for the stream, or 0 when it does not say; not every MFT answers CODECAPI_AVEncMPVProfile.
+	uint32_t query_video_profile(IMFSinkWriter &sink_writer, DWORD const &index) noexcept
+	{
+		auto const transform{ get_video_encoder_transform(sink_writer, index) };
+		if (!transform) return 0;
+
+		auto const codec_api{ transform.try_query<ICodecAPI>() };
+		if (!codec_api) return 0;
+
+		VARIANT value{};
+		if (FAILED(codec_api->GetValue(&CODECAPI_AVEncMPVProfile, &value))) return 0;
+
+		auto const profile{ value.vt == VT_UI4 ? value.ulVal : value.vt == VT_UINT ? value.uintVal : 0u };
+		VariantClear(&value);
+		return profile;
+	}
+
+	auto make_keyframe_control(output_configuration const &configuration) noexcept
+	{
+		keyframe_control keyframes{};
+		if (configuration.detects_scene_cuts)
+			keyframes.planner.emplace(static_cast<int32_t>(configuration.gop_length), static_cast<double>(configuration.scene_threshold));
+		return keyframes;
+	}
+
+	// Only the paths that hand an encoder its frames one by one can force keyframes; the rest say so rather than drop the setting silently.
+	auto warn_without_scene_cuts(output_configuration const &configuration, wstring_view path) noexcept
+	{
+		if (configuration.detects_scene_cuts)
+			aviutl_logger->warn(aviutl_logger, format(L"Scene detection is ignored when {}.", path).c_str());
+	}
+
+	auto is_keyframe_due(keyframe_control &keyframes, scene::thumbnail const &frame) noexcept
+	{
+		return keyframes.planner && keyframes.planner->next(frame) != scene::boundary::none;
+	}
+
+	auto report_keyframes(keyframe_control const &keyframes) noexcept
+	{
+		if (!keyframes.planner) return;
+
+		aviutl_logger->info(aviutl_logger, format(L"Started {} GOPs at scene cuts and {} at the maximum length; {:.1f} frames each on average.", keyframes.planner->get_scene_cuts(), keyframes.planner->get_length_cuts(), keyframes.planner->get_mean_length()).c_str());
+	}
+
+	expected<probe_trial, error> try_video_encoder(GUID const &output_video_format, GUID const &input_video_format, bool const &is_accelerated, resolution_t &&resolution) noexcept
+	{
+		auto const begin{ chrono::steady_clock::now() };
+
+		com_ptr_nothrow<IStream> memory_stream{};
+		memory_stream.attach(SHCreateMemStream(nullptr, 0));
+		if (!memory_stream) [[unlikely]] return unexpected{ error{ E_OUTOFMEMORY, "SHCreateMemStream(nullptr, 0)" } };
+
+		com_ptr_nothrow<IMFByteStream> byte_stream{};
+		UNEXPECT_IF_FAILED(MFCreateMFByteStreamOnStream(memory_stream.get(), out_ptr(byte_stream)));
+
+		auto sink_writer_attributes{ com_ptr_nothrow<IMFAttributes>{} };
+		MFCreateAttributes(out_ptr(sink_writer_attributes), 3);
+		sink_writer_attributes->SetGUID(MF_TRANSCODE_CONTAINERTYPE, output_video_format == MFVideoFormat_WVC1 ? MFTranscodeContainerType_ASF : MFTranscodeContainerType_MPEG4);
+
+		if (is_accelerated)
+		{
+			auto const d3d_manager{ session::get_dxgi_device_manager(*aviutl_logger) };
+			if (!d3d_manager) [[unlikely]] return unexpected{ d3d_manager.error() };
+			sink_writer_attributes->SetUINT32(MF_READWRITE_ENABLE_HARDWARE_TRANSFORMS, true);
+			sink_writer_attributes->SetUnknown(MF_SINK_WRITER_D3D_MANAGER, d3d_manager->get());
+		}
+
+		auto sink_writer{ com_ptr_nothrow<IMFSinkWriter>{} };
+		UNEXPECT_IF_FAILED(MFCreateSinkWriterFromURL(nullptr, byte_stream.get(), sink_writer_attributes.get(), out_ptr(sink_writer)));
+
+		auto const input_media_type{ make_input_video_media_type(move(resolution), { 30, 1 }, input_video_format, is_accelerated) };
+		// The trial only asks which encoder comes up, so its threads and GOP are left to it.
+		auto const index{ configure_video_stream(*sink_writer, 70, *input_media_type, output_video_format, 0, 0) };
+		if (!index) [[unlikely]] return unexpected{ index.error() };
+
+		chrono::duration<double, milli> const elapsed{ chrono::steady_clock::now() - begin };
+		auto [encoder, is_hardware] { find_video_encoder(*sink_writer, *index) };
+
+		return probe_trial{ move(encoder), is_hardware, query_video_profile(*sink_writer, *index), elapsed.count() };
+	}
+
+	auto probe_video_encoder(GUID const &output_video_format, bool const &is_accelerated) noexcept
+	{
+		static auto const constinit probe_resolutions{ to_array<pair<int32_t, int32_t>>({ { 1920, 1080 }, { 3840, 2160 }, { 7680, 4320 } }) };
+
+		aviutl_logger->info(aviutl_logger, format(L"Probing {} encoders. This happens only once...", is_accelerated ? L"hardware" : L"software").c_str());
+
+		probe::record record{};
+		record.available_encoders = enumerate_video_encoders(output_video_format, is_accelerated);
+
+		// Hardware encoders are fed NV12, so it is tried first there; software prefers YUY2 because it needs no conversion.
+		auto const input_video_formats{ is_accelerated ? to_array({ MFVideoFormat_NV12, MFVideoFormat_YUY2 }) : to_array({ MFVideoFormat_YUY2, MFVideoFormat_NV12 }) };
+
+		for (auto const &input_video_format : input_video_formats)
+			if (auto const trial{ try_video_encoder(output_video_format, input_video_format, is_accelerated, { probe_resolutions.front().first, probe_resolutions.front().second }) })
+			{
+				// With hardware transforms enabled the writer silently falls back to a software MFT, which is not what we are probing for.
+				if (is_accelerated && !trial->is_hardware) continue;
+
+				record.input_subtypes.push_back(input_video_format.Data1);
+				if (record.encoder.empty())
+				{
+					record.encoder = trial->encoder;
+					record.profile = trial->profile;
+					record.init_milliseconds = trial->init_milliseconds;
+				}
+			}
+
+		record.is_supported = !record.input_subtypes.empty();
+		record.is_capped = !record.is_supported;
+
+		if (record.is_supported)
+			for (auto const &[width, height] : probe_resolutions)
+			{
+				GUID input_video_format{ MFVideoFormat_Base };
+				input_video_format.Data1 = record.input_subtypes.front();
+
+				auto const trial{ try_video_encoder(output_video_format, input_video_format, is_accelerated, { width, height }) };
+				if (!trial || (is_accelerated && !trial->is_hardware))
+				{
+					record.is_capped = true;
+					break;
+				}
+
+				record.max_width = width;
+				record.max_height = height;
+			}
+
+		probe::store(output_video_format, is_accelerated, record);
+
+		aviutl_logger->info(aviutl_logger, format
+		(
+			L"Probed {} path: {} (max {}x{}{}, {:.2f} ms to initialize).",
+			is_accelerated ? L"hardware" : L"software",
+			record.is_supported ? (record.encoder.empty() ? L"supported" : record.encoder) : L"unsupported",
+			record.max_width,
+			record.max_height,
+			record.is_capped ? L"" : L" or more",
+			record.init_milliseconds
+		).c_str());
+
+		return record;
+	}
+
+	auto get_output_resolution(OUTPUT_INFO const &oip, output_configuration const &configuration) noexcept
+	{
+		auto width{ static_cast<int32_t>(configuration.output_width) }, height{ static_cast<int32_t>(configuration.output_height) };
+		if (!width && !height) return pair{ oip.w, oip.h };
+
+		// A side left at 0 follows the aspect ratio of the project; 4:2:0 needs both to be even.
+		if (!width) width = static_cast<int32_t>(static_cast<int64_t>(oip.w) * height / oip.h);
+		if (!height) height = static_cast<int32_t>(static_cast<int64_t>(oip.h) * width / oip.w);
+
+		return pair{ max(width & ~1, 2), max(height & ~1, 2) };
+	}
+
+	auto get_output_frame_rate(OUTPUT_INFO const &oip, output_configuration const &configuration) noexcept
+	{
+		auto const rate{ static_cast<int64_t>(configuration.output_rate) }, scale{ static_cast<int64_t>(max(configuration.output_scale, 1u)) };
+
+		// Only dropping frames saves anything; a higher rate would have the host render the same frame more than once.
+		if (!rate || rate * oip.scale >= static_cast<int64_t>(oip.rate) * scale) return pair{ oip.rate, oip.scale };
+
+		return pair{ static_cast<int32_t>(rate), static_cast<int32_t>(scale) };
+	}
+
+	auto get_output_frame_count(OUTPUT_INFO const &oip, int32_t const &rate, int32_t const &scale) noexcept
+	{
+		// Every output frame that starts before the project ends, so the last source frame is never cut short.
+		auto const numerator{ static_cast<int64_t>(oip.n) * oip.scale * rate }, denominator{ static_cast<int64_t>(oip.rate) * scale };
+		return static_cast<int32_t>((numerator + denominator - 1) / denominator);
+	}
+
+	// Derived from [cpu] alone, so every part of an export that asks gets the same answer.
+	auto get_cpu_budget(output_configuration const &configuration) noexcept
+	{
+		return schedule::make_cpu_budget(configuration.cpu_cores, configuration.cpu_percent, configuration.cpu_priority, configuration.pins_cpu);
+	}
+
+	// The host thread converts every frame, and the scaler brings two helpers of its own.
+	auto get_conversion_threads(encoding_plan const &plan) noexcept
+	{
+		return plan.scaler ? 3u : 1u;
+	}
+
+	auto plan_frames(OUTPUT_INFO const &oip, output_configuration const &configuration) noexcept
+	{
+		auto const [width, height] { get_output_resolution(oip, configuration) };
+		auto const [rate, scale] { get_output_frame_rate(oip, configuration) };
+		auto const frame_count{ get_output_frame_count(oip, rate, scale) };
+		auto const has_audio{ get_stream_selection(oip, configuration) != stream_selection::video_only };
+
+		if (rate != oip.rate || scale != oip.scale)
+			aviutl_logger->info(aviutl_logger, format(L"Rendering {} of {} frames for {}/{} fps.", frame_count, oip.n, rate, scale).c_str());
+
+		auto const budget{ get_cpu_budget(configuration) };
+
+		shared_ptr<scale::frame_scaler const> scaler{};
+		if (width != oip.w || height != oip.h)
+		{
+			static auto const constinit filter_names{ to_array({ L"bilinear", L"bicubic", L"Lanczos-3" }) };
+			auto const filter{ clamp<uint32_t>(configuration.scaling_filter, 0, filter_names.size() - 1) };
+
+			// The scaler's helpers count against the budget like any other thread of ours.
+			scaler = make_shared<scale::frame_scaler>(pair{ oip.w, oip.h }, pair{ width, height }, static_cast<scale::filter>(filter), [budget](function<void()> const &task)
+			{
+				schedule::thread_scope const scope{ budget };
+				task();
+			});
+			aviutl_logger->info(aviutl_logger, format(L"Scaling {}x{} to {}x{} with {}.", oip.w, oip.h, width, height, filter_names[filter]).c_str());
+		}
+
+		encoding_plan plan{ scaler ? MFVideoFormat_NV12 : MFVideoFormat_YUY2, false, width, height, rate, scale, frame_count, has_audio, scaler, budget, 0 };
+		// As if it were the only encoder; budget_encoder_threads splits it further and says so.
+		plan.encoder_thread_count = plan.budget.get_encoder_threads(get_conversion_threads(plan));
+		return plan;
+	}
+
+	auto plan_video_encoding(OUTPUT_INFO const &oip, GUID const &output_video_format, bool const &is_accelerated, output_configuration const &configuration) noexcept
+	{
+		auto const frames{ plan_frames(oip, configuration) };
+
+		auto const get_record{ [&output_video_format](bool const &is_hardware)
+		{
+			if (auto record{ probe::load(output_video_format, is_hardware) }) return move(*record);
+			return probe_video_encoder(output_video_format, is_hardware);
+		} };
+
+		auto const make_plan{ [&frames](uint32_t const &input_subtype, bool const &is_hardware)
+		{
+			auto plan{ frames };
+			plan.input_video_format.Data1 = input_subtype;
+			plan.is_accelerated = is_hardware;
+			return plan;
+		} };
+
+		// The scaler works on NV12, which every encoder we drive accepts even when it prefers something else.
+		auto const get_input_subtype{ [&frames](probe::record const &record) { return frames.scaler ? MFVideoFormat_NV12.Data1 : record.input_subtypes.front(); } };
+
+		if (is_accelerated)
+		{
+			if (auto const record{ get_record(true) }; probe::is_capable(record, frames.width, frames.height))
+				return make_plan(get_input_subtype(record), true);
+
+			aviutl_logger->warn(aviutl_logger, format(L"No hardware encoder is known to handle {}x{}. Using software instead.", frames.width, frames.height).c_str());
+		}
+
+		if (auto const record{ get_record(false) }; probe::is_capable(record, frames.width, frames.height))
+			return make_plan(get_input_subtype(record), false);
+
+		// Nothing is known to work; let the writer report why.
+		return make_plan(frames.scaler ? MFVideoFormat_NV12.Data1 : get_suitable_input_video_format_guid(is_accelerated).Data1, is_accelerated);
+	}
+
+	// Encoders pick their thread count when they are configured, so this runs once the plan is known and before any writer is made.
+	void budget_encoder_threads(encoding_plan &plan, uint32_t const &encoder_count = 1) noexcept
+	{
+		auto const conversion_threads{ get_conversion_threads(plan) };
+		plan.encoder_thread_count = plan.budget.get_encoder_threads(conversion_threads, encoder_count);
+
+		if (plan.budget.threads)
+			aviutl_logger->info(aviutl_logger, format(L"Keeping the export to {} of {} logical processors: {} for conversion and {} per encoder.", plan.budget.threads, plan.budget.available, conversion_threads, plan.encoder_thread_count).c_str());
+	}
+
+	auto get_video_frame(OUTPUT_INFO const &oip, encoding_plan const &plan, int32_t const &f) noexcept
+	{
+		// Output frame f starts at f * scale / rate seconds, so it shows the source frame on screen at that moment.
+		auto const source_frame{ static_cast<int64_t>(f) * plan.scale * oip.rate / (static_cast<int64_t>(plan.rate) * oip.scale) };
+		return static_cast<uint8_t const *>(oip.func_get_video(static_cast<int32_t>(source_frame), FCC('YUY2')));
+	}
+
+	auto convert_video_frame(OUTPUT_INFO const &oip, uint8_t const frame_image[], IMFMediaType &input_media_type, encoding_plan const &plan, int64_t const &time_stamp, com_ptr_nothrow<IMFMediaBuffer> &video_buffer) noexcept
+	{
 		RETURN_IF_FAILED(MFCreateMediaBufferFromMediaType(&input_media_type, time_stamp, 0, 0, out_ptr(video_buffer)));
 
 		com_ptr_nothrow<IMF2DBuffer2> video_2d_buffer{};
@@ -433,92 +883,2557 @@ namespace mfop
 		long stride{};
 		DWORD buffer_size{};
 		video_2d_buffer->Lock2DSize(MF2DBuffer_LockFlags_Write, &scanline, &stride, &buffer_begin, &buffer_size);
-		RETURN_IF_FAILED(MFCopyImage(scanline, stride, is_accelerated ? yuy2_to_nv12(frame_image, { oip.w, oip.h }).get() : frame_image, stride, stride, oip.h));
+		if (plan.input_video_format == MFVideoFormat_NV12)
+		{
+			auto const nv12_image{ yuy2_to_nv12(frame_image, { oip.w, oip.h }) };
+			if (plan.scaler)
+				plan.scaler->scale(nv12_image.get(), oip.w, scanline, stride);
+			else
+			{
+				RETURN_IF_FAILED(MFCopyImage(scanline, stride, nv12_image.get(), oip.w, oip.w, oip.h));
+				RETURN_IF_FAILED(MFCopyImage(scanline + static_cast<ptrdiff_t>(stride) * oip.h, stride, nv12_image.get() + static_cast<ptrdiff_t>(oip.w) * oip.h, oip.w, oip.w, oip.h / 2));
+			}
+		}
+		else
+			RETURN_IF_FAILED(MFCopyImage(scanline, stride, frame_image, oip.w * 2, oip.w * 2, oip.h));
 		video_2d_buffer->Unlock2D();
 
 		DWORD contiguous_length{};
 		video_2d_buffer->GetContiguousLength(&contiguous_length);
 		video_buffer->SetCurrentLength(contiguous_length);
 
-		return write_sample_to_sink_writer(sink_writer, index, *video_buffer, time_stamp * f, time_stamp);
+		return S_OK;
 	}
 
-	auto write_audio_sample(OUTPUT_INFO const &oip, IMFSinkWriter &sink_writer, int32_t const &n, DWORD const &index, IMFMediaType &input_media_type, int32_t const &max_samples) noexcept
+	// Reads the second of audio starting at sample n, the stride every audio loop steps by.
+	auto read_audio_buffer(OUTPUT_INFO const &oip, int32_t const &n, IMFMediaType &input_media_type, timebase::clock const &audio_clock, com_ptr_nothrow<IMFMediaBuffer> &audio_buffer, int64_t &sample_duration) noexcept
 	{
-		if (oip.func_is_abort()) return E_ABORT;
-
-		oip.func_rest_time_disp(n, oip.audio_n);
-
 		int32_t actual_samples{};
-		auto const audio_data{ oip.func_get_audio(n, max_samples, &actual_samples, WAVE_FORMAT_PCM) };
+		auto const audio_data{ oip.func_get_audio(n, oip.audio_rate, &actual_samples, WAVE_FORMAT_PCM) };
 		if (!actual_samples) return S_FALSE;
 
-		auto const sample_duration{ static_cast<int64_t>(actual_samples) * 10'000'000LL / max_samples };
-		auto const sample_time{ static_cast<int64_t>(n) * 10'000'000LL / oip.audio_rate };
+		auto const length{ static_cast<DWORD>(actual_samples * get_pcm_block_alignment(oip.audio_ch, audio_bits_per_sample)) };
+		sample_duration = audio_clock.get_duration(n, actual_samples);
 
-		com_ptr_nothrow<IMFMediaBuffer> audio_buffer{};
-		RETURN_IF_FAILED(MFCreateMediaBufferFromMediaType(&input_media_type, sample_duration, static_cast<DWORD>(actual_samples), 0, out_ptr(audio_buffer)));
+		RETURN_IF_FAILED(MFCreateMediaBufferFromMediaType(&input_media_type, sample_duration, length, 0, out_ptr(audio_buffer)));
 
 		uint8_t *media_data{};
 		DWORD media_data_max_length{};
 		audio_buffer->Lock(&media_data, &media_data_max_length, nullptr);
-		if (memmove_s(media_data, media_data_max_length, audio_data, static_cast<size_t>(actual_samples)) != 0) return E_OUTOFMEMORY;
+		if (memmove_s(media_data, media_data_max_length, audio_data, length) != 0) return E_OUTOFMEMORY;
 		audio_buffer->Unlock();
 
-		audio_buffer->SetCurrentLength(static_cast<DWORD>(actual_samples));
+		audio_buffer->SetCurrentLength(length);
 
-		return write_sample_to_sink_writer(sink_writer, index, *audio_buffer, sample_time, sample_duration);
+		return S_OK;
 	}
 
-	using unique_mfshutdown_call = unique_call<decltype(&::MFShutdown), ::MFShutdown>;
-	[[nodiscard]] inline unique_mfshutdown_call MFStartup(DWORD &&flags = MFSTARTUP_FULL)
+	auto write_video_buffer(OUTPUT_INFO const &oip, IMFSinkWriter &sink_writer, int32_t const &f, int32_t const &frame_count, DWORD const &index, IMFMediaBuffer &video_buffer, timebase::clock const &video_clock, bool const &is_keyframe = false, ICodecAPI *const encoder = nullptr) noexcept
 	{
-		FAIL_FAST_IF_FAILED(::MFStartup(MF_VERSION, flags));
-		return {};
+		if (oip.func_is_abort()) return E_ABORT;
+
+		oip.func_rest_time_disp(f, frame_count);
+
+		return write_sample_to_sink_writer(sink_writer, index, video_buffer, video_clock.get_time(f), video_clock.get_duration(f), is_keyframe, encoder);
 	}
 
-	expected<HRESULT, error> output_file(OUTPUT_INFO const &oip, output_configuration &&configuration, LOG_HANDLE &logger)
+	auto write_video_sample(OUTPUT_INFO const &oip, IMFSinkWriter &sink_writer, int32_t const &f, DWORD const &index, IMFMediaType &input_media_type, encoding_plan const &plan, timebase::clock const &video_clock, buffering::depth_controller &depth_controller, keyframe_control &keyframes) noexcept
 	{
-		auto const com_cleanup{ CoInitializeEx_failfast() };
-		auto const mf_cleanup{ MFStartup() };
+		if (oip.func_is_abort()) return E_ABORT;
 
-		aviutl_logger = &logger;
+		auto const fetch_begin{ chrono::steady_clock::now() };
+		auto const frame_image{ get_video_frame(oip, plan, f) };
+		auto const fetch_end{ chrono::steady_clock::now() };
 
-		auto const output_video_format{ get_suitable_output_video_format_guid(filesystem::path(oip.savefile).extension(), configuration.is_hevc_preferable) };
+		// Looked at before conversion, while the host's own frame is still at hand whatever the encoder is fed.
+		auto const is_keyframe{ keyframes.planner && is_keyframe_due(keyframes, scene::make_thumbnail(frame_image, oip.w, oip.h)) };
+
+		com_ptr_nothrow<IMFMediaBuffer> video_buffer{};
+		RETURN_IF_FAILED(convert_video_frame(oip, frame_image, input_media_type, plan, video_clock.get_duration(f), video_buffer));
 
-		auto const input_media_types{ make_input_media_types(oip, output_video_format, configuration.is_accelerated) };
+		auto const result{ write_video_buffer(oip, sink_writer, f, plan.frame_count, index, *video_buffer, video_clock, is_keyframe, keyframes.encoder.get()) };
 
-		auto sink_writer_with_indices{ make_initialized_sink_writer(oip, output_video_format, configuration.video_quality, configuration.audio_bit_rate, input_media_types) };
-		if (!sink_writer_with_indices) [[unlikely]] return unexpected{ sink_writer_with_indices.error() };
+		depth_controller.record(fetch_end - fetch_begin, chrono::steady_clock::now() - fetch_end);
 
-		auto const [sink_writer, indices] { *sink_writer_with_indices };
+		return result;
+	}
 
-		oip.func_set_buffer_size(8, 8);
+	auto write_host_video_sample(OUTPUT_INFO const &oip, IMFSinkWriter &sink_writer, int32_t const &f, DWORD const &index, encoding_plan const &plan, timebase::clock const &video_clock, buffering::depth_controller &depth_controller, keyframe_control &keyframes, frame::host_frame_wrapper &wrapper) noexcept
+	{
+		if (oip.func_is_abort()) return E_ABORT;
 
-		aviutl_logger->info(aviutl_logger, L"Sending video samples to the writer...");
+		// Any call into the host may reuse the frame, so progress is shown before it is fetched rather than after.
+		oip.func_rest_time_disp(f, plan.frame_count);
 
-		auto const video_time_stamp{ get_average_time_per_frame(*input_media_types.first) };
+		auto const fetch_begin{ chrono::steady_clock::now() };
+		auto const frame_image{ get_video_frame(oip, plan, f) };
+		auto const fetch_end{ chrono::steady_clock::now() };
 
-		auto aeternum{ S_OK };
+		auto const is_keyframe{ keyframes.planner && is_keyframe_due(keyframes, scene::make_thumbnail(frame_image, oip.w, oip.h)) };
 
-		for (auto f{ 0 }; f < oip.n; ++f)
-			if ((aeternum = write_video_sample(oip, *sink_writer, f, indices.first, *input_media_types.first, configuration.is_accelerated, video_time_stamp)) < 0)
-				goto abort;
+		com_ptr_nothrow<IMFMediaBuffer> video_buffer{};
+		RETURN_IF_FAILED(wrapper.wrap(frame_image, video_buffer));
+
+		auto const result{ write_sample_to_sink_writer(sink_writer, index, *video_buffer, video_clock.get_time(f), video_clock.get_duration(f), is_keyframe, keyframes.encoder.get()) };
+		video_buffer.reset();
+		wrapper.release_current();
+
+		depth_controller.record(fetch_end - fetch_begin, chrono::steady_clock::now() - fetch_end);
+
+		return result;
+	}
+
+	auto apply_buffer_depth(OUTPUT_INFO const &oip, buffering::depth const &depth) noexcept
+	{
+		oip.func_set_buffer_size(depth.video, depth.audio);
+		aviutl_logger->info(aviutl_logger, format(L"Prefetch depth set to {} video / {} audio ({}).", depth.video, depth.audio, depth.reason).c_str());
+	}
+
+	auto get_prefetch_memory_budget() noexcept
+	{
+		MEMORYSTATUSEX memory_status{ sizeof(memory_status) };
+		GlobalMemoryStatusEx(&memory_status);
+		return clamp<uint64_t>(memory_status.ullTotalPhys / 16, 256ull << 20, 1ull << 30);
+	}
+
+	auto write_audio_buffer(OUTPUT_INFO const &oip, IMFSinkWriter &sink_writer, int32_t const &n, DWORD const &index, IMFMediaBuffer &audio_buffer, timebase::clock const &audio_clock, int64_t const &sample_duration) noexcept
+	{
+		if (oip.func_is_abort()) return E_ABORT;
+
+		oip.func_rest_time_disp(n, oip.audio_n);
+
+		return write_sample_to_sink_writer(sink_writer, index, audio_buffer, audio_clock.get_time(n), sample_duration);
+	}
+
+	auto write_audio_sample(OUTPUT_INFO const &oip, IMFSinkWriter &sink_writer, int32_t const &n, DWORD const &index, IMFMediaType &input_media_type, timebase::clock const &audio_clock) noexcept
+	{
+		if (oip.func_is_abort()) return E_ABORT;
+
+		com_ptr_nothrow<IMFMediaBuffer> audio_buffer{};
+		int64_t sample_duration{};
+		if (auto const hr{ read_audio_buffer(oip, n, input_media_type, audio_clock, audio_buffer, sample_duration) }; hr != S_OK) return hr;
+
+		return write_audio_buffer(oip, sink_writer, n, index, *audio_buffer, audio_clock, sample_duration);
+	}
+
+	// Writes PCM the caller already holds, such as the host's audio handed over a frame at a time.
+	HRESULT write_pcm_sample(IMFSinkWriter &sink_writer, DWORD const &index, IMFMediaType &input_media_type, timebase::clock const &audio_clock, uint32_t const &block_alignment, int64_t const &n, span<uint8_t const> samples) noexcept
+	{
+		auto const sample_time{ audio_clock.get_time(n) };
+		auto const sample_duration{ audio_clock.get_duration(n, static_cast<int64_t>(samples.size() / block_alignment)) };
+
+		com_ptr_nothrow<IMFMediaBuffer> audio_buffer{};
+		RETURN_IF_FAILED(MFCreateMediaBufferFromMediaType(&input_media_type, sample_duration, static_cast<DWORD>(samples.size()), 0, out_ptr(audio_buffer)));
+
+		uint8_t *media_data{};
+		DWORD media_data_max_length{};
+		RETURN_IF_FAILED(audio_buffer->Lock(&media_data, &media_data_max_length, nullptr));
+		if (media_data_max_length >= samples.size()) ranges::copy(samples, media_data);
+		audio_buffer->Unlock();
+		if (media_data_max_length < samples.size()) [[unlikely]] return E_OUTOFMEMORY;
+
+		audio_buffer->SetCurrentLength(static_cast<DWORD>(samples.size()));
+
+		return write_sample_to_sink_writer(sink_writer, index, *audio_buffer, sample_time, sample_duration);
+	}
+
+	auto prefetch_samples(OUTPUT_INFO const &oip, IMFMediaTypes const &input_media_types, encoding_plan const &plan, timebase::clock const &video_clock, timebase::clock const &audio_clock, bool const &makes_thumbnails) noexcept
+	{
+		prefetched_samples prefetched{};
+
+		auto const frame_size{ max(MFGetAttributeUINT32(input_media_types.first.get(), MF_MT_SAMPLE_SIZE, 1), 1u) };
+		auto const frame_count{ min(plan.frame_count, static_cast<int32_t>(clamp(prefetch_budget / frame_size, 1u, max_prefetch_frames))) };
+
+		for (auto f{ 0 }; f < frame_count && !oip.func_is_abort(); ++f)
 		{
-			aviutl_logger->info(aviutl_logger, L"Sending audio samples to the writer...");
+			auto const frame_image{ get_video_frame(oip, plan, f) };
 
-			auto const audio_max_samples{ static_cast<int32_t>(get_pcm_block_alignment(oip.audio_ch, audio_bits_per_sample) * oip.audio_rate) };
+			com_ptr_nothrow<IMFMediaBuffer> video_buffer{};
+			if (FAILED(convert_video_frame(oip, frame_image, *input_media_types.first, plan, video_clock.get_duration(f), video_buffer))) break;
+			prefetched.video.push_back(move(video_buffer));
 
-			for (auto n{ 0 }; n < oip.audio_n; n += oip.audio_rate)
-				if ((aeternum = write_audio_sample(oip, *sink_writer, n, indices.second, *input_media_types.second, audio_max_samples)) < 0)
-					break;
+			// The planner has to see frames in order, and the writer it belongs to does not exist yet.
+			if (makes_thumbnails) prefetched.thumbnails.push_back(scene::make_thumbnail(frame_image, oip.w, oip.h));
 		}
-	abort:
-		aviutl_logger->info(aviutl_logger, SUCCEEDED(aeternum) ? L"Finalizing. It may take a while..." : L"Aborting...");
-		UNEXPECT_IF_FAILED(sink_writer->Finalize());
 
-		UNEXPECT_IF_FAILED(aeternum);
+		if (input_media_types.second && oip.audio_n > 0 && !oip.func_is_abort())
+			if (read_audio_buffer(oip, 0, *input_media_types.second, audio_clock, prefetched.audio, prefetched.audio_duration) != S_OK)
+				prefetched.audio.reset();
 
-		return S_OK;
+		return prefetched;
+	}
+
+	auto discard_sink_writer(com_ptr_nothrow<IMFSinkWriter> &sink_writer) noexcept
+	{
+		// Shutting the media sink down closes the file without draining the encoders like Finalize would.
+		com_ptr_nothrow<IMFMediaSink> media_sink{};
+		if (SUCCEEDED(sink_writer->GetServiceForStream(MF_SINK_WRITER_MEDIASINK, GUID_NULL, IID_PPV_ARGS(media_sink.put()))))
+			media_sink->Shutdown();
+
+		sink_writer.reset();
+	}
+
+	auto truncate_to_complete_fragments(wchar_t const *path) noexcept
+	{
+		unique_hfile file{ CreateFileW(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr) };
+		if (!file) return uint64_t{};
+
+		LARGE_INTEGER file_size{};
+		GetFileSizeEx(file.get(), &file_size);
+
+		auto const read_big_endian{ [](span<uint8_t const> bytes) { return ranges::fold_left(bytes, uint64_t{}, [](uint64_t const &value, uint8_t const &byte) { return value << 8 | byte; }); } };
+
+		uint64_t offset{}, complete_size{};
+		while (offset + 8 <= static_cast<uint64_t>(file_size.QuadPart))
+		{
+			LARGE_INTEGER position{};
+			position.QuadPart = static_cast<int64_t>(offset);
+			SetFilePointerEx(file.get(), position, nullptr, FILE_BEGIN);
+
+			array<uint8_t, 16> header{};
+			DWORD header_length{};
+			if (!ReadFile(file.get(), header.data(), static_cast<DWORD>(header.size()), &header_length, nullptr) || header_length < 8) break;
+
+			auto box_size{ read_big_endian(span{ header }.first(4)) };
+			if (box_size == 1 && header_length == header.size()) box_size = read_big_endian(span{ header }.last(8));
+			if (box_size < 8 || offset + box_size > static_cast<uint64_t>(file_size.QuadPart)) break;
+
+			offset += box_size;
+
+			// A fragment only counts once its media data is complete, and the init segment once the movie box is.
+			if (auto const type{ string_view{ reinterpret_cast<char const *>(header.data() + 4), 4 } }; type == "mdat" || type == "moov")
+				complete_size = offset;
+		}
+
+		LARGE_INTEGER end_of_file{};
+		end_of_file.QuadPart = static_cast<int64_t>(complete_size);
+		if (complete_size > 0 && SetFilePointerEx(file.get(), end_of_file, nullptr, FILE_BEGIN)) SetEndOfFile(file.get());
+
+		return complete_size;
+	}
+
+	auto normalize_output_path(wchar_t const *path)
+	{
+		error_code ignored{};
+		auto normalized{ filesystem::absolute(path, ignored).lexically_normal().wstring() };
+		CharUpperBuffW(normalized.data(), static_cast<DWORD>(normalized.size()));
+		return normalized;
+	}
+
+	// A finished output goes through a stream of ours when its digest is wanted; otherwise the sink writer opens the file itself.
+	expected<com_ptr_nothrow<IMFByteStream>, error> make_output_byte_stream(wchar_t const *path, bool const &writes_digest) noexcept
+	{
+		com_ptr_nothrow<IMFByteStream> byte_stream{};
+		if (!writes_digest) return byte_stream;
+
+		auto const file{ digest::digest_file::create(path) };
+		if (!file) [[unlikely]] return unexpected{ file.error() };
+
+		// Seekable and readable like the file would be, so the MP4 sink still patches its sizes and moves the movie header to the front.
+		UNEXPECT_IF_FAILED(stream::make_byte_stream(*file, true, true, byte_stream));
+
+		scoped_lock const guard{ pending_digests.lock };
+		pending_digests.files.insert_or_assign(normalize_output_path(path), *file);
+		return byte_stream;
+	}
+
+	auto take_digest_file(wchar_t const *path)
+	{
+		scoped_lock const guard{ pending_digests.lock };
+		auto const found{ pending_digests.files.extract(normalize_output_path(path)) };
+		return found ? found.mapped().lock() : nullptr;
+	}
+
+	// The media sink may or may not close its stream when Finalize is done with it, so the sidecar is written here at the latest.
+	auto close_digest_file(digest::digest_file &file, wstring_view path, LOG_HANDLE &logger) noexcept
+	{
+		auto const begin{ chrono::steady_clock::now() };
+		auto const hr{ file.close() };
+		chrono::duration<double> const elapsed{ chrono::steady_clock::now() - begin };
+
+		if (SUCCEEDED(hr))
+			logger.info(&logger, format(L"Wrote the BLAKE3 digest of {} in {:.2f} s, reading {:.1f} MiB back.", path, elapsed.count(), static_cast<double>(file.get_reread_size()) / (1 << 20)).c_str());
+		else
+			logger.error(&logger, format(L"FAILED TO WRITE THE DIGEST OF {}: 0x{:08x}.", path, static_cast<uint32_t>(hr)).c_str());
+
+		return hr;
+	}
+
+	auto discard_partial_file(wchar_t const *path, bool const &keeps_fragments) noexcept
+	{
+		// Whatever is kept is not the file the digest was being taken of.
+		if (auto const file{ take_digest_file(path) }) file->discard();
+		DeleteFileW(digest::get_sidecar_path(path).c_str());
+
+		if (keeps_fragments)
+			if (auto const kept_size{ truncate_to_complete_fragments(path) })
+			{
+				aviutl_logger->info(aviutl_logger, format(L"Kept {:.1f} MiB of complete fragments.", static_cast<double>(kept_size) / (1 << 20)).c_str());
+				return;
+			}
+
+		if (!DeleteFileW(path))
+			aviutl_logger->warn(aviutl_logger, format(L"Could not delete the partial file (error {}).", GetLastError()).c_str());
+	}
+
+	auto is_finalizing(wstring const &path)
+	{
+		scoped_lock const guard{ pending_finalizations.lock };
+		return pending_finalizations.paths.contains(path);
+	}
+
+	auto finalize_in_background(com_ptr_nothrow<IMFSinkWriter> &&sink_writer, wstring &&path, schedule::cpu_budget const &budget, LOG_HANDLE &logger, function<void()> &&on_finalized = {})
+	{
+		// Those that are done only have their destructors left, if even that; they are joined here so the list does not grow with every export.
+		list<pair<wstring, jthread>> finished{};
+		{
+			scoped_lock const guard{ pending_finalizations.lock };
+			pending_finalizations.paths.insert(path);
+
+			for (auto i{ pending_finalizations.threads.begin() }; i != pending_finalizations.threads.end(); )
+				if (pending_finalizations.paths.contains(i->first))
+					++i;
+				else
+					finished.splice(finished.end(), pending_finalizations.threads, i++);
+		}
+		finished.clear();
+
+		auto digest_file{ take_digest_file(path.c_str()) };
+		auto thread_path{ path };
+
+		// The thread owns the writer, and UninitializePlugin joins it, so nothing it touches goes away underneath it.
+		jthread finalizer{ [sink_writer = move(sink_writer), path = move(path), &logger, on_finalized = move(on_finalized), budget, digest_file = move(digest_file)]() mutable
+		{
+			auto const com_cleanup{ CoInitializeEx_failfast() };
+			schedule::thread_scope const scope{ budget };
+
+			auto const begin{ chrono::steady_clock::now() };
+			auto const hr{ sink_writer->Finalize() };
+			sink_writer.reset();
+			chrono::duration<double> const elapsed{ chrono::steady_clock::now() - begin };
+
+			if (SUCCEEDED(hr))
+			{
+				logger.info(&logger, format(L"Finalized {} in {:.1f} s.", path, elapsed.count()).c_str());
+				if (digest_file) close_digest_file(*digest_file, path, logger);
+				if (on_finalized) on_finalized();
+			}
+			else
+			{
+				if (digest_file) digest_file->discard();
+				logger.error(&logger, format(L"FAILED TO FINALIZE {}: 0x{:08x} after {:.1f} s.", path, static_cast<uint32_t>(hr), elapsed.count()).c_str());
+			}
+
+			scoped_lock const guard{ pending_finalizations.lock };
+			pending_finalizations.paths.erase(path);
+		} };
+
+		scoped_lock const guard{ pending_finalizations.lock };
+		pending_finalizations.threads.emplace_back(move(thread_path), move(finalizer));
+	}
+
+	auto make_planned_sink_writer(OUTPUT_INFO const &oip, GUID const &output_video_format, output_configuration const &configuration, encoding_plan plan) noexcept
+	{
+		auto const com_cleanup{ CoInitializeEx_failfast() };
+
+		// Each attempt starts the file over, and the digest with it.
+		auto const make{ [&]() -> expected<sink_writer_with_indices_t, error>
+		{
+			auto const byte_stream{ make_output_byte_stream(oip.savefile, configuration.writes_digest) };
+			if (!byte_stream) [[unlikely]] return unexpected{ byte_stream.error() };
+
+			return make_initialized_sink_writer(oip.savefile, output_video_format, configuration.video_quality, configuration.audio_bit_rate, make_input_media_types(oip, output_video_format, plan), plan.encoder_thread_count, configuration.gop_length, false, byte_stream->get());
+		} };
+
+		auto result{ make() };
+		if (result || !plan.is_accelerated) return pair{ move(result), plan };
+
+		aviutl_logger->warn(aviutl_logger, L"Hardware encoder rejected the stream. Retrying with software...");
+
+		plan = plan_video_encoding(oip, output_video_format, false, configuration);
+
+		auto fallback{ make() };
+
+		// Only remember the failure once software proved that the rest of the setup was fine.
+		if (auto record{ probe::load(output_video_format, true) }; fallback && record)
+		{
+			record->is_capped = true;
+			record->max_width = min<uint32_t>(record->max_width, plan.width - 1);
+			record->max_height = min<uint32_t>(record->max_height, plan.height - 1);
+			probe::store(output_video_format, true, *record);
+		}
+
+		return pair{ move(fallback), plan };
+	}
+
+	// Without [gop] maxLength a cached segment lasts this long, within what encoders pick for a GOP on their own.
+	auto const constinit default_segment_seconds{ 4 };
+
+	auto get_segment_length(encoding_plan const &plan, output_configuration const &configuration, uint64_t const &frame_bytes) noexcept
+	{
+		// A segment is one GOP, so the IDR each one starts on is one the encoder would have put there anyway; [gop] maxLength sets it, or a few seconds do.
+		auto const gop{ configuration.gop_length ? static_cast<int32_t>(configuration.gop_length) : static_cast<int32_t>(max<int64_t>(static_cast<int64_t>(plan.rate) * default_segment_seconds / plan.scale, 1)) };
+
+		// The frames of a segment are held until it is known whether it was cached.
+		auto const affordable{ static_cast<int32_t>(clamp<uint64_t>(get_prefetch_memory_budget() / frame_bytes, 1, numeric_limits<int32_t>::max())) };
+		if (affordable < gop)
+			aviutl_logger->warn(aviutl_logger, format(L"Cutting segments to {} frames rather than a GOP of {} to stay within memory; each adds a keyframe.", affordable, gop).c_str());
+
+		return min(gop, affordable);
+	}
+
+	auto get_segment_seed(OUTPUT_INFO const &oip, GUID const &output_video_format, output_configuration const &configuration, encoding_plan const &plan, int32_t const &segment_length) noexcept
+	{
+		hash::xxh64 settings{};
+
+		auto const feed{ [&settings](auto const &value) { settings.update({ reinterpret_cast<uint8_t const *>(&value), sizeof(value) }); } };
+
+		// Anything that changes the encoded bits of a segment has to change its key.
+		feed(oip.w);
+		feed(oip.h);
+		feed(oip.rate);
+		feed(oip.scale);
+		feed(segment_length);
+		feed(output_video_format);
+		feed(plan.input_video_format);
+		feed(plan.is_accelerated);
+		feed(plan.width);
+		feed(plan.height);
+		feed(plan.rate);
+		feed(plan.scale);
+		feed(configuration.scaling_filter);
+		feed(configuration.video_quality);
+		// The GOP the encoder is told moves every IDR after the first.
+		feed(configuration.gop_length);
+
+		// Which encoder, and under which OS build and drivers, since an update to either may encode the same frames differently.
+		auto const feed_text{ [&settings](wstring_view text) { settings.update({ reinterpret_cast<uint8_t const *>(text.data()), text.size() * sizeof(wchar_t) }); } };
+		if (auto const record{ probe::load(output_video_format, plan.is_accelerated) }) feed_text(record->encoder);
+		feed_text(probe::get_environment());
+
+		return settings.digest();
+	}
+
+	expected<pair<com_ptr_nothrow<IMFSinkWriter>, DWORD>, error> make_segment_writer(filesystem::path const &path, GUID const &output_video_format, uint32_t const &video_quality, IMFMediaType &input_media_type, uint32_t const &thread_count, uint32_t const &gop_size) noexcept
+	{
+		auto sink_writer{ make_sink_writer(path.c_str(), input_media_type, output_video_format) };
+		if (!sink_writer) [[unlikely]] return unexpected{ sink_writer.error() };
+
+		auto const index{ configure_video_stream(**sink_writer, video_quality, input_media_type, output_video_format, thread_count, gop_size) };
+		if (!index) [[unlikely]] return unexpected{ index.error() };
+
+		UNEXPECT_IF_FAILED((*sink_writer)->BeginWriting());
+
+		return pair{ move(*sink_writer), *index };
+	}
+
+	// frames holds the segment's host frames back to back; they are only converted here, on a miss.
+	expected<HRESULT, error> encode_segment(OUTPUT_INFO const &oip, filesystem::path const &path, GUID const &output_video_format, uint32_t const &video_quality, IMFMediaType &input_media_type, encoding_plan const &plan, span<uint8_t const> frames, int32_t const &segment_length, timebase::clock const &video_clock) noexcept
+	{
+		auto const segment_writer{ make_segment_writer(path, output_video_format, video_quality, input_media_type, plan.encoder_thread_count, static_cast<uint32_t>(segment_length)) };
+		if (!segment_writer) [[unlikely]] return unexpected{ segment_writer.error() };
+
+		auto const &[sink_writer, index] { *segment_writer };
+		auto const frame_bytes{ static_cast<size_t>(oip.w) * oip.h * 2 };
+
+		// Segments start at zero wherever they sit in the export, since a cached one may be reused anywhere; the join shifts them into place.
+		for (auto i{ 0 }; i < static_cast<int32_t>(frames.size() / frame_bytes); ++i)
+		{
+			com_ptr_nothrow<IMFMediaBuffer> video_buffer{};
+			UNEXPECT_IF_FAILED(convert_video_frame(oip, frames.data() + i * frame_bytes, input_media_type, plan, video_clock.get_duration(i), video_buffer));
+			UNEXPECT_IF_FAILED(write_sample_to_sink_writer(*sink_writer, index, *video_buffer, video_clock.get_time(i), video_clock.get_duration(i)));
+		}
+
+		UNEXPECT_IF_FAILED(sink_writer->Finalize());
+
+		return S_OK;
+	}
+
+	expected<sink_writer_with_indices_t, error> make_remuxing_sink_writer(OUTPUT_INFO const &oip, GUID const &output_video_format, uint32_t const &video_quality, uint32_t const &audio_bit_rate, IMFMediaType *input_audio_media_type, filesystem::path const &first_segment, bool const &writes_digest) noexcept
+	{
+		com_ptr_nothrow<IMFSourceReader> source_reader{};
+		UNEXPECT_IF_FAILED(MFCreateSourceReaderFromURL(first_segment.c_str(), nullptr, out_ptr(source_reader)));
+
+		com_ptr_nothrow<IMFMediaType> encoded_media_type{};
+		UNEXPECT_IF_FAILED(source_reader->GetNativeMediaType(static_cast<DWORD>(MF_SOURCE_READER_FIRST_VIDEO_STREAM), 0, out_ptr(encoded_media_type)));
+
+		auto const byte_stream{ make_output_byte_stream(oip.savefile, writes_digest) };
+		if (!byte_stream) [[unlikely]] return unexpected{ byte_stream.error() };
+
+		auto const sink_writer{ make_sink_writer(oip.savefile, *encoded_media_type, output_video_format, false, byte_stream->get()) };
+		if (!sink_writer) [[unlikely]] return unexpected{ sink_writer.error() };
+
+		// Giving the same type on both sides makes the writer pass the segments through without an encoder.
+		DWORD video_index{};
+		UNEXPECT_IF_FAILED((*sink_writer)->AddStream(encoded_media_type.get(), &video_index));
+		UNEXPECT_IF_FAILED((*sink_writer)->SetInputMediaType(video_index, encoded_media_type.get(), nullptr));
+
+		DWORD audio_index{ static_cast<DWORD>(MF_SINK_WRITER_INVALID_STREAM_INDEX) };
+		if (input_audio_media_type)
+		{
+			auto const index{ configure_audio_stream(**sink_writer, audio_bit_rate, video_quality, *input_audio_media_type, output_video_format) };
+			if (!index) [[unlikely]] return unexpected{ index.error() };
+			audio_index = *index;
+		}
+
+		UNEXPECT_IF_FAILED((*sink_writer)->BeginWriting());
+
+		return sink_writer_with_indices_t{ move(*sink_writer), stream_indices_t{ video_index, audio_index } };
+	}
+
+	auto append_segment(OUTPUT_INFO const &oip, IMFSinkWriter &sink_writer, DWORD const &index, filesystem::path const &path, int64_t const &offset) noexcept
+	{
+		if (oip.func_is_abort()) return E_ABORT;
+
+		com_ptr_nothrow<IMFSourceReader> source_reader{};
+		RETURN_IF_FAILED(MFCreateSourceReaderFromURL(path.c_str(), nullptr, out_ptr(source_reader)));
+
+		for (;;)
+		{
+			DWORD flags{};
+			int64_t time{};
+			com_ptr_nothrow<IMFSample> sample{};
+			RETURN_IF_FAILED(source_reader->ReadSample(static_cast<DWORD>(MF_SOURCE_READER_FIRST_VIDEO_STREAM), 0, nullptr, &flags, &time, sample.put()));
+			if (flags & MF_SOURCE_READERF_ENDOFSTREAM) break;
+			if (!sample) continue;
+
+			sample->SetSampleTime(time + offset);
+			if (uint64_t decode_time{}; SUCCEEDED(sample->GetUINT64(MFSampleExtension_DecodeTimestamp, &decode_time)))
+				sample->SetUINT64(MFSampleExtension_DecodeTimestamp, decode_time + offset);
+
+			RETURN_IF_FAILED(sink_writer.WriteSample(index, sample.get()));
+		}
+
+		return S_OK;
+	}
+
+	auto log_segment_statistics(segment::statistics const &statistics) noexcept
+	{
+		auto const total{ max(statistics.hits + statistics.misses, 1u) };
+		aviutl_logger->info(aviutl_logger, format
+		(
+			L"Segment cache: {} hits, {} misses ({:.0f}% reused, {:.1f} MiB), {:.1f} MiB evicted.",
+			statistics.hits,
+			statistics.misses,
+			statistics.hits * 100.0 / total,
+			static_cast<double>(statistics.reused_bytes) / (1 << 20),
+			static_cast<double>(statistics.evicted_bytes) / (1 << 20)
+		).c_str());
+	}
+
+	expected<HRESULT, error> join_segments(OUTPUT_INFO const &oip, GUID const &output_video_format, output_configuration const &configuration, IMFMediaTypes const &input_media_types, span<filesystem::path const> segments, int32_t const &segment_length, wstring &&output_path, LOG_HANDLE &logger, function<void()> &&on_finalized)
+	{
+		auto const video_clock{ get_video_clock(*input_media_types.first) };
+		timebase::clock const audio_clock{ oip.audio_rate, 1 };
+
+		auto aeternum{ S_OK };
+
+		aviutl_logger->info(aviutl_logger, format(L"Joining {} segments...", segments.size()).c_str());
+
+		auto sink_writer_with_indices{ make_remuxing_sink_writer(oip, output_video_format, configuration.video_quality, configuration.audio_bit_rate, input_media_types.second.get(), segments.front(), configuration.writes_digest) };
+		if (!sink_writer_with_indices) [[unlikely]] return unexpected{ sink_writer_with_indices.error() };
+
+		auto &[sink_writer, indices] { *sink_writer_with_indices };
+
+		for (auto i{ 0 }; i < static_cast<int32_t>(segments.size()) && SUCCEEDED(aeternum); ++i)
+			aeternum = append_segment(oip, *sink_writer, indices.first, segments[i], video_clock.get_time(static_cast<int64_t>(segment_length) * i));
+
+		// AAC primes every stream it starts, so audio cut per segment would click at each join; it is encoded in one piece instead.
+		if (input_media_types.second)
+			for (auto n{ 0 }; n < oip.audio_n && SUCCEEDED(aeternum); n += oip.audio_rate)
+				aeternum = write_audio_sample(oip, *sink_writer, n, indices.second, *input_media_types.second, audio_clock);
+
+		if (aeternum == E_ABORT)
+		{
+			aviutl_logger->info(aviutl_logger, L"Aborting without finalizing...");
+			discard_sink_writer(sink_writer);
+			discard_partial_file(oip.savefile, false);
+			UNEXPECT_IF_FAILED(aeternum);
+		}
+
+		if (FAILED(aeternum))
+		{
+			aviutl_logger->info(aviutl_logger, L"Aborting...");
+			UNEXPECT_IF_FAILED(sink_writer->Finalize());
+
+			UNEXPECT_IF_FAILED(aeternum);
+		}
+
+		aviutl_logger->info(aviutl_logger, L"All segments joined. Finalizing in the background...");
+		finalize_in_background(move(sink_writer), move(output_path), get_cpu_budget(configuration), logger, move(on_finalized));
+
+		return S_FALSE;
+	}
+
+	expected<HRESULT, error> output_file_through_segment_cache(OUTPUT_INFO const &oip, GUID const &output_video_format, output_configuration const &configuration, encoding_plan const &plan, wstring &&output_path, LOG_HANDLE &logger)
+	{
+		warn_without_scene_cuts(configuration, L"exporting through the segment cache");
+
+		auto const input_media_types{ make_input_media_types(oip, output_video_format, plan) };
+
+		auto const video_clock{ get_video_clock(*input_media_types.first) };
+
+		auto const frame_bytes{ static_cast<uint64_t>(oip.w) * oip.h * 2 };
+		auto const segment_length{ get_segment_length(plan, configuration, frame_bytes) };
+		auto const seed{ get_segment_seed(oip, output_video_format, configuration, plan, segment_length) };
+
+		segment::cache cache{ configure::get_data_path(L"MFOutput.cache"), static_cast<uint64_t>(configuration.segment_cache_size) << 20 };
+
+		aviutl_logger->info(aviutl_logger, format(L"Fingerprinting segments of {} frames...", segment_length).c_str());
+
+		vector<filesystem::path> segments{};
+		// Every frame has to be rendered to know whether it changed, so it is kept as the host handed it rather than fetched twice on a miss, and converted only then.
+		vector<uint8_t> held(static_cast<size_t>(frame_bytes) * segment_length);
+		auto aeternum{ S_OK };
+
+		for (auto begin{ 0 }; begin < plan.frame_count && SUCCEEDED(aeternum); begin += segment_length)
+		{
+			hash::xxh64 fingerprint{ seed };
+			auto const end{ min(begin + segment_length, plan.frame_count) };
+
+			for (auto f{ begin }; f < end; ++f)
+			{
+				if (oip.func_is_abort())
+				{
+					aeternum = E_ABORT;
+					break;
+				}
+
+				oip.func_rest_time_disp(f, plan.frame_count);
+
+				auto const frame{ span{ get_video_frame(oip, plan, f), static_cast<size_t>(frame_bytes) } };
+				fingerprint.update(frame);
+				ranges::copy(frame, held.begin() + static_cast<ptrdiff_t>((f - begin) * frame_bytes));
+			}
+			if (FAILED(aeternum)) break;
+
+			auto const key{ fingerprint.digest() };
+			if (auto cached{ cache.find(key) })
+			{
+				segments.push_back(move(*cached));
+				continue;
+			}
+
+			if (auto const encoded{ encode_segment(oip, cache.reserve(key), output_video_format, configuration.video_quality, *input_media_types.first, plan, span{ held }.first(static_cast<size_t>((end - begin) * frame_bytes)), segment_length, video_clock) }; !encoded) [[unlikely]]
+			{
+				error_code ignored{};
+				filesystem::remove(cache.reserve(key), ignored);
+				cache.save();
+				return unexpected{ encoded.error() };
+			}
+
+			auto committed{ cache.commit(key) };
+			if (!committed) [[unlikely]] return unexpected{ error{ HRESULT_FROM_WIN32(ERROR_CANNOT_MAKE), "segment::cache::commit(key)" } };
+			segments.push_back(move(*committed));
+		}
+
+		held = {};
+
+		// Segments finished before an abort are kept; the next export gets them for free.
+		cache.save();
+		log_segment_statistics(cache.get_statistics());
+
+		UNEXPECT_IF_FAILED(aeternum);
+
+		return join_segments(oip, output_video_format, configuration, input_media_types, segments, segment_length, move(output_path), logger, {});
+	}
+
+	// A checkpoint segment is known by its first, middle and last frames; rendering only those again is what makes resuming cheap.
+	auto get_checkpoint_samples(int32_t const &begin, int32_t const &end) noexcept
+	{
+		return array{ begin, begin + (end - begin) / 2, end - 1 };
+	}
+
+	auto fingerprint_checkpoint(OUTPUT_INFO const &oip, encoding_plan const &plan, int32_t const &begin, int32_t const &end) noexcept
+	{
+		auto const frame_bytes{ static_cast<size_t>(oip.w) * oip.h * 2 };
+
+		// Each frame once and in order, as the encoding loop hashes them.
+		hash::xxh64 fingerprint{};
+		for (auto previous{ -1 }; auto const &f : get_checkpoint_samples(begin, end))
+			if (f != exchange(previous, f)) fingerprint.update({ get_video_frame(oip, plan, f), frame_bytes });
+
+		return fingerprint.digest();
+	}
+
+	expected<HRESULT, error> output_file_with_checkpoints(OUTPUT_INFO const &oip, GUID const &output_video_format, output_configuration const &configuration, encoding_plan const &plan, wstring &&output_path, LOG_HANDLE &logger)
+	{
+		warn_without_scene_cuts(configuration, L"exporting with checkpoints");
+
+		auto const input_media_types{ make_input_media_types(oip, output_video_format, plan) };
+		auto const video_clock{ get_video_clock(*input_media_types.first) };
+
+		auto const frames_per_second{ max((plan.rate + plan.scale - 1) / plan.scale, 1) };
+		auto const segment_length{ frames_per_second * max(static_cast<int32_t>(configuration.checkpoint_interval), 1) };
+		auto const segment_count{ (plan.frame_count + segment_length - 1) / segment_length };
+
+		checkpoint::journal journal
+		{
+			filesystem::path{ wstring{ oip.savefile } + L".mfop-parts" },
+			{ get_segment_seed(oip, output_video_format, configuration, plan, segment_length), segment_length, plan.frame_count, oip.audio_n }
+		};
+
+		auto aeternum{ S_OK };
+
+		// The settings and the length match, but the timeline may have been edited since; what its sampled frames render to now tells.
+		for (auto i{ 0 }; i < journal.get_sealed_count(); ++i)
+		{
+			if (oip.func_is_abort())
+			{
+				aeternum = E_ABORT;
+				break;
+			}
+
+			oip.func_rest_time_disp(i, journal.get_sealed_count());
+
+			auto const begin{ i * segment_length };
+			if (auto const recorded{ journal.get_fingerprint(i) }; !recorded || *recorded != fingerprint_checkpoint(oip, plan, begin, min(begin + segment_length, plan.frame_count)))
+			{
+				aviutl_logger->warn(aviutl_logger, format(L"Sealed segment {} no longer matches the timeline. Encoding again from there.", i).c_str());
+				journal.unseal_from(i);
+				break;
+			}
+		}
+
+		if (auto const sealed{ journal.get_sealed_count() }; sealed && SUCCEEDED(aeternum))
+			aviutl_logger->info(aviutl_logger, format(L"Resuming from frame {} ({} of {} segments already sealed).", min(sealed * segment_length, plan.frame_count), sealed, segment_count).c_str());
+
+		auto const frame_bytes{ static_cast<size_t>(oip.w) * oip.h * 2 };
+
+		for (auto i{ journal.get_sealed_count() }; i < segment_count && SUCCEEDED(aeternum); ++i)
+		{
+			auto segment_writer{ make_segment_writer(journal.get_partial_path(i), output_video_format, configuration.video_quality, *input_media_types.first, plan.encoder_thread_count, configuration.gop_length) };
+			if (!segment_writer) [[unlikely]] return unexpected{ segment_writer.error() };
+
+			auto &[sink_writer, index] { *segment_writer };
+
+			auto const begin{ i * segment_length }, end{ min(begin + segment_length, plan.frame_count) };
+			auto const samples{ get_checkpoint_samples(begin, end) };
+			hash::xxh64 fingerprint{};
+
+			// Segments are streamed straight into their own writer, so a long interval costs disk, not memory.
+			for (auto f{ begin }; f < end; ++f)
+			{
+				if (oip.func_is_abort())
+				{
+					aeternum = E_ABORT;
+					break;
+				}
+
+				oip.func_rest_time_disp(f, plan.frame_count);
+
+				auto const frame_image{ get_video_frame(oip, plan, f) };
+				if (ranges::contains(samples, f)) fingerprint.update({ frame_image, frame_bytes });
+
+				com_ptr_nothrow<IMFMediaBuffer> video_buffer{};
+				if (FAILED(aeternum = convert_video_frame(oip, frame_image, *input_media_types.first, plan, video_clock.get_duration(f), video_buffer))) break;
+				if (FAILED(aeternum = write_sample_to_sink_writer(*sink_writer, index, *video_buffer, video_clock.get_time(f - i * segment_length), video_clock.get_duration(f - i * segment_length)))) break;
+			}
+
+			if (FAILED(aeternum))
+			{
+				discard_sink_writer(sink_writer);
+				discard_partial_file(journal.get_partial_path(i).c_str(), false);
+				break;
+			}
+
+			UNEXPECT_IF_FAILED(sink_writer->Finalize());
+			sink_writer.reset();
+
+			if (!journal.seal(i, fingerprint.digest())) [[unlikely]] return unexpected{ error{ HRESULT_FROM_WIN32(ERROR_CANNOT_MAKE), "checkpoint::journal::seal(i, fingerprint.digest())" } };
+		}
+
+		if (aeternum == E_ABORT)
+			aviutl_logger->info(aviutl_logger, format(L"Aborted with {} of {} segments sealed. Exporting to the same file again resumes from there.", journal.get_sealed_count(), segment_count).c_str());
+
+		UNEXPECT_IF_FAILED(aeternum);
+
+		auto const segments{ views::iota(0, segment_count) | views::transform([&journal](int32_t const &i) { return journal.get_path(i); }) | ranges::to<vector>() };
+
+		// The parts are only removed once the joined file is known to be good; until then they are the only complete copy.
+		return join_segments(oip, output_video_format, configuration, input_media_types, segments, segment_length, move(output_path), logger, [journal] mutable { journal.remove(); });
+	}
+
+	expected<fanout_sink, error> make_fanout_sink(OUTPUT_INFO const &oip, output_configuration const &configuration, wstring &&path, uint32_t const &video_quality, uint32_t const &audio_bit_rate, bool const &is_hevc_preferable, bool const &is_accelerated, uint32_t const &encoder_thread_count) noexcept
+	{
+		auto const output_video_format{ get_suitable_output_video_format_guid(filesystem::path{ path }.extension(), is_hevc_preferable) };
+		auto plan{ plan_video_encoding(oip, output_video_format, is_accelerated, configuration) };
+		auto input_media_types{ make_input_media_types(oip, output_video_format, plan) };
+
+		// Each attempt starts the file over, and the digest with it.
+		auto const make{ [&]() -> expected<sink_writer_with_indices_t, error>
+		{
+			auto const byte_stream{ make_output_byte_stream(path.c_str(), configuration.writes_digest) };
+			if (!byte_stream) [[unlikely]] return unexpected{ byte_stream.error() };
+
+			// Throttling lets a slow encoder block its writer thread, which fills its queue and in turn holds back the host.
+			return make_initialized_sink_writer(path, output_video_format, video_quality, audio_bit_rate, input_media_types, encoder_thread_count, configuration.gop_length, true, byte_stream->get());
+		} };
+
+		auto sink_writer_with_indices{ make() };
+		if (!sink_writer_with_indices && plan.is_accelerated)
+		{
+			aviutl_logger->warn(aviutl_logger, format(L"Hardware encoder rejected the stream for {}. Retrying with software...", path).c_str());
+
+			plan = plan_video_encoding(oip, output_video_format, false, configuration);
+			input_media_types = make_input_media_types(oip, output_video_format, plan);
+			sink_writer_with_indices = make();
+		}
+		if (!sink_writer_with_indices) [[unlikely]] return unexpected{ sink_writer_with_indices.error() };
+
+		auto &[sink_writer, indices] { *sink_writer_with_indices };
+
+		auto keyframe_encoder{ configuration.detects_scene_cuts ? find_keyframe_encoder(*sink_writer, indices.first) : nullptr };
+
+		return fanout_sink{ move(path), plan, move(input_media_types), move(sink_writer), indices.first, indices.second, nullptr, {}, {}, move(keyframe_encoder) };
+	}
+
+	struct shared_memory
+	{
+		unique_handle mapping;
+		unique_mapview_ptr<uint8_t> view;
+		size_t size;
+	};
+
+	expected<shared_memory, error> create_shared_memory(wstring const &name, uint64_t const &size) noexcept
+	{
+		unique_handle mapping{ CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE | SEC_COMMIT, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), name.c_str()) };
+		if (!mapping) [[unlikely]] return unexpected{ error{ HRESULT_FROM_WIN32(GetLastError()), "CreateFileMappingW(name)" } };
+		if (GetLastError() == ERROR_ALREADY_EXISTS) [[unlikely]] return unexpected{ error{ HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS), "the shared memory name, which another export or a stale consumer still holds" } };
+
+		unique_mapview_ptr<uint8_t> view{ static_cast<uint8_t *>(MapViewOfFile(mapping.get(), FILE_MAP_ALL_ACCESS, 0, 0, static_cast<size_t>(size))) };
+		if (!view) [[unlikely]] return unexpected{ error{ HRESULT_FROM_WIN32(GetLastError()), "MapViewOfFile(mapping)" } };
+
+		return shared_memory{ move(mapping), move(view), static_cast<size_t>(size) };
+	}
+
+	expected<shared_memory, error> open_shared_memory(wstring const &name) noexcept
+	{
+		unique_handle mapping{ OpenFileMappingW(FILE_MAP_ALL_ACCESS, false, name.c_str()) };
+		if (!mapping) [[unlikely]] return unexpected{ error{ HRESULT_FROM_WIN32(GetLastError()), "OpenFileMappingW(name)" } };
+
+		unique_mapview_ptr<uint8_t> view{ static_cast<uint8_t *>(MapViewOfFile(mapping.get(), FILE_MAP_ALL_ACCESS, 0, 0, 0)) };
+		if (!view) [[unlikely]] return unexpected{ error{ HRESULT_FROM_WIN32(GetLastError()), "MapViewOfFile(mapping)" } };
+
+		// The whole section was mapped, and its size is only known from the view.
+		MEMORY_BASIC_INFORMATION information{};
+		VirtualQuery(view.get(), &information, sizeof(information));
+
+		return shared_memory{ move(mapping), move(view), information.RegionSize };
+	}
+
+	expected<shared_memory, error> create_spill_file(uint64_t const &size) noexcept
+	{
+		static atomic<uint32_t> serial{};
+
+		array<wchar_t, MAX_PATH + 1> directory{};
+		GetTempPathW(static_cast<DWORD>(directory.size()), directory.data());
+		auto const path{ format(L"{}MFOutput.spill.{}.{}.tmp", directory.data(), GetCurrentProcessId(), serial++) };
+
+		// Kept in the file cache for as long as memory allows, and gone as soon as the mapping is.
+		unique_hfile file{ CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr) };
+		if (!file) [[unlikely]] return unexpected{ error{ HRESULT_FROM_WIN32(GetLastError()), "CreateFileW(spill)" } };
+
+		unique_handle mapping{ CreateFileMappingW(file.get(), nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), nullptr) };
+		if (!mapping) [[unlikely]] return unexpected{ error{ HRESULT_FROM_WIN32(GetLastError()), "CreateFileMappingW(spill)" } };
+
+		unique_mapview_ptr<uint8_t> view{ static_cast<uint8_t *>(MapViewOfFile(mapping.get(), FILE_MAP_ALL_ACCESS, 0, 0, static_cast<size_t>(size))) };
+		if (!view) [[unlikely]] return unexpected{ error{ HRESULT_FROM_WIN32(GetLastError()), "MapViewOfFile(spill)" } };
+
+		return shared_memory{ move(mapping), move(view), static_cast<size_t>(size) };
+	}
+
+	auto constexpr fanout_sample_header_size{ sizeof(fanout_sample::index) + sizeof(fanout_sample::time) + sizeof(fanout_sample::duration) + sizeof(fanout_sample::is_keyframe) };
+
+	auto pack_fanout_sample(fanout_sample const &sample, vector<uint8_t> &bytes) noexcept
+	{
+		uint8_t *data{};
+		DWORD length{};
+		// Left empty on failure, which unpack_fanout_sample() refuses.
+		if (FAILED(sample.buffer->Lock(&data, nullptr, &length))) [[unlikely]] return;
+
+		bytes.resize(fanout_sample_header_size + length);
+		memcpy(bytes.data(), &sample.index, sizeof(sample.index));
+		memcpy(bytes.data() + sizeof(sample.index), &sample.time, sizeof(sample.time));
+		memcpy(bytes.data() + sizeof(sample.index) + sizeof(sample.time), &sample.duration, sizeof(sample.duration));
+		memcpy(bytes.data() + sizeof(sample.index) + sizeof(sample.time) + sizeof(sample.duration), &sample.is_keyframe, sizeof(sample.is_keyframe));
+		memcpy(bytes.data() + fanout_sample_header_size, data, length);
+
+		sample.buffer->Unlock();
+	}
+
+	auto unpack_fanout_sample(span<uint8_t const> bytes) noexcept
+	{
+		if (bytes.size() < fanout_sample_header_size) [[unlikely]] return optional<fanout_sample>{};
+
+		fanout_sample sample{};
+		memcpy(&sample.index, bytes.data(), sizeof(sample.index));
+		memcpy(&sample.time, bytes.data() + sizeof(sample.index), sizeof(sample.time));
+		memcpy(&sample.duration, bytes.data() + sizeof(sample.index) + sizeof(sample.time), sizeof(sample.duration));
+		memcpy(&sample.is_keyframe, bytes.data() + sizeof(sample.index) + sizeof(sample.time) + sizeof(sample.duration), sizeof(sample.is_keyframe));
+
+		// Video comes back as a plain contiguous buffer rather than a 2D one, which the writer accepts just the same.
+		auto const payload{ bytes.subspan(fanout_sample_header_size) };
+		if (FAILED(MFCreateMemoryBuffer(static_cast<DWORD>(payload.size()), out_ptr(sample.buffer)))) [[unlikely]] return optional<fanout_sample>{};
+
+		uint8_t *data{};
+		if (FAILED(sample.buffer->Lock(&data, nullptr, nullptr))) [[unlikely]] return optional<fanout_sample>{};
+		ranges::copy(payload, data);
+		sample.buffer->Unlock();
+		sample.buffer->SetCurrentLength(static_cast<DWORD>(payload.size()));
+
+		return optional{ move(sample) };
+	}
+
+	auto get_extra_output_path(wchar_t const *savefile, configure::extra_output const &output)
+	{
+		filesystem::path path{ savefile };
+		auto const extension{ output.extension.empty() ? path.extension().wstring() : output.extension };
+		return (path.parent_path() / (path.stem().wstring() + output.suffix + extension)).wstring();
+	}
+
+	auto drain_fanout_queue(IMFSinkWriter &sink_writer, ICodecAPI *const keyframe_encoder, spill::queue<fanout_sample> &queue, schedule::cpu_budget const &budget) noexcept
+	{
+		auto const com_cleanup{ CoInitializeEx_failfast() };
+		// A software encoder does its work on the thread that writes to it, so this is where the budget bites.
+		schedule::thread_scope const scope{ budget };
+
+		while (auto sample{ queue.pop() })
+			// The encoder is told here rather than by the host thread, which runs ahead of it by however much is queued.
+			if (auto const hr{ write_sample_to_sink_writer(sink_writer, sample->index, *sample->buffer, sample->time, sample->duration, sample->is_keyframe, keyframe_encoder) }; FAILED(hr))
+			{
+				queue.close();
+				return hr;
+			}
+
+		// A sample that could not be read back from a spill tier ends the queue early, and must not pass for its end.
+		return queue.has_failed() ? HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT) : S_OK;
+	}
+
+	auto push_fanout_sample(fanout_sink &sink, fanout_sample &&sample) noexcept
+	{
+		auto const begin{ chrono::steady_clock::now() };
+		auto const is_accepted{ sink.queue->push(move(sample)) };
+		sink.blocked_time += chrono::steady_clock::now() - begin;
+
+		// A refused sample means the writer failed; its own HRESULT is collected when it is joined.
+		return is_accepted ? S_OK : E_FAIL;
+	}
+
+	expected<HRESULT, error> output_file_to_many(OUTPUT_INFO const &oip, output_configuration const &configuration, LOG_HANDLE &logger)
+	{
+		vector<fanout_sink> sinks{};
+
+		// Every output is scaled alike, so the frames planned for one tell how many threads conversion takes for all.
+		auto frames{ plan_frames(oip, configuration) };
+		budget_encoder_threads(frames, static_cast<uint32_t>(1 + configuration.extra_outputs.size()));
+
+		// Outputs opened before one that could not be are left neither finished nor on disk.
+		auto const discard_made{ [&](error const &reason)
+		{
+			for (auto &sink : sinks)
+			{
+				discard_sink_writer(sink.sink_writer);
+				discard_partial_file(sink.path.c_str(), false);
+			}
+			return unexpected{ reason };
+		} };
+
+		auto main_sink{ make_fanout_sink(oip, configuration, oip.savefile, configuration.video_quality, configuration.audio_bit_rate, configuration.is_hevc_preferable, configuration.is_accelerated, frames.encoder_thread_count) };
+		if (!main_sink) [[unlikely]] return unexpected{ main_sink.error() };
+		sinks.push_back(move(*main_sink));
+
+		for (auto const &output : configuration.extra_outputs)
+		{
+			auto path{ get_extra_output_path(oip.savefile, output) };
+			if (is_finalizing(normalize_output_path(path.c_str()))) [[unlikely]] return discard_made(error{ HRESULT_FROM_WIN32(ERROR_SHARING_VIOLATION), "the background finalization of a previous export to the same file" });
+
+			auto sink{ make_fanout_sink(oip, configuration, move(path), output.video_quality, output.audio_bit_rate, output.is_hevc_preferable, output.is_accelerated, frames.encoder_thread_count) };
+			if (!sink) [[unlikely]] return discard_made(sink.error());
+			sinks.push_back(move(*sink));
+		}
+
+		auto conversions{ sinks | views::transform([](fanout_sink const &sink) { return sink.plan.input_video_format.Data1; }) | ranges::to<vector>() };
+		ranges::sort(conversions);
+		conversions.erase(ranges::unique(conversions).begin(), conversions.end());
+
+		auto const frame_bytes{ static_cast<uint64_t>(oip.w) * oip.h * 2 };
+		auto const queue_capacity{ clamp<uint64_t>(get_prefetch_memory_budget() / (frame_bytes * conversions.size()), 2, 16) };
+
+		aviutl_logger->info(aviutl_logger, format(L"Fanning out to {} outputs with {} conversions per frame and up to {} frames queued.", sinks.size(), conversions.size(), queue_capacity).c_str());
+
+		// Past the wait, what the writers have not taken yet is compressed into RAM, then into a temporary file, instead of holding the host back.
+		vector<shared_memory> spill_files{};
+		if (configuration.uses_spill)
+		{
+			for (auto i{ configuration.spill_disk ? sinks.size() : 0 }; i; --i)
+			{
+				auto file{ create_spill_file(static_cast<uint64_t>(configuration.spill_disk) << 20) };
+				if (!file) [[unlikely]] return unexpected{ file.error() };
+				spill_files.push_back(move(*file));
+			}
+
+			aviutl_logger->info(aviutl_logger, format(L"Spilling after {} ms into {} MiB of memory and {} MiB on disk per output.", configuration.spill_wait, configuration.spill_memory, configuration.spill_disk).c_str());
+		}
+
+		for (size_t i{}; i < sinks.size(); ++i)
+		{
+			auto &sink{ sinks[i] };
+			sink.queue = make_unique<spill::queue<fanout_sample>>
+			(
+				queue_capacity,
+				chrono::milliseconds{ configuration.spill_wait },
+				configuration.uses_spill ? static_cast<size_t>(configuration.spill_memory) << 20 : 0,
+				spill_files.empty() ? span<uint8_t>{} : span{ spill_files[i].view.get(), spill_files[i].size },
+				pack_fanout_sample,
+				unpack_fanout_sample
+			);
+			sink.writer = async(launch::async, drain_fanout_queue, ref(*sink.sink_writer), sink.keyframe_encoder.get(), ref(*sink.queue), cref(sink.plan.budget));
+		}
+
+		auto const video_clock{ get_video_clock(*sinks.front().input_media_types.first) };
+		timebase::clock const audio_clock{ oip.audio_rate, 1 };
+
+		auto aeternum{ S_OK };
+
+		// Every sink shares the frame rate of the configuration, so any of their plans picks the same source frames.
+		auto const &timing{ sinks.front().plan };
+
+		// One planner for all of them, so every output starts its GOPs on the same frames.
+		auto keyframes{ make_keyframe_control(configuration) };
+
+		for (auto f{ 0 }; f < timing.frame_count && SUCCEEDED(aeternum); ++f)
+		{
+			if (oip.func_is_abort())
+			{
+				aeternum = E_ABORT;
+				break;
+			}
+
+			oip.func_rest_time_disp(f, timing.frame_count);
+
+			auto const frame_image{ get_video_frame(oip, timing, f) };
+			auto const is_keyframe{ keyframes.planner && is_keyframe_due(keyframes, scene::make_thumbnail(frame_image, oip.w, oip.h)) };
+
+			// Sinks fed the same layout share one converted buffer; the encoders only read from it.
+			vector<pair<GUID, com_ptr_nothrow<IMFMediaBuffer>>> converted{};
+
+			for (auto &sink : sinks)
+			{
+				auto found{ ranges::find(converted, sink.plan.input_video_format, &decltype(converted)::value_type::first) };
+				if (found == converted.end())
+				{
+					com_ptr_nothrow<IMFMediaBuffer> video_buffer{};
+					if (FAILED(aeternum = convert_video_frame(oip, frame_image, *sink.input_media_types.first, sink.plan, video_clock.get_duration(f), video_buffer))) break;
+					found = converted.insert(converted.end(), { sink.plan.input_video_format, move(video_buffer) });
+				}
+
+				if (FAILED(aeternum = push_fanout_sample(sink, { sink.video_index, found->second, video_clock.get_time(f), video_clock.get_duration(f), is_keyframe }))) break;
+			}
+		}
+
+		if (timing.has_audio)
+			for (auto n{ 0 }; n < oip.audio_n && SUCCEEDED(aeternum); n += oip.audio_rate)
+			{
+				if (oip.func_is_abort())
+				{
+					aeternum = E_ABORT;
+					break;
+				}
+
+				oip.func_rest_time_disp(n, oip.audio_n);
+
+				com_ptr_nothrow<IMFMediaBuffer> audio_buffer{};
+				int64_t sample_duration{};
+				if ((aeternum = read_audio_buffer(oip, n, *sinks.front().input_media_types.second, audio_clock, audio_buffer, sample_duration)) != S_OK) continue;
+
+				auto const sample_time{ audio_clock.get_time(n) };
+				for (auto &sink : sinks)
+					if (FAILED(aeternum = push_fanout_sample(sink, { sink.audio_index, audio_buffer, sample_time, sample_duration, false }))) break;
+			}
+
+		for (auto &sink : sinks)
+		{
+			if (FAILED(aeternum)) sink.queue->close();
+			else sink.queue->finish();
+		}
+
+		for (auto &sink : sinks)
+			if (auto const hr{ sink.writer.get() }; FAILED(hr) && (SUCCEEDED(aeternum) || aeternum == E_FAIL))
+				aeternum = hr;
+
+		if (aeternum == E_ABORT)
+		{
+			aviutl_logger->info(aviutl_logger, L"Aborting without finalizing...");
+
+			for (auto &sink : sinks)
+			{
+				discard_sink_writer(sink.sink_writer);
+				discard_partial_file(sink.path.c_str(), false);
+			}
+
+			UNEXPECT_IF_FAILED(aeternum);
+		}
+
+		if (FAILED(aeternum))
+		{
+			aviutl_logger->info(aviutl_logger, L"Aborting...");
+
+			for (auto &sink : sinks)
+				sink.sink_writer->Finalize();
+
+			UNEXPECT_IF_FAILED(aeternum);
+		}
+
+		for (auto &sink : sinks)
+		{
+			aviutl_logger->info(aviutl_logger, format(L"{} held the host back for {:.1f} s.", sink.path, chrono::duration<double>{ sink.blocked_time }.count()).c_str());
+
+			if (configuration.uses_spill)
+			{
+				auto const statistics{ sink.queue->get_statistics() };
+				aviutl_logger->info(aviutl_logger, format
+				(
+					L"{} samples were queued as they were, {} compressed in memory and {} spilled to disk; compressed {:.2f}:1, spilled at {:.0f} MiB/s, longest wait {:.1f} ms.",
+					statistics.raw_items,
+					statistics.compressed_items,
+					statistics.spilled_items,
+					statistics.get_compression_ratio(),
+					statistics.get_spill_bandwidth(),
+					chrono::duration<double, milli>{ statistics.peak_wait }.count()
+				).c_str());
+
+				if (statistics.overflows)
+					aviutl_logger->warn(aviutl_logger, format(L"Both spill tiers were full {} times, and the host waited on the writer regardless. Consider raising [spill] disk.", statistics.overflows).c_str());
+			}
+
+			auto path{ normalize_output_path(sink.path.c_str()) };
+			finalize_in_background(move(sink.sink_writer), move(path), sink.plan.budget, logger);
+		}
+
+		report_keyframes(keyframes);
+		aviutl_logger->info(aviutl_logger, L"All samples sent. Finalizing in the background...");
+
+		return S_FALSE;
+	}
+
+	expected<HRESULT, error> output_audio_only(OUTPUT_INFO const &oip, GUID const &output_video_format, output_configuration const &configuration, wstring &&output_path, LOG_HANDLE &logger)
+	{
+		auto const input_media_type{ make_input_audio_media_type(oip.audio_ch, oip.audio_rate, output_video_format) };
+		timebase::clock const audio_clock{ oip.audio_rate, 1 };
+
+		auto const byte_stream{ make_output_byte_stream(oip.savefile, configuration.writes_digest) };
+		if (!byte_stream) [[unlikely]] return unexpected{ byte_stream.error() };
+
+		auto sink_writer{ make_sink_writer(oip.savefile, *input_media_type, output_video_format, false, byte_stream->get()) };
+		if (!sink_writer) [[unlikely]] return unexpected{ sink_writer.error() };
+
+		auto const index{ configure_audio_stream(**sink_writer, configuration.audio_bit_rate, configuration.video_quality, *input_media_type, output_video_format) };
+		if (!index) [[unlikely]] return unexpected{ index.error() };
+
+		UNEXPECT_IF_FAILED((*sink_writer)->BeginWriting());
+
+		// No frame is ever requested, so the host skips rendering entirely and only mixes the audio.
+		aviutl_logger->info(aviutl_logger, L"Sending audio samples to the writer without video...");
+
+		auto aeternum{ S_OK };
+
+		for (auto n{ 0 }; n < oip.audio_n && SUCCEEDED(aeternum); n += oip.audio_rate)
+			aeternum = write_audio_sample(oip, **sink_writer, n, *index, *input_media_type, audio_clock);
+
+		if (aeternum == E_ABORT)
+		{
+			aviutl_logger->info(aviutl_logger, L"Aborting without finalizing...");
+			discard_sink_writer(*sink_writer);
+			discard_partial_file(oip.savefile, false);
+			UNEXPECT_IF_FAILED(aeternum);
+		}
+
+		if (FAILED(aeternum))
+		{
+			aviutl_logger->info(aviutl_logger, L"Aborting...");
+			UNEXPECT_IF_FAILED((*sink_writer)->Finalize());
+
+			UNEXPECT_IF_FAILED(aeternum);
+		}
+
+		aviutl_logger->info(aviutl_logger, L"All samples sent. Finalizing in the background...");
+		finalize_in_background(move(*sink_writer), move(output_path), get_cpu_budget(configuration), logger);
+
+		return S_FALSE;
+	}
+
+	auto get_y4m_format(encoding_plan const &plan)
+	{
+		// Host frames are YUY2 and go out as 4:2:2 untouched; only the scaler, which works on NV12, turns them into 4:2:0.
+		return raw::y4m_format{ { plan.width, plan.height }, { plan.rate, plan.scale }, plan.scaler ? raw::chroma::yuv420 : raw::chroma::yuv422 };
+	}
+
+	expected<HRESULT, error> output_raw_file(OUTPUT_INFO const &oip, output_configuration const &configuration)
+	{
+		auto const begin{ chrono::steady_clock::now() };
+
+		filesystem::path const video_path{ oip.savefile };
+		auto const audio_path{ filesystem::path{ video_path }.replace_extension(L".wav") };
+		auto const streams{ get_stream_selection(oip, configuration, video_path.extension()) };
+
+		if (!configuration.extra_outputs.empty())
+			aviutl_logger->warn(aviutl_logger, L"Extra outputs are skipped when exporting raw samples.");
+
+		auto aeternum{ S_OK };
+		uint64_t written_size{};
+		vector<pair<filesystem::path, hash::blake3_file *>> written_paths{};
+
+		// Each file is hashed as it goes out; only the header a writer patches on close is read back.
+		hash::blake3_file video_hasher{}, audio_hasher{};
+		auto const observe{ [&configuration](hash::blake3_file &hasher)
+		{
+			return configuration.writes_digest ? raw::write_observer{ [&hasher](uint64_t const &position, span<uint8_t const> bytes) { hasher.write(position, bytes); } } : raw::write_observer{};
+		} };
+
+		// Nothing here encodes, so each stream is written in one sequential pass as fast as the host renders and the disk takes it.
+		if (streams != stream_selection::audio_only)
+		{
+			auto const plan{ plan_frames(oip, configuration) };
+
+			raw::y4m_writer video{ video_path, get_y4m_format(plan), observe(video_hasher) };
+			written_paths.emplace_back(video_path, &video_hasher);
+
+			vector<uint8_t> scaled(plan.scaler ? static_cast<size_t>(plan.width) * plan.height * 3 / 2 : 0);
+
+			for (auto f{ 0 }; f < plan.frame_count && video && SUCCEEDED(aeternum); ++f)
+			{
+				if (oip.func_is_abort())
+				{
+					aeternum = E_ABORT;
+					break;
+				}
+
+				oip.func_rest_time_disp(f, plan.frame_count);
+
+				auto const frame_image{ get_video_frame(oip, plan, f) };
+
+				if (plan.scaler)
+				{
+					plan.scaler->scale(yuy2_to_nv12(frame_image, { oip.w, oip.h }).get(), oip.w, scaled.data(), plan.width);
+					if (!video.write_nv12(scaled.data())) aeternum = HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+				}
+				else if (!video.write_yuy2(frame_image))
+					aeternum = HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+			}
+
+			if (!video.close() && SUCCEEDED(aeternum)) aeternum = HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+			written_size += video.get_size();
+		}
+
+		if (streams != stream_selection::video_only && SUCCEEDED(aeternum))
+		{
+			auto const block_alignment{ get_pcm_block_alignment(oip.audio_ch, audio_bits_per_sample) };
+
+			raw::wav_writer audio{ audio_path, oip.audio_ch, oip.audio_rate, observe(audio_hasher) };
+			written_paths.emplace_back(audio_path, &audio_hasher);
+
+			for (auto n{ 0 }; n < oip.audio_n && audio && SUCCEEDED(aeternum); n += oip.audio_rate)
+			{
+				if (oip.func_is_abort())
+				{
+					aeternum = E_ABORT;
+					break;
+				}
+
+				oip.func_rest_time_disp(n, oip.audio_n);
+
+				int32_t actual_samples{};
+				auto const audio_data{ static_cast<uint8_t const *>(oip.func_get_audio(n, oip.audio_rate, &actual_samples, WAVE_FORMAT_PCM)) };
+				if (!actual_samples) break;
+
+				if (!audio.write({ audio_data, static_cast<size_t>(actual_samples) * block_alignment })) aeternum = HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+			}
+
+			if (!audio.close() && SUCCEEDED(aeternum)) aeternum = HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+			written_size += audio.get_size();
+		}
+
+		if (FAILED(aeternum))
+		{
+			aviutl_logger->info(aviutl_logger, L"Aborting...");
+
+			for (auto const &path : written_paths | views::keys)
+				discard_partial_file(path.c_str(), false);
+
+			UNEXPECT_IF_FAILED(aeternum);
+		}
+
+		chrono::duration<double> const elapsed{ chrono::steady_clock::now() - begin };
+		aviutl_logger->info(aviutl_logger, format
+		(
+			L"Wrote {:.1f} MiB of raw samples in {:.1f} s ({:.0f} MiB/s).",
+			static_cast<double>(written_size) / (1 << 20),
+			elapsed.count(),
+			static_cast<double>(written_size) / (1 << 20) / max(elapsed.count(), 0.001)
+		).c_str());
+
+		if (configuration.writes_digest)
+			for (auto const &[path, hasher] : written_paths)
+				if (auto const hr{ digest::write_digest_of(path, *hasher) }; FAILED(hr)) [[unlikely]] return unexpected{ error{ hr, "the digest sidecar" } };
+
+		return S_OK;
+	}
+
+	// Hands the host's audio up to sample `until` to `send` a second at a time, so it can follow the video a frame at a time.
+	HRESULT send_audio_until(OUTPUT_INFO const &oip, int32_t &audio_sent, int32_t const &until, function<HRESULT(int32_t const &, span<uint8_t const>)> const &send) noexcept
+	{
+		auto const block_alignment{ get_pcm_block_alignment(oip.audio_ch, audio_bits_per_sample) };
+
+		// The host's buffer lasts only until the next call into it, and waiting for room to send to asks the host whether to abort.
+		vector<uint8_t> held{};
+
+		while (audio_sent < min(until, oip.audio_n))
+		{
+			int32_t actual_samples{};
+			auto const audio_data{ static_cast<uint8_t const *>(oip.func_get_audio(audio_sent, min(until - audio_sent, oip.audio_rate), &actual_samples, WAVE_FORMAT_PCM)) };
+			if (!actual_samples) break;
+
+			held.assign(audio_data, audio_data + static_cast<size_t>(actual_samples) * block_alignment);
+			RETURN_IF_FAILED(send(audio_sent, held));
+			audio_sent += actual_samples;
+		}
+
+		return S_OK;
+	}
+
+	auto get_audio_sample_at(OUTPUT_INFO const &oip, encoding_plan const &plan, int32_t const &f) noexcept
+	{
+		// Every sample that starts before frame f does, decided on the exact rates rather than on rounded timestamps.
+		return static_cast<int32_t>(timebase::clock{ oip.audio_rate, 1 }.count_before(timebase::clock{ plan.rate, plan.scale }, f));
+	}
+
+	HRESULT write_to_pipe(pipe::double_buffered_writer &writer, span<uint8_t const> data) noexcept
+	{
+		auto buffer{ span<uint8_t>{} };
+		RETURN_IF_FAILED(writer.acquire(data.size(), buffer));
+		ranges::copy(data, buffer.begin());
+		return writer.submit();
+	}
+
+	expected<HRESULT, error> output_file_through_pipe(OUTPUT_INFO const &oip, output_configuration const &configuration)
+	{
+		auto const begin{ chrono::steady_clock::now() };
+
+		if (!configuration.extra_outputs.empty())
+			aviutl_logger->warn(aviutl_logger, L"Extra outputs are skipped when exporting through a pipe.");
+		warn_without_scene_cuts(configuration, L"exporting through a pipe");
+
+		auto const plan{ plan_frames(oip, configuration) };
+		auto const y4m{ get_y4m_format(plan) };
+		auto const log_path{ configure::get_data_path(L"MFOutput.pipe.log") };
+
+		aviutl_logger->info(aviutl_logger, format(L"Launching the encoder: {}", configuration.pipe_command).c_str());
+
+		auto process{ pipe::launch(configuration.pipe_command, oip.savefile, log_path, [&oip] { return oip.func_is_abort(); }) };
+		if (!process) [[unlikely]] return unexpected{ process.error() };
+
+		auto &video{ *process->video };
+		auto const audio{ plan.has_audio ? process->audio.get() : nullptr };
+		auto aeternum{ write_to_pipe(video, { reinterpret_cast<uint8_t const *>(y4m.get_header().data()), y4m.get_header().size() }) };
+		if (audio && SUCCEEDED(aeternum)) aeternum = write_to_pipe(*audio, raw::make_wav_header(oip.audio_ch, oip.audio_rate));
+
+		// Audio follows the video a frame at a time, so an encoder reading both pipes in step never waits on the one that is behind.
+		auto audio_sent{ 0 };
+		auto const send_audio{ [&audio](int32_t const &, span<uint8_t const> samples) { return write_to_pipe(*audio, samples); } };
+
+		vector<uint8_t> scaled(plan.scaler ? static_cast<size_t>(plan.width) * plan.height * 3 / 2 : 0);
+
+		for (auto f{ 0 }; f < plan.frame_count && SUCCEEDED(aeternum); ++f)
+		{
+			if (oip.func_is_abort())
+			{
+				aeternum = E_ABORT;
+				break;
+			}
+
+			oip.func_rest_time_disp(f, plan.frame_count);
+
+			// Packing straight into the idle pipe buffer is the only copy the frame goes through.
+			// The buffer comes first: waiting for it asks the host whether to abort, and any host call invalidates the frame it handed out.
+			auto frame{ span<uint8_t>{} };
+			aeternum = video.acquire(y4m.get_frame_size(), frame);
+			if (FAILED(aeternum)) break;
+
+			auto const frame_image{ get_video_frame(oip, plan, f) };
+			if (plan.scaler) plan.scaler->scale(yuy2_to_nv12(frame_image, { oip.w, oip.h }).get(), oip.w, scaled.data(), plan.width);
+
+			if (plan.scaler)
+				y4m.pack_nv12(scaled.data(), frame);
+			else
+				y4m.pack_yuy2(frame_image, frame);
+
+			aeternum = video.submit();
+
+			if (audio && SUCCEEDED(aeternum)) aeternum = send_audio_until(oip, audio_sent, get_audio_sample_at(oip, plan, f + 1), send_audio);
+		}
+
+		if (audio && SUCCEEDED(aeternum)) aeternum = send_audio_until(oip, audio_sent, oip.audio_n, send_audio);
+
+		if (FAILED(aeternum))
+		{
+			aviutl_logger->info(aviutl_logger, L"Aborting...");
+			pipe::terminate(*process);
+			discard_partial_file(oip.savefile, false);
+
+			if (aeternum == HRESULT_FROM_WIN32(ERROR_BROKEN_PIPE)) [[unlikely]] return unexpected{ error{ aeternum, "the encoder, which exited early; see MFOutput.pipe.log" } };
+			UNEXPECT_IF_FAILED(aeternum);
+		}
+
+		auto const exit_code{ pipe::finish(*process) };
+		if (!exit_code) [[unlikely]]
+		{
+			aviutl_logger->info(aviutl_logger, L"Aborting...");
+			pipe::terminate(*process);
+			discard_partial_file(oip.savefile, false);
+			return unexpected{ exit_code.error() };
+		}
+		if (*exit_code) [[unlikely]] return unexpected{ error{ E_FAIL, format("the encoder, which exited with {}; see MFOutput.pipe.log", *exit_code) } };
+
+		chrono::duration<double> const elapsed{ chrono::steady_clock::now() - begin };
+		auto const report{ [&elapsed](wstring_view name, pipe::statistics const &statistics)
+		{
+			aviutl_logger->info(aviutl_logger, format
+			(
+				L"Piped {:.1f} MiB of {} ({:.0f} MiB/s), stalled for {:.1f} s waiting on the encoder.",
+				static_cast<double>(statistics.written_bytes) / (1 << 20),
+				name,
+				static_cast<double>(statistics.written_bytes) / (1 << 20) / max(elapsed.count(), 0.001),
+				chrono::duration<double>{ statistics.stalled_time }.count()
+			).c_str());
+		} };
+
+		report(L"video", video.get_statistics());
+		if (audio) report(L"audio", audio->get_statistics());
+
+		return S_OK;
+	}
+
+	expected<HRESULT, error> output_file_to_frame_server(OUTPUT_INFO const &oip, output_configuration const &configuration)
+	{
+		if (!configuration.extra_outputs.empty())
+			aviutl_logger->warn(aviutl_logger, L"Extra outputs are skipped when serving frames.");
+		warn_without_scene_cuts(configuration, L"serving frames");
+
+		auto const plan{ plan_frames(oip, configuration) };
+		auto const y4m{ get_y4m_format(plan) };
+		auto const block_alignment{ get_pcm_block_alignment(oip.audio_ch, audio_bits_per_sample) };
+
+		// A slot holds a frame or up to a second of audio, whichever is larger.
+		auto const slot_count{ clamp(configuration.frame_server_slots, 2u, 256u) };
+		auto const slot_capacity{ max<size_t>(y4m.get_frame_size(), plan.has_audio ? static_cast<size_t>(block_alignment) * oip.audio_rate : 0) };
+		auto const mapping_size{ static_cast<uint64_t>(ring::get_mapping_size(slot_count, slot_capacity)) };
+		auto const mapping_name{ format(LR"(Local\{})", configuration.frame_server_name) };
+
+		auto const memory{ create_shared_memory(mapping_name, mapping_size) };
+		if (!memory) [[unlikely]] return unexpected{ memory.error() };
+
+		// A consumer that stops reading for this long, most likely because it crashed, is dropped rather than holding the export up forever.
+		ring::producer producer{ { memory->view.get(), memory->size }, slot_count, slot_capacity, { y4m.get_header(), oip.audio_ch, oip.audio_rate }, 10s };
+
+		aviutl_logger->info(aviutl_logger, format(L"Waiting for a consumer on {} ({} slots of {:.1f} MiB)...", mapping_name, slot_count, static_cast<double>(slot_capacity) / (1 << 20)).c_str());
+
+		for (auto backoff{ ring::backoff{} }; !producer.get_consumer_count(); backoff.wait())
+			if (oip.func_is_abort())
+			{
+				producer.close(false);
+				return unexpected{ error{ E_ABORT, "waiting for a frame server consumer" } };
+			}
+
+		auto const begin{ chrono::steady_clock::now() };
+		auto stalled_time{ chrono::nanoseconds{} };
+		auto published_bytes{ uint64_t{} };
+
+		// The slowest consumer sets the pace: a slot is not reused until all of them have acknowledged it.
+		auto const acquire{ [&](size_t const &size, span<uint8_t> &buffer) -> HRESULT
+		{
+			// The ring never hands out less than asked for, so this would otherwise wait forever.
+			if (size > producer.get_slot_capacity()) [[unlikely]] return HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+
+			buffer = producer.try_acquire(size);
+			if (buffer.empty())
+			{
+				auto const stall_begin{ chrono::steady_clock::now() };
+				for (auto backoff{ ring::backoff{} }; buffer.empty(); buffer = producer.try_acquire(size))
+				{
+					if (oip.func_is_abort()) return E_ABORT;
+					backoff.wait();
+				}
+				stalled_time += chrono::steady_clock::now() - stall_begin;
+			}
+
+			if (!producer.get_consumer_count()) [[unlikely]]
+			{
+				aviutl_logger->warn(aviutl_logger, L"Every consumer stopped reading and was dropped. Stopping...");
+				return HRESULT_FROM_WIN32(ERROR_NO_DATA);
+			}
+
+			published_bytes += buffer.size();
+			return S_OK;
+		} };
+
+		auto audio_sent{ 0 };
+		auto const publish_audio{ [&](int32_t const &position, span<uint8_t const> samples) -> HRESULT
+		{
+			auto slot{ span<uint8_t>{} };
+			RETURN_IF_FAILED(acquire(samples.size(), slot));
+			ranges::copy(samples, slot.begin());
+			producer.publish(ring::kind::audio, position);
+			return S_OK;
+		} };
+
+		auto aeternum{ S_OK };
+		vector<uint8_t> scaled(plan.scaler ? static_cast<size_t>(plan.width) * plan.height * 3 / 2 : 0);
+
+		for (auto f{ 0 }; f < plan.frame_count && SUCCEEDED(aeternum); ++f)
+		{
+			if (oip.func_is_abort())
+			{
+				aeternum = E_ABORT;
+				break;
+			}
+
+			oip.func_rest_time_disp(f, plan.frame_count);
+
+			// Frames are packed straight into the shared slot; consumers read them from there without another copy.
+			// The slot comes first: waiting for it asks the host whether to abort, and any host call invalidates the frame it handed out.
+			auto frame{ span<uint8_t>{} };
+			aeternum = acquire(y4m.get_frame_size(), frame);
+			if (FAILED(aeternum)) break;
+
+			auto const frame_image{ get_video_frame(oip, plan, f) };
+			if (plan.scaler) plan.scaler->scale(yuy2_to_nv12(frame_image, { oip.w, oip.h }).get(), oip.w, scaled.data(), plan.width);
+
+			if (plan.scaler)
+				y4m.pack_nv12(scaled.data(), frame);
+			else
+				y4m.pack_yuy2(frame_image, frame);
+
+			producer.publish(ring::kind::video, f);
+
+			if (plan.has_audio) aeternum = send_audio_until(oip, audio_sent, get_audio_sample_at(oip, plan, f + 1), publish_audio);
+		}
+
+		if (plan.has_audio && SUCCEEDED(aeternum)) aeternum = send_audio_until(oip, audio_sent, oip.audio_n, publish_audio);
+
+		producer.close(SUCCEEDED(aeternum));
+
+		if (FAILED(aeternum))
+		{
+			aviutl_logger->info(aviutl_logger, L"Aborting...");
+			UNEXPECT_IF_FAILED(aeternum);
+		}
+
+		chrono::duration<double> const elapsed{ chrono::steady_clock::now() - begin };
+		aviutl_logger->info(aviutl_logger, format
+		(
+			L"Served {:.1f} MiB to {} consumer(s) ({:.0f} MiB/s), stalled for {:.1f} s waiting on them.",
+			static_cast<double>(published_bytes) / (1 << 20),
+			producer.get_consumer_count(),
+			static_cast<double>(published_bytes) / (1 << 20) / max(elapsed.count(), 0.001),
+			chrono::duration<double>{ stalled_time }.count()
+		).c_str());
+
+		return S_OK;
+	}
+
+	// Audio follows the video a frame at a time; written after it, every fragment or packet the sink cuts would hold video alone.
+	HRESULT write_interleaved_samples(OUTPUT_INFO const &oip, IMFSinkWriter &sink_writer, stream_indices_t const &indices, GUID const &output_video_format, encoding_plan const &plan, keyframe_control &keyframes) noexcept
+	{
+		auto const input_media_types{ make_input_media_types(oip, output_video_format, plan) };
+		auto const video_clock{ get_video_clock(*input_media_types.first) };
+		timebase::clock const audio_clock{ oip.audio_rate, 1 };
+		auto const block_alignment{ get_pcm_block_alignment(oip.audio_ch, audio_bits_per_sample) };
+
+		auto depth_controller{ buffering::depth_controller{ static_cast<uint64_t>(oip.w) * oip.h * 2, get_prefetch_memory_budget() } };
+		apply_buffer_depth(oip, depth_controller.initial());
+
+		auto audio_sent{ 0 };
+		auto const send_audio{ [&](int32_t const &n, span<uint8_t const> samples) { return write_pcm_sample(sink_writer, indices.second, *input_media_types.second, audio_clock, block_alignment, n, samples); } };
+
+		auto aeternum{ S_OK };
+
+		for (auto f{ 0 }; f < plan.frame_count && SUCCEEDED(aeternum); ++f)
+		{
+			aeternum = write_video_sample(oip, sink_writer, f, indices.first, *input_media_types.first, plan, video_clock, depth_controller, keyframes);
+			if (plan.has_audio && SUCCEEDED(aeternum)) aeternum = send_audio_until(oip, audio_sent, get_audio_sample_at(oip, plan, f + 1), send_audio);
+
+			if (auto const depth{ depth_controller.update() })
+				apply_buffer_depth(oip, *depth);
+		}
+
+		if (plan.has_audio && SUCCEEDED(aeternum)) aeternum = send_audio_until(oip, audio_sent, oip.audio_n, send_audio);
+
+		return aeternum;
+	}
+
+	// Hands what the writer's media sink writes to the segmenter, which cuts it into segments as it arrives.
+	struct package_sink final : stream::byte_sink
+	{
+		package_sink(filesystem::path const &manifest_path, double const &target_duration) :
+			segmenter{ manifest_path, target_duration },
+			lock{},
+			result{}
+		{
+		}
+
+		HRESULT write(uint64_t const &position, span<uint8_t const> bytes) noexcept override
+		{
+			scoped_lock const guard{ lock };
+			return segmenter.write(position, bytes) ? S_OK : HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+		}
+
+		HRESULT read(uint64_t const &position, span<uint8_t> bytes, size_t &read_size) noexcept override
+		{
+			scoped_lock const guard{ lock };
+			read_size = segmenter.read(position, bytes);
+			return S_OK;
+		}
+
+		// The media sink may or may not close its stream when it shuts down, so whoever comes first finishes the segments.
+		HRESULT close() noexcept override
+		{
+			scoped_lock const guard{ lock };
+			if (!result) result = segmenter.finish() ? S_OK : HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+			return *result;
+		}
+
+		void discard() noexcept
+		{
+			scoped_lock const guard{ lock };
+			segmenter.discard();
+			result = E_ABORT;
+		}
+
+		package::statistics get_statistics() noexcept
+		{
+			scoped_lock const guard{ lock };
+			return segmenter.get_statistics();
+		}
+
+	private:
+		package::segmenter segmenter;
+		mutex lock;
+		optional<HRESULT> result;
+	};
+
+	expected<pair<shared_ptr<package_sink>, sink_writer_with_indices_t>, error> make_packaging_sink_writer(OUTPUT_INFO const &oip, output_configuration const &configuration, encoding_plan const &plan, uint32_t const &segment_duration, uint32_t const &gop_size) noexcept
+	{
+		// Each attempt starts the init segment over, in case a writer that failed had already begun it.
+		auto sink{ make_shared<package_sink>(oip.savefile, static_cast<double>(segment_duration)) };
+
+		com_ptr_nothrow<IMFByteStream> byte_stream{};
+		UNEXPECT_IF_FAILED(stream::make_byte_stream(sink, true, true, byte_stream));
+
+		auto sink_writer{ make_initialized_sink_writer(oip.savefile, MFVideoFormat_H264, configuration.video_quality, configuration.audio_bit_rate, make_input_media_types(oip, MFVideoFormat_H264, plan), plan.encoder_thread_count, gop_size, false, byte_stream.get()) };
+		if (!sink_writer) [[unlikely]] return unexpected{ sink_writer.error() };
+
+		return pair{ move(sink), move(*sink_writer) };
+	}
+
+	expected<HRESULT, error> output_packaged_file(OUTPUT_INFO const &oip, output_configuration const &configuration, wstring &&output_path, LOG_HANDLE &logger)
+	{
+		if (!configuration.extra_outputs.empty())
+			aviutl_logger->warn(aviutl_logger, L"Extra outputs are skipped when packaging into segments.");
+
+		if (get_stream_selection(oip, configuration) == stream_selection::audio_only) [[unlikely]] return unexpected{ error{ E_INVALIDARG, "packaging, which cuts segments on the video stream" } };
+
+		auto plan{ plan_video_encoding(oip, MFVideoFormat_H264, configuration.is_accelerated, configuration) };
+		budget_encoder_threads(plan);
+
+		auto const segment_duration{ max(configuration.segment_duration, 1u) };
+		// Segments can only start at keyframes, so unless told otherwise the encoder puts one wherever a segment is due.
+		auto const gop_size{ configuration.gop_length ? configuration.gop_length : static_cast<uint32_t>(max(llround(static_cast<double>(segment_duration) * plan.rate / plan.scale), 1ll)) };
+
+		auto packaging{ [&]
+		{
+			auto result{ make_packaging_sink_writer(oip, configuration, plan, segment_duration, gop_size) };
+			if (result || !plan.is_accelerated) return result;
+
+			aviutl_logger->warn(aviutl_logger, L"Hardware encoder rejected the stream. Retrying with software...");
+
+			plan = plan_video_encoding(oip, MFVideoFormat_H264, false, configuration);
+			return make_packaging_sink_writer(oip, configuration, plan, segment_duration, gop_size);
+		}() };
+		if (!packaging) [[unlikely]] return unexpected{ packaging.error() };
+
+		auto &[sink, sink_writer_with_indices] { *packaging };
+		auto &[sink_writer, indices] { sink_writer_with_indices };
+
+		auto keyframes{ make_keyframe_control(configuration) };
+		if (keyframes.planner) keyframes.encoder = find_keyframe_encoder(*sink_writer, indices.first);
+
+		aviutl_logger->info(aviutl_logger, format(L"Packaging into segments of about {} s...", segment_duration).c_str());
+
+		auto const aeternum{ write_interleaved_samples(oip, *sink_writer, indices, MFVideoFormat_H264, plan, keyframes) };
+
+		if (FAILED(aeternum))
+		{
+			aviutl_logger->info(aviutl_logger, L"Aborting...");
+
+			discard_sink_writer(sink_writer);
+			// Kept, the segments cut so far stay listed in a manifest that ends where the export stopped.
+			if (configuration.keeps_partial_file)
+				sink->close();
+			else
+				sink->discard();
+
+			UNEXPECT_IF_FAILED(aeternum);
+		}
+
+		report_keyframes(keyframes);
+
+		aviutl_logger->info(aviutl_logger, L"All samples sent. Finalizing in the background...");
+		finalize_in_background(move(sink_writer), move(output_path), plan.budget, logger, [sink = sink, &logger]
+		{
+			if (auto const hr{ sink->close() }; FAILED(hr))
+			{
+				logger.error(&logger, format(L"FAILED TO FINISH THE SEGMENTS: 0x{:08x}.", static_cast<uint32_t>(hr)).c_str());
+				return;
+			}
+
+			auto const statistics{ sink->get_statistics() };
+			logger.info(&logger, format(L"Cut {:.1f} MiB into {} segments, the longest {:.2f} s.", static_cast<double>(statistics.written_bytes) / (1 << 20), statistics.segments, statistics.longest_duration).c_str());
+		});
+
+		return S_FALSE;
+	}
+
+	expected<pair<shared_ptr<network::ts_sender>, sink_writer_with_indices_t>, error> make_streaming_sink_writer(OUTPUT_INFO const &oip, output_configuration const &configuration, GUID const &output_video_format, encoding_plan const &plan) noexcept
+	{
+		// Each attempt connects anew, since a writer that failed may have closed the stream it was given.
+		auto sender{ network::ts_sender::connect(configuration.stream_address, configuration.is_stream_realtime) };
+		if (!sender) [[unlikely]] return unexpected{ sender.error() };
+
+		// The transport stream sink only ever appends, so the stream need not seek or read back.
+		com_ptr_nothrow<IMFByteStream> byte_stream{};
+		UNEXPECT_IF_FAILED(stream::make_byte_stream(*sender, false, false, byte_stream));
+
+		// Throttled, the writer blocks once the sender's queue is full instead of buffering the whole export in memory.
+		auto sink_writer{ make_initialized_sink_writer(oip.savefile, output_video_format, configuration.video_quality, configuration.audio_bit_rate, make_input_media_types(oip, output_video_format, plan), plan.encoder_thread_count, configuration.gop_length, true, byte_stream.get(), MFTranscodeContainerType_MPEG2) };
+		if (!sink_writer) [[unlikely]] return unexpected{ sink_writer.error() };
+
+		return pair{ move(*sender), move(*sink_writer) };
+	}
+
+	expected<HRESULT, error> output_file_to_stream(OUTPUT_INFO const &oip, output_configuration const &configuration)
+	{
+		if (!configuration.extra_outputs.empty())
+			aviutl_logger->warn(aviutl_logger, L"Extra outputs are skipped when streaming.");
+
+		if (get_stream_selection(oip, configuration) == stream_selection::audio_only) [[unlikely]] return unexpected{ error{ E_INVALIDARG, "streaming, which paces the transport stream by the video" } };
+
+		auto const output_video_format{ configuration.is_hevc_preferable ? MFVideoFormat_HEVC : MFVideoFormat_H264 };
+		auto plan{ plan_video_encoding(oip, output_video_format, configuration.is_accelerated, configuration) };
+		budget_encoder_threads(plan);
+
+		auto streaming{ [&]
+		{
+			auto result{ make_streaming_sink_writer(oip, configuration, output_video_format, plan) };
+			if (result || !plan.is_accelerated) return result;
+
+			aviutl_logger->warn(aviutl_logger, L"Hardware encoder rejected the stream. Retrying with software...");
+
+			plan = plan_video_encoding(oip, output_video_format, false, configuration);
+			return make_streaming_sink_writer(oip, configuration, output_video_format, plan);
+		}() };
+		if (!streaming) [[unlikely]] return unexpected{ streaming.error() };
+
+		auto &[sender, sink_writer_with_indices] { *streaming };
+		auto &[sink_writer, indices] { sink_writer_with_indices };
+
+		auto keyframes{ make_keyframe_control(configuration) };
+		if (keyframes.planner) keyframes.encoder = find_keyframe_encoder(*sink_writer, indices.first);
+
+		aviutl_logger->info(aviutl_logger, format(L"Streaming MPEG-TS to {} {}...", configuration.stream_address, configuration.is_stream_realtime ? L"in real time" : L"as fast as possible").c_str());
+
+		auto const aeternum{ write_interleaved_samples(oip, *sink_writer, indices, output_video_format, plan, keyframes) };
+
+		if (FAILED(aeternum))
+		{
+			aviutl_logger->info(aviutl_logger, L"Aborting...");
+
+			discard_sink_writer(sink_writer);
+			sender->abandon();
+
+			UNEXPECT_IF_FAILED(aeternum);
+		}
+
+		report_keyframes(keyframes);
+
+		// Nothing is left behind to finalize later; what the encoders still hold has to go out before the export is over.
+		UNEXPECT_IF_FAILED(sink_writer->Finalize());
+		UNEXPECT_IF_FAILED(sender->close());
+
+		auto const statistics{ sender->get_statistics() };
+		aviutl_logger->info(aviutl_logger, format
+		(
+			L"Sent {:.1f} MiB in {} datagrams over {:.1f} s ({:.2f} Mbit/s), with {:.2f} ms of jitter and at most {:.1f} ms behind the stream's clock.",
+			static_cast<double>(statistics.bytes) / (1 << 20),
+			statistics.datagrams,
+			statistics.elapsed,
+			statistics.get_bit_rate() / 1e6,
+			statistics.jitter * 1e3,
+			max(statistics.max_lateness, 0.0) * 1e3
+		).c_str());
+
+		return S_OK;
+	}
+
+	auto to_utf8(wstring_view text)
+	{
+		string utf8(static_cast<size_t>(WideCharToMultiByte(CP_UTF8, 0, text.data(), static_cast<int32_t>(text.size()), nullptr, 0, nullptr, nullptr)), '\0');
+		WideCharToMultiByte(CP_UTF8, 0, text.data(), static_cast<int32_t>(text.size()), utf8.data(), static_cast<int32_t>(utf8.size()), nullptr, nullptr);
+		return utf8;
+	}
+
+	auto from_utf8(string_view text)
+	{
+		wstring wide(static_cast<size_t>(MultiByteToWideChar(CP_UTF8, 0, text.data(), static_cast<int32_t>(text.size()), nullptr, 0)), L'\0');
+		MultiByteToWideChar(CP_UTF8, 0, text.data(), static_cast<int32_t>(text.size()), wide.data(), static_cast<int32_t>(wide.size()));
+		return wide;
+	}
+
+	auto to_status(HRESULT const &hr, string_view where)
+	{
+		return SUCCEEDED(hr) ? protocol::status{} : protocol::status{ hr, string{ where } };
+	}
+
+	// The worker side of the encoder host: the same sink writer the plugin would build, fed with frames that are already converted.
+	struct host_encoder final : protocol::encoder
+	{
+		protocol::status start(protocol::job const &job) override
+		{
+			path.assign(reinterpret_cast<wchar_t const *>(job.output_path.data()), job.output_path.size());
+			memcpy(&output_video_format, job.output_video_format.data(), sizeof(output_video_format));
+			width = job.width;
+			height = job.height;
+			audio_clock = timebase::clock{ job.audio_sampling_rate, 1 };
+			block_alignment = get_pcm_block_alignment(job.audio_channel_count, audio_bits_per_sample);
+
+			auto input_video_format{ MFVideoFormat_Base };
+			input_video_format.Data1 = job.input_subtype;
+			is_nv12 = input_video_format == MFVideoFormat_NV12;
+
+			// This process only encodes, so its priority and affinity reach the encoder's own threads too.
+			schedule::apply_to_process({ 0, 0, static_cast<schedule::priority>(job.priority), job.affinity });
+
+			if (auto const session_started{ session::startup(*aviutl_logger) }; !session_started) [[unlikely]] return { session_started.error().code, session_started.error().where };
+
+			auto const make{ [&](bool const &is_accelerated) -> expected<sink_writer_with_indices_t, error>
+			{
+				input_media_types =
+				{
+					make_input_video_media_type({ width, height }, { job.rate, job.scale }, input_video_format, is_accelerated),
+					job.has_audio ? make_input_audio_media_type(job.audio_channel_count, job.audio_sampling_rate, output_video_format) : nullptr
+				};
+				auto const byte_stream{ make_output_byte_stream(path.c_str(), job.writes_digest) };
+				if (!byte_stream) [[unlikely]] return unexpected{ byte_stream.error() };
+
+				return make_initialized_sink_writer(path, output_video_format, job.video_quality, job.audio_bit_rate, input_media_types, job.encoder_thread_count, job.gop_length, false, byte_stream->get());
+			} };
+
+			auto result{ make(job.is_accelerated) };
+			if (!result && job.is_accelerated)
+			{
+				aviutl_logger->warn(aviutl_logger, L"Hardware encoder rejected the stream. Retrying with software...");
+				return adopt(make(false));
+			}
+
+			return adopt(move(result));
+		}
+
+		protocol::status write_video(int64_t const &frame, span<uint8_t const> image) override
+		{
+			return to_status(write_video_image(frame, image), "IMFSinkWriter::WriteSample(video)");
+		}
+
+		protocol::status write_audio(int64_t const &sample, span<uint8_t const> samples) override
+		{
+			return to_status(write_audio_samples(sample, samples), "IMFSinkWriter::WriteSample(audio)");
+		}
+
+		protocol::status finish() override
+		{
+			auto const digest_file{ take_digest_file(path.c_str()) };
+
+			auto const begin{ chrono::steady_clock::now() };
+			auto const hr{ sink_writer->Finalize() };
+			sink_writer.reset();
+			chrono::duration<double> const elapsed{ chrono::steady_clock::now() - begin };
+
+			if (FAILED(hr)) [[unlikely]]
+			{
+				if (digest_file) digest_file->discard();
+				discard_partial_file(path.c_str(), false);
+				return to_status(hr, "IMFSinkWriter::Finalize()");
+			}
+
+			if (digest_file)
+				if (auto const digested{ close_digest_file(*digest_file, path, *aviutl_logger) }; FAILED(digested)) [[unlikely]] return to_status(digested, "the digest sidecar");
+
+			return { S_OK, format("Finalized in {:.1f} s.", elapsed.count()) };
+		}
+
+		void abort() noexcept override
+		{
+			if (!sink_writer) return;
+
+			discard_sink_writer(sink_writer);
+			discard_partial_file(path.c_str(), false);
+		}
+
+	private:
+		wstring path;
+		GUID output_video_format;
+		IMFMediaTypes input_media_types;
+		com_ptr_nothrow<IMFSinkWriter> sink_writer;
+		DWORD video_index;
+		DWORD audio_index;
+		timebase::clock video_clock{ 1, 1 };
+		timebase::clock audio_clock{ 1, 1 };
+		int32_t width;
+		int32_t height;
+		uint32_t block_alignment;
+		bool is_nv12;
+
+		protocol::status adopt(expected<sink_writer_with_indices_t, error> &&result)
+		{
+			if (!result) [[unlikely]] return { result.error().code, result.error().where };
+
+			sink_writer = move(result->first);
+			video_index = result->second.first;
+			audio_index = result->second.second;
+			video_clock = get_video_clock(*input_media_types.first);
+
+			return {};
+		}
+
+		HRESULT write_video_image(int64_t const &frame, span<uint8_t const> image) noexcept
+		{
+			// The plugin packs the planes without padding, at the output size.
+			auto const row_size{ is_nv12 ? width : width * 2 };
+			if (image.size() < static_cast<size_t>(row_size) * height * (is_nv12 ? 3 : 2) / 2) [[unlikely]] return E_INVALIDARG;
+
+			com_ptr_nothrow<IMFMediaBuffer> video_buffer{};
+			RETURN_IF_FAILED(MFCreateMediaBufferFromMediaType(input_media_types.first.get(), video_clock.get_duration(frame), 0, 0, out_ptr(video_buffer)));
+
+			com_ptr_nothrow<IMF2DBuffer2> video_2d_buffer{};
+			RETURN_IF_FAILED(video_buffer.query_to(&video_2d_buffer));
+
+			uint8_t *scanline{}, *buffer_begin{};
+			long stride{};
+			DWORD buffer_size{};
+			RETURN_IF_FAILED(video_2d_buffer->Lock2DSize(MF2DBuffer_LockFlags_Write, &scanline, &stride, &buffer_begin, &buffer_size));
+			auto hr{ MFCopyImage(scanline, stride, image.data(), row_size, row_size, height) };
+			if (SUCCEEDED(hr) && is_nv12) hr = MFCopyImage(scanline + static_cast<ptrdiff_t>(stride) * height, stride, image.data() + static_cast<ptrdiff_t>(width) * height, width, width, height / 2);
+			video_2d_buffer->Unlock2D();
+			RETURN_IF_FAILED(hr);
+
+			DWORD contiguous_length{};
+			video_2d_buffer->GetContiguousLength(&contiguous_length);
+			video_buffer->SetCurrentLength(contiguous_length);
+
+			return write_sample_to_sink_writer(*sink_writer, video_index, *video_buffer, video_clock.get_time(frame), video_clock.get_duration(frame));
+		}
+
+		HRESULT write_audio_samples(int64_t const &sample, span<uint8_t const> samples) noexcept
+		{
+			return write_pcm_sample(*sink_writer, audio_index, *input_media_types.second, audio_clock, block_alignment, sample, samples);
+		}
+	};
+
+	static protocol::worker *encoder_host_worker{};
+
+	// Inside the worker, the log goes back to the plugin over the reply ring.
+	static LOG_HANDLE encoder_host_logger
+	{
+		[](LOG_HANDLE *, LPCWSTR message) { encoder_host_worker->log(to_utf8(message)); },
+		[](LOG_HANDLE *, LPCWSTR message) { encoder_host_worker->log(to_utf8(message)); },
+		[](LOG_HANDLE *, LPCWSTR message) { encoder_host_worker->log("[warn] " + to_utf8(message)); },
+		[](LOG_HANDLE *, LPCWSTR message) { encoder_host_worker->log("[error] " + to_utf8(message)); },
+		[](LOG_HANDLE *, LPCWSTR message) { encoder_host_worker->log("[verbose] " + to_utf8(message)); }
+	};
+
+	void run_encoder_host(wstring_view arguments) noexcept
+	{
+		auto const separator{ arguments.find(L' ') };
+		wstring const name{ arguments.substr(0, separator) };
+		auto const parent_id{ separator == wstring_view::npos ? 0ul : wcstoul(wstring{ arguments.substr(separator + 1) }.c_str(), nullptr, 10) };
+
+		unique_handle const parent{ OpenProcess(SYNCHRONIZE, false, parent_id) };
+		auto const commands{ open_shared_memory(format(LR"(Local\{}.commands)", name)) };
+		auto const replies{ open_shared_memory(format(LR"(Local\{}.replies)", name)) };
+		if (!parent || !commands || !replies) [[unlikely]] return;
+
+		auto const com_cleanup{ CoInitializeEx_failfast() };
+
+		protocol::worker worker{ { commands->view.get(), commands->size }, { replies->view.get(), replies->size } };
+		if (!worker) [[unlikely]] return;
+
+		encoder_host_worker = &worker;
+		aviutl_logger = &encoder_host_logger;
+
+		host_encoder encoder{};
+		worker.serve(encoder, [&parent] { return WaitForSingleObject(parent.get(), 0) != WAIT_TIMEOUT; });
+
+		session::release();
+	}
+
+	expected<unique_process_information, error> launch_encoder_host(wstring const &name) noexcept
+	{
+		HMODULE module{};
+		GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, reinterpret_cast<LPCWSTR>(&run_encoder_host), &module);
+
+		array<wchar_t, MAX_PATH> module_path{}, system_path{};
+		GetModuleFileNameW(module, module_path.data(), static_cast<DWORD>(module_path.size()));
+		GetSystemDirectoryW(system_path.data(), static_cast<uint32_t>(system_path.size()));
+
+		// The worker is this very plugin, loaded by rundll32, so no separate executable has to be shipped next to it.
+		auto command_line{ format(LR"("{}\rundll32.exe" "{}",RunEncoderHost {} {})", system_path.data(), module_path.data(), name, GetCurrentProcessId()) };
+
+		STARTUPINFOW startup_information{ sizeof(startup_information) };
+		unique_process_information process{};
+		if (!CreateProcessW(nullptr, command_line.data(), nullptr, nullptr, false, CREATE_NO_WINDOW, nullptr, nullptr, &startup_information, process.reset_and_addressof())) [[unlikely]]
+			return unexpected{ error{ HRESULT_FROM_WIN32(GetLastError()), "CreateProcessW(rundll32)" } };
+
+		return process;
+	}
+
+	expected<HRESULT, error> output_file_through_encoder_host(OUTPUT_INFO const &oip, GUID const &output_video_format, output_configuration const &configuration)
+	{
+		static atomic<uint32_t> serial{};
+
+		warn_without_scene_cuts(configuration, L"encoding in a separate process");
+
+		auto const begin{ chrono::steady_clock::now() };
+
+		auto plan{ plan_video_encoding(oip, output_video_format, configuration.is_accelerated, configuration) };
+		budget_encoder_threads(plan);
+		auto const is_nv12{ plan.input_video_format == MFVideoFormat_NV12 };
+		auto const frame_size{ static_cast<size_t>(plan.width) * plan.height * (is_nv12 ? 3 : 4) / 2 };
+		auto const block_alignment{ get_pcm_block_alignment(oip.audio_ch, audio_bits_per_sample) };
+
+		// Two frames in flight on each side of the copy, and room for a second of audio or the job itself.
+		auto const slot_count{ 4u };
+		auto const slot_capacity{ max<size_t>({ frame_size, plan.has_audio ? static_cast<size_t>(block_alignment) * oip.audio_rate : 0, 4096 }) };
+
+		auto const name{ format(L"MFOutput.host.{}.{}", GetCurrentProcessId(), serial++) };
+		auto const commands{ create_shared_memory(format(LR"(Local\{}.commands)", name), ring::get_mapping_size(slot_count, slot_capacity)) };
+		if (!commands) [[unlikely]] return unexpected{ commands.error() };
+		auto const replies{ create_shared_memory(format(LR"(Local\{}.replies)", name), ring::get_mapping_size(protocol::reply_slot_count, protocol::reply_slot_capacity)) };
+		if (!replies) [[unlikely]] return unexpected{ replies.error() };
+
+		unique_process_information worker{};
+
+		// The command ring is set up here, before the worker is there to look at it.
+		protocol::client client
+		{
+			{ commands->view.get(), commands->size }, { replies->view.get(), replies->size }, slot_count, slot_capacity,
+			[&worker] { return WaitForSingleObject(worker.hProcess, 0) == WAIT_TIMEOUT; },
+			[&oip] { return oip.func_is_abort(); },
+			[](string_view message) { aviutl_logger->info(aviutl_logger, format(L"[host] {}", from_utf8(message)).c_str()); }
+		};
+
+		auto launched{ launch_encoder_host(name) };
+		if (!launched) [[unlikely]] return unexpected{ launched.error() };
+		worker = move(*launched);
+
+		aviutl_logger->info(aviutl_logger, format(L"Encoding in a separate process (PID {}).", worker.dwProcessId).c_str());
+
+		protocol::job job{ { reinterpret_cast<char16_t const *>(oip.savefile) }, {}, plan.input_video_format.Data1, plan.is_accelerated, plan.width, plan.height, plan.rate, plan.scale, plan.frame_count, plan.has_audio, oip.audio_ch, oip.audio_rate, configuration.video_quality, configuration.audio_bit_rate, plan.encoder_thread_count, configuration.gop_length, to_underlying(plan.budget.priority), plan.budget.affinity, configuration.writes_digest };
+		memcpy(job.output_video_format.data(), &output_video_format, sizeof(output_video_format));
+
+		auto result{ client.start(job) };
+
+		auto audio_sent{ 0 };
+		auto const publish_audio{ [&client](int32_t const &position, span<uint8_t const> samples) -> HRESULT
+		{
+			auto const slot{ client.acquire(samples.size()) };
+			if (!slot) return slot.error().code;
+
+			ranges::copy(samples, slot->begin());
+			client.publish(ring::kind::audio, position);
+			return S_OK;
+		} };
+
+		// Only fetching and converting happens in this process; the frame is converted straight into the shared slot.
+		for (auto f{ 0 }; f < plan.frame_count && !result.is_failed(); ++f)
+		{
+			if (oip.func_is_abort())
+			{
+				result = { E_ABORT, "the encoder host, on request" };
+				break;
+			}
+
+			oip.func_rest_time_disp(f, plan.frame_count);
+
+			// The slot comes first: waiting for it asks the host whether to abort, and any host call invalidates the frame it handed out.
+			auto const frame{ client.acquire(frame_size) };
+			if (!frame)
+			{
+				result = frame.error();
+				break;
+			}
+
+			auto const frame_image{ get_video_frame(oip, plan, f) };
+
+			if (!is_nv12)
+				copy_n(frame_image, frame_size, frame->data());
+			else if (auto const nv12_image{ yuy2_to_nv12(frame_image, { oip.w, oip.h }) }; plan.scaler)
+				plan.scaler->scale(nv12_image.get(), oip.w, frame->data(), plan.width);
+			else
+				copy_n(nv12_image.get(), frame_size, frame->data());
+
+			client.publish(ring::kind::video, f);
+
+			if (plan.has_audio)
+				if (auto const hr{ send_audio_until(oip, audio_sent, get_audio_sample_at(oip, plan, f + 1), publish_audio) }; FAILED(hr))
+					result = { hr, "sending audio to the encoder host" };
+		}
+
+		if (plan.has_audio && !result.is_failed())
+			if (auto const hr{ send_audio_until(oip, audio_sent, oip.audio_n, publish_audio) }; FAILED(hr))
+				result = { hr, "sending audio to the encoder host" };
+
+		if (!result.is_failed())
+		{
+			aviutl_logger->info(aviutl_logger, L"All samples sent. Waiting for the encoder host to finalize...");
+			result = client.finish();
+		}
+		else
+			client.abort();
+
+		// An aborted worker cleans up after itself; one that hangs is not waited on for long.
+		if (WaitForSingleObject(worker.hProcess, 10'000) == WAIT_TIMEOUT)
+			TerminateProcess(worker.hProcess, ERROR_TIMEOUT);
+
+		PROCESS_MEMORY_COUNTERS counters{ sizeof(counters) };
+		GetProcessMemoryInfo(worker.hProcess, &counters, sizeof(counters));
+
+		DWORD exit_code{};
+		GetExitCodeProcess(worker.hProcess, &exit_code);
+
+		if (result.is_failed())
+		{
+			aviutl_logger->info(aviutl_logger, L"Aborting...");
+
+			// A worker that crashed could not delete what it had written.
+			if (result.code == protocol::worker_lost)
+			{
+				aviutl_logger->error(aviutl_logger, format(L"The encoder host exited with 0x{:08x}; this process was not affected.", exit_code).c_str());
+				discard_partial_file(oip.savefile, false);
+			}
+
+			return unexpected{ error{ result.code, result.detail } };
+		}
+
+		chrono::duration<double> const elapsed{ chrono::steady_clock::now() - begin };
+		aviutl_logger->info(aviutl_logger, format
+		(
+			L"{} Encoded in {:.1f} s, stalled for {:.1f} s waiting on the encoder host, which peaked at {:.0f} MiB.",
+			from_utf8(result.detail),
+			elapsed.count(),
+			chrono::duration<double>{ client.get_stalled_time() }.count(),
+			static_cast<double>(counters.PeakWorkingSetSize) / (1 << 20)
+		).c_str());
+
+		return S_OK;
+	}
+
+	// A get_difference() value; two decoders of the same frame round a level or so apart, while another picture is tens away.
+	auto const constinit passthrough_threshold{ 3.0 };
+	// Frames of the scene compared with the file before passing it through, from the first to the last.
+	auto const constinit passthrough_check_frames{ 5 };
+
+	struct passthrough_plan
+	{
+		filesystem::path source;
+		vector<uint32_t> kept_tracks;
+	};
+
+	auto is_codec_of(string_view codec, GUID const &output_video_format) noexcept
+	{
+		if (output_video_format == MFVideoFormat_HEVC) return codec == "hvc1" || codec == "hev1";
+		return codec == "avc1" || codec == "avc3";
+	}
+
+	expected<com_ptr_nothrow<IMFSourceReader>, error> make_checking_source_reader(OUTPUT_INFO const &oip, filesystem::path const &path) noexcept
+	{
+		com_ptr_nothrow<IMFAttributes> attributes{};
+		UNEXPECT_IF_FAILED(MFCreateAttributes(out_ptr(attributes), 1));
+		// The decoder may hand out NV12 or a padded height; the processor turns it into the YUY2 the host renders.
+		UNEXPECT_IF_FAILED(attributes->SetUINT32(MF_SOURCE_READER_ENABLE_VIDEO_PROCESSING, TRUE));
+
+		com_ptr_nothrow<IMFSourceReader> source_reader{};
+		UNEXPECT_IF_FAILED(MFCreateSourceReaderFromURL(path.c_str(), attributes.get(), out_ptr(source_reader)));
+		UNEXPECT_IF_FAILED(source_reader->SetStreamSelection(static_cast<DWORD>(MF_SOURCE_READER_ALL_STREAMS), FALSE));
+		UNEXPECT_IF_FAILED(source_reader->SetStreamSelection(static_cast<DWORD>(MF_SOURCE_READER_FIRST_VIDEO_STREAM), TRUE));
+
+		com_ptr_nothrow<IMFMediaType> media_type{};
+		UNEXPECT_IF_FAILED(MFCreateMediaType(out_ptr(media_type)));
+		UNEXPECT_IF_FAILED(media_type->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video));
+		UNEXPECT_IF_FAILED(media_type->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_YUY2));
+		UNEXPECT_IF_FAILED(source_reader->SetCurrentMediaType(static_cast<DWORD>(MF_SOURCE_READER_FIRST_VIDEO_STREAM), nullptr, media_type.get()));
+
+		com_ptr_nothrow<IMFMediaType> current_type{};
+		UNEXPECT_IF_FAILED(source_reader->GetCurrentMediaType(static_cast<DWORD>(MF_SOURCE_READER_FIRST_VIDEO_STREAM), out_ptr(current_type)));
+
+		// Rows past the picture, where the coded height was rounded up, are left out of the thumbnail.
+		uint32_t width{}, height{};
+		UNEXPECT_IF_FAILED(MFGetAttributeSize(current_type.get(), MF_MT_FRAME_SIZE, &width, &height));
+		if (width != static_cast<uint32_t>(oip.w) || height < static_cast<uint32_t>(oip.h)) [[unlikely]] return unexpected{ error{ MF_E_INVALIDMEDIATYPE, "the decoded frame size of the passed-through file" } };
+
+		return source_reader;
+	}
+
+	// Decodes the frame of the file on screen at frame f of the scene, and thumbnails it as the host's frame is.
+	expected<scene::thumbnail, error> get_source_thumbnail(OUTPUT_INFO const &oip, IMFSourceReader &source_reader, int32_t const &f) noexcept
+	{
+		timebase::clock const video_clock{ oip.rate, oip.scale };
+		auto const middle{ video_clock.get_time(f) + video_clock.get_duration(f) / 2 };
+
+		PROPVARIANT position{};
+		position.vt = VT_I8;
+		position.hVal.QuadPart = video_clock.get_time(f);
+		UNEXPECT_IF_FAILED(source_reader.SetCurrentPosition(GUID_NULL, position));
+
+		// Seeking lands on the keyframe before, so decoding goes on until the frame that covers the middle of f.
+		for (;;)
+		{
+			DWORD flags{};
+			int64_t time{};
+			com_ptr_nothrow<IMFSample> sample{};
+			UNEXPECT_IF_FAILED(source_reader.ReadSample(static_cast<DWORD>(MF_SOURCE_READER_FIRST_VIDEO_STREAM), 0, nullptr, &flags, &time, sample.put()));
+			if (flags & MF_SOURCE_READERF_ENDOFSTREAM) [[unlikely]] return unexpected{ error{ MF_E_END_OF_STREAM, "the frame check of the passed-through file" } };
+			if (!sample) continue;
+
+			int64_t duration{};
+			if (FAILED(sample->GetSampleDuration(&duration)) || !duration) duration = video_clock.get_duration(f);
+			if (time + duration <= middle) continue;
+
+			com_ptr_nothrow<IMFMediaBuffer> buffer{};
+			UNEXPECT_IF_FAILED(sample->ConvertToContiguousBuffer(out_ptr(buffer)));
+
+			uint8_t *data{};
+			DWORD length{};
+			UNEXPECT_IF_FAILED(buffer->Lock(&data, nullptr, &length));
+			auto const unlock{ scope_exit([&]() noexcept { buffer->Unlock(); }) };
+
+			if (length < static_cast<DWORD>(oip.w) * 2 * oip.h) [[unlikely]] return unexpected{ error{ MF_E_BUFFERTOOSMALL, "the frame check of the passed-through file" } };
+			return scene::make_thumbnail(data, oip.w, oip.h);
+		}
+	}
+
+	// Whether the scene is exactly a file that can be copied rather than encoded, and which of its tracks to copy.
+	// Only a snapshot read for this very export is trusted; the frame check below catches a file that decodes differently, not an edit between the frames it samples.
+	auto find_passthrough(OUTPUT_INFO const &oip, output_configuration const &configuration, GUID const &output_video_format) -> optional<passthrough_plan>
+	{
+		auto const decline{ [](wstring_view reason)
+		{
+			aviutl_logger->info(aviutl_logger, format(L"Encoding the clip instead of passing it through, as {}.", reason).c_str());
+			return nullopt;
+		} };
+
+		if (!timeline::refresh()) return decline(L"the timeline could not be read for this export");
+
+		auto const clip{ timeline::get_single_clip() };
+		if (!clip) return nullopt;
+
+		if (get_output_resolution(oip, configuration) != pair{ oip.w, oip.h } || get_output_frame_rate(oip, configuration) != pair{ oip.rate, oip.scale }) return decline(L"the output is scaled or has its frame rate changed");
+		if (!configuration.extra_outputs.empty()) return decline(L"extra outputs are to be encoded");
+		// A range as long as the clip that starts later would pass the length check and copy the wrong part of the file.
+		if (clip->range_start > 0) return decline(L"the selected frame range does not start at frame 0");
+		if (clip->length != oip.n) return decline(L"the scene is not as long as the clip");
+		if (normalize_output_path(clip->path.c_str()) == normalize_output_path(oip.savefile)) return decline(L"the output would overwrite the clip");
+
+		auto const movie{ remux::read_movie(clip->path) };
+		if (!movie) return decline(L"the file is not a progressive MP4 that can be copied");
+
+		auto const video{ ranges::find_if(movie->tracks, &remux::track::is_video) };
+		if (video == movie->tracks.end() || !is_codec_of(video->codec, output_video_format)) return decline(L"the file's video is not in the chosen format");
+		if (video->width != static_cast<uint32_t>(oip.w) || video->height != static_cast<uint32_t>(oip.h)) return decline(L"the file's frame size differs from the scene's");
+
+		// Every frame of the scene has to be a sample of the file, at the same rate, for the copy to play as the scene does.
+		auto const scene_duration{ static_cast<double>(oip.n) * oip.scale / oip.rate };
+		auto const track_duration{ static_cast<double>(video->duration) / max(video->timescale, 1u) };
+		if (video->samples.size() != static_cast<size_t>(oip.n) || abs(track_duration - scene_duration) * oip.rate > oip.scale) return decline(L"the file's frames do not line up with the scene's");
+
+		passthrough_plan plan{ clip->path, { video->id } };
+
+		auto const source_reader{ make_checking_source_reader(oip, clip->path) };
+		if (!source_reader) return decline(L"the file could not be decoded for the frame check");
+
+		if (clip->has_audio && get_stream_selection(oip, configuration) == stream_selection::both)
+		{
+			auto const audio{ ranges::find_if(movie->tracks, &remux::track::is_audio) };
+			if (audio == movie->tracks.end() || audio->codec != "mp4a") return decline(L"the file's audio is not AAC");
+
+			com_ptr_nothrow<IMFMediaType> audio_type{};
+			if (FAILED((*source_reader)->GetNativeMediaType(static_cast<DWORD>(MF_SOURCE_READER_FIRST_AUDIO_STREAM), 0, out_ptr(audio_type)))) return decline(L"the file's audio could not be read");
+			if (MFGetAttributeUINT32(audio_type.get(), MF_MT_AUDIO_SAMPLES_PER_SECOND, 0) != static_cast<uint32_t>(oip.audio_rate) || MFGetAttributeUINT32(audio_type.get(), MF_MT_AUDIO_NUM_CHANNELS, 0) != static_cast<uint32_t>(oip.audio_ch)) return decline(L"the file's audio differs from the scene's in rate or channels");
+
+			plan.kept_tracks.push_back(audio->id);
+		}
+
+		for (auto i{ 0 }; i < passthrough_check_frames; ++i)
+		{
+			auto const f{ static_cast<int32_t>(static_cast<int64_t>(oip.n - 1) * i / (passthrough_check_frames - 1)) };
+
+			auto const frame_image{ static_cast<uint8_t const *>(oip.func_get_video(f, FCC('YUY2'))) };
+			if (!frame_image) return decline(L"the host did not render a frame to check");
+
+			auto const source_thumbnail{ get_source_thumbnail(oip, **source_reader, f) };
+			if (!source_thumbnail) return decline(L"a frame of the file could not be decoded for the check");
+
+			if (auto const difference{ scene::get_difference(scene::make_thumbnail(frame_image, oip.w, oip.h), *source_thumbnail) }; difference > passthrough_threshold)
+				return decline(format(L"frame {} differs from the file's by {:.1f}", f, difference));
+		}
+
+		return plan;
+	}
+
+	auto to_error(remux::failure const &failure) noexcept
+	{
+		switch (failure)
+		{
+		case remux::failure::unreadable: return error{ HRESULT_FROM_WIN32(ERROR_READ_FAULT), "remux::remux_movie" };
+		case remux::failure::unsupported: return error{ E_NOTIMPL, "remux::remux_movie" };
+		case remux::failure::unwritable: return error{ HRESULT_FROM_WIN32(ERROR_WRITE_FAULT), "remux::remux_movie" };
+		case remux::failure::aborted: return error{ E_ABORT, "remux::remux_movie" };
+		}
+		return error{ E_UNEXPECTED, "remux::remux_movie" };
+	}
+
+	expected<HRESULT, error> output_passthrough_file(OUTPUT_INFO const &oip, passthrough_plan const &plan, bool const &writes_digest)
+	{
+		aviutl_logger->info(aviutl_logger, format(L"Copying {} to the output without encoding...", plan.source.wstring()).c_str());
+
+		auto const begin{ chrono::steady_clock::now() };
+
+		// The copy goes out front to back, so hashing it on the way leaves nothing to read back.
+		hash::blake3_file hasher{};
+		auto const on_written{ [&hasher](span<uint8_t const> bytes) { hasher.write(hasher.get_size(), bytes); } };
+
+		auto const statistics{ remux::remux_movie(plan.source, oip.savefile, plan.kept_tracks, [&](uint64_t const &copied, uint64_t const &total)
+		{
+			if (oip.func_is_abort()) return false;
+
+			// The host counts progress in frames, so the bytes are put in those terms.
+			oip.func_rest_time_disp(static_cast<int32_t>(static_cast<double>(copied) / max(total, uint64_t{ 1 }) * oip.n), oip.n);
+			return true;
+		}, writes_digest ? function<void(span<uint8_t const>)>{ on_written } : function<void(span<uint8_t const>)>{}) };
+		if (!statistics) [[unlikely]] return unexpected{ to_error(statistics.error()) };
+
+		chrono::duration<double> const elapsed{ chrono::steady_clock::now() - begin };
+		aviutl_logger->info(aviutl_logger, format
+		(
+			L"Copied {:.1f} MiB of {} tracks in {} runs of {} chunks, behind a {:.1f} KiB movie header, in {:.1f} s.",
+			static_cast<double>(statistics->copied_bytes) / (1 << 20),
+			plan.kept_tracks.size(),
+			statistics->runs,
+			statistics->chunks,
+			static_cast<double>(statistics->movie_header_size) / (1 << 10),
+			elapsed.count()
+		).c_str());
+
+		if (writes_digest)
+			if (auto const hr{ digest::write_digest_of(oip.savefile, hasher) }; FAILED(hr)) [[unlikely]] return unexpected{ error{ hr, "the digest sidecar" } };
+
+		return S_OK;
+	}
+
+	expected<HRESULT, error> output_file(OUTPUT_INFO const &oip, output_configuration &&configuration, LOG_HANDLE &logger)
+	{
+		auto const export_begin{ chrono::steady_clock::now() };
+
+		auto const com_cleanup{ CoInitializeEx_failfast() };
+
+		aviutl_logger = &logger;
+
+		schedule::utilization_meter const utilization{};
+		auto const report_utilization{ scope_exit([&, budget = get_cpu_budget(configuration)]() noexcept
+		{
+			auto const busy{ utilization.get_busy_processors() };
+			auto const limit{ budget.threads ? budget.threads : budget.available };
+			aviutl_logger->info(aviutl_logger, format(L"Kept {:.1f} logical processors busy on average, rendering included; {:.0f}% of the {} allowed.", busy, busy * 100 / limit, limit).c_str());
+		}) };
+
+		auto output_path{ normalize_output_path(oip.savefile) };
+		if (is_finalizing(output_path)) [[unlikely]] return unexpected{ error{ HRESULT_FROM_WIN32(ERROR_SHARING_VIOLATION), "the background finalization of a previous export to the same file" } };
+
+		if (configuration.uses_frame_server)
+			return output_file_to_frame_server(oip, configuration);
+
+		if (configuration.uses_pipe && !configuration.pipe_command.empty())
+			return output_file_through_pipe(oip, configuration);
+
+		if (auto const extension{ filesystem::path{ oip.savefile }.extension() }; extension == L".y4m" || extension == L".wav")
+			return output_raw_file(oip, configuration);
+
+		auto const session_started{ session::startup(logger) };
+		if (!session_started) [[unlikely]] return unexpected{ session_started.error() };
+
+		if (configuration.uses_stream)
+			return output_file_to_stream(oip, configuration);
+
+		if (auto const extension{ filesystem::path{ oip.savefile }.extension() }; extension == L".m3u8" || extension == L".mpd")
+			return output_packaged_file(oip, configuration, move(output_path), logger);
+
+		auto const output_video_format{ get_suitable_output_video_format_guid(filesystem::path(oip.savefile).extension(), configuration.is_hevc_preferable) };
+
+		if (get_stream_selection(oip, configuration, filesystem::path(oip.savefile).extension()) == stream_selection::audio_only)
+		{
+			if (!configuration.extra_outputs.empty())
+				aviutl_logger->warn(aviutl_logger, L"Extra outputs are skipped when only audio is exported.");
+
+			return output_audio_only(oip, output_video_format, configuration, move(output_path), logger);
+		}
+
+		if (configuration.uses_passthrough && filesystem::path{ oip.savefile }.extension() == L".mp4")
+			if (auto const passthrough{ find_passthrough(oip, configuration, output_video_format) })
+				return output_passthrough_file(oip, *passthrough, configuration.writes_digest);
+
+		if (configuration.uses_encoder_host)
+		{
+			if (!configuration.extra_outputs.empty())
+				aviutl_logger->warn(aviutl_logger, L"Extra outputs are skipped when encoding in a separate process.");
+
+			return output_file_through_encoder_host(oip, output_video_format, configuration);
+		}
+
+		// The fan-out writes from its own threads, which is where a spill queue can sit; with no extra outputs it writes just the one.
+		if (!configuration.extra_outputs.empty() || configuration.uses_spill)
+			return output_file_to_many(oip, configuration, logger);
+
+		auto plan{ plan_video_encoding(oip, output_video_format, configuration.is_accelerated, configuration) };
+		budget_encoder_threads(plan);
+
+		// Windows Media streams cannot be passed through the writer segment by segment, so they always encode from scratch.
+		if (output_video_format != MFVideoFormat_WVC1 && plan.frame_count > 0)
+		{
+			if (configuration.uses_checkpoints)
+				return output_file_with_checkpoints(oip, output_video_format, configuration, plan, move(output_path), logger);
+			if (configuration.uses_segment_cache)
+				return output_file_through_segment_cache(oip, output_video_format, configuration, plan, move(output_path), logger);
+		}
+
+		auto input_media_types{ make_input_media_types(oip, output_video_format, plan) };
+
+		auto const video_clock{ get_video_clock(*input_media_types.first) };
+		timebase::clock const audio_clock{ oip.audio_rate, 1 };
+
+		auto depth_controller{ buffering::depth_controller{ static_cast<uint64_t>(oip.w) * oip.h * 2, get_prefetch_memory_budget() } };
+		apply_buffer_depth(oip, depth_controller.initial());
+
+		// The writer and its encoders take a while to come up, so the host renders the first frames in the meantime.
+		auto sink_writer_future{ async(launch::async, make_planned_sink_writer, cref(oip), cref(output_video_format), cref(configuration), plan) };
+
+		auto prefetched{ prefetch_samples(oip, input_media_types, plan, video_clock, audio_clock, configuration.detects_scene_cuts) };
+
+		auto [sink_writer_with_indices, initialized_plan] { sink_writer_future.get() };
+		if (!sink_writer_with_indices) [[unlikely]] return unexpected{ sink_writer_with_indices.error() };
+
+		if (initialized_plan.input_video_format != plan.input_video_format || initialized_plan.is_accelerated != plan.is_accelerated)
+		{
+			prefetched.video.clear();
+			prefetched.thumbnails.clear();
+			plan = initialized_plan;
+			input_media_types = make_input_media_types(oip, output_video_format, plan);
+		}
+
+		auto &[sink_writer, indices] { *sink_writer_with_indices };
+
+		auto keyframes{ make_keyframe_control(configuration) };
+		if (keyframes.planner) keyframes.encoder = find_keyframe_encoder(*sink_writer, indices.first);
+
+		// A software encoder fed YUY2 at the host's own size takes the frame exactly as the host renders it.
+		optional<frame::host_frame_wrapper> wrapper{};
+		if (plan.input_video_format == MFVideoFormat_YUY2 && !plan.is_accelerated && !plan.scaler)
+			wrapper.emplace(oip.w, oip.h);
+
+		aviutl_logger->info(aviutl_logger, L"Sending video samples to the writer...");
+
+		auto aeternum{ S_OK };
+
+		for (auto f{ 0 }; f < plan.frame_count; ++f)
+		{
+			if ((aeternum = static_cast<size_t>(f) < prefetched.video.size()
+				? write_video_buffer(oip, *sink_writer, f, plan.frame_count, indices.first, *exchange(prefetched.video[f], nullptr), video_clock, keyframes.planner && is_keyframe_due(keyframes, prefetched.thumbnails[f]), keyframes.encoder.get())
+				: wrapper
+				? write_host_video_sample(oip, *sink_writer, f, indices.first, plan, video_clock, depth_controller, keyframes, *wrapper)
+				: write_video_sample(oip, *sink_writer, f, indices.first, *input_media_types.first, plan, video_clock, depth_controller, keyframes)) < 0)
+				goto abort;
+
+			if (auto const depth{ depth_controller.update() })
+				apply_buffer_depth(oip, *depth);
+
+			if (f == 0)
+				aviutl_logger->info(aviutl_logger, format(L"Time to first sample: {:.2f} ms ({} frames prefetched).", chrono::duration<double, milli>{ chrono::steady_clock::now() - export_begin }.count(), prefetched.video.size()).c_str());
+		}
+		if (plan.has_audio)
+		{
+			aviutl_logger->info(aviutl_logger, L"Sending audio samples to the writer...");
+
+			for (auto n{ 0 }; n < oip.audio_n; n += oip.audio_rate)
+				if ((aeternum = n == 0 && prefetched.audio
+					? write_audio_buffer(oip, *sink_writer, n, indices.second, *prefetched.audio, audio_clock, prefetched.audio_duration)
+					: write_audio_sample(oip, *sink_writer, n, indices.second, *input_media_types.second, audio_clock)) < 0)
+					break;
+		}
+	abort:
+		if (aeternum == E_ABORT)
+		{
+			auto const abort_begin{ chrono::steady_clock::now() };
+			aviutl_logger->info(aviutl_logger, L"Aborting without finalizing...");
+
+			discard_sink_writer(sink_writer);
+			// Only fragmented MP4 stays playable when cut at a fragment boundary.
+			discard_partial_file(oip.savefile, configuration.keeps_partial_file && output_video_format == MFVideoFormat_H264);
+
+			aviutl_logger->info(aviutl_logger, format(L"Aborted in {:.2f} ms.", chrono::duration<double, milli>{ chrono::steady_clock::now() - abort_begin }.count()).c_str());
+
+			UNEXPECT_IF_FAILED(aeternum);
+		}
+
+		if (FAILED(aeternum))
+		{
+			aviutl_logger->info(aviutl_logger, L"Aborting...");
+			UNEXPECT_IF_FAILED(sink_writer->Finalize());
+
+			UNEXPECT_IF_FAILED(aeternum);
+		}
+
+		report_keyframes(keyframes);
+
+		if (wrapper)
+		{
+			auto const statistics{ wrapper->get_statistics() };
+			aviutl_logger->info(aviutl_logger, format(L"Passed {} of {} host frames to the encoder without copying ({:.0f}%); the rest were still held when the host moved on.", statistics.wrapped - statistics.copied, statistics.wrapped, statistics.get_avoided_ratio() * 100).c_str());
+
+			if (statistics.locked)
+				aviutl_logger->warn(aviutl_logger, format(L"The encoder kept {} host frames locked after they were written; the host waited for each, and the frames after them were copied up front again.", statistics.locked).c_str());
+		}
+
+		aviutl_logger->info(aviutl_logger, L"All samples sent. Finalizing in the background...");
+		finalize_in_background(move(sink_writer), move(output_path), plan.budget, logger);
+
+		return S_FALSE;
+	}
+
+	void wait_for_pending_outputs() noexcept
+	{
+		// Joined outside the lock, which every finalizer takes on its way out.
+		list<pair<wstring, jthread>> threads{};
+		{
+			scoped_lock const guard{ pending_finalizations.lock };
+			threads.swap(pending_finalizations.threads);
+		}
+		threads.clear();
 	}
 }
@@ -18,6 +18,7 @@ export module mfop.core;
 
 import std;
 import mfop.configure;
+export import mfop.error;
 
 namespace mfop
 {
@@ -29,12 +30,41 @@ namespace mfop
 			std::underlying_type<configure::audio_bit_rate>::type audio_bit_rate;
 			std::underlying_type<configure::is_hevc_preferable>::type is_hevc_preferable;
 			std::underlying_type<configure::is_accelerated>::type is_accelerated;
-		};
-
-		struct error
-		{
-			HRESULT code;
-			std::string where;
+			std::underlying_type<configure::keeps_partial_file>::type keeps_partial_file;
+			std::underlying_type<configure::uses_segment_cache>::type uses_segment_cache;
+			std::underlying_type<configure::segment_cache_size>::type segment_cache_size;
+			std::underlying_type<configure::uses_checkpoints>::type uses_checkpoints;
+			std::underlying_type<configure::checkpoint_interval>::type checkpoint_interval;
+			std::vector<configure::extra_output> extra_outputs;
+			std::underlying_type<configure::output_width>::type output_width;
+			std::underlying_type<configure::output_height>::type output_height;
+			std::underlying_type<configure::scaling_filter>::type scaling_filter;
+			std::underlying_type<configure::output_rate>::type output_rate;
+			std::underlying_type<configure::output_scale>::type output_scale;
+			std::underlying_type<configure::exported_streams>::type exported_streams;
+			std::underlying_type<configure::uses_pipe>::type uses_pipe;
+			std::wstring pipe_command;
+			std::underlying_type<configure::uses_frame_server>::type uses_frame_server;
+			std::underlying_type<configure::frame_server_slots>::type frame_server_slots;
+			std::wstring frame_server_name;
+			std::underlying_type<configure::uses_encoder_host>::type uses_encoder_host;
+			std::underlying_type<configure::uses_spill>::type uses_spill;
+			std::underlying_type<configure::spill_wait>::type spill_wait;
+			std::underlying_type<configure::spill_memory>::type spill_memory;
+			std::underlying_type<configure::spill_disk>::type spill_disk;
+			std::underlying_type<configure::cpu_cores>::type cpu_cores;
+			std::underlying_type<configure::cpu_percent>::type cpu_percent;
+			std::underlying_type<configure::cpu_priority>::type cpu_priority;
+			std::underlying_type<configure::pins_cpu>::type pins_cpu;
+			std::underlying_type<configure::detects_scene_cuts>::type detects_scene_cuts;
+			std::underlying_type<configure::gop_length>::type gop_length;
+			std::underlying_type<configure::scene_threshold>::type scene_threshold;
+			std::underlying_type<configure::segment_duration>::type segment_duration;
+			std::underlying_type<configure::uses_stream>::type uses_stream;
+			std::wstring stream_address;
+			std::underlying_type<configure::is_stream_realtime>::type is_stream_realtime;
+			std::underlying_type<configure::uses_passthrough>::type uses_passthrough;
+			std::underlying_type<configure::writes_digest>::type writes_digest;
 		};
 
 		std::expected<HRESULT, error> output_file
@@ -43,5 +73,10 @@ namespace mfop
 			output_configuration &&configuration,
 			LOG_HANDLE &logger
 		); 
+
+		void wait_for_pending_outputs() noexcept;
+
+		// Body of the worker process started by the encoder host; the arguments are the ring name and the parent's process ID.
+		void run_encoder_host(std::wstring_view arguments) noexcept;
 	}
 }
@@ -0,0 +1,143 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#define STRICT
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <wil/resource.h>
+
+module mfop.digest;
+
+import std;
+
+using namespace std;
+using namespace wil;
+
+namespace mfop
+{
+	namespace digest
+	{
+		auto get_overlapped(uint64_t const &position) noexcept
+		{
+			OVERLAPPED overlapped{};
+			overlapped.Offset = static_cast<DWORD>(position);
+			overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+			return overlapped;
+		}
+
+		auto read_at(HANDLE file, uint64_t const &position, span<uint8_t> bytes) noexcept
+		{
+			auto overlapped{ get_overlapped(position) };
+			DWORD size{};
+			return ReadFile(file, bytes.data(), static_cast<DWORD>(bytes.size()), &size, &overlapped) && size == bytes.size();
+		}
+
+		auto to_hex(hash::blake3::digest_t const &digest)
+		{
+			string text{};
+			for (auto const &byte : digest) text += format("{:02x}", byte);
+			return text;
+		}
+
+		auto write_sidecar(filesystem::path const &path, optional<hash::blake3::digest_t> const &digest)
+		{
+			if (!digest) [[unlikely]] return HRESULT_FROM_WIN32(ERROR_READ_FAULT);
+
+			auto const name{ path.filename().u8string() };
+			ofstream sidecar{ get_sidecar_path(path), ios::binary | ios::trunc };
+			sidecar << to_hex(*digest) << "  " << string_view{ reinterpret_cast<char const *>(name.data()), name.size() } << '\n';
+			sidecar.close();
+
+			return sidecar ? S_OK : HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+		}
+
+		expected<shared_ptr<digest_file>, error> digest_file::create(filesystem::path const &path) noexcept
+		{
+			// Readable, as the MP4 sink reads the movie back when it moves the header to the front.
+			unique_hfile file{ CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr) };
+			if (!file) [[unlikely]] return unexpected{ error{ HRESULT_FROM_WIN32(GetLastError()), "CreateFileW" } };
+
+			return make_shared<digest_file>(move(file), path);
+		}
+
+		digest_file::digest_file(unique_hfile &&file, filesystem::path const &path) noexcept :
+			file{ move(file) },
+			path{ path },
+			hasher{},
+			result{},
+			lock{}
+		{
+		}
+
+		HRESULT digest_file::write(uint64_t const &position, span<uint8_t const> bytes) noexcept
+		{
+			scoped_lock const guard{ lock };
+
+			auto overlapped{ get_overlapped(position) };
+			DWORD written{};
+			if (!WriteFile(file.get(), bytes.data(), static_cast<DWORD>(bytes.size()), &written, &overlapped)) [[unlikely]] return HRESULT_FROM_WIN32(GetLastError());
+			if (written != bytes.size()) [[unlikely]] return HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+
+			hasher.write(position, bytes);
+			return S_OK;
+		}
+
+		HRESULT digest_file::read(uint64_t const &position, span<uint8_t> bytes, size_t &read_size) noexcept
+		{
+			scoped_lock const guard{ lock };
+
+			auto overlapped{ get_overlapped(position) };
+			DWORD size{};
+			// Past the end, ReadFile fails with ERROR_HANDLE_EOF where the stream wants a short read.
+			if (!ReadFile(file.get(), bytes.data(), static_cast<DWORD>(bytes.size()), &size, &overlapped) && GetLastError() != ERROR_HANDLE_EOF) [[unlikely]] return HRESULT_FROM_WIN32(GetLastError());
+
+			read_size = size;
+			return S_OK;
+		}
+
+		HRESULT digest_file::close() noexcept
+		{
+			scoped_lock const guard{ lock };
+			if (result) return *result;
+
+			auto const digest{ hasher.digest([this](uint64_t const &position, span<uint8_t> bytes) { return read_at(file.get(), position, bytes); }) };
+			file.reset();
+
+			return *(result = write_sidecar(path, digest));
+		}
+
+		void digest_file::discard() noexcept
+		{
+			scoped_lock const guard{ lock };
+			if (!result) result = E_ABORT;
+			file.reset();
+		}
+
+		uint64_t digest_file::get_reread_size() noexcept
+		{
+			scoped_lock const guard{ lock };
+			return hasher.get_reread_size();
+		}
+
+		filesystem::path get_sidecar_path(filesystem::path const &path)
+		{
+			auto sidecar{ path };
+			sidecar += L".b3";
+			return sidecar;
+		}
+
+		HRESULT write_digest_of(filesystem::path const &path, hash::blake3_file &hasher) noexcept
+		{
+			unique_hfile file{ CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr) };
+			if (!file) [[unlikely]] return HRESULT_FROM_WIN32(GetLastError());
+
+			return write_sidecar(path, hasher.digest([&](uint64_t const &position, span<uint8_t> bytes) { return read_at(file.get(), position, bytes); }));
+		}
+	}
+}
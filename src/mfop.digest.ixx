@@ -0,0 +1,60 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#define STRICT
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <wil/resource.h>
+
+export module mfop.digest;
+
+import std;
+import mfop.error;
+import mfop.hash;
+import mfop.stream;
+
+namespace mfop
+{
+	namespace digest
+	{
+		export
+		{
+			// Writes what a media sink hands over to a file, hashing it on the way, and leaves its BLAKE3 beside it once the sink closes the stream.
+			struct digest_file final : stream::byte_sink
+			{
+				static std::expected<std::shared_ptr<digest_file>, error> create(std::filesystem::path const &path) noexcept;
+
+				digest_file(wil::unique_hfile &&file, std::filesystem::path const &path) noexcept;
+				digest_file(digest_file const &) = delete;
+
+				HRESULT write(std::uint64_t const &position, std::span<std::uint8_t const> bytes) noexcept override;
+				HRESULT read(std::uint64_t const &position, std::span<std::uint8_t> bytes, std::size_t &read_size) noexcept override;
+				// Finishes the hash, reading back only the blocks the sink went back to, and writes the sidecar; a sidecar that cannot be written fails Finalize.
+				HRESULT close() noexcept override;
+				// For an export that was aborted: no sidecar, even if the media sink closes the stream later.
+				void discard() noexcept;
+
+				// Bytes read back from the file to finish the hash, for the log.
+				std::uint64_t get_reread_size() noexcept;
+
+			private:
+				wil::unique_hfile file;
+				std::filesystem::path path;
+				hash::blake3_file hasher;
+				std::optional<HRESULT> result;
+				std::mutex lock;
+			};
+
+			// <output>.b3, in the format b3sum --check reads.
+			std::filesystem::path get_sidecar_path(std::filesystem::path const &path);
+			// Finishes a hash the writer of the file took as it wrote, reading back only what it went back to, and writes the sidecar.
+			HRESULT write_digest_of(std::filesystem::path const &path, hash::blake3_file &hasher) noexcept;
+		}
+	}
+}
@@ -0,0 +1,28 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#define STRICT
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+
+export module mfop.error;
+
+import std;
+
+namespace mfop
+{
+	export
+	{
+		struct error
+		{
+			HRESULT code;
+			std::string where;
+		};
+	}
+}
@@ -0,0 +1,340 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#define STRICT
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <wil/com.h>
+#include <wrl/implements.h>
+#include <mfapi.h>
+#include <mfobjects.h>
+
+module mfop.frame;
+
+import std;
+
+using namespace std;
+using namespace wil;
+
+namespace mfop
+{
+	namespace frame
+	{
+		auto const constinit max_spares{ size_t{ 4 } };
+		// Frames in a row whose locks were gone by the time they were handed back, before the host's frames are passed on uncopied.
+		auto const constinit trusted_after{ 30u };
+
+		struct frame_pool
+		{
+			size_t size;
+			mutex lock;
+			vector<unique_ptr<uint8_t[]>> spares;
+
+			auto take()
+			{
+				{
+					lock_guard const guard{ lock };
+					if (!spares.empty())
+					{
+						auto bytes{ move(spares.back()) };
+						spares.pop_back();
+						return bytes;
+					}
+				}
+
+				return make_unique_for_overwrite<uint8_t[]>(size);
+			}
+
+			auto give_back(unique_ptr<uint8_t[]> &&bytes) noexcept
+			{
+				lock_guard const guard{ lock };
+				if (spares.size() < max_spares) spares.push_back(move(bytes));
+			}
+		};
+
+		using host_frame_buffer_base = Microsoft::WRL::RuntimeClass<Microsoft::WRL::RuntimeClassFlags<Microsoft::WRL::ClassicCom>, IMFMediaBuffer, Microsoft::WRL::ChainInterfaces<IMF2DBuffer2, IMF2DBuffer>>;
+
+		// Reads straight from the host's frame until detach() moves it into a buffer of its own.
+		struct host_frame_buffer : host_frame_buffer_base
+		{
+			host_frame_buffer(uint8_t const frame[], int32_t const &width, int32_t const &height, shared_ptr<frame_pool> pool) noexcept :
+				pool{ move(pool) },
+				lock{},
+				is_unlocked{},
+				data{ frame },
+				copy{},
+				pitch{ width * 2 },
+				height{ height },
+				length{ static_cast<DWORD>(width * 2 * height) },
+				lock_count{},
+				references{ 1 }
+			{
+			}
+
+			// Counted alongside WRL's own count, which it keeps to itself; Make hands out the first reference without AddRef.
+			STDMETHODIMP_(ULONG) AddRef() override
+			{
+				references.fetch_add(1, memory_order_relaxed);
+				return host_frame_buffer_base::AddRef();
+			}
+
+			STDMETHODIMP_(ULONG) Release() override
+			{
+				references.fetch_sub(1, memory_order_acq_rel);
+				return host_frame_buffer_base::Release();
+			}
+
+			// Whether anyone but the caller, who holds one reference, still holds the buffer.
+			bool is_shared() const noexcept
+			{
+				return references.load(memory_order_acquire) > 1;
+			}
+
+			void wait_until_unlocked()
+			{
+				unique_lock guard{ lock };
+				is_unlocked.wait(guard, [this] { return lock_count == 0; });
+			}
+
+			~host_frame_buffer()
+			{
+				if (copy) pool->give_back(move(copy));
+			}
+
+			// false when it already had a copy; is_locked tells whether someone still reads the host's frame through an earlier lock.
+			bool detach(bool &is_locked)
+			{
+				lock_guard const guard{ lock };
+				is_locked = lock_count > 0;
+				if (copy) return false;
+
+				copy = pool->take();
+				memcpy(copy.get(), data, length);
+				data = copy.get();
+				return true;
+			}
+
+			STDMETHODIMP Lock(BYTE **buffer, DWORD *max_length, DWORD *current_length) override
+			{
+				if (!buffer) return E_POINTER;
+
+				lock_guard const guard{ lock };
+				++lock_count;
+				// Encoders only read their input, so a plain lock hands out the frame as it is.
+				*buffer = const_cast<BYTE *>(data);
+				if (max_length) *max_length = length;
+				if (current_length) *current_length = length;
+				return S_OK;
+			}
+
+			STDMETHODIMP Unlock() override
+			{
+				lock_guard const guard{ lock };
+				if (!lock_count) return MF_E_INVALIDREQUEST;
+				if (!--lock_count) is_unlocked.notify_all();
+				return S_OK;
+			}
+
+			STDMETHODIMP GetCurrentLength(DWORD *current_length) override
+			{
+				if (!current_length) return E_POINTER;
+				*current_length = length;
+				return S_OK;
+			}
+
+			STDMETHODIMP SetCurrentLength(DWORD current_length) override
+			{
+				// The frame is always whole; only its own size is accepted.
+				return current_length == length ? S_OK : E_INVALIDARG;
+			}
+
+			STDMETHODIMP GetMaxLength(DWORD *max_length) override
+			{
+				return GetCurrentLength(max_length);
+			}
+
+			STDMETHODIMP Lock2D(BYTE **scanline, LONG *stride) override
+			{
+				return Lock2DSize(MF2DBuffer_LockFlags_Read, scanline, stride, nullptr, nullptr);
+			}
+
+			STDMETHODIMP Unlock2D() override
+			{
+				return Unlock();
+			}
+
+			STDMETHODIMP GetScanline0AndPitch(BYTE **scanline, LONG *stride) override
+			{
+				if (!scanline || !stride) return E_POINTER;
+
+				lock_guard const guard{ lock };
+				if (!lock_count) return MF_E_UNEXPECTED;
+				*scanline = const_cast<BYTE *>(data);
+				*stride = pitch;
+				return S_OK;
+			}
+
+			STDMETHODIMP IsContiguousFormat(BOOL *is_contiguous) override
+			{
+				if (!is_contiguous) return E_POINTER;
+				*is_contiguous = TRUE;
+				return S_OK;
+			}
+
+			STDMETHODIMP GetContiguousLength(DWORD *contiguous_length) override
+			{
+				return GetCurrentLength(contiguous_length);
+			}
+
+			STDMETHODIMP ContiguousCopyTo(BYTE *destination, DWORD destination_length) override
+			{
+				if (!destination) return E_POINTER;
+				if (destination_length < length) return E_INVALIDARG;
+
+				lock_guard const guard{ lock };
+				memcpy(destination, data, length);
+				return S_OK;
+			}
+
+			STDMETHODIMP ContiguousCopyFrom(BYTE const *source, DWORD source_length) override
+			{
+				BYTE *scanline{}, *begin{};
+				LONG stride{};
+				DWORD buffer_length{};
+				if (auto const hr{ Lock2DSize(MF2DBuffer_LockFlags_Write, &scanline, &stride, &begin, &buffer_length) }; FAILED(hr)) return hr;
+
+				memcpy(scanline, source, min(source_length, length));
+				return Unlock();
+			}
+
+			STDMETHODIMP Lock2DSize(MF2DBuffer_LockFlags flags, BYTE **scanline, LONG *stride, BYTE **begin, DWORD *buffer_length) override
+			{
+				if (!scanline || !stride) return E_POINTER;
+
+				// Writing must not reach the host's frame, so whoever asks to write gets a copy of their own first.
+				if (flags & MF2DBuffer_LockFlags_Write)
+				{
+					bool is_locked{};
+					detach(is_locked);
+				}
+
+				lock_guard const guard{ lock };
+				++lock_count;
+				*scanline = const_cast<BYTE *>(data);
+				*stride = pitch;
+				if (begin) *begin = const_cast<BYTE *>(data);
+				if (buffer_length) *buffer_length = length;
+				return S_OK;
+			}
+
+			STDMETHODIMP Copy2DTo(IMF2DBuffer2 *destination) override
+			{
+				if (!destination) return E_POINTER;
+
+				BYTE *scanline{}, *begin{};
+				LONG stride{};
+				DWORD buffer_length{};
+				if (auto const hr{ destination->Lock2DSize(MF2DBuffer_LockFlags_Write, &scanline, &stride, &begin, &buffer_length) }; FAILED(hr)) return hr;
+
+				auto hr{ S_OK };
+				{
+					lock_guard const guard{ lock };
+					hr = MFCopyImage(scanline, stride, data, pitch, pitch, height);
+				}
+
+				destination->Unlock2D();
+				return hr;
+			}
+
+		private:
+			shared_ptr<frame_pool> pool;
+			mutex lock;
+			condition_variable is_unlocked;
+			uint8_t const *data;
+			unique_ptr<uint8_t[]> copy;
+			LONG pitch;
+			int32_t height;
+			DWORD length;
+			int32_t lock_count;
+			atomic<ULONG> references;
+		};
+
+		double statistics::get_avoided_ratio() const noexcept
+		{
+			return wrapped ? static_cast<double>(wrapped - copied) / wrapped : 0.0;
+		}
+
+		host_frame_wrapper::host_frame_wrapper(int32_t const &width, int32_t const &height) noexcept :
+			width{ width },
+			height{ height },
+			pool{ make_shared<frame_pool>(static_cast<size_t>(width) * 2 * height) },
+			current{},
+			counters{},
+			released_in_time{},
+			copies_upfront{ true }
+		{
+		}
+
+		host_frame_wrapper::~host_frame_wrapper()
+		{
+			release_current();
+		}
+
+		HRESULT host_frame_wrapper::wrap(uint8_t const frame[], com_ptr_nothrow<IMFMediaBuffer> &buffer) noexcept
+		{
+			release_current();
+
+			auto const made{ Microsoft::WRL::Make<host_frame_buffer>(frame, width, height, pool) };
+			if (!made) [[unlikely]] return E_OUTOFMEMORY;
+
+			current = made.Get();
+			buffer = current;
+			++counters.wrapped;
+
+			if (copies_upfront)
+			{
+				bool is_locked{};
+				made->detach(is_locked);
+				++counters.copied;
+			}
+
+			return S_OK;
+		}
+
+		void host_frame_wrapper::release_current() noexcept
+		{
+			if (!current) return;
+
+			auto &buffer{ *static_cast<host_frame_buffer *>(current.get()) };
+
+			// What is left after our own reference is the writer's, or the encoder's waiting on more input.
+			bool is_locked{};
+			if (buffer.is_shared() && buffer.detach(is_locked)) ++counters.copied;
+
+			if (is_locked)
+			{
+				// The lock was handed out before the copy, so the encoder may still be reading the host's frame, which the host reuses as soon as this returns.
+				if (!copies_upfront) buffer.wait_until_unlocked();
+
+				++counters.locked;
+				copies_upfront = true;
+				released_in_time = 0;
+			}
+			else if (copies_upfront && ++released_in_time >= trusted_after)
+				copies_upfront = false;
+
+			current.reset();
+		}
+
+		statistics host_frame_wrapper::get_statistics() const noexcept
+		{
+			return counters;
+		}
+	}
+}
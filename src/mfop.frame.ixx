@@ -0,0 +1,66 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#define STRICT
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <wil/com.h>
+#include <mfobjects.h>
+
+export module mfop.frame;
+
+import std;
+
+namespace mfop
+{
+	namespace frame
+	{
+		struct frame_pool;
+
+		export
+		{
+			struct statistics
+			{
+				std::uint64_t wrapped;
+				// Frames still held by the writer or the encoder when the host was about to reuse them.
+				std::uint64_t copied;
+				// Frames the encoder still had locked when they were handed back; the host waited for each, and copying up front started over.
+				std::uint64_t locked;
+
+				double get_avoided_ratio() const noexcept;
+			};
+
+			// Hands the host's YUY2 frames to the writer as media buffers without copying them first,
+			// once the encoder has shown for a while, on frames copied up front, that it lets go of its input locks by the time the write returns.
+			struct host_frame_wrapper
+			{
+				host_frame_wrapper(std::int32_t const &width, std::int32_t const &height) noexcept;
+				host_frame_wrapper(host_frame_wrapper const &) = delete;
+				~host_frame_wrapper();
+
+				// frame has to stay valid until release_current(), so nothing may call into the host in between.
+				HRESULT wrap(std::uint8_t const frame[], wil::com_ptr_nothrow<IMFMediaBuffer> &buffer) noexcept;
+				// Copies the frame into a pooled buffer if anyone still holds it, and otherwise just lets it go.
+				// A frame still locked is waited for, as the encoder reads the host's memory through that lock.
+				void release_current() noexcept;
+
+				statistics get_statistics() const noexcept;
+
+			private:
+				std::int32_t width;
+				std::int32_t height;
+				std::shared_ptr<frame_pool> pool;
+				wil::com_ptr_nothrow<IMFMediaBuffer> current;
+				statistics counters;
+				std::uint32_t released_in_time;
+				bool copies_upfront;
+			};
+		}
+	}
+}
@@ -0,0 +1,527 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#include <immintrin.h>
+
+module mfop.hash;
+
+import std;
+
+using namespace std;
+
+namespace mfop
+{
+	namespace hash
+	{
+		auto const constinit prime_1{ 0x9e3779b185ebca87ull };
+		auto const constinit prime_2{ 0xc2b2ae3d27d4eb4full };
+		auto const constinit prime_3{ 0x165667b19e3779f9ull };
+		auto const constinit prime_4{ 0x85ebca77c2b2ae63ull };
+		auto const constinit prime_5{ 0x27d4eb2f165667c5ull };
+
+		auto constexpr read_64(uint8_t const bytes[]) noexcept
+		{
+			uint64_t value{};
+			for (auto i{ 0 }; i < 8; ++i)
+				value |= static_cast<uint64_t>(bytes[i]) << (i * 8);
+			return value;
+		}
+
+		auto constexpr read_32(uint8_t const bytes[]) noexcept
+		{
+			uint64_t value{};
+			for (auto i{ 0 }; i < 4; ++i)
+				value |= static_cast<uint64_t>(bytes[i]) << (i * 8);
+			return value;
+		}
+
+		auto constexpr round(uint64_t const &lane, uint64_t const &input) noexcept
+		{
+			return rotl(lane + input * prime_2, 31) * prime_1;
+		}
+
+		auto constexpr merge_round(uint64_t const &accumulator, uint64_t const &lane) noexcept
+		{
+			return (accumulator ^ round(0, lane)) * prime_1 + prime_4;
+		}
+
+		xxh64::xxh64(uint64_t const &seed) noexcept :
+			seed{ seed },
+			lanes{ seed + prime_1 + prime_2, seed + prime_2, seed, seed - prime_1 },
+			pending{},
+			pending_size{},
+			total_size{}
+		{
+		}
+
+		void xxh64::update(span<uint8_t const> data) noexcept
+		{
+			total_size += data.size();
+
+			if (pending_size + data.size() < pending.size())
+			{
+				ranges::copy(data, pending.begin() + pending_size);
+				pending_size += data.size();
+				return;
+			}
+
+			if (pending_size > 0)
+			{
+				auto const filler{ pending.size() - pending_size };
+				ranges::copy(data.first(filler), pending.begin() + pending_size);
+				data = data.subspan(filler);
+				pending_size = 0;
+
+				for (auto i{ 0u }; i < lanes.size(); ++i)
+					lanes[i] = round(lanes[i], read_64(pending.data() + i * 8));
+			}
+
+			for (; data.size() >= pending.size(); data = data.subspan(pending.size()))
+				for (auto i{ 0u }; i < lanes.size(); ++i)
+					lanes[i] = round(lanes[i], read_64(data.data() + i * 8));
+
+			ranges::copy(data, pending.begin());
+			pending_size = data.size();
+		}
+
+		uint64_t xxh64::digest() const noexcept
+		{
+			auto result{ total_size >= pending.size()
+				? merge_round(merge_round(merge_round(merge_round(rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18), lanes[0]), lanes[1]), lanes[2]), lanes[3])
+				: seed + prime_5 };
+
+			result += total_size;
+
+			auto tail{ span{ pending }.first(pending_size) };
+
+			for (; tail.size() >= 8; tail = tail.subspan(8))
+				result = rotl(result ^ round(0, read_64(tail.data())), 27) * prime_1 + prime_4;
+
+			if (tail.size() >= 4)
+			{
+				result = rotl(result ^ read_32(tail.data()) * prime_1, 23) * prime_2 + prime_3;
+				tail = tail.subspan(4);
+			}
+
+			for (auto const &byte : tail)
+				result = rotl(result ^ byte * prime_5, 11) * prime_1;
+
+			result ^= result >> 33;
+			result *= prime_2;
+			result ^= result >> 29;
+			result *= prime_3;
+			result ^= result >> 32;
+
+			return result;
+		}
+
+		auto const constinit blake3_iv{ to_array<uint32_t>({ 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 }) };
+		// Where each round takes its message words from, the permutation applied round after round.
+		auto constexpr message_schedule{ []
+		{
+			auto const permutation{ to_array<uint8_t>({ 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 }) };
+			array<array<uint8_t, 16>, 7> schedule{};
+			for (auto i{ 0u }; i < schedule[0].size(); ++i) schedule[0][i] = static_cast<uint8_t>(i);
+			for (auto round{ 1u }; round < schedule.size(); ++round)
+				for (auto i{ 0u }; i < schedule[round].size(); ++i)
+					schedule[round][i] = schedule[round - 1][permutation[i]];
+			return schedule;
+		}() };
+
+		auto const constinit chunk_start{ 1u };
+		auto const constinit chunk_end{ 2u };
+		auto const constinit parent{ 4u };
+		auto const constinit root{ 8u };
+
+		using words_t = array<uint32_t, 16>;
+
+		template<int Bits> auto rotate_right(__m128i const &x) noexcept
+		{
+			return _mm_or_si128(_mm_srli_epi32(x, Bits), _mm_slli_epi32(x, 32 - Bits));
+		}
+
+		// G on the four columns at once, or on the four diagonals once the rows are turned.
+		auto mix(__m128i &a, __m128i &b, __m128i &c, __m128i &d, __m128i const &x, __m128i const &y) noexcept
+		{
+			a = _mm_add_epi32(_mm_add_epi32(a, b), x);
+			d = rotate_right<16>(_mm_xor_si128(d, a));
+			c = _mm_add_epi32(c, d);
+			b = rotate_right<12>(_mm_xor_si128(b, c));
+			a = _mm_add_epi32(_mm_add_epi32(a, b), y);
+			d = rotate_right<8>(_mm_xor_si128(d, a));
+			c = _mm_add_epi32(c, d);
+			b = rotate_right<7>(_mm_xor_si128(b, c));
+		}
+
+		// Every other word from First on, in the order of the round; known at compile time, each is a plain load.
+		template<size_t Round, size_t First> auto gather(words_t const &words) noexcept
+		{
+			auto constexpr &order{ message_schedule[Round] };
+			return _mm_setr_epi32(static_cast<int32_t>(words[order[First]]), static_cast<int32_t>(words[order[First + 2]]), static_cast<int32_t>(words[order[First + 4]]), static_cast<int32_t>(words[order[First + 6]]));
+		}
+
+		template<size_t Round> auto mix_round(__m128i &a, __m128i &b, __m128i &c, __m128i &d, words_t const &words) noexcept
+		{
+			mix(a, b, c, d, gather<Round, 0>(words), gather<Round, 1>(words));
+			b = _mm_shuffle_epi32(b, _MM_SHUFFLE(0, 3, 2, 1));
+			c = _mm_shuffle_epi32(c, _MM_SHUFFLE(1, 0, 3, 2));
+			d = _mm_shuffle_epi32(d, _MM_SHUFFLE(2, 1, 0, 3));
+
+			mix(a, b, c, d, gather<Round, 8>(words), gather<Round, 9>(words));
+			b = _mm_shuffle_epi32(b, _MM_SHUFFLE(2, 1, 0, 3));
+			c = _mm_shuffle_epi32(c, _MM_SHUFFLE(1, 0, 3, 2));
+			d = _mm_shuffle_epi32(d, _MM_SHUFFLE(0, 3, 2, 1));
+		}
+
+		template<size_t... Rounds> auto mix_rounds(__m128i &a, __m128i &b, __m128i &c, __m128i &d, words_t const &words, index_sequence<Rounds...>) noexcept
+		{
+			(mix_round<Rounds>(a, b, c, d, words), ...);
+		}
+
+		// Only the first half of the output is kept; it is the chaining value, or at the root the digest.
+		auto compress(blake3::chaining_value const &value, words_t const &words, uint64_t const &counter, uint32_t const &size, uint32_t const &flags) noexcept
+		{
+			auto a{ _mm_loadu_si128(reinterpret_cast<__m128i const *>(value.data())) };
+			auto b{ _mm_loadu_si128(reinterpret_cast<__m128i const *>(value.data() + 4)) };
+			auto c{ _mm_loadu_si128(reinterpret_cast<__m128i const *>(blake3_iv.data())) };
+			auto d{ _mm_setr_epi32(static_cast<int32_t>(counter), static_cast<int32_t>(counter >> 32), static_cast<int32_t>(size), static_cast<int32_t>(flags)) };
+
+			mix_rounds(a, b, c, d, words, make_index_sequence<message_schedule.size()>{});
+
+			blake3::chaining_value result{};
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(result.data()), _mm_xor_si128(a, c));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(result.data() + 4), _mm_xor_si128(b, d));
+			return result;
+		}
+
+		// The intrinsics already tie this to little-endian processors, so the words are the bytes as they lie.
+		auto get_words(span<uint8_t const, 64> block) noexcept
+		{
+			words_t words{};
+			memcpy(words.data(), block.data(), sizeof words);
+			return words;
+		}
+
+		// Row i of four vectors becomes vector i of four rows.
+		auto transpose(__m128i &x0, __m128i &x1, __m128i &x2, __m128i &x3) noexcept
+		{
+			auto const t0{ _mm_unpacklo_epi32(x0, x1) }, t1{ _mm_unpacklo_epi32(x2, x3) }, t2{ _mm_unpackhi_epi32(x0, x1) }, t3{ _mm_unpackhi_epi32(x2, x3) };
+			x0 = _mm_unpacklo_epi64(t0, t1);
+			x1 = _mm_unpackhi_epi64(t0, t1);
+			x2 = _mm_unpacklo_epi64(t2, t3);
+			x3 = _mm_unpackhi_epi64(t2, t3);
+		}
+
+		template<size_t Round> auto mix_lanes_round(array<__m128i, 16> &v, array<__m128i, 16> const &m) noexcept
+		{
+			auto constexpr &order{ message_schedule[Round] };
+			mix(v[0], v[4], v[8], v[12], m[order[0]], m[order[1]]);
+			mix(v[1], v[5], v[9], v[13], m[order[2]], m[order[3]]);
+			mix(v[2], v[6], v[10], v[14], m[order[4]], m[order[5]]);
+			mix(v[3], v[7], v[11], v[15], m[order[6]], m[order[7]]);
+			mix(v[0], v[5], v[10], v[15], m[order[8]], m[order[9]]);
+			mix(v[1], v[6], v[11], v[12], m[order[10]], m[order[11]]);
+			mix(v[2], v[7], v[8], v[13], m[order[12]], m[order[13]]);
+			mix(v[3], v[4], v[9], v[14], m[order[14]], m[order[15]]);
+		}
+
+		template<size_t... Rounds> auto mix_lanes(array<__m128i, 16> &v, array<__m128i, 16> const &m, index_sequence<Rounds...>) noexcept
+		{
+			(mix_lanes_round<Rounds>(v, m), ...);
+		}
+
+		// Four whole chunks side by side, one to a lane; each vector holds the same word of all four, so nothing is turned between the halves of a round.
+		auto compress_chunks(span<uint8_t const> data, uint64_t const &first_chunk) noexcept
+		{
+			array<__m128i, 8> value{};
+			for (auto i{ 0u }; i < value.size(); ++i)
+				value[i] = _mm_set1_epi32(static_cast<int32_t>(blake3_iv[i]));
+
+			auto const counter_at{ [&](uint64_t const &i, int32_t const &shift) { return static_cast<int32_t>((first_chunk + i) >> shift); } };
+			auto const counter_low{ _mm_setr_epi32(counter_at(0, 0), counter_at(1, 0), counter_at(2, 0), counter_at(3, 0)) };
+			auto const counter_high{ _mm_setr_epi32(counter_at(0, 32), counter_at(1, 32), counter_at(2, 32), counter_at(3, 32)) };
+
+			auto constexpr blocks_per_chunk{ blake3::chunk_size / 64 };
+			for (auto block{ 0u }; block < blocks_per_chunk; ++block)
+			{
+				array<__m128i, 16> m{};
+				for (auto group{ 0u }; group < 4; ++group)
+				{
+					for (auto lane{ 0u }; lane < 4; ++lane)
+						m[group * 4 + lane] = _mm_loadu_si128(reinterpret_cast<__m128i const *>(data.data() + lane * blake3::chunk_size + block * 64 + group * 16));
+					transpose(m[group * 4], m[group * 4 + 1], m[group * 4 + 2], m[group * 4 + 3]);
+				}
+
+				auto const flags{ (block == 0 ? chunk_start : 0) | (block == blocks_per_chunk - 1 ? chunk_end : 0) };
+				array<__m128i, 16> v
+				{
+					value[0], value[1], value[2], value[3], value[4], value[5], value[6], value[7],
+					_mm_set1_epi32(static_cast<int32_t>(blake3_iv[0])), _mm_set1_epi32(static_cast<int32_t>(blake3_iv[1])), _mm_set1_epi32(static_cast<int32_t>(blake3_iv[2])), _mm_set1_epi32(static_cast<int32_t>(blake3_iv[3])),
+					counter_low, counter_high, _mm_set1_epi32(64), _mm_set1_epi32(static_cast<int32_t>(flags))
+				};
+
+				mix_lanes(v, m, make_index_sequence<message_schedule.size()>{});
+
+				for (auto i{ 0u }; i < value.size(); ++i)
+					value[i] = _mm_xor_si128(v[i], v[i + 8]);
+			}
+
+			transpose(value[0], value[1], value[2], value[3]);
+			transpose(value[4], value[5], value[6], value[7]);
+
+			array<blake3::chaining_value, 4> values{};
+			for (auto lane{ 0u }; lane < values.size(); ++lane)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(values[lane].data()), value[lane]);
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(values[lane].data() + 4), value[lane + 4]);
+			}
+			return values;
+		}
+
+		auto get_words(blake3::chaining_value const &left, blake3::chaining_value const &right) noexcept
+		{
+			words_t words{};
+			ranges::copy(left, words.begin());
+			ranges::copy(right, words.begin() + 8);
+			return words;
+		}
+
+		// A node whose last compression waits until it is known whether the node is the root.
+		struct node
+		{
+			blake3::chaining_value value;
+			words_t words;
+			uint64_t counter;
+			uint32_t size;
+			uint32_t flags;
+
+			auto get_value() const noexcept
+			{
+				return compress(value, words, counter, size, flags);
+			}
+
+			auto get_digest() const noexcept
+			{
+				auto const result{ compress(value, words, 0, size, flags | root) };
+
+				blake3::digest_t digest{};
+				for (auto i{ 0u }; i < digest.size(); ++i)
+					digest[i] = static_cast<uint8_t>(result[i / 4] >> (i % 4 * 8));
+				return digest;
+			}
+		};
+
+		auto make_parent(blake3::chaining_value const &left, blake3::chaining_value const &right) noexcept
+		{
+			return node{ blake3_iv, get_words(left, right), 0, 64, parent };
+		}
+
+		// What is left of the stack folds into the last chunk from the right.
+		auto fold(span<blake3::chaining_value const> stack, node last) noexcept
+		{
+			for (; !stack.empty(); stack = stack.first(stack.size() - 1))
+				last = make_parent(stack.back(), last.get_value());
+			return last;
+		}
+
+		blake3::blake3() noexcept :
+			chunk_value{ blake3_iv },
+			chunk_counter{},
+			block{},
+			block_size{},
+			blocks_compressed{},
+			stack{},
+			stack_size{}
+		{
+		}
+
+		void blake3::update(span<uint8_t const> data) noexcept
+		{
+			while (!data.empty())
+			{
+				// A full chunk or block is only compressed once more input comes, as the last of them is finished differently.
+				if (blocks_compressed * block.size() + block_size == chunk_size)
+				{
+					push(compress(chunk_value, get_words(block), chunk_counter, static_cast<uint32_t>(block_size), (blocks_compressed ? 0 : chunk_start) | chunk_end), chunk_counter + 1);
+					chunk_value = blake3_iv;
+					++chunk_counter;
+					block.fill(0);
+					block_size = 0;
+					blocks_compressed = 0;
+				}
+
+				if (block_size == block.size())
+				{
+					chunk_value = compress(chunk_value, get_words(block), chunk_counter, static_cast<uint32_t>(block_size), blocks_compressed ? 0 : chunk_start);
+					++blocks_compressed;
+					block.fill(0);
+					block_size = 0;
+				}
+
+				auto const taken{ min(block.size() - block_size, data.size()) };
+				ranges::copy(data.first(taken), block.begin() + block_size);
+				block_size += taken;
+				data = data.subspan(taken);
+			}
+		}
+
+		blake3::digest_t blake3::digest() const noexcept
+		{
+			return fold(span{ stack }.first(stack_size), node{ chunk_value, get_words(block), chunk_counter, static_cast<uint32_t>(block_size), (blocks_compressed ? 0 : chunk_start) | chunk_end }).get_digest();
+		}
+
+		blake3::chaining_value blake3::get_subtree_value(span<uint8_t const> data, uint64_t const &first_chunk) noexcept
+		{
+			// A subtree of four chunks or more is a whole number of fours, hashed a four at a time and then paired up level by level.
+			if (auto const chunks{ data.size() / chunk_size }; chunks >= 4)
+			{
+				vector<chaining_value> level(chunks);
+				for (auto i{ 0u }; i < chunks; i += 4)
+					ranges::copy(compress_chunks(data.subspan(i * chunk_size, 4 * chunk_size), first_chunk + i), level.begin() + i);
+
+				for (; level.size() > 1; level.resize(level.size() / 2))
+					for (auto i{ 0u }; i < level.size() / 2; ++i)
+						level[i] = make_parent(level[i * 2], level[i * 2 + 1]).get_value();
+
+				return level.front();
+			}
+
+			// The counts that decide the merges carry over from the start of the input, as the subtree is aligned to its own size.
+			blake3 hasher{};
+			hasher.chunk_counter = first_chunk;
+			hasher.update(data);
+			return fold(span{ hasher.stack }.first(hasher.stack_size), node{ hasher.chunk_value, get_words(hasher.block), hasher.chunk_counter, static_cast<uint32_t>(hasher.block_size), (hasher.blocks_compressed ? 0 : chunk_start) | chunk_end }).get_value();
+		}
+
+		blake3::digest_t blake3::join(span<chaining_value const> subtrees, uint64_t const &subtree_chunks, span<uint8_t const> tail) noexcept
+		{
+			// Counted in subtrees, the merges come out as they would have counted in chunks.
+			blake3 hasher{};
+			auto const pushed{ tail.empty() ? subtrees.first(subtrees.size() - 1) : subtrees };
+			for (auto i{ 0u }; i < pushed.size(); ++i)
+				hasher.push(pushed[i], i + 1);
+
+			if (tail.empty())
+			{
+				auto const stack{ span{ hasher.stack }.first(hasher.stack_size) };
+				return fold(stack.first(stack.size() - 1), make_parent(stack.back(), subtrees.back())).get_digest();
+			}
+
+			hasher.chunk_counter = subtrees.size() * subtree_chunks;
+			hasher.update(tail);
+			return hasher.digest();
+		}
+
+		void blake3::push(chaining_value value, uint64_t total) noexcept
+		{
+			for (; (total & 1) == 0; total >>= 1)
+				value = make_parent(stack[--stack_size], value).get_value();
+			stack[stack_size++] = value;
+		}
+
+		blake3_file::blake3_file() noexcept :
+			blocks{},
+			pending{},
+			size{},
+			reread_size{},
+			is_in_order{ true }
+		{
+		}
+
+		void blake3_file::write(uint64_t const &position, span<uint8_t const> data)
+		{
+			auto const end{ position + data.size() };
+			size = max(size, end);
+
+			auto const hashed_end{ blocks.size() * block_size };
+			for (auto index{ position / block_size }; index < blocks.size() && index * block_size < end; ++index)
+				blocks[index].reset();
+
+			if (!is_in_order) return;
+
+			auto const frontier{ hashed_end + pending.size() };
+			if (position > frontier)
+			{
+				is_in_order = false;
+				pending = {};
+				return;
+			}
+
+			// A media sink going back to patch a size usually lands in the block that is still being filled.
+			if (auto const patch_begin{ max(position, hashed_end) }, patch_end{ min(end, frontier) }; patch_begin < patch_end)
+				ranges::copy(data.subspan(patch_begin - position, patch_end - patch_begin), pending.begin() + (patch_begin - hashed_end));
+
+			if (end <= frontier) return;
+
+			for (auto rest{ data.subspan(frontier - position) }; !rest.empty(); )
+			{
+				auto const taken{ min(block_size - pending.size(), rest.size()) };
+				pending.insert(pending.end(), rest.begin(), rest.begin() + taken);
+				rest = rest.subspan(taken);
+
+				if (pending.size() == block_size)
+				{
+					blocks.emplace_back(blake3::get_subtree_value(pending, blocks.size() * (block_size / blake3::chunk_size)));
+					pending.clear();
+				}
+			}
+		}
+
+		optional<blake3::digest_t> blake3_file::digest(function<bool(uint64_t const &, span<uint8_t>)> const &read)
+		{
+			vector<uint8_t> buffer{};
+			auto const read_back{ [&](uint64_t const &position, size_t const &length)
+			{
+				buffer.resize(length);
+				reread_size += length;
+				return read(position, buffer);
+			} };
+
+			auto const full_blocks{ size / block_size };
+			auto const tail_size{ static_cast<size_t>(size % block_size) };
+			auto const has_tail{ is_in_order && blocks.size() == full_blocks && pending.size() == tail_size };
+
+			// Up to a block, the root is inside it, so there is nothing to join and the block is hashed whole.
+			// A file of exactly one block had it hashed as a subtree, not as the root, and is read back.
+			if (size <= block_size)
+			{
+				blake3 hasher{};
+				if (has_tail && blocks.empty()) hasher.update(pending);
+				else if (read_back(0, static_cast<size_t>(size))) hasher.update(buffer);
+				else return nullopt;
+				return hasher.digest();
+			}
+
+			vector<blake3::chaining_value> values(full_blocks);
+			for (auto i{ 0u }; i < full_blocks; ++i)
+			{
+				if (i < blocks.size() && blocks[i])
+				{
+					values[i] = *blocks[i];
+					continue;
+				}
+
+				if (!read_back(i * block_size, block_size)) return nullopt;
+				values[i] = blake3::get_subtree_value(buffer, i * (block_size / blake3::chunk_size));
+			}
+
+			if (!has_tail && !read_back(full_blocks * block_size, tail_size)) return nullopt;
+			return blake3::join(values, block_size / blake3::chunk_size, has_tail ? span<uint8_t const>{ pending } : span<uint8_t const>{ buffer });
+		}
+
+		uint64_t blake3_file::get_size() const noexcept
+		{
+			return size;
+		}
+
+		uint64_t blake3_file::get_reread_size() const noexcept
+		{
+			return reread_size;
+		}
+	}
+}
@@ -0,0 +1,91 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+export module mfop.hash;
+
+import std;
+
+namespace mfop
+{
+	namespace hash
+	{
+		export
+		{
+			// Streaming XXH64; fast enough to fingerprint every frame we are handed without showing up in a profile.
+			struct xxh64
+			{
+				explicit xxh64(std::uint64_t const &seed = 0) noexcept;
+
+				void update(std::span<std::uint8_t const> data) noexcept;
+				std::uint64_t digest() const noexcept;
+
+			private:
+				std::uint64_t seed;
+				std::array<std::uint64_t, 4> lanes;
+				std::array<std::uint8_t, 32> pending;
+				std::size_t pending_size;
+				std::uint64_t total_size;
+			};
+
+			// Streaming BLAKE3, unkeyed with a 256-bit digest; each block is compressed a row of four words to a vector.
+			// The input is a tree of chunks, so a subtree hashed apart, or again after its bytes changed, joins the rest without going over them.
+			struct blake3
+			{
+				using chaining_value = std::array<std::uint32_t, 8>;
+				using digest_t = std::array<std::uint8_t, 32>;
+
+				static std::size_t constexpr chunk_size{ 1024 };
+
+				blake3() noexcept;
+
+				void update(std::span<std::uint8_t const> data) noexcept;
+				digest_t digest() const noexcept;
+
+				// Of a whole subtree: a power of two chunks that starts at a multiple of as many, and is not all of the input.
+				static chaining_value get_subtree_value(std::span<std::uint8_t const> data, std::uint64_t const &first_chunk) noexcept;
+				// Of equal subtrees of subtree_chunks each, in order, and the bytes after them; with no bytes after them, there have to be two subtrees or more.
+				static digest_t join(std::span<chaining_value const> subtrees, std::uint64_t const &subtree_chunks, std::span<std::uint8_t const> tail) noexcept;
+
+			private:
+				chaining_value chunk_value;
+				std::uint64_t chunk_counter;
+				std::array<std::uint8_t, 64> block;
+				std::size_t block_size;
+				std::size_t blocks_compressed;
+				// One chaining value per level of the tree whose left half is done.
+				std::array<chaining_value, 54> stack;
+				std::size_t stack_size;
+
+				void push(chaining_value value, std::uint64_t total) noexcept;
+			};
+
+			// The BLAKE3 of a file, taken from the writes to it in whatever order they come.
+			// Each block is hashed once it has been written through; one written again afterwards is read back at the end, as is everything after a write that skipped ahead.
+			struct blake3_file
+			{
+				static std::size_t constexpr block_size{ std::size_t{ 1 } << 20 };
+
+				blake3_file() noexcept;
+
+				void write(std::uint64_t const &position, std::span<std::uint8_t const> data);
+				// read fills the span with the file's bytes at the position, and returns false if it cannot.
+				std::optional<blake3::digest_t> digest(std::function<bool(std::uint64_t const &, std::span<std::uint8_t>)> const &read);
+
+				std::uint64_t get_size() const noexcept;
+				std::uint64_t get_reread_size() const noexcept;
+
+			private:
+				// Emptied when a block that was hashed is written again.
+				std::vector<std::optional<blake3::chaining_value>> blocks;
+				// The start of the block after the hashed ones, while the writes have gone in order.
+				std::vector<std::uint8_t> pending;
+				std::uint64_t size;
+				std::uint64_t reread_size;
+				bool is_in_order;
+			};
+		}
+	}
+}
@@ -6,4 +6,6 @@
 
 export module mfop;
 export import mfop.core;
-export import mfop.configure;
\ No newline at end of file
+export import mfop.configure;
+export import mfop.session;
+export import mfop.timeline;
\ No newline at end of file
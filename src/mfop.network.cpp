@@ -0,0 +1,268 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#define STRICT
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#include <Windows.h>
+#include <wil/resource.h>
+
+#pragma comment(lib, "Ws2_32")
+
+module mfop.network;
+
+import std;
+
+using namespace std;
+using namespace wil;
+
+namespace mfop
+{
+	namespace network
+	{
+		// About six seconds at 10 Mbit/s; in real time, how far the encoder may get ahead of what has gone out.
+		auto const constinit max_queued_bytes{ size_t{ 8 } << 20 };
+
+		struct endpoint
+		{
+			bool is_tcp;
+			wstring host;
+			wstring port;
+		};
+
+		auto parse_address(wstring_view address) noexcept -> optional<endpoint>
+		{
+			auto is_tcp{ false };
+			if (address.starts_with(L"tcp://"))
+			{
+				is_tcp = true;
+				address.remove_prefix(6);
+			}
+			else if (address.starts_with(L"udp://"))
+				address.remove_prefix(6);
+
+			auto host{ wstring_view{} };
+			auto port{ wstring_view{} };
+
+			if (address.starts_with(L'['))
+			{
+				auto const close{ address.find(L"]:") };
+				if (close == wstring_view::npos) return nullopt;
+				host = address.substr(1, close - 1);
+				port = address.substr(close + 2);
+			}
+			else
+			{
+				auto const colon{ address.rfind(L':') };
+				if (colon == wstring_view::npos) return nullopt;
+				host = address.substr(0, colon);
+				port = address.substr(colon + 1);
+			}
+
+			if (host.empty() || port.empty()) return nullopt;
+			return endpoint{ is_tcp, wstring{ host }, wstring{ port } };
+		}
+
+		expected<shared_ptr<ts_sender>, error> ts_sender::connect(wstring_view address, bool const &is_realtime) noexcept
+		{
+			WSADATA data{};
+			if (auto const code{ WSAStartup(MAKEWORD(2, 2), &data) }) [[unlikely]] return unexpected{ error{ HRESULT_FROM_WIN32(code), "WSAStartup" } };
+			auto cleanup{ scope_exit([]() noexcept { WSACleanup(); }) };
+
+			auto const found_endpoint{ parse_address(address) };
+			if (!found_endpoint) [[unlikely]] return unexpected{ error{ E_INVALIDARG, "[stream] address" } };
+
+			ADDRINFOW hints{};
+			hints.ai_family = AF_UNSPEC;
+			hints.ai_socktype = found_endpoint->is_tcp ? SOCK_STREAM : SOCK_DGRAM;
+			hints.ai_protocol = found_endpoint->is_tcp ? IPPROTO_TCP : IPPROTO_UDP;
+
+			ADDRINFOW *addresses{};
+			if (auto const code{ GetAddrInfoW(found_endpoint->host.c_str(), found_endpoint->port.c_str(), &hints, &addresses) }) [[unlikely]] return unexpected{ error{ HRESULT_FROM_WIN32(code), "GetAddrInfoW" } };
+			auto const free_addresses{ scope_exit([&]() noexcept { FreeAddrInfoW(addresses); }) };
+
+			// The first address that takes a connection wins; a UDP socket is connected too, so every send goes to the same place.
+			unique_socket connected{};
+			auto last_error{ WSAEADDRNOTAVAIL };
+			for (auto candidate{ addresses }; candidate && !connected; candidate = candidate->ai_next)
+			{
+				unique_socket socket_handle{ socket(candidate->ai_family, candidate->ai_socktype, candidate->ai_protocol) };
+				if (!socket_handle || ::connect(socket_handle.get(), candidate->ai_addr, static_cast<int32_t>(candidate->ai_addrlen)) == SOCKET_ERROR)
+				{
+					last_error = WSAGetLastError();
+					continue;
+				}
+
+				connected = move(socket_handle);
+			}
+			if (!connected) [[unlikely]] return unexpected{ error{ HRESULT_FROM_WIN32(last_error), "connect" } };
+
+			if (found_endpoint->is_tcp)
+			{
+				// Datagrams are already as large as they are going to get, so waiting to fill a segment only adds jitter.
+				BOOL const is_enabled{ TRUE };
+				setsockopt(connected.get(), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<char const *>(&is_enabled), sizeof is_enabled);
+			}
+
+			cleanup.release();
+			return make_shared<ts_sender>(move(connected), found_endpoint->is_tcp, is_realtime);
+		}
+
+		ts_sender::ts_sender(unique_socket &&socket_handle, bool const &is_tcp, bool const &is_realtime) noexcept :
+			socket_handle{ move(socket_handle) },
+			is_tcp{ is_tcp },
+			scheduler{},
+			pacer{ is_realtime },
+			meter{},
+			ready{},
+			queue{},
+			queued_bytes{},
+			status{ S_OK },
+			is_closing{},
+			is_abandoned{},
+			result{},
+			lock{},
+			close_lock{},
+			has_room{},
+			has_item{},
+			sender{ [this] { run(); } }
+		{
+		}
+
+		ts_sender::~ts_sender()
+		{
+			abandon();
+			socket_handle.reset();
+			WSACleanup();
+		}
+
+		HRESULT ts_sender::write(uint64_t const &, span<uint8_t const> bytes) noexcept
+		{
+			// The stream only goes forward, so where the bytes belong is always right after the last ones.
+			unique_lock guard{ lock };
+			if (FAILED(status)) return status;
+
+			scheduler.push(bytes, ready);
+			return enqueue(guard);
+		}
+
+		HRESULT ts_sender::close() noexcept
+		{
+			scoped_lock const closing{ close_lock };
+
+			{
+				unique_lock guard{ lock };
+				if (result) return *result;
+
+				scheduler.flush(ready);
+				if (SUCCEEDED(status)) enqueue(guard);
+				is_closing = true;
+			}
+
+			has_item.notify_all();
+			if (sender.joinable()) sender.join();
+
+			scoped_lock const guard{ lock };
+			result = status;
+			return *result;
+		}
+
+		void ts_sender::abandon() noexcept
+		{
+			scoped_lock const closing{ close_lock };
+
+			{
+				scoped_lock const guard{ lock };
+				is_abandoned = true;
+				queue.clear();
+				queued_bytes = 0;
+				if (!result) result = E_ABORT;
+			}
+
+			has_item.notify_all();
+			has_room.notify_all();
+			if (sender.joinable()) sender.join();
+		}
+
+		transport::statistics ts_sender::get_statistics() noexcept
+		{
+			scoped_lock const guard{ lock };
+			return meter.get_statistics();
+		}
+
+		HRESULT ts_sender::enqueue(unique_lock<mutex> &guard) noexcept
+		{
+			for (auto &datagram : ready)
+			{
+				has_room.wait(guard, [this] { return queued_bytes < max_queued_bytes || FAILED(status) || is_abandoned; });
+				if (FAILED(status)) return status;
+				if (is_abandoned) return E_ABORT;
+
+				queued_bytes += datagram.bytes.size();
+				queue.push_back(move(datagram));
+				has_item.notify_one();
+			}
+
+			ready.clear();
+			return S_OK;
+		}
+
+		void ts_sender::run() noexcept
+		{
+			for (;;)
+			{
+				unique_lock guard{ lock };
+				has_item.wait(guard, [this] { return !queue.empty() || is_closing || is_abandoned; });
+				if (is_abandoned || queue.empty()) return;
+
+				auto datagram{ move(queue.front()) };
+				queue.pop_front();
+				queued_bytes -= datagram.bytes.size();
+				has_room.notify_one();
+
+				// Waiting on the condition rather than sleeping lets an abort cut the wait short.
+				if (has_item.wait_until(guard, pacer.get_send_time(datagram.due), [this] { return is_abandoned; })) return;
+
+				guard.unlock();
+				auto const hr{ send(datagram.bytes) };
+				auto const sent_time{ chrono::steady_clock::now() };
+				guard.lock();
+
+				if (FAILED(hr))
+				{
+					status = hr;
+					has_room.notify_all();
+					return;
+				}
+
+				meter.record(datagram.due, sent_time, datagram.bytes.size());
+			}
+		}
+
+		HRESULT ts_sender::send(span<uint8_t const> bytes) noexcept
+		{
+			for (size_t sent{}; sent < bytes.size();)
+			{
+				auto const result{ ::send(socket_handle.get(), reinterpret_cast<char const *>(bytes.data() + sent), static_cast<int32_t>(bytes.size() - sent), 0) };
+				if (result == SOCKET_ERROR)
+				{
+					auto const code{ WSAGetLastError() };
+					// Nobody listening yet is no reason to stop a UDP stream; a receiver may come up at any time and pick it up from there.
+					if (!is_tcp && (code == WSAECONNREFUSED || code == WSAECONNRESET)) return S_OK;
+					return HRESULT_FROM_WIN32(code);
+				}
+
+				sent += static_cast<size_t>(result);
+			}
+
+			return S_OK;
+		}
+	}
+}
@@ -0,0 +1,74 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#define STRICT
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <WinSock2.h>
+#include <Windows.h>
+#include <wil/resource.h>
+
+export module mfop.network;
+
+import std;
+import mfop.error;
+import mfop.stream;
+import mfop.transport;
+
+namespace mfop
+{
+	namespace network
+	{
+		export
+		{
+			// Sends the transport stream a media sink writes to a socket, a datagram at a time, at the pace its PCRs set.
+			struct ts_sender final : stream::byte_sink
+			{
+				// address is udp://host:port or tcp://host:port, with IPv6 hosts in brackets; with neither scheme it is UDP.
+				static std::expected<std::shared_ptr<ts_sender>, error> connect(std::wstring_view address, bool const &is_realtime) noexcept;
+
+				// Takes over a connected socket, and the WSAStartup that came before it.
+				ts_sender(wil::unique_socket &&socket_handle, bool const &is_tcp, bool const &is_realtime) noexcept;
+				ts_sender(ts_sender const &) = delete;
+				~ts_sender();
+
+				// Only holds the media sink back once the queue is full, which in real time is as far as it may run ahead.
+				HRESULT write(std::uint64_t const &position, std::span<std::uint8_t const> bytes) noexcept override;
+				// Sends what is left, the last short datagram included, and waits for it to go.
+				HRESULT close() noexcept override;
+				// Drops whatever is still queued, for an export that was aborted.
+				void abandon() noexcept;
+
+				transport::statistics get_statistics() noexcept;
+
+			private:
+				wil::unique_socket socket_handle;
+				bool is_tcp;
+				transport::scheduler scheduler;
+				transport::pacer pacer;
+				transport::meter meter;
+				std::vector<transport::datagram> ready;
+				std::deque<transport::datagram> queue;
+				std::size_t queued_bytes;
+				HRESULT status;
+				bool is_closing;
+				bool is_abandoned;
+				std::optional<HRESULT> result;
+				std::mutex lock;
+				std::mutex close_lock;
+				std::condition_variable has_room;
+				std::condition_variable has_item;
+				std::thread sender;
+
+				void run() noexcept;
+				HRESULT send(std::span<std::uint8_t const> bytes) noexcept;
+				HRESULT enqueue(std::unique_lock<std::mutex> &guard) noexcept;
+			};
+		}
+	}
+}
@@ -0,0 +1,694 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module mfop.package;
+
+import std;
+
+using namespace std;
+
+namespace mfop
+{
+	namespace package
+	{
+		// trun and trex sample flags: set on every sample but the ones a decoder can start from.
+		auto const constinit non_sync_sample{ 0x10000u };
+
+		struct box
+		{
+			string_view type;
+			span<uint8_t const> payload;
+		};
+
+		struct fragment
+		{
+			bool has_reference;
+			bool starts_with_sync;
+			uint64_t base_time;
+			uint64_t duration;
+		};
+
+		auto read_big_endian(span<uint8_t const> bytes, size_t const &offset, size_t const &size) noexcept
+		{
+			if (offset > bytes.size() || size > bytes.size() - offset) return uint64_t{};
+			return ranges::fold_left(bytes.subspan(offset, size), uint64_t{}, [](uint64_t const &value, uint8_t const &byte) { return value << 8 | byte; });
+		}
+
+		auto skip(span<uint8_t const> bytes, size_t const &size) noexcept
+		{
+			return size < bytes.size() ? bytes.subspan(size) : span<uint8_t const>{};
+		}
+
+		// Stops at the first box that does not fit, so a truncated one is never read past.
+		auto get_boxes(span<uint8_t const> bytes)
+		{
+			vector<box> boxes{};
+			for (size_t offset{}; offset + 8 <= bytes.size();)
+			{
+				auto size{ read_big_endian(bytes, offset, 4) };
+				auto header{ uint64_t{ 8 } };
+				if (size == 1)
+				{
+					size = read_big_endian(bytes, offset + 8, 8);
+					header = 16;
+				}
+				else if (size == 0)
+					size = bytes.size() - offset;
+
+				if (size < header || size > bytes.size() - offset) break;
+
+				boxes.push_back({ { reinterpret_cast<char const *>(bytes.data() + offset + 4), 4 }, bytes.subspan(offset + header, size - header) });
+				offset += size;
+			}
+			return boxes;
+		}
+
+		auto find_box(span<uint8_t const> bytes, initializer_list<string_view> path) -> optional<span<uint8_t const>>
+		{
+			for (auto const &type : path)
+			{
+				auto const boxes{ get_boxes(bytes) };
+				auto const found{ ranges::find(boxes, type, &box::type) };
+				if (found == boxes.end()) return nullopt;
+				bytes = found->payload;
+			}
+			return bytes;
+		}
+
+		// MPEG-4 descriptors spread their length over up to four bytes, seven bits each.
+		auto read_descriptor(span<uint8_t const> bytes, size_t &offset) -> optional<pair<uint8_t, span<uint8_t const>>>
+		{
+			if (offset >= bytes.size()) return nullopt;
+
+			auto const tag{ bytes[offset++] };
+			size_t length{};
+			for (auto i{ 0 }; i < 4 && offset < bytes.size(); ++i)
+			{
+				auto const byte{ bytes[offset++] };
+				length = length << 7 | (byte & 0x7f);
+				if (!(byte & 0x80)) break;
+			}
+
+			if (length > bytes.size() - offset) return nullopt;
+
+			auto const body{ bytes.subspan(offset, length) };
+			offset += length;
+			return pair{ tag, body };
+		}
+
+		auto get_audio_codec(span<uint8_t const> esds)
+		{
+			// AAC-LC is what the writer's AAC encoder produces, and what a missing or unreadable esds most likely holds.
+			auto const fallback{ "mp4a.40.2"s };
+
+			size_t offset{ 4 };
+			auto const es{ read_descriptor(esds, offset) };
+			if (!es || es->first != 0x03) return fallback;
+
+			auto const es_flags{ read_big_endian(es->second, 2, 1) };
+			size_t inner{ 3 };
+			if (es_flags & 0x80) inner += 2;
+			if (es_flags & 0x40) inner += 1 + read_big_endian(es->second, inner, 1);
+			if (es_flags & 0x20) inner += 2;
+
+			auto const decoder_config{ read_descriptor(es->second, inner) };
+			if (!decoder_config || decoder_config->first != 0x04 || decoder_config->second.empty()) return fallback;
+
+			auto const object_type{ decoder_config->second[0] };
+			size_t specific{ 13 };
+			auto const specific_info{ read_descriptor(decoder_config->second, specific) };
+			if (!specific_info || specific_info->first != 0x05 || specific_info->second.empty()) return format("mp4a.{:x}", object_type);
+
+			// Audio object types past 30 escape into six more bits.
+			auto audio_object_type{ static_cast<uint32_t>(specific_info->second[0] >> 3) };
+			if (audio_object_type == 31 && specific_info->second.size() >= 2)
+				audio_object_type = 32 + ((specific_info->second[0] & 7) << 3 | specific_info->second[1] >> 5);
+
+			return format("mp4a.{:x}.{}", object_type, audio_object_type);
+		}
+
+		auto read_tracks(span<uint8_t const> moov)
+		{
+			vector<track> tracks{};
+
+			for (auto const &trak : get_boxes(moov))
+			{
+				if (trak.type != "trak") continue;
+
+				track entry{};
+
+				if (auto const tkhd{ find_box(trak.payload, { "tkhd" }) })
+					entry.id = static_cast<uint32_t>(read_big_endian(*tkhd, read_big_endian(*tkhd, 0, 1) == 1 ? 20 : 12, 4));
+
+				auto const mdia{ find_box(trak.payload, { "mdia" }) };
+				if (!mdia) continue;
+
+				if (auto const mdhd{ find_box(*mdia, { "mdhd" }) })
+					entry.timescale = static_cast<uint32_t>(read_big_endian(*mdhd, read_big_endian(*mdhd, 0, 1) == 1 ? 20 : 12, 4));
+
+				if (auto const hdlr{ find_box(*mdia, { "hdlr" }) }; hdlr && hdlr->size() >= 12)
+					entry.is_video = string_view{ reinterpret_cast<char const *>(hdlr->data() + 8), 4 } == "vide";
+
+				// Only the first sample description counts; the writer never makes more than one.
+				if (auto const stsd{ find_box(*mdia, { "minf", "stbl", "stsd" }) })
+					if (auto const entries{ get_boxes(skip(*stsd, 8)) }; !entries.empty())
+					{
+						auto const &sample_entry{ entries.front() };
+						entry.codec = sample_entry.type;
+
+						if (sample_entry.type == "avc1" || sample_entry.type == "avc3")
+						{
+							entry.width = static_cast<uint32_t>(read_big_endian(sample_entry.payload, 24, 2));
+							entry.height = static_cast<uint32_t>(read_big_endian(sample_entry.payload, 26, 2));
+
+							// The profile, its constraint flags and the level sit right after the version in avcC.
+							if (auto const avcc{ find_box(skip(sample_entry.payload, 78), { "avcC" }) }; avcc && avcc->size() >= 4)
+								entry.codec = format("{}.{:02x}{:02x}{:02x}", sample_entry.type, (*avcc)[1], (*avcc)[2], (*avcc)[3]);
+						}
+						else if (sample_entry.type == "mp4a")
+						{
+							auto const esds{ find_box(skip(sample_entry.payload, 28), { "esds" }) };
+							entry.codec = get_audio_codec(esds ? *esds : span<uint8_t const>{});
+						}
+					}
+
+				tracks.push_back(move(entry));
+			}
+
+			if (auto const mvex{ find_box(moov, { "mvex" }) })
+				for (auto const &trex : get_boxes(*mvex))
+				{
+					if (trex.type != "trex") continue;
+
+					auto const found{ ranges::find(tracks, static_cast<uint32_t>(read_big_endian(trex.payload, 4, 4)), &track::id) };
+					if (found == tracks.end()) continue;
+
+					found->default_duration = static_cast<uint32_t>(read_big_endian(trex.payload, 12, 4));
+					found->default_flags = static_cast<uint32_t>(read_big_endian(trex.payload, 20, 4));
+				}
+
+			return tracks;
+		}
+
+		// Only the reference track's run is looked at: its duration is what the segments are measured in.
+		auto read_fragment(span<uint8_t const> moof, presentation const &media)
+		{
+			fragment result{};
+			if (media.tracks.empty()) return result;
+
+			auto const &reference{ media.tracks[media.reference] };
+
+			for (auto const &traf : get_boxes(moof))
+			{
+				if (traf.type != "traf") continue;
+
+				auto const tfhd{ find_box(traf.payload, { "tfhd" }) };
+				if (!tfhd || read_big_endian(*tfhd, 4, 4) != reference.id) continue;
+
+				auto default_duration{ reference.default_duration };
+				auto default_flags{ reference.default_flags };
+
+				auto const tfhd_flags{ read_big_endian(*tfhd, 1, 3) };
+				size_t offset{ 8 };
+				if (tfhd_flags & 0x01) offset += 8;
+				if (tfhd_flags & 0x02) offset += 4;
+				if (tfhd_flags & 0x08)
+				{
+					default_duration = static_cast<uint32_t>(read_big_endian(*tfhd, offset, 4));
+					offset += 4;
+				}
+				if (tfhd_flags & 0x10) offset += 4;
+				if (tfhd_flags & 0x20) default_flags = static_cast<uint32_t>(read_big_endian(*tfhd, offset, 4));
+
+				if (auto const tfdt{ find_box(traf.payload, { "tfdt" }) })
+					result.base_time = read_big_endian(*tfdt, 4, read_big_endian(*tfdt, 0, 1) == 1 ? 8 : 4);
+
+				auto is_first{ true };
+				for (auto const &trun : get_boxes(traf.payload))
+				{
+					if (trun.type != "trun") continue;
+
+					auto const trun_flags{ read_big_endian(trun.payload, 1, 3) };
+					auto const sample_count{ read_big_endian(trun.payload, 4, 4) };
+
+					size_t run_offset{ 8 };
+					if (trun_flags & 0x001) run_offset += 4;
+					auto first_flags{ default_flags };
+					if (trun_flags & 0x004)
+					{
+						first_flags = static_cast<uint32_t>(read_big_endian(trun.payload, run_offset, 4));
+						run_offset += 4;
+					}
+
+					auto const record_size{ static_cast<size_t>(4 * popcount(trun_flags & 0xf00)) };
+					auto const flags_offset{ (trun_flags & 0x100 ? 4u : 0u) + (trun_flags & 0x200 ? 4u : 0u) };
+					auto const count{ record_size ? min<uint64_t>(sample_count, (trun.payload.size() - min(run_offset, trun.payload.size())) / record_size) : sample_count };
+
+					for (uint64_t i{}; i < count; ++i)
+					{
+						auto const record{ run_offset + i * record_size };
+
+						if (is_first)
+						{
+							auto const flags{ i == 0 && trun_flags & 0x004 ? first_flags : trun_flags & 0x400 ? static_cast<uint32_t>(read_big_endian(trun.payload, record + flags_offset, 4)) : default_flags };
+							result.starts_with_sync = !(flags & non_sync_sample);
+							is_first = false;
+						}
+
+						result.duration += trun_flags & 0x100 ? read_big_endian(trun.payload, record, 4) : default_duration;
+					}
+				}
+
+				result.has_reference = !is_first;
+			}
+
+			return result;
+		}
+
+		auto to_path(string_view utf8)
+		{
+			return filesystem::path{ u8string{ utf8.begin(), utf8.end() } };
+		}
+
+		// Percent-encodes everything but the unreserved characters, so names with spaces or kana survive as URIs.
+		auto encode_uri(string_view text)
+		{
+			string encoded{};
+			for (auto const &character : text)
+			{
+				auto const byte{ static_cast<uint8_t>(character) };
+				if ((byte < 0x80 && isalnum(byte)) || byte == '-' || byte == '.' || byte == '_' || byte == '~')
+					encoded += character;
+				else
+					encoded += format("%{:02X}", byte);
+			}
+			return encoded;
+		}
+
+		auto format_utc(chrono::system_clock::time_point const &time)
+		{
+			auto const seconds{ chrono::floor<chrono::seconds>(time) };
+			auto const days{ chrono::floor<chrono::days>(seconds) };
+			chrono::year_month_day const date{ days };
+			chrono::hh_mm_ss const clock{ seconds - days };
+
+			return format("{:04}-{:02}-{:02}T{:02}:{:02}:{:02}Z", static_cast<int32_t>(date.year()), static_cast<uint32_t>(date.month()), static_cast<uint32_t>(date.day()), clock.hours().count(), clock.minutes().count(), clock.seconds().count());
+		}
+
+		auto get_timescale(presentation const &media) noexcept
+		{
+			return media.tracks.empty() ? 1u : max(media.tracks[media.reference].timescale, 1u);
+		}
+
+		auto get_longest_duration(presentation const &media) noexcept
+		{
+			return media.segments.empty() ? 0.0 : static_cast<double>(ranges::max(media.segments | views::transform(&media_segment::duration))) / get_timescale(media);
+		}
+
+		string get_segment_name(string_view prefix, uint64_t const &number)
+		{
+			return format("{}{:05}.m4s", prefix, number);
+		}
+
+		string make_hls_playlist(presentation const &media)
+		{
+			auto const timescale{ get_timescale(media) };
+
+			// Segments can only start at keyframes, so one may run past the target; the declared maximum has to cover it.
+			auto const target_duration{ max<int64_t>(static_cast<int64_t>(ceil(media.target_duration)), llround(get_longest_duration(media))) };
+
+			auto playlist{ format("#EXTM3U\n#EXT-X-VERSION:7\n#EXT-X-TARGETDURATION:{}\n#EXT-X-PLAYLIST-TYPE:EVENT\n#EXT-X-INDEPENDENT-SEGMENTS\n#EXT-X-MAP:URI=\"{}\"\n", target_duration, encode_uri(media.init_name)) };
+
+			for (auto const &segment : media.segments)
+				playlist += format("#EXTINF:{:.3f},\n{}\n", static_cast<double>(segment.duration) / timescale, encode_uri(get_segment_name(media.media_prefix, segment.number)));
+
+			if (media.is_complete) playlist += "#EXT-X-ENDLIST\n";
+
+			return playlist;
+		}
+
+		string make_dash_manifest(presentation const &media)
+		{
+			auto const timescale{ get_timescale(media) };
+
+			uint64_t total_duration{}, bandwidth{ 1 };
+			for (auto const &segment : media.segments)
+			{
+				total_duration += segment.duration;
+				if (segment.duration) bandwidth = max(bandwidth, segment.size * 8 * timescale / segment.duration);
+			}
+
+			auto manifest{ "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""s };
+
+			// While the export runs the manifest is live, so players come back for the segments written since.
+			if (media.is_complete)
+				manifest += format(" type=\"static\" mediaPresentationDuration=\"PT{:.3f}S\"", static_cast<double>(total_duration) / timescale);
+			else
+				manifest += format(" type=\"dynamic\" availabilityStartTime=\"{}\" publishTime=\"{}\" minimumUpdatePeriod=\"PT{:g}S\"", format_utc(media.started), format_utc(chrono::system_clock::now()), media.target_duration);
+
+			manifest += format(" minBufferTime=\"PT{:g}S\">\n  <Period id=\"1\" start=\"PT0S\">\n", media.target_duration);
+
+			auto const has_video{ ranges::any_of(media.tracks, &track::is_video) };
+			manifest += format("    <AdaptationSet id=\"1\" mimeType=\"{}\" segmentAlignment=\"true\" startWithSAP=\"1\">\n", has_video ? "video/mp4" : "audio/mp4");
+			manifest += format("      <SegmentTemplate timescale=\"{}\" initialization=\"{}\" media=\"{}$Number%05d$.m4s\" startNumber=\"1\">\n        <SegmentTimeline>\n", timescale, encode_uri(media.init_name), encode_uri(media.media_prefix));
+
+			// Runs of equal, back-to-back segments share one S element.
+			for (size_t i{}; i < media.segments.size();)
+			{
+				auto const &first{ media.segments[i] };
+				auto repeat{ size_t{} };
+				while (i + repeat + 1 < media.segments.size() && media.segments[i + repeat + 1].duration == first.duration && media.segments[i + repeat + 1].start == first.start + (repeat + 1) * first.duration)
+					++repeat;
+
+				auto const is_contiguous{ i > 0 && media.segments[i - 1].start + media.segments[i - 1].duration == first.start };
+				manifest += format("          <S{} d=\"{}\"{}/>\n", is_contiguous ? ""s : format(" t=\"{}\"", first.start), first.duration, repeat ? format(" r=\"{}\"", repeat) : ""s);
+				i += repeat + 1;
+			}
+
+			manifest += "        </SegmentTimeline>\n      </SegmentTemplate>\n";
+
+			string codecs{};
+			for (auto const &entry : media.tracks)
+				codecs += (codecs.empty() ? "" : ",") + entry.codec;
+
+			manifest += format("      <Representation id=\"1\" codecs=\"{}\" bandwidth=\"{}\"", codecs, bandwidth);
+			if (auto const video{ ranges::find_if(media.tracks, &track::is_video) }; video != media.tracks.end())
+				manifest += format(" width=\"{}\" height=\"{}\"", video->width, video->height);
+			manifest += "/>\n    </AdaptationSet>\n  </Period>\n</MPD>\n";
+
+			return manifest;
+		}
+
+		segmenter::segmenter(filesystem::path const &manifest_path, double const &target_duration) :
+			manifest_path{ manifest_path },
+			directory{ manifest_path.parent_path() },
+			media{},
+			pending{},
+			parsed{},
+			pieces{},
+			init_path{},
+			init{},
+			current{},
+			current_path{},
+			open_segment{},
+			counters{},
+			has_tracks{},
+			is_failed{}
+		{
+			auto extension{ manifest_path.extension().u8string() };
+			ranges::transform(extension, extension.begin(), [](char8_t const &character) { return static_cast<char8_t>(tolower(character)); });
+
+			auto const stem{ manifest_path.stem().u8string() };
+			string const name{ stem.begin(), stem.end() };
+
+			media.format = extension == u8".mpd" ? manifest_format::dash : manifest_format::hls;
+			media.init_name = name + "_init.mp4";
+			media.media_prefix = name + "_";
+			media.target_duration = max(target_duration, 1.0);
+			media.started = chrono::system_clock::now();
+
+			init_path = directory / to_path(media.init_name);
+			init.open(init_path, ios::binary | ios::trunc);
+			is_failed = !init;
+		}
+
+		bool segmenter::write(uint64_t const &position, span<uint8_t const> bytes)
+		{
+			if (is_failed) return false;
+
+			auto at{ position };
+			if (at < parsed)
+			{
+				auto const count{ static_cast<size_t>(min<uint64_t>(bytes.size(), parsed - at)) };
+				if (!patch(at, bytes.first(count))) return !(is_failed = true);
+
+				at += count;
+				bytes = bytes.subspan(count);
+			}
+
+			if (bytes.empty()) return true;
+
+			// A seek past the end leaves a gap the writer means to fill later, so it reads as zeros until then.
+			auto const offset{ static_cast<size_t>(at - parsed) };
+			if (offset + bytes.size() > pending.size()) pending.resize(offset + bytes.size());
+			ranges::copy(bytes, pending.begin() + offset);
+
+			if (!parse_boxes(false)) return !(is_failed = true);
+			return true;
+		}
+
+		size_t segmenter::read(uint64_t const &position, span<uint8_t> bytes)
+		{
+			flush();
+
+			size_t done{};
+			while (done < bytes.size())
+			{
+				auto const at{ position + done };
+
+				if (at >= parsed)
+				{
+					auto const offset{ at - parsed };
+					if (offset >= pending.size()) break;
+
+					auto const count{ min<size_t>(bytes.size() - done, pending.size() - offset) };
+					ranges::copy_n(pending.begin() + offset, count, bytes.begin() + done);
+					done += count;
+					continue;
+				}
+
+				auto const found{ ranges::upper_bound(pieces, at, {}, &piece::begin) };
+				if (found == pieces.begin() || prev(found)->file.empty()) break;
+
+				auto const &source{ *prev(found) };
+				auto const count{ static_cast<size_t>(min<uint64_t>(bytes.size() - done, source.end - at)) };
+
+				ifstream file{ source.file, ios::binary };
+				file.seekg(static_cast<streamoff>(source.offset + (at - source.begin)));
+				if (!file.read(reinterpret_cast<char *>(bytes.data() + done), static_cast<streamsize>(count))) break;
+				done += count;
+			}
+
+			return done;
+		}
+
+		bool segmenter::finish()
+		{
+			if (is_failed) return false;
+
+			// A box whose size is zero runs to the end of the stream, which only now is known.
+			auto const is_whole{ parse_boxes(true) && pending.empty() };
+
+			// What did arrive whole is still listed, so a stream cut short plays up to where it stopped.
+			if (open_segment && !close_segment()) return !(is_failed = true);
+
+			if (init.is_open()) init.close();
+			media.is_complete = true;
+
+			is_failed = !write_manifest() || !is_whole;
+			return !is_failed;
+		}
+
+		void segmenter::discard()
+		{
+			init.close();
+			current.close();
+			is_failed = true;
+
+			error_code ignored{};
+			filesystem::remove(init_path, ignored);
+			if (open_segment) filesystem::remove(current_path, ignored);
+			for (auto const &segment : media.segments)
+				filesystem::remove(directory / to_path(get_segment_name(media.media_prefix, segment.number)), ignored);
+			filesystem::remove(manifest_path, ignored);
+		}
+
+		presentation const &segmenter::get_presentation() const noexcept
+		{
+			return media;
+		}
+
+		statistics segmenter::get_statistics() const noexcept
+		{
+			return counters;
+		}
+
+		bool segmenter::patch(uint64_t const &position, span<uint8_t const> bytes)
+		{
+			flush();
+
+			auto at{ position };
+			for (auto found{ ranges::upper_bound(pieces, position, {}, &piece::begin) }; !bytes.empty(); ++found)
+			{
+				if (found == pieces.begin()) return false;
+
+				// Pieces follow one another without gaps, so a patch that spans boxes just moves on to the next one.
+				auto const &target{ *prev(found) };
+				if (at < target.begin || at >= target.end) return false;
+
+				auto const count{ static_cast<size_t>(min<uint64_t>(bytes.size(), target.end - at)) };
+
+				if (!target.file.empty())
+				{
+					fstream file{ target.file, ios::binary | ios::in | ios::out };
+					file.seekp(static_cast<streamoff>(target.offset + (at - target.begin)));
+					if (!file.write(reinterpret_cast<char const *>(bytes.data()), static_cast<streamsize>(count))) return false;
+				}
+
+				counters.patched_bytes += count;
+				at += count;
+				bytes = bytes.subspan(count);
+			}
+
+			return true;
+		}
+
+		void segmenter::flush()
+		{
+			if (init.is_open()) init.flush();
+			if (current.is_open()) current.flush();
+		}
+
+		bool segmenter::parse_boxes(bool const &is_final)
+		{
+			while (pending.size() >= 8)
+			{
+				auto size{ read_big_endian(pending, 0, 4) };
+				auto header{ uint64_t{ 8 } };
+				if (size == 1)
+				{
+					if (pending.size() < 16) break;
+					size = read_big_endian(pending, 8, 8);
+					header = 16;
+				}
+				else if (size == 0)
+				{
+					if (!is_final) break;
+					size = pending.size();
+				}
+
+				if (size < header) return false;
+				// The writer hands over a box in several writes, so an incomplete one just waits for the rest.
+				if (size > pending.size()) break;
+
+				span<uint8_t const> const bytes{ pending.data(), static_cast<size_t>(size) };
+				string_view const type{ reinterpret_cast<char const *>(pending.data() + 4), 4 };
+
+				if (type == "moof")
+				{
+					if (!begin_fragment(bytes)) return false;
+				}
+				else if (open_segment)
+				{
+					// The random access index points into the whole file, which no longer exists as such.
+					if (type == "mfra")
+						pieces.push_back({ parsed, parsed + size, {}, 0 });
+					else if (!append(bytes, current_path, current))
+						return false;
+				}
+				else
+				{
+					if (!append(bytes, init_path, init)) return false;
+
+					if (type == "moov")
+					{
+						media.tracks = read_tracks(bytes.subspan(static_cast<size_t>(header)));
+						auto const video{ ranges::find_if(media.tracks, &track::is_video) };
+						media.reference = video == media.tracks.end() ? 0 : static_cast<size_t>(video - media.tracks.begin());
+						has_tracks = !media.tracks.empty();
+					}
+				}
+
+				parsed += size;
+				pending.erase(pending.begin(), pending.begin() + static_cast<ptrdiff_t>(size));
+			}
+
+			return true;
+		}
+
+		bool segmenter::append(span<uint8_t const> box, filesystem::path const &file, ofstream &stream)
+		{
+			auto const offset{ static_cast<uint64_t>(stream.tellp()) };
+			pieces.push_back({ parsed, parsed + box.size(), file, offset });
+
+			stream.write(reinterpret_cast<char const *>(box.data()), static_cast<streamsize>(box.size()));
+			if (!stream) return false;
+
+			counters.written_bytes += box.size();
+			if (&stream == &current) open_segment->size += box.size();
+
+			return true;
+		}
+
+		bool segmenter::begin_fragment(span<uint8_t const> moof)
+		{
+			auto const payload{ find_box(moof, { "moof" }) };
+			auto const fragment{ read_fragment(payload ? *payload : span<uint8_t const>{}, media) };
+			auto const threshold{ media.target_duration * get_timescale(media) };
+
+			// Cuts only where the reference track starts on a sync sample, so that every segment decodes on its own.
+			if (!open_segment || (has_tracks && fragment.has_reference && fragment.starts_with_sync && open_segment->duration >= threshold))
+			{
+				if (open_segment && !close_segment()) return false;
+
+				// Everything before the first fragment was the init segment.
+				if (init.is_open())
+				{
+					init.close();
+					if (!init) return false;
+				}
+
+				auto const number{ static_cast<uint64_t>(media.segments.size() + 1) };
+				auto const start{ fragment.has_reference ? fragment.base_time : media.segments.empty() ? 0 : media.segments.back().start + media.segments.back().duration };
+
+				current_path = directory / to_path(get_segment_name(media.media_prefix, number));
+				current.open(current_path, ios::binary | ios::trunc);
+				if (!current) return false;
+
+				open_segment = media_segment{ number, start, 0, 0 };
+			}
+
+			open_segment->duration += fragment.duration;
+
+			return append(moof, current_path, current);
+		}
+
+		bool segmenter::close_segment()
+		{
+			current.close();
+			if (!current) return false;
+
+			media.segments.push_back(*open_segment);
+			open_segment.reset();
+
+			++counters.segments;
+			counters.longest_duration = get_longest_duration(media);
+
+			// A player holding the manifest open only delays the update until the next segment.
+			write_manifest();
+
+			return true;
+		}
+
+		bool segmenter::write_manifest()
+		{
+			auto const text{ media.format == manifest_format::dash ? make_dash_manifest(media) : make_hls_playlist(media) };
+
+			auto partial_path{ manifest_path };
+			partial_path += L".partial";
+
+			{
+				ofstream file{ partial_path, ios::binary | ios::trunc };
+				file.write(text.data(), static_cast<streamsize>(text.size()));
+				if (!file) return false;
+			}
+
+			error_code error{};
+			filesystem::rename(partial_path, manifest_path, error);
+			return !error;
+		}
+	}
+}
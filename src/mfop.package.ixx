@@ -0,0 +1,129 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+export module mfop.package;
+
+import std;
+
+namespace mfop
+{
+	namespace package
+	{
+		export
+		{
+			enum struct manifest_format
+			{
+				hls,
+				dash
+			};
+
+			struct track
+			{
+				std::uint32_t id;
+				std::uint32_t timescale;
+				bool is_video;
+				// As the manifests want it, such as avc1.640028 or mp4a.40.2.
+				std::string codec;
+				std::uint32_t width;
+				std::uint32_t height;
+				// From the movie's trex, for fragments that leave them out.
+				std::uint32_t default_duration;
+				std::uint32_t default_flags;
+			};
+
+			struct media_segment
+			{
+				std::uint64_t number;
+				// In the timescale of the track segments are cut on.
+				std::uint64_t start;
+				std::uint64_t duration;
+				std::uint64_t size;
+			};
+
+			struct presentation
+			{
+				manifest_format format;
+				std::string init_name;
+				// The segment file name with the number left out, as the DASH template needs it.
+				std::string media_prefix;
+				std::vector<track> tracks;
+				// The track segments are cut on: the video one if there is any.
+				std::size_t reference;
+				double target_duration;
+				std::vector<media_segment> segments;
+				bool is_complete;
+				// The wall clock time the export started, for a DASH manifest that is still growing.
+				std::chrono::system_clock::time_point started;
+			};
+
+			struct statistics
+			{
+				std::uint64_t segments;
+				std::uint64_t written_bytes;
+				// Bytes the writer went back and rewrote after they had been handed to a file.
+				std::uint64_t patched_bytes;
+				double longest_duration;
+			};
+
+			std::string get_segment_name(std::string_view prefix, std::uint64_t const &number);
+			std::string make_hls_playlist(presentation const &media);
+			std::string make_dash_manifest(presentation const &media);
+
+			// Cuts a fragmented MP4 into an init segment and media segments beside the manifest while it is still being written.
+			struct segmenter
+			{
+				// The manifest's extension picks the format: .mpd for DASH, anything else for HLS.
+				segmenter(std::filesystem::path const &manifest_path, double const &target_duration);
+				segmenter(segmenter const &) = delete;
+
+				// Past what has been parsed, the bytes continue the stream; before it, they patch the file they were already handed to.
+				bool write(std::uint64_t const &position, std::span<std::uint8_t const> bytes);
+				// Reads back what was written, from wherever it ended up; returns how many bytes there were.
+				std::size_t read(std::uint64_t const &position, std::span<std::uint8_t> bytes);
+				// Closes the last segment and writes the final manifest; false if the stream ended inside a box.
+				bool finish();
+				// Removes every file written so far, the manifest included.
+				void discard();
+
+				presentation const &get_presentation() const noexcept;
+				statistics get_statistics() const noexcept;
+
+			private:
+				struct piece
+				{
+					std::uint64_t begin;
+					std::uint64_t end;
+					// Empty for boxes that belong in no file, such as mfra.
+					std::filesystem::path file;
+					std::uint64_t offset;
+				};
+
+				std::filesystem::path manifest_path;
+				std::filesystem::path directory;
+				presentation media;
+				std::vector<std::uint8_t> pending;
+				std::uint64_t parsed;
+				std::vector<piece> pieces;
+				std::filesystem::path init_path;
+				std::ofstream init;
+				std::ofstream current;
+				std::filesystem::path current_path;
+				std::optional<media_segment> open_segment;
+				statistics counters;
+				bool has_tracks;
+				bool is_failed;
+
+				bool patch(std::uint64_t const &position, std::span<std::uint8_t const> bytes);
+				void flush();
+				bool parse_boxes(bool const &is_final);
+				bool append(std::span<std::uint8_t const> box, std::filesystem::path const &file, std::ofstream &stream);
+				bool begin_fragment(std::span<std::uint8_t const> moof);
+				bool close_segment();
+				bool write_manifest();
+			};
+		}
+	}
+}
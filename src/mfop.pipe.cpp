@@ -0,0 +1,270 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#define STRICT
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <wil/resource.h>
+#include <wil/result_macros.h>
+
+#define UNEXPECT_IF_FAILED(hr) if (HRESULT const __mfop_hr{ hr }) if (FAILED(__mfop_hr)) [[unlikely]] return std::unexpected{ mfop::error{ __mfop_hr, #hr } }
+
+module mfop.pipe;
+
+import std;
+
+using namespace std;
+using namespace wil;
+
+namespace mfop
+{
+	namespace pipe
+	{
+		auto const constinit pipe_buffer_size{ 1u << 20 };
+		// Over five minutes of 48 kHz stereo; a child that has not opened its pipe by then is waited for after all.
+		auto const constinit max_backlog_size{ size_t{ 64 } << 20 };
+		auto const constinit poll_milliseconds{ 100u };
+
+		double_buffered_writer::double_buffered_writer(unique_hfile &&pipe, HANDLE const &process, function<bool()> const &is_aborted) noexcept :
+			pipe{ move(pipe) },
+			process{ process },
+			is_aborted{ is_aborted },
+			connection{},
+			connected{ CreateEventW(nullptr, true, false, nullptr) },
+			is_connected{},
+			slots{},
+			current{},
+			backlog{},
+			backlog_size{},
+			is_held_back{},
+			current_statistics{}
+		{
+			for (auto &slot : slots)
+				slot.completed.reset(CreateEventW(nullptr, true, true, nullptr));
+
+			// The child may already have opened the pipe, or may not get to it until it has read some video.
+			connection.hEvent = connected.get();
+			if (ConnectNamedPipe(this->pipe.get(), &connection) || GetLastError() == ERROR_PIPE_CONNECTED)
+				is_connected = true;
+		}
+
+		double_buffered_writer::~double_buffered_writer()
+		{
+			// The kernel still writes from these buffers, so they must not go away before it lets go of them.
+			DWORD transferred{};
+			if (!is_connected && CancelIoEx(pipe.get(), &connection))
+				GetOverlappedResult(pipe.get(), &connection, &transferred, true);
+
+			for (auto &slot : slots)
+				if (slot.is_pending && CancelIoEx(pipe.get(), &slot.overlapped))
+					GetOverlappedResult(pipe.get(), &slot.overlapped, &transferred, true);
+		}
+
+		HRESULT double_buffered_writer::wait(OVERLAPPED &overlapped) noexcept
+		{
+			auto const begin{ chrono::steady_clock::now() };
+			array const handles{ overlapped.hEvent, process };
+			auto signaled{ DWORD{} };
+			while ((signaled = WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(), false, poll_milliseconds)) == WAIT_TIMEOUT && !is_aborted());
+			current_statistics.stalled_time += chrono::steady_clock::now() - begin;
+
+			DWORD transferred{};
+			if (signaled != WAIT_OBJECT_0)
+			{
+				// Either the encoder is gone and nobody will ever read what is left, or the user gave up on it.
+				CancelIoEx(pipe.get(), &overlapped);
+				GetOverlappedResult(pipe.get(), &overlapped, &transferred, true);
+				return signaled == WAIT_TIMEOUT ? E_ABORT : HRESULT_FROM_WIN32(ERROR_BROKEN_PIPE);
+			}
+
+			RETURN_IF_WIN32_BOOL_FALSE(GetOverlappedResult(pipe.get(), &overlapped, &transferred, false));
+			return S_OK;
+		}
+
+		HRESULT double_buffered_writer::wait_for_slot() noexcept
+		{
+			auto &slot{ slots[current] };
+			if (!slot.is_pending) return S_OK;
+
+			slot.is_pending = false;
+			return wait(slot.overlapped);
+		}
+
+		HRESULT double_buffered_writer::acquire(size_t const &size, span<uint8_t> &buffer) noexcept
+		{
+			if (!is_connected && WaitForSingleObject(connected.get(), 0) == WAIT_TIMEOUT && backlog_size + size <= max_backlog_size)
+			{
+				backlog_size += backlog.emplace_back(size).size();
+				buffer = backlog.back();
+				is_held_back = true;
+				return S_OK;
+			}
+
+			RETURN_IF_FAILED(drain());
+			RETURN_IF_FAILED(wait_for_slot());
+
+			auto &slot{ slots[current] };
+			slot.data.resize(size);
+			buffer = slot.data;
+			return S_OK;
+		}
+
+		HRESULT double_buffered_writer::submit() noexcept
+		{
+			if (exchange(is_held_back, false)) return S_OK;
+
+			auto &slot{ slots[current] };
+
+			slot.overlapped = {};
+			slot.overlapped.hEvent = slot.completed.get();
+			if (!WriteFile(pipe.get(), slot.data.data(), static_cast<DWORD>(slot.data.size()), nullptr, &slot.overlapped) && GetLastError() != ERROR_IO_PENDING)
+				return HRESULT_FROM_WIN32(GetLastError());
+
+			slot.is_pending = true;
+			current_statistics.written_bytes += slot.data.size();
+			current ^= 1;
+			return S_OK;
+		}
+
+		HRESULT double_buffered_writer::drain() noexcept
+		{
+			if (!is_connected)
+			{
+				RETURN_IF_FAILED(wait(connection));
+				is_connected = true;
+			}
+
+			for (; !backlog.empty(); backlog.pop_front())
+			{
+				RETURN_IF_FAILED(wait_for_slot());
+				slots[current].data = move(backlog.front());
+				RETURN_IF_FAILED(submit());
+			}
+			backlog_size = 0;
+
+			return S_OK;
+		}
+
+		HRESULT double_buffered_writer::close() noexcept
+		{
+			if (!pipe) return S_OK;
+			if (!backlog.empty()) RETURN_IF_FAILED(drain());
+
+			for (auto &slot : slots)
+				if (exchange(slot.is_pending, false))
+					RETURN_IF_FAILED(wait(slot.overlapped));
+
+			// Closing the server end before the child has read everything would throw the rest away.
+			if (is_connected) FlushFileBuffers(pipe.get());
+			pipe.reset();
+			return S_OK;
+		}
+
+		statistics const &double_buffered_writer::get_statistics() const noexcept
+		{
+			return current_statistics;
+		}
+
+		auto make_server_pipe(wstring const &name) noexcept
+		{
+			return unique_hfile{ CreateNamedPipeW(name.c_str(), PIPE_ACCESS_OUTBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE, PIPE_TYPE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1, pipe_buffer_size, 0, 0, nullptr) };
+		}
+
+		auto replace_all(wstring &text, wstring_view from, wstring_view to)
+		{
+			for (auto position{ text.find(from) }; position != wstring::npos; position = text.find(from, position + to.size()))
+				text.replace(position, from.size(), to);
+		}
+
+		expected<encoder_process, error> launch(wstring_view command_line, wstring_view output_path, filesystem::path const &log_path, function<bool()> const &is_aborted) noexcept
+		{
+			static atomic<uint32_t> serial{};
+
+			auto const pipe_name{ format(LR"(\\.\pipe\MFOutput.{}.{})", GetCurrentProcessId(), serial++) };
+			auto const video_pipe_name{ pipe_name + L".video" }, audio_pipe_name{ pipe_name + L".audio" };
+			auto const has_audio{ command_line.contains(L"{audio}") };
+
+			SECURITY_ATTRIBUTES inheritable{ sizeof(inheritable), nullptr, true };
+
+			auto video_pipe{ make_server_pipe(video_pipe_name) };
+			if (!video_pipe) [[unlikely]] return unexpected{ error{ HRESULT_FROM_WIN32(GetLastError()), "CreateNamedPipeW(video)" } };
+
+			unique_hfile standard_input{ CreateFileW(video_pipe_name.c_str(), GENERIC_READ, 0, &inheritable, OPEN_EXISTING, 0, nullptr) };
+			if (!standard_input) [[unlikely]] return unexpected{ error{ HRESULT_FROM_WIN32(GetLastError()), "CreateFileW(video)" } };
+
+			unique_hfile audio_pipe{};
+			if (has_audio)
+			{
+				audio_pipe = make_server_pipe(audio_pipe_name);
+				if (!audio_pipe) [[unlikely]] return unexpected{ error{ HRESULT_FROM_WIN32(GetLastError()), "CreateNamedPipeW(audio)" } };
+			}
+
+			// Whatever the encoder prints ends up in one file, which is the only place to look when it fails.
+			unique_hfile log{ CreateFileW(log_path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, &inheritable, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr) };
+
+			wstring command{ command_line };
+			replace_all(command, L"{output}", output_path);
+			replace_all(command, L"{audio}", audio_pipe_name);
+
+			// Only its standard handles reach the encoder; anything else inheritable the host or another plugin has open would otherwise stay open for as long as it runs.
+			array<HANDLE, 2> inherited_handles{ standard_input.get() };
+			auto inherited_count{ size_t{ 1 } };
+			if (log) inherited_handles[inherited_count++] = log.get();
+
+			SIZE_T attribute_list_size{};
+			InitializeProcThreadAttributeList(nullptr, 1, 0, &attribute_list_size);
+			auto const attribute_list_buffer{ make_unique_for_overwrite<uint8_t[]>(attribute_list_size) };
+			auto const attribute_list{ reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attribute_list_buffer.get()) };
+			if (!InitializeProcThreadAttributeList(attribute_list, 1, 0, &attribute_list_size)) [[unlikely]] return unexpected{ error{ HRESULT_FROM_WIN32(GetLastError()), "InitializeProcThreadAttributeList(attribute_list)" } };
+			auto const attribute_list_cleanup{ scope_exit([attribute_list]() noexcept { DeleteProcThreadAttributeList(attribute_list); }) };
+
+			if (!UpdateProcThreadAttribute(attribute_list, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST, inherited_handles.data(), inherited_count * sizeof(HANDLE), nullptr, nullptr)) [[unlikely]]
+				return unexpected{ error{ HRESULT_FROM_WIN32(GetLastError()), "UpdateProcThreadAttribute(PROC_THREAD_ATTRIBUTE_HANDLE_LIST)" } };
+
+			STARTUPINFOEXW startup_information{ { sizeof(startup_information) } };
+			startup_information.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+			startup_information.StartupInfo.hStdInput = standard_input.get();
+			startup_information.StartupInfo.hStdOutput = log.get();
+			startup_information.StartupInfo.hStdError = log.get();
+			startup_information.lpAttributeList = attribute_list;
+
+			encoder_process process{};
+			if (!CreateProcessW(nullptr, command.data(), nullptr, nullptr, true, CREATE_NO_WINDOW | EXTENDED_STARTUPINFO_PRESENT, nullptr, nullptr, &startup_information.StartupInfo, process.information.reset_and_addressof())) [[unlikely]]
+				return unexpected{ error{ HRESULT_FROM_WIN32(GetLastError()), "CreateProcessW(command_line)" } };
+
+			process.video = make_unique<double_buffered_writer>(move(video_pipe), process.information.hProcess, is_aborted);
+			if (has_audio) process.audio = make_unique<double_buffered_writer>(move(audio_pipe), process.information.hProcess, is_aborted);
+			process.is_aborted = is_aborted;
+
+			return process;
+		}
+
+		expected<DWORD, error> finish(encoder_process &process) noexcept
+		{
+			// Audio still held back goes out before the video pipe waits to be read dry, as the encoder may want either first.
+			if (process.audio) UNEXPECT_IF_FAILED(process.audio->drain());
+			UNEXPECT_IF_FAILED(process.video->close());
+			if (process.audio) UNEXPECT_IF_FAILED(process.audio->close());
+
+			while (WaitForSingleObject(process.information.hProcess, poll_milliseconds) == WAIT_TIMEOUT)
+				if (process.is_aborted()) [[unlikely]] return unexpected{ error{ E_ABORT, "waiting for the encoder to exit" } };
+
+			DWORD exit_code{};
+			if (!GetExitCodeProcess(process.information.hProcess, &exit_code)) [[unlikely]] return unexpected{ error{ HRESULT_FROM_WIN32(GetLastError()), "GetExitCodeProcess(process.information.hProcess)" } };
+
+			return exit_code;
+		}
+
+		void terminate(encoder_process &process) noexcept
+		{
+			TerminateProcess(process.information.hProcess, ERROR_CANCELLED);
+			WaitForSingleObject(process.information.hProcess, INFINITE);
+		}
+	}
+}
@@ -0,0 +1,92 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#define STRICT
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <wil/resource.h>
+
+export module mfop.pipe;
+
+import std;
+import mfop.error;
+
+namespace mfop
+{
+	namespace pipe
+	{
+		export
+		{
+			struct statistics
+			{
+				std::uint64_t written_bytes;
+				std::chrono::nanoseconds stalled_time;
+			};
+
+			// Two buffers on one overlapped pipe: the next one is filled while the child is still reading the last.
+			struct double_buffered_writer
+			{
+				// Every wait also gives up once is_aborted says so, rather than leaving the user stuck on an encoder that stopped reading.
+				double_buffered_writer(wil::unique_hfile &&pipe, HANDLE const &process, std::function<bool()> const &is_aborted) noexcept;
+				double_buffered_writer(double_buffered_writer const &) = delete;
+				~double_buffered_writer();
+
+				// Hands out the idle buffer, waiting for its previous write to be read first.
+				// Until the child opens the pipe, buffers are held back in memory instead, up to a limit, so a child that reads some video first never holds this one up.
+				HRESULT acquire(std::size_t const &size, std::span<std::uint8_t> &buffer) noexcept;
+				HRESULT submit() noexcept;
+				// Waits for the child to open the pipe and writes what was held back.
+				HRESULT drain() noexcept;
+				HRESULT close() noexcept;
+
+				statistics const &get_statistics() const noexcept;
+
+			private:
+				struct slot
+				{
+					std::vector<std::uint8_t> data;
+					OVERLAPPED overlapped;
+					wil::unique_event completed;
+					bool is_pending;
+				};
+
+				wil::unique_hfile pipe;
+				HANDLE process;
+				std::function<bool()> is_aborted;
+				OVERLAPPED connection;
+				wil::unique_event connected;
+				bool is_connected;
+				std::array<slot, 2> slots;
+				std::size_t current;
+				std::deque<std::vector<std::uint8_t>> backlog;
+				std::size_t backlog_size;
+				bool is_held_back;
+				statistics current_statistics;
+
+				HRESULT wait(OVERLAPPED &overlapped) noexcept;
+				HRESULT wait_for_slot() noexcept;
+			};
+
+			struct encoder_process
+			{
+				wil::unique_process_information information;
+				std::unique_ptr<double_buffered_writer> video;
+				// Only there when the command line asks for {audio}.
+				std::unique_ptr<double_buffered_writer> audio;
+				std::function<bool()> is_aborted;
+			};
+
+			// Video goes to standard input; {output} and {audio} in the command line become the output path and the name of a pipe carrying WAV.
+			std::expected<encoder_process, error> launch(std::wstring_view command_line, std::wstring_view output_path, std::filesystem::path const &log_path, std::function<bool()> const &is_aborted) noexcept;
+			// Closes both pipes once they are drained and waits for the encoder to exit.
+			std::expected<DWORD, error> finish(encoder_process &process) noexcept;
+			void terminate(encoder_process &process) noexcept;
+		}
+	}
+}
@@ -0,0 +1,184 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#define STRICT
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <wil/com.h>
+#include <dxgi1_2.h>
+
+#pragma comment(lib, "dxgi")
+
+module mfop.probe;
+
+import std;
+import mfop.configure;
+
+using namespace std;
+using namespace wil;
+
+namespace mfop
+{
+	namespace probe
+	{
+		auto const constinit cache_version{ 2 };
+
+		auto get_cache_path() noexcept
+		{
+			static auto const path{ configure::get_data_path(L"MFOutput.probe.ini") };
+			return path.c_str();
+		}
+
+		auto fourcc_to_wstring(uint32_t const &fourcc)
+		{
+			return wstring
+			{
+				static_cast<wchar_t>(fourcc & 0xff),
+				static_cast<wchar_t>((fourcc >> 8) & 0xff),
+				static_cast<wchar_t>((fourcc >> 16) & 0xff),
+				static_cast<wchar_t>((fourcc >> 24) & 0xff)
+			};
+		}
+
+		auto wstring_to_fourcc(wstring_view text) noexcept
+		{
+			uint32_t fourcc{};
+			for (auto i{ 0u }; i < 4 && i < text.size(); ++i)
+				fourcc |= static_cast<uint32_t>(text[i] & 0xff) << (i * 8);
+			return fourcc;
+		}
+
+		auto get_section_name(GUID const &output_video_format, bool const &is_accelerated)
+		{
+			return format(L"{}.{}", fourcc_to_wstring(output_video_format.Data1), is_accelerated ? L"hardware" : L"software");
+		}
+
+		auto read_string(wstring const &section, wchar_t const *key)
+		{
+			array<wchar_t, 1024> buffer{};
+			GetPrivateProfileStringW(section.c_str(), key, L"", buffer.data(), static_cast<DWORD>(buffer.size()), get_cache_path());
+			return wstring{ buffer.data() };
+		}
+
+		auto get_environment_key()
+		{
+			array<wchar_t, 32> build{};
+			DWORD size{ sizeof(build) };
+			RegGetValueW(HKEY_LOCAL_MACHINE, LR"(SOFTWARE\Microsoft\Windows NT\CurrentVersion)", L"CurrentBuildNumber", RRF_RT_REG_SZ, nullptr, build.data(), &size);
+
+			DWORD update_build_revision{};
+			size = sizeof(update_build_revision);
+			RegGetValueW(HKEY_LOCAL_MACHINE, LR"(SOFTWARE\Microsoft\Windows NT\CurrentVersion)", L"UBR", RRF_RT_REG_DWORD, nullptr, &update_build_revision, &size);
+
+			auto key{ format(L"{}.{}", build.data(), update_build_revision) };
+
+			com_ptr_nothrow<IDXGIFactory1> factory{};
+			if (FAILED(CreateDXGIFactory1(IID_PPV_ARGS(factory.put())))) return key;
+
+			com_ptr_nothrow<IDXGIAdapter1> adapter{};
+			for (auto i{ 0u }; SUCCEEDED(factory->EnumAdapters1(i, adapter.put())); ++i)
+			{
+				DXGI_ADAPTER_DESC1 description{};
+				adapter->GetDesc1(&description);
+				if (description.Flags & DXGI_ADAPTER_FLAG_SOFTWARE) continue;
+
+				LARGE_INTEGER driver_version{};
+				adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driver_version);
+
+				key += format
+				(
+					L"/{:04x}:{:04x}:{}.{}.{}.{}",
+					description.VendorId,
+					description.DeviceId,
+					HIWORD(driver_version.HighPart),
+					LOWORD(driver_version.HighPart),
+					HIWORD(driver_version.LowPart),
+					LOWORD(driver_version.LowPart)
+				);
+			}
+
+			return key;
+		}
+
+		wstring const &get_environment() noexcept
+		{
+			static auto const environment{ get_environment_key() };
+			return environment;
+		}
+
+		void validate_cache() noexcept
+		{
+			static once_flag is_validated{};
+
+			call_once(is_validated, []
+			{
+				auto const &environment{ get_environment() };
+
+				if (GetPrivateProfileIntW(L"probe", L"version", 0, get_cache_path()) == cache_version && read_string(L"probe", L"environment") == environment)
+					return;
+
+				DeleteFileW(get_cache_path());
+				WritePrivateProfileStringW(L"probe", L"version", to_wstring(cache_version).c_str(), get_cache_path());
+				WritePrivateProfileStringW(L"probe", L"environment", environment.c_str(), get_cache_path());
+			});
+		}
+
+		optional<record> load(GUID const &output_video_format, bool const &is_accelerated) noexcept
+		{
+			validate_cache();
+
+			auto const section{ get_section_name(output_video_format, is_accelerated) };
+			if (!GetPrivateProfileIntW(section.c_str(), L"probed", false, get_cache_path())) return nullopt;
+
+			record value{};
+			value.is_supported = GetPrivateProfileIntW(section.c_str(), L"supported", false, get_cache_path());
+			value.encoder = read_string(section, L"encoder");
+			value.available_encoders = read_string(section, L"availableEncoders");
+			value.profile = GetPrivateProfileIntW(section.c_str(), L"profile", 0, get_cache_path());
+			value.max_width = GetPrivateProfileIntW(section.c_str(), L"maxWidth", 0, get_cache_path());
+			value.max_height = GetPrivateProfileIntW(section.c_str(), L"maxHeight", 0, get_cache_path());
+			value.is_capped = GetPrivateProfileIntW(section.c_str(), L"capped", false, get_cache_path());
+			value.init_milliseconds = wcstod(read_string(section, L"initMilliseconds").c_str(), nullptr);
+
+			for (auto const subtype : views::split(read_string(section, L"inputSubtypes"), L','))
+				if (!subtype.empty())
+					value.input_subtypes.push_back(wstring_to_fourcc(wstring_view{ subtype.begin(), subtype.end() }));
+
+			return value;
+		}
+
+		void store(GUID const &output_video_format, bool const &is_accelerated, record const &value) noexcept
+		{
+			validate_cache();
+
+			auto const section{ get_section_name(output_video_format, is_accelerated) };
+
+			wstring input_subtypes{};
+			for (auto const &subtype : value.input_subtypes)
+				input_subtypes += (input_subtypes.empty() ? L"" : L",") + fourcc_to_wstring(subtype);
+
+			WritePrivateProfileStringW(section.c_str(), L"probed", L"1", get_cache_path());
+			WritePrivateProfileStringW(section.c_str(), L"supported", value.is_supported ? L"1" : L"0", get_cache_path());
+			WritePrivateProfileStringW(section.c_str(), L"encoder", value.encoder.c_str(), get_cache_path());
+			WritePrivateProfileStringW(section.c_str(), L"availableEncoders", value.available_encoders.c_str(), get_cache_path());
+			WritePrivateProfileStringW(section.c_str(), L"profile", to_wstring(value.profile).c_str(), get_cache_path());
+			WritePrivateProfileStringW(section.c_str(), L"inputSubtypes", input_subtypes.c_str(), get_cache_path());
+			WritePrivateProfileStringW(section.c_str(), L"maxWidth", to_wstring(value.max_width).c_str(), get_cache_path());
+			WritePrivateProfileStringW(section.c_str(), L"maxHeight", to_wstring(value.max_height).c_str(), get_cache_path());
+			WritePrivateProfileStringW(section.c_str(), L"capped", value.is_capped ? L"1" : L"0", get_cache_path());
+			WritePrivateProfileStringW(section.c_str(), L"initMilliseconds", format(L"{:.2f}", value.init_milliseconds).c_str(), get_cache_path());
+		}
+
+		bool is_capable(record const &value, uint32_t const &width, uint32_t const &height) noexcept
+		{
+			if (!value.is_supported || value.input_subtypes.empty()) return false;
+			return !value.is_capped || (width <= value.max_width && height <= value.max_height);
+		}
+	}
+}
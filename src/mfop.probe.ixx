@@ -0,0 +1,45 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#define STRICT
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+
+export module mfop.probe;
+
+import std;
+
+namespace mfop
+{
+	namespace probe
+	{
+		export
+		{
+			struct record
+			{
+				bool is_supported;
+				std::wstring encoder;
+				std::wstring available_encoders;
+				std::uint32_t profile;
+				std::vector<std::uint32_t> input_subtypes;
+				std::uint32_t max_width;
+				std::uint32_t max_height;
+				bool is_capped;
+				double init_milliseconds;
+			};
+
+			// Records live in MFOutput.probe.ini and are dropped whenever the OS build or the display driver changes.
+			std::optional<record> load(GUID const &output_video_format, bool const &is_accelerated) noexcept;
+			void store(GUID const &output_video_format, bool const &is_accelerated, record const &value) noexcept;
+			bool is_capable(record const &value, std::uint32_t const &width, std::uint32_t const &height) noexcept;
+			// The OS build and display drivers the records hold for; a change in either may also change what an encoder puts out.
+			std::wstring const &get_environment() noexcept;
+		}
+	}
+}
@@ -0,0 +1,426 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module mfop.protocol;
+
+import std;
+import mfop.ring;
+import mfop.hash;
+
+using namespace std;
+
+namespace mfop
+{
+	namespace protocol
+	{
+		enum struct command : uint32_t
+		{
+			start,
+			finish
+		};
+
+		enum struct reply_type : uint32_t
+		{
+			log,
+			started,
+			finished,
+			failed
+		};
+
+		// Both ends are the same build on the same machine, so fields go across as they lie in memory.
+		struct message_writer
+		{
+			vector<uint8_t> bytes;
+
+			template<typename T>
+			auto put(T const &value)
+			{
+				static_assert(is_trivially_copyable_v<T>);
+				auto const begin{ reinterpret_cast<uint8_t const *>(&value) };
+				bytes.insert(bytes.end(), begin, begin + sizeof(T));
+			}
+
+			template<typename Char>
+			auto put(basic_string_view<Char> text)
+			{
+				put(static_cast<uint32_t>(text.size()));
+				auto const begin{ reinterpret_cast<uint8_t const *>(text.data()) };
+				bytes.insert(bytes.end(), begin, begin + text.size() * sizeof(Char));
+			}
+		};
+
+		struct message_reader
+		{
+			span<uint8_t const> bytes;
+			bool is_valid{ true };
+
+			template<typename T>
+			auto take(T &value)
+			{
+				static_assert(is_trivially_copyable_v<T>);
+				if (!is_valid || bytes.size() < sizeof(T))
+				{
+					is_valid = false;
+					return;
+				}
+
+				memcpy(&value, bytes.data(), sizeof(T));
+				bytes = bytes.subspan(sizeof(T));
+			}
+
+			template<typename Char>
+			auto take(basic_string<Char> &text)
+			{
+				uint32_t length{};
+				take(length);
+				if (!is_valid || bytes.size() < length * sizeof(Char))
+				{
+					is_valid = false;
+					return;
+				}
+
+				text.resize(length);
+				memcpy(text.data(), bytes.data(), length * sizeof(Char));
+				bytes = bytes.subspan(length * sizeof(Char));
+			}
+		};
+
+		auto encode_job(job const &job)
+		{
+			message_writer writer{};
+			writer.put(command::start);
+			writer.put(u16string_view{ job.output_path });
+			writer.put(job.output_video_format);
+			writer.put(job.input_subtype);
+			writer.put(job.is_accelerated);
+			writer.put(job.width);
+			writer.put(job.height);
+			writer.put(job.rate);
+			writer.put(job.scale);
+			writer.put(job.frame_count);
+			writer.put(job.has_audio);
+			writer.put(job.audio_channel_count);
+			writer.put(job.audio_sampling_rate);
+			writer.put(job.video_quality);
+			writer.put(job.audio_bit_rate);
+			writer.put(job.encoder_thread_count);
+			writer.put(job.gop_length);
+			writer.put(job.priority);
+			writer.put(job.affinity);
+			writer.put(job.writes_digest);
+			return move(writer.bytes);
+		}
+
+		auto decode_job(message_reader &reader)
+		{
+			job job{};
+			reader.take(job.output_path);
+			reader.take(job.output_video_format);
+			reader.take(job.input_subtype);
+			reader.take(job.is_accelerated);
+			reader.take(job.width);
+			reader.take(job.height);
+			reader.take(job.rate);
+			reader.take(job.scale);
+			reader.take(job.frame_count);
+			reader.take(job.has_audio);
+			reader.take(job.audio_channel_count);
+			reader.take(job.audio_sampling_rate);
+			reader.take(job.video_quality);
+			reader.take(job.audio_bit_rate);
+			reader.take(job.encoder_thread_count);
+			reader.take(job.gop_length);
+			reader.take(job.priority);
+			reader.take(job.affinity);
+			reader.take(job.writes_digest);
+			return reader.is_valid ? optional{ job } : nullopt;
+		}
+
+		bool status::is_failed() const noexcept
+		{
+			return code < 0;
+		}
+
+		status null_encoder::start(job const &)
+		{
+			return {};
+		}
+
+		status null_encoder::write_video(int64_t const &, span<uint8_t const> image)
+		{
+			++video_frames;
+			fingerprint.update(image);
+			return {};
+		}
+
+		status null_encoder::write_audio(int64_t const &, span<uint8_t const> samples)
+		{
+			audio_bytes += static_cast<int64_t>(samples.size());
+			fingerprint.update(samples);
+			return {};
+		}
+
+		status null_encoder::finish()
+		{
+			return { 0, format("{} frames and {} bytes of audio, XXH64 {:016x}", video_frames, audio_bytes, fingerprint.digest()) };
+		}
+
+		void null_encoder::abort() noexcept
+		{
+		}
+
+		worker::worker(span<uint8_t> commands, span<uint8_t> replies) noexcept :
+			commands{ commands },
+			replies{ replies, reply_slot_count, reply_slot_capacity, {} }
+		{
+		}
+
+		worker::operator bool() const noexcept
+		{
+			return static_cast<bool>(commands);
+		}
+
+		bool worker::reply(uint32_t const &type, status const &result, function<bool()> const &is_orphaned) noexcept
+		{
+			message_writer writer{};
+			writer.put(type);
+			writer.put(result.code);
+			auto const detail{ string_view{ result.detail }.substr(0, reply_slot_capacity - writer.bytes.size()) };
+			writer.bytes.insert(writer.bytes.end(), detail.begin(), detail.end());
+
+			auto buffer{ replies.try_acquire(writer.bytes.size()) };
+			for (ring::backoff backoff{}; buffer.empty(); buffer = replies.try_acquire(writer.bytes.size()))
+			{
+				if (type == static_cast<uint32_t>(reply_type::log) || is_orphaned()) return false;
+				backoff.wait();
+			}
+
+			ranges::copy(writer.bytes, buffer.begin());
+			replies.publish(ring::kind::control, 0);
+			return true;
+		}
+
+		void worker::log(string_view message) noexcept
+		{
+			reply(static_cast<uint32_t>(reply_type::log), { 0, string{ message } }, [] { return true; });
+		}
+
+		status worker::serve(encoder &encoder, function<bool()> const &is_orphaned)
+		{
+			// Replies published before the plugin is listening would be lost, so nothing happens until it is.
+			for (ring::backoff backoff{}; !replies.get_consumer_count(); backoff.wait())
+				if (is_orphaned()) return { worker_lost, "waiting for the plugin to listen" };
+
+			auto const fail{ [&](status &&result)
+			{
+				encoder.abort();
+				reply(static_cast<uint32_t>(reply_type::failed), result, is_orphaned);
+				return result;
+			} };
+
+			for (ring::backoff backoff{};;)
+			{
+				auto const message{ commands.try_read() };
+				if (!message)
+				{
+					if (commands.is_finished() || is_orphaned())
+					{
+						encoder.abort();
+						return { commands.is_aborted() ? aborted : worker_lost, "the plugin, which stopped sending" };
+					}
+
+					backoff.wait();
+					continue;
+				}
+				backoff.reset();
+
+				status result{};
+				switch (message->type)
+				{
+				case ring::kind::video:
+					result = encoder.write_video(message->position, message->payload);
+					break;
+
+				case ring::kind::audio:
+					result = encoder.write_audio(message->position, message->payload);
+					break;
+
+				case ring::kind::control:
+				{
+					message_reader reader{ message->payload };
+					command type{};
+					reader.take(type);
+
+					if (type == command::start)
+					{
+						auto const job{ decode_job(reader) };
+						if (!job)
+						{
+							result = { bad_message, "the job description" };
+							break;
+						}
+
+						result = encoder.start(*job);
+						if (!result.is_failed()) reply(static_cast<uint32_t>(reply_type::started), result, is_orphaned);
+					}
+					else if (type == command::finish)
+					{
+						commands.acknowledge();
+						result = encoder.finish();
+						if (result.is_failed()) return fail(move(result));
+
+						reply(static_cast<uint32_t>(reply_type::finished), result, is_orphaned);
+						return result;
+					}
+					else
+						result = { bad_message, "an unknown command" };
+
+					break;
+				}
+
+				default:
+					result = { bad_message, "an unknown message kind" };
+				}
+
+				commands.acknowledge();
+				if (result.is_failed()) return fail(move(result));
+			}
+		}
+
+		client::client(span<uint8_t> commands, span<uint8_t> replies, uint32_t const &slot_count, size_t const &slot_capacity, function<bool()> &&is_worker_alive, function<bool()> &&is_aborted, function<void(string_view)> &&on_log) :
+			commands{ commands, slot_count, slot_capacity, {} },
+			replies_memory{ replies },
+			replies{},
+			is_worker_alive{ move(is_worker_alive) },
+			is_aborted{ move(is_aborted) },
+			on_log{ move(on_log) },
+			last_status{},
+			last_reply{},
+			stalled_time{}
+		{
+		}
+
+		void client::poll() noexcept
+		{
+			if (!replies) return;
+
+			while (auto const message{ replies->try_read() })
+			{
+				message_reader reader{ message->payload };
+				uint32_t type{};
+				int32_t code{};
+				reader.take(type);
+				reader.take(code);
+				string_view const detail{ reinterpret_cast<char const *>(reader.bytes.data()), reader.bytes.size() };
+
+				if (type == static_cast<uint32_t>(reply_type::log))
+					on_log(detail);
+				else
+				{
+					last_reply = type;
+					last_status = { code, string{ detail } };
+				}
+
+				replies->acknowledge();
+			}
+		}
+
+		optional<status> client::check_liveness(bool const &is_abortable)
+		{
+			// Looked at before polling, so whatever the worker said on its way out is not missed.
+			auto const is_alive{ is_worker_alive() };
+			poll();
+
+			if (last_status && last_status->is_failed()) return last_status;
+			if (!is_alive) return status{ worker_lost, "the encoder host, which exited unexpectedly" };
+			if (is_abortable && is_aborted()) return status{ aborted, "the encoder host, on request" };
+			return nullopt;
+		}
+
+		status client::wait_for_reply(uint32_t const &type, bool const &is_abortable)
+		{
+			for (ring::backoff backoff{};; backoff.wait())
+			{
+				auto const result{ check_liveness(is_abortable) };
+				if (last_reply == type) return *last_status;
+				if (result) return *result;
+			}
+		}
+
+		status client::start(job const &job)
+		{
+			for (ring::backoff backoff{}; !replies || !*replies || !commands.get_consumer_count(); backoff.wait())
+			{
+				if (!replies || !*replies) replies.emplace(replies_memory);
+				if (auto const result{ check_liveness(true) }) return *result;
+			}
+
+			auto const bytes{ encode_job(job) };
+			auto const buffer{ acquire(bytes.size()) };
+			if (!buffer) return buffer.error();
+
+			ranges::copy(bytes, buffer->begin());
+			publish(ring::kind::control, 0);
+
+			return wait_for_reply(static_cast<uint32_t>(reply_type::started), true);
+		}
+
+		expected<span<uint8_t>, status> client::acquire(size_t const &size)
+		{
+			poll();
+			if (last_status && last_status->is_failed()) return unexpected{ *last_status };
+			if (size > commands.get_slot_capacity()) [[unlikely]] return unexpected{ status{ message_too_large, "a command larger than a slot of the ring" } };
+
+			auto buffer{ commands.try_acquire(size) };
+			if (!buffer.empty()) return buffer;
+
+			auto const begin{ chrono::steady_clock::now() };
+			for (ring::backoff backoff{}; buffer.empty(); buffer = commands.try_acquire(size))
+			{
+				if (auto const result{ check_liveness(true) })
+				{
+					stalled_time += chrono::steady_clock::now() - begin;
+					return unexpected{ *result };
+				}
+				backoff.wait();
+			}
+			stalled_time += chrono::steady_clock::now() - begin;
+
+			return buffer;
+		}
+
+		void client::publish(ring::kind const &type, int64_t const &position) noexcept
+		{
+			commands.publish(type, position);
+		}
+
+		status client::finish()
+		{
+			message_writer writer{};
+			writer.put(command::finish);
+
+			auto const buffer{ acquire(writer.bytes.size()) };
+			if (!buffer) return buffer.error();
+
+			ranges::copy(writer.bytes, buffer->begin());
+			publish(ring::kind::control, 0);
+			commands.close(true);
+
+			// Finalizing cannot be cut short, so only the worker going away ends this wait.
+			return wait_for_reply(static_cast<uint32_t>(reply_type::finished), false);
+		}
+
+		void client::abort() noexcept
+		{
+			commands.close(false);
+		}
+
+		chrono::nanoseconds client::get_stalled_time() const noexcept
+		{
+			return stalled_time;
+		}
+	}
+}
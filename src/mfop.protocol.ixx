@@ -0,0 +1,142 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+export module mfop.protocol;
+
+import std;
+import mfop.ring;
+import mfop.hash;
+
+namespace mfop
+{
+	namespace protocol
+	{
+		export
+		{
+			// HRESULTs, spelled out so that this module stays free of Windows headers.
+			std::int32_t constexpr aborted{ static_cast<std::int32_t>(0x8000'4004u) };
+			std::int32_t constexpr worker_lost{ static_cast<std::int32_t>(0x8007'006du) };
+			std::int32_t constexpr bad_message{ static_cast<std::int32_t>(0x8000'ffffu) };
+			std::int32_t constexpr message_too_large{ static_cast<std::int32_t>(0x8007'007au) };
+
+			std::uint32_t constexpr reply_slot_count{ 64 };
+			std::size_t constexpr reply_slot_capacity{ 1024 };
+
+			struct status
+			{
+				std::int32_t code;
+				std::string detail;
+
+				bool is_failed() const noexcept;
+			};
+
+			// Everything the worker needs to build the sink writer the plugin would otherwise have built itself.
+			struct job
+			{
+				std::u16string output_path;
+				std::array<std::uint8_t, 16> output_video_format;
+				// FourCC of the frames that follow, already converted and packed at the output size.
+				std::uint32_t input_subtype;
+				bool is_accelerated;
+				std::int32_t width;
+				std::int32_t height;
+				std::int32_t rate;
+				std::int32_t scale;
+				std::int32_t frame_count;
+				bool has_audio;
+				std::int32_t audio_channel_count;
+				std::int32_t audio_sampling_rate;
+				std::uint32_t video_quality;
+				std::uint32_t audio_bit_rate;
+				// The share of the CPU budget that is the worker's; see mfop.schedule.
+				std::uint32_t encoder_thread_count;
+				// [video] gopLength; 0 leaves it to the encoder.
+				std::uint32_t gop_length;
+				std::uint32_t priority;
+				std::uint64_t affinity;
+				// Leave a BLAKE3 sidecar beside the output; see mfop.digest.
+				bool writes_digest;
+			};
+
+			// The worker side: owns the encoder and never touches the host.
+			struct encoder
+			{
+				virtual ~encoder() = default;
+
+				virtual status start(job const &job) = 0;
+				virtual status write_video(std::int64_t const &frame, std::span<std::uint8_t const> image) = 0;
+				virtual status write_audio(std::int64_t const &sample, std::span<std::uint8_t const> samples) = 0;
+				// Finalizes the output; the detail of the result ends up in the plugin's log.
+				virtual status finish() = 0;
+				virtual void abort() noexcept = 0;
+			};
+
+			// Counts and fingerprints what it is given, so the transport can be measured and checked without a real encoder.
+			struct null_encoder final : encoder
+			{
+				status start(job const &job) override;
+				status write_video(std::int64_t const &frame, std::span<std::uint8_t const> image) override;
+				status write_audio(std::int64_t const &sample, std::span<std::uint8_t const> samples) override;
+				status finish() override;
+				void abort() noexcept override;
+
+			private:
+				std::int64_t video_frames{};
+				std::int64_t audio_bytes{};
+				hash::xxh64 fingerprint{};
+			};
+
+			struct worker
+			{
+				// Consumes commands and publishes replies; both mappings are created by the plugin beforehand.
+				worker(std::span<std::uint8_t> commands, std::span<std::uint8_t> replies) noexcept;
+
+				explicit operator bool() const noexcept;
+
+				// Best effort: dropped rather than waited on when the plugin is not reading.
+				void log(std::string_view message) noexcept;
+				// Runs until the job is finished, aborted or fails, or until is_orphaned says the plugin is gone.
+				status serve(encoder &encoder, std::function<bool()> const &is_orphaned);
+
+			private:
+				ring::consumer commands;
+				ring::producer replies;
+
+				bool reply(std::uint32_t const &type, status const &result, std::function<bool()> const &is_orphaned) noexcept;
+			};
+
+			struct client
+			{
+				client(std::span<std::uint8_t> commands, std::span<std::uint8_t> replies, std::uint32_t const &slot_count, std::size_t const &slot_capacity, std::function<bool()> &&is_worker_alive, std::function<bool()> &&is_aborted, std::function<void(std::string_view)> &&on_log);
+
+				// Waits for the worker to attach to both rings, then hands it the job and waits for its encoder to come up.
+				status start(job const &job);
+				std::expected<std::span<std::uint8_t>, status> acquire(std::size_t const &size);
+				void publish(ring::kind const &type, std::int64_t const &position) noexcept;
+				status finish();
+				void abort() noexcept;
+
+				std::chrono::nanoseconds get_stalled_time() const noexcept;
+
+			private:
+				ring::producer commands;
+				std::span<std::uint8_t> replies_memory;
+				std::optional<ring::consumer> replies;
+				std::function<bool()> is_worker_alive;
+				std::function<bool()> is_aborted;
+				std::function<void(std::string_view)> on_log;
+				// What the worker last replied, apart from its log.
+				std::optional<status> last_status;
+				std::uint32_t last_reply;
+				std::chrono::nanoseconds stalled_time;
+
+				status wait_for_reply(std::uint32_t const &type, bool const &is_abortable);
+				void poll() noexcept;
+				std::optional<status> check_liveness(bool const &is_abortable);
+			};
+		}
+	}
+}
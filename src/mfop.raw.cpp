@@ -0,0 +1,267 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module mfop.raw;
+
+import std;
+
+using namespace std;
+
+namespace mfop
+{
+	namespace raw
+	{
+		auto const constinit wav_header_size{ 80u };
+		auto const constinit riff_size_limit{ 0xffff'ffffull };
+
+		template<size_t N>
+		auto constexpr put_little_endian(array<uint8_t, N> &bytes, size_t const &offset, uint64_t const &value, size_t const &width) noexcept
+		{
+			for (auto i{ 0u }; i < width; ++i)
+				bytes[offset + i] = static_cast<uint8_t>(value >> (i * 8));
+		}
+
+		template<size_t N>
+		auto constexpr put_tag(array<uint8_t, N> &bytes, size_t const &offset, string_view tag) noexcept
+		{
+			ranges::copy(tag, bytes.begin() + offset);
+		}
+
+		auto to_bytes(string_view text) noexcept
+		{
+			return span{ reinterpret_cast<uint8_t const *>(text.data()), text.size() };
+		}
+
+		sequential_file::sequential_file(filesystem::path const &path, write_observer const &observer, size_t const &buffer_size) :
+			file{},
+			observer{ observer },
+			buffer(max<size_t>(buffer_size, 1 << 16)),
+			buffered{},
+			size{}
+		{
+			// Our own buffer already batches the writes; a second one in the stream would only add a copy.
+			file.rdbuf()->pubsetbuf(nullptr, 0);
+			file.open(path, ios::binary | ios::trunc);
+		}
+
+		bool sequential_file::flush()
+		{
+			if (buffered && !file.write(reinterpret_cast<char const *>(buffer.data()), static_cast<streamsize>(buffered))) return false;
+			buffered = 0;
+			return true;
+		}
+
+		bool sequential_file::write(span<uint8_t const> data)
+		{
+			if (observer) observer(size, data);
+			size += data.size();
+
+			if (buffered + data.size() > buffer.size() && !flush()) return false;
+
+			// Whole frames are usually as large as the buffer, so they skip it instead of being copied twice.
+			if (data.size() >= buffer.size())
+				return static_cast<bool>(file.write(reinterpret_cast<char const *>(data.data()), static_cast<streamsize>(data.size())));
+
+			ranges::copy(data, buffer.begin() + buffered);
+			buffered += data.size();
+			return true;
+		}
+
+		bool sequential_file::write_at(uint64_t const &offset, span<uint8_t const> data)
+		{
+			if (observer) observer(offset, data);
+			if (!flush()) return false;
+
+			file.seekp(static_cast<streamoff>(offset));
+			file.write(reinterpret_cast<char const *>(data.data()), static_cast<streamsize>(data.size()));
+			file.seekp(0, ios::end);
+
+			return static_cast<bool>(file);
+		}
+
+		bool sequential_file::close()
+		{
+			auto const is_flushed{ flush() };
+			file.close();
+			return is_flushed && !file.fail();
+		}
+
+		uint64_t sequential_file::get_size() const noexcept
+		{
+			return size;
+		}
+
+		sequential_file::operator bool() const noexcept
+		{
+			return static_cast<bool>(file);
+		}
+
+		auto const constinit frame_tag{ "FRAME\n"sv };
+
+		y4m_format::y4m_format(pair<int32_t, int32_t> const &resolution, pair<int32_t, int32_t> const &fps, chroma const &subsampling) :
+			width{ resolution.first },
+			height{ resolution.second },
+			subsampling{ subsampling },
+			header{ format("YUV4MPEG2 W{} H{} F{}:{} Ip A1:1 {}\n", resolution.first, resolution.second, fps.first, fps.second, subsampling == chroma::yuv422 ? "C422" : "C420mpeg2") }
+		{
+		}
+
+		string const &y4m_format::get_header() const noexcept
+		{
+			return header;
+		}
+
+		size_t y4m_format::get_frame_size() const noexcept
+		{
+			return frame_tag.size() + static_cast<size_t>(width) * height * (subsampling == chroma::yuv422 ? 4 : 3) / 2;
+		}
+
+		void y4m_format::pack_yuy2(uint8_t const yuy2[], span<uint8_t> frame) const noexcept
+		{
+			auto const luma_size{ static_cast<size_t>(width) * height };
+			auto const y{ ranges::copy(frame_tag, frame.data()).out }, u{ y + luma_size }, v{ u + luma_size / 2 };
+
+			// One pass over each Y0 U Y1 V quad reads the frame only once.
+			for (size_t i{}; i < luma_size / 2; ++i)
+			{
+				auto const quad{ yuy2 + i * 4 };
+				y[i * 2] = quad[0];
+				u[i] = quad[1];
+				y[i * 2 + 1] = quad[2];
+				v[i] = quad[3];
+			}
+		}
+
+		void y4m_format::pack_nv12(uint8_t const nv12[], span<uint8_t> frame) const noexcept
+		{
+			auto const luma_size{ static_cast<size_t>(width) * height };
+			auto const y{ ranges::copy(frame_tag, frame.data()).out }, u{ y + luma_size }, v{ u + luma_size / 4 };
+
+			copy_n(nv12, luma_size, y);
+
+			for (size_t i{}, uv{ luma_size }; i < luma_size / 4; ++i, uv += 2)
+			{
+				u[i] = nv12[uv];
+				v[i] = nv12[uv + 1];
+			}
+		}
+
+		y4m_writer::y4m_writer(filesystem::path const &path, y4m_format const &format, write_observer const &observer) :
+			file{ path, observer },
+			format{ format },
+			frame(format.get_frame_size())
+		{
+			file.write(to_bytes(format.get_header()));
+		}
+
+		bool y4m_writer::write_yuy2(uint8_t const yuy2[])
+		{
+			format.pack_yuy2(yuy2, frame);
+			return file.write(frame);
+		}
+
+		bool y4m_writer::write_nv12(uint8_t const nv12[])
+		{
+			format.pack_nv12(nv12, frame);
+			return file.write(frame);
+		}
+
+		bool y4m_writer::close()
+		{
+			return file.close();
+		}
+
+		uint64_t y4m_writer::get_size() const noexcept
+		{
+			return file.get_size();
+		}
+
+		y4m_writer::operator bool() const noexcept
+		{
+			return static_cast<bool>(file);
+		}
+
+		array<uint8_t, wav_header_size> make_wav_header(int32_t const &channel_count, int32_t const &sampling_rate) noexcept
+		{
+			auto const block_alignment{ static_cast<uint32_t>(channel_count) * 2 };
+
+			// The JUNK chunk holds the place of the ds64 chunk that RF64 needs, so growing past 4 GiB never moves the data.
+			array<uint8_t, wav_header_size> header{};
+			put_tag(header, 0, "RIFF");
+			put_little_endian(header, 4, riff_size_limit, 4);
+			put_tag(header, 8, "WAVE");
+			put_tag(header, 12, "JUNK");
+			put_little_endian(header, 16, 28, 4);
+			put_tag(header, 48, "fmt ");
+			put_little_endian(header, 52, 16, 4);
+			put_little_endian(header, 56, 1, 2);
+			put_little_endian(header, 58, channel_count, 2);
+			put_little_endian(header, 60, sampling_rate, 4);
+			put_little_endian(header, 64, static_cast<uint64_t>(sampling_rate) * block_alignment, 4);
+			put_little_endian(header, 68, block_alignment, 2);
+			put_little_endian(header, 70, 16, 2);
+			put_tag(header, 72, "data");
+			put_little_endian(header, 76, riff_size_limit, 4);
+
+			return header;
+		}
+
+		wav_writer::wav_writer(filesystem::path const &path, int32_t const &channel_count, int32_t const &sampling_rate, write_observer const &observer) :
+			file{ path, observer },
+			block_alignment{ static_cast<uint32_t>(channel_count) * 2 },
+			data_size{}
+		{
+			file.write(make_wav_header(channel_count, sampling_rate));
+		}
+
+		bool wav_writer::write(span<uint8_t const> samples)
+		{
+			data_size += samples.size();
+			return file.write(samples);
+		}
+
+		bool wav_writer::close()
+		{
+			auto const riff_size{ wav_header_size - 8 + data_size };
+
+			array<uint8_t, wav_header_size> header{};
+			if (riff_size <= riff_size_limit)
+			{
+				put_tag(header, 0, "RIFF");
+				put_little_endian(header, 4, riff_size, 4);
+				put_little_endian(header, 76, data_size, 4);
+
+				if (!file.write_at(0, span{ header }.first(8)) || !file.write_at(76, span{ header }.subspan(76, 4))) return false;
+			}
+			else
+			{
+				put_tag(header, 0, "RF64");
+				put_little_endian(header, 4, riff_size_limit, 4);
+				put_tag(header, 8, "WAVE");
+				put_tag(header, 12, "ds64");
+				put_little_endian(header, 16, 28, 4);
+				put_little_endian(header, 20, riff_size, 8);
+				put_little_endian(header, 28, data_size, 8);
+				put_little_endian(header, 36, data_size / block_alignment, 8);
+				put_little_endian(header, 76, riff_size_limit, 4);
+
+				if (!file.write_at(0, span{ header }.first(48)) || !file.write_at(76, span{ header }.subspan(76, 4))) return false;
+			}
+
+			return file.close();
+		}
+
+		uint64_t wav_writer::get_size() const noexcept
+		{
+			return file.get_size();
+		}
+
+		wav_writer::operator bool() const noexcept
+		{
+			return static_cast<bool>(file);
+		}
+	}
+}
@@ -0,0 +1,107 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+export module mfop.raw;
+
+import std;
+
+namespace mfop
+{
+	namespace raw
+	{
+		export
+		{
+			// Sees every write where it lands in the file, as it is made, so that a hash can be taken without reading the file back.
+			using write_observer = std::function<void(std::uint64_t const &, std::span<std::uint8_t const>)>;
+
+			// Collects small writes into one large buffer, so the file is written in a few big sequential requests.
+			struct sequential_file
+			{
+				explicit sequential_file(std::filesystem::path const &path, write_observer const &observer = {}, std::size_t const &buffer_size = 8 << 20);
+
+				bool write(std::span<std::uint8_t const> data);
+				bool write_at(std::uint64_t const &offset, std::span<std::uint8_t const> data);
+				bool close();
+
+				std::uint64_t get_size() const noexcept;
+				explicit operator bool() const noexcept;
+
+			private:
+				std::ofstream file;
+				write_observer observer;
+				std::vector<std::uint8_t> buffer;
+				std::size_t buffered;
+				std::uint64_t size;
+
+				bool flush();
+			};
+
+			enum struct chroma
+			{
+				yuv420,
+				yuv422
+			};
+
+			// Lays out YUV4MPEG2 with planar 8-bit frames, which any encoder can read back without a demuxer.
+			struct y4m_format
+			{
+				y4m_format(std::pair<std::int32_t, std::int32_t> const &resolution, std::pair<std::int32_t, std::int32_t> const &fps, chroma const &subsampling);
+
+				std::string const &get_header() const noexcept;
+				// Bytes per frame, including its FRAME line.
+				std::size_t get_frame_size() const noexcept;
+
+				// Packed YUY2 becomes planar 4:2:2 without touching a sample.
+				void pack_yuy2(std::uint8_t const yuy2[], std::span<std::uint8_t> frame) const noexcept;
+				// NV12 with a stride of its width becomes planar 4:2:0.
+				void pack_nv12(std::uint8_t const nv12[], std::span<std::uint8_t> frame) const noexcept;
+
+			private:
+				std::int32_t width;
+				std::int32_t height;
+				chroma subsampling;
+				std::string header;
+			};
+
+			struct y4m_writer
+			{
+				y4m_writer(std::filesystem::path const &path, y4m_format const &format, write_observer const &observer = {});
+
+				bool write_yuy2(std::uint8_t const yuy2[]);
+				bool write_nv12(std::uint8_t const nv12[]);
+				bool close();
+
+				std::uint64_t get_size() const noexcept;
+				explicit operator bool() const noexcept;
+
+			private:
+				sequential_file file;
+				y4m_format format;
+				std::vector<std::uint8_t> frame;
+			};
+
+			// Streamed WAV leaves its sizes at the maximum, which readers of pipes take as "until the end".
+			std::array<std::uint8_t, 80> make_wav_header(std::int32_t const &channel_count, std::int32_t const &sampling_rate) noexcept;
+
+			// 16-bit PCM that turns into RF64 on close once it outgrows the 4 GiB a RIFF header can describe.
+			struct wav_writer
+			{
+				wav_writer(std::filesystem::path const &path, std::int32_t const &channel_count, std::int32_t const &sampling_rate, write_observer const &observer = {});
+
+				bool write(std::span<std::uint8_t const> samples);
+				bool close();
+
+				std::uint64_t get_size() const noexcept;
+				explicit operator bool() const noexcept;
+
+			private:
+				sequential_file file;
+				std::uint32_t block_alignment;
+				std::uint64_t data_size;
+			};
+		}
+	}
+}
@@ -0,0 +1,555 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module mfop.remux;
+
+import std;
+
+using namespace std;
+
+namespace mfop
+{
+	namespace remux
+	{
+		auto const constinit copy_buffer_size{ size_t{ 4 } << 20 };
+
+		struct box
+		{
+			string_view type;
+			span<uint8_t const> payload;
+		};
+
+		struct top_level_box
+		{
+			string type;
+			uint64_t offset;
+			uint64_t size;
+		};
+
+		struct chunk
+		{
+			uint64_t offset;
+			uint64_t size;
+		};
+
+		struct source_track
+		{
+			track entry;
+			vector<chunk> chunks;
+		};
+
+		struct source_layout
+		{
+			vector<uint8_t> file_type;
+			vector<uint8_t> movie_header;
+			uint32_t timescale;
+			uint64_t duration;
+			vector<source_track> tracks;
+		};
+
+		// A chunk of a kept track, where it sits in the source.
+		struct placed_chunk
+		{
+			size_t track_index;
+			size_t chunk_index;
+			uint64_t offset;
+			uint64_t size;
+		};
+
+		bool track::is_video() const noexcept
+		{
+			return handler == "vide";
+		}
+
+		bool track::is_audio() const noexcept
+		{
+			return handler == "soun";
+		}
+
+		auto read_big_endian(span<uint8_t const> bytes, size_t const &offset, size_t const &size) noexcept
+		{
+			if (offset > bytes.size() || size > bytes.size() - offset) return uint64_t{};
+			return ranges::fold_left(bytes.subspan(offset, size), uint64_t{}, [](uint64_t const &value, uint8_t const &byte) { return value << 8 | byte; });
+		}
+
+		auto skip(span<uint8_t const> bytes, size_t const &size) noexcept
+		{
+			return size < bytes.size() ? bytes.subspan(size) : span<uint8_t const>{};
+		}
+
+		auto get_boxes(span<uint8_t const> bytes)
+		{
+			vector<box> boxes{};
+			for (size_t offset{}; offset + 8 <= bytes.size();)
+			{
+				auto size{ read_big_endian(bytes, offset, 4) };
+				auto header{ uint64_t{ 8 } };
+				if (size == 1)
+				{
+					size = read_big_endian(bytes, offset + 8, 8);
+					header = 16;
+				}
+				else if (size == 0)
+					size = bytes.size() - offset;
+
+				if (size < header || size > bytes.size() - offset) break;
+
+				boxes.push_back({ { reinterpret_cast<char const *>(bytes.data() + offset + 4), 4 }, bytes.subspan(offset + header, size - header) });
+				offset += size;
+			}
+			return boxes;
+		}
+
+		auto find_box(span<uint8_t const> bytes, initializer_list<string_view> path) -> optional<span<uint8_t const>>
+		{
+			for (auto const &type : path)
+			{
+				auto const boxes{ get_boxes(bytes) };
+				auto const found{ ranges::find(boxes, type, &box::type) };
+				if (found == boxes.end()) return nullopt;
+				bytes = found->payload;
+			}
+			return bytes;
+		}
+
+		auto append_big_endian(vector<uint8_t> &bytes, uint64_t const &value, size_t const &size)
+		{
+			for (auto i{ size }; i > 0; --i) bytes.push_back(static_cast<uint8_t>(value >> (8 * (i - 1))));
+		}
+
+		auto append_box(vector<uint8_t> &bytes, string_view type, span<uint8_t const> payload)
+		{
+			append_big_endian(bytes, 8 + payload.size(), 4);
+			bytes.insert(bytes.end(), type.begin(), type.end());
+			bytes.insert(bytes.end(), payload.begin(), payload.end());
+		}
+
+		auto read_file(ifstream &file, uint64_t const &offset, uint64_t const &size) -> optional<vector<uint8_t>>
+		{
+			vector<uint8_t> bytes(static_cast<size_t>(size));
+			file.seekg(static_cast<streamoff>(offset));
+			if (!file.read(reinterpret_cast<char *>(bytes.data()), static_cast<streamsize>(size))) return nullopt;
+			return bytes;
+		}
+
+		// Only the headers are read; an mdat of many gigabytes is stepped over.
+		auto read_top_level_boxes(ifstream &file, uint64_t const &file_size) -> optional<vector<top_level_box>>
+		{
+			vector<top_level_box> boxes{};
+			for (uint64_t offset{}; offset + 8 <= file_size;)
+			{
+				auto const header{ read_file(file, offset, min<uint64_t>(16, file_size - offset)) };
+				if (!header) return nullopt;
+
+				auto size{ read_big_endian(*header, 0, 4) };
+				auto header_size{ uint64_t{ 8 } };
+				if (size == 1)
+				{
+					if (header->size() < 16) return nullopt;
+					size = read_big_endian(*header, 8, 8);
+					header_size = 16;
+				}
+				else if (size == 0)
+					size = file_size - offset;
+
+				if (size < header_size || size > file_size - offset) return nullopt;
+
+				boxes.push_back({ string{ reinterpret_cast<char const *>(header->data() + 4), 4 }, offset, size });
+				offset += size;
+			}
+			return boxes;
+		}
+
+		// A full box's entries, or nothing when it claims more than it holds.
+		auto get_entries(span<uint8_t const> table, size_t const &entry_size, size_t const &header_size = 8) -> optional<span<uint8_t const>>
+		{
+			auto const count{ read_big_endian(table, header_size - 4, 4) };
+			if (table.size() < header_size || count > (table.size() - header_size) / entry_size) return nullopt;
+			return table.subspan(header_size, static_cast<size_t>(count * entry_size));
+		}
+
+		auto read_track(span<uint8_t const> trak, uint64_t const &file_size) -> expected<source_track, failure>
+		{
+			source_track result{};
+			auto &entry{ result.entry };
+
+			auto const tkhd{ find_box(trak, { "tkhd" }) };
+			auto const mdia{ find_box(trak, { "mdia" }) };
+			if (!tkhd || !mdia) return unexpected{ failure::unreadable };
+
+			entry.id = static_cast<uint32_t>(read_big_endian(*tkhd, read_big_endian(*tkhd, 0, 1) == 1 ? 20 : 12, 4));
+
+			if (auto const mdhd{ find_box(*mdia, { "mdhd" }) })
+			{
+				auto const is_long{ read_big_endian(*mdhd, 0, 1) == 1 };
+				entry.timescale = static_cast<uint32_t>(read_big_endian(*mdhd, is_long ? 20 : 12, 4));
+				entry.duration = read_big_endian(*mdhd, is_long ? 24 : 16, is_long ? 8 : 4);
+			}
+
+			if (auto const hdlr{ find_box(*mdia, { "hdlr" }) }; hdlr && hdlr->size() >= 12)
+				entry.handler = string{ reinterpret_cast<char const *>(hdlr->data() + 8), 4 };
+
+			// Samples kept in another file cannot be copied from this one.
+			if (auto const dref{ find_box(*mdia, { "minf", "dinf", "dref" }) })
+				for (auto const &reference : get_boxes(skip(*dref, 8)))
+					if (!(read_big_endian(reference.payload, 0, 4) & 1)) return unexpected{ failure::unsupported };
+
+			auto const stbl{ find_box(*mdia, { "minf", "stbl" }) };
+			if (!stbl) return unexpected{ failure::unreadable };
+
+			auto const tables{ get_boxes(*stbl) };
+			auto const find_table{ [&](string_view type) -> optional<span<uint8_t const>>
+			{
+				auto const found{ ranges::find(tables, type, &box::type) };
+				return found == tables.end() ? nullopt : optional{ found->payload };
+			} };
+
+			// Compact sizes are rare enough to leave to the encoder, and auxiliary offsets point into the file like chunk offsets do.
+			if (find_table("stz2") || find_table("saio")) return unexpected{ failure::unsupported };
+
+			if (auto const stsd{ find_table("stsd") })
+				if (auto const entries{ get_boxes(skip(*stsd, 8)) }; !entries.empty())
+				{
+					entry.codec = entries.front().type;
+					if (entry.is_video())
+					{
+						entry.width = static_cast<uint32_t>(read_big_endian(entries.front().payload, 24, 2));
+						entry.height = static_cast<uint32_t>(read_big_endian(entries.front().payload, 26, 2));
+					}
+				}
+
+			auto const stsz{ find_table("stsz") };
+			auto const stsc{ find_table("stsc") };
+			auto const stco{ find_table("stco") };
+			auto const co64{ find_table("co64") };
+			auto const stts{ find_table("stts") };
+			if (!stsz || !stsc || !stts || (!stco && !co64)) return unexpected{ failure::unreadable };
+
+			auto const constant_size{ static_cast<uint32_t>(read_big_endian(*stsz, 4, 4)) };
+			auto const sample_count{ read_big_endian(*stsz, 8, 4) };
+			auto const sizes{ constant_size ? optional{ span<uint8_t const>{} } : get_entries(*stsz, 4, 12) };
+			auto const chunk_offsets{ co64 ? get_entries(*co64, 8) : get_entries(*stco, 4) };
+			auto const chunk_runs{ get_entries(*stsc, 12) };
+			auto const time_runs{ get_entries(*stts, 8) };
+			if (!sizes || !chunk_offsets || !chunk_runs || !time_runs || (!constant_size && sizes->size() / 4 != sample_count)) return unexpected{ failure::unreadable };
+
+			auto &samples{ entry.samples };
+			samples.resize(static_cast<size_t>(sample_count));
+
+			for (size_t i{}; i < samples.size(); ++i)
+				samples[i] = { 0, constant_size ? constant_size : static_cast<uint32_t>(read_big_endian(*sizes, i * 4, 4)), 0, 0, true };
+
+			{
+				size_t i{};
+				uint64_t time{};
+				for (size_t run{}; run < time_runs->size() / 8; ++run)
+				{
+					auto const count{ read_big_endian(*time_runs, run * 8, 4) };
+					auto const delta{ read_big_endian(*time_runs, run * 8 + 4, 4) };
+					for (uint64_t k{}; k < count && i < samples.size(); ++k, time += delta) samples[i++].decode_time = time;
+				}
+			}
+
+			if (auto const ctts{ find_table("ctts") })
+				if (auto const offset_runs{ get_entries(*ctts, 8) })
+				{
+					auto const is_signed{ read_big_endian(*ctts, 0, 1) == 1 };
+					size_t i{};
+					for (size_t run{}; run < offset_runs->size() / 8; ++run)
+					{
+						auto const count{ read_big_endian(*offset_runs, run * 8, 4) };
+						auto const value{ static_cast<uint32_t>(read_big_endian(*offset_runs, run * 8 + 4, 4)) };
+						auto const offset{ is_signed ? static_cast<int64_t>(static_cast<int32_t>(value)) : static_cast<int64_t>(value) };
+						for (uint64_t k{}; k < count && i < samples.size(); ++k) samples[i++].composition_offset = offset;
+					}
+				}
+
+			// Without a sync sample table every sample is one.
+			if (auto const stss{ find_table("stss") })
+				if (auto const sync_samples{ get_entries(*stss, 4) })
+				{
+					for (auto &sample : samples) sample.is_sync = false;
+					for (size_t i{}; i < sync_samples->size() / 4; ++i)
+						if (auto const number{ read_big_endian(*sync_samples, i * 4, 4) }; number >= 1 && number <= samples.size()) samples[static_cast<size_t>(number - 1)].is_sync = true;
+				}
+
+			auto const offset_size{ co64 ? size_t{ 8 } : size_t{ 4 } };
+			auto const chunk_count{ chunk_offsets->size() / offset_size };
+			auto const run_count{ chunk_runs->size() / 12 };
+
+			size_t sample_index{};
+			size_t run{};
+			for (size_t c{}; c < chunk_count; ++c)
+			{
+				// stsc numbers chunks from one, and each run lasts until the next one's first chunk.
+				while (run + 1 < run_count && read_big_endian(*chunk_runs, (run + 1) * 12, 4) <= c + 1) ++run;
+				auto const per_chunk{ run_count ? read_big_endian(*chunk_runs, run * 12 + 4, 4) : 0 };
+
+				auto const start{ read_big_endian(*chunk_offsets, c * offset_size, offset_size) };
+				auto offset{ start };
+				for (uint64_t k{}; k < per_chunk && sample_index < samples.size(); ++k)
+				{
+					samples[sample_index].offset = offset;
+					offset += samples[sample_index++].size;
+				}
+
+				if (offset > file_size) return unexpected{ failure::unreadable };
+				result.chunks.push_back({ start, offset - start });
+			}
+
+			if (sample_index != samples.size()) return unexpected{ failure::unreadable };
+
+			return result;
+		}
+
+		auto read_layout(ifstream &file, uint64_t const &file_size) -> expected<source_layout, failure>
+		{
+			auto const boxes{ read_top_level_boxes(file, file_size) };
+			if (!boxes) return unexpected{ failure::unreadable };
+
+			source_layout layout{};
+
+			if (auto const ftyp{ ranges::find(*boxes, "ftyp"sv, &top_level_box::type) }; ftyp != boxes->end())
+				if (auto const bytes{ read_file(file, ftyp->offset, ftyp->size) })
+					layout.file_type = move(*bytes);
+
+			auto const moov{ ranges::find(*boxes, "moov"sv, &top_level_box::type) };
+			if (moov == boxes->end()) return unexpected{ failure::unreadable };
+
+			auto movie_header{ read_file(file, moov->offset, moov->size) };
+			if (!movie_header) return unexpected{ failure::unreadable };
+			layout.movie_header = move(*movie_header);
+
+			auto const payload{ get_boxes(layout.movie_header) };
+			if (payload.empty()) return unexpected{ failure::unreadable };
+			auto const movie_boxes{ get_boxes(payload.front().payload) };
+
+			// Fragments carry samples the movie header does not list.
+			if (ranges::contains(movie_boxes, "mvex"sv, &box::type) || ranges::contains(*boxes, "moof"sv, &top_level_box::type)) return unexpected{ failure::unsupported };
+
+			if (auto const mvhd{ ranges::find(movie_boxes, "mvhd"sv, &box::type) }; mvhd != movie_boxes.end())
+			{
+				auto const is_long{ read_big_endian(mvhd->payload, 0, 1) == 1 };
+				layout.timescale = static_cast<uint32_t>(read_big_endian(mvhd->payload, is_long ? 20 : 12, 4));
+				layout.duration = read_big_endian(mvhd->payload, is_long ? 24 : 16, is_long ? 8 : 4);
+			}
+
+			for (auto const &trak : movie_boxes)
+			{
+				if (trak.type != "trak") continue;
+
+				auto parsed{ read_track(trak.payload, file_size) };
+				if (!parsed) return unexpected{ parsed.error() };
+				layout.tracks.push_back(move(*parsed));
+			}
+
+			if (layout.tracks.empty()) return unexpected{ failure::unreadable };
+
+			return layout;
+		}
+
+		auto open_layout(filesystem::path const &path, ifstream &file) -> expected<source_layout, failure>
+		{
+			file.open(path, ios::binary);
+			error_code error{};
+			auto const file_size{ filesystem::file_size(path, error) };
+			if (!file || error) return unexpected{ failure::unreadable };
+
+			return read_layout(file, file_size);
+		}
+
+		// Rebuilds the boxes along path below bytes, hands the last one's children to replace, and copies everything else as it is.
+		auto rebuild(span<uint8_t const> bytes, span<string_view const> path, auto const &replace) -> vector<uint8_t>
+		{
+			vector<uint8_t> result{};
+			for (auto const &child : get_boxes(bytes))
+			{
+				if (path.empty() || child.type != path.front())
+				{
+					append_box(result, child.type, child.payload);
+					continue;
+				}
+
+				append_box(result, child.type, path.size() == 1 ? replace(child.payload) : rebuild(child.payload, path.subspan(1), replace));
+			}
+			return result;
+		}
+
+		// The movie header with the dropped tracks left out, and the kept ones pointing at offsets.
+		auto make_movie_header(source_layout const &layout, vector<bool> const &is_kept, bool const &uses_long_offsets, span<vector<uint64_t> const> offsets)
+		{
+			static constexpr array<string_view const, 3> sample_table_path{ "mdia", "minf", "stbl" };
+
+			vector<uint8_t> payload{};
+			size_t track_index{};
+
+			for (auto const &child : get_boxes(get_boxes(layout.movie_header).front().payload))
+			{
+				if (child.type != "trak")
+				{
+					append_box(payload, child.type, child.payload);
+					continue;
+				}
+
+				auto const index{ track_index++ };
+				if (!is_kept[index]) continue;
+
+				auto const track_box{ rebuild(child.payload, sample_table_path, [&](span<uint8_t const> stbl)
+				{
+					vector<uint8_t> table{};
+					for (auto const &entry : get_boxes(stbl))
+					{
+						if (entry.type != "stco" && entry.type != "co64")
+						{
+							append_box(table, entry.type, entry.payload);
+							continue;
+						}
+
+						vector<uint8_t> chunk_offsets{};
+						append_big_endian(chunk_offsets, 0, 4);
+						append_big_endian(chunk_offsets, offsets[index].size(), 4);
+						for (auto const &offset : offsets[index]) append_big_endian(chunk_offsets, offset, uses_long_offsets ? 8 : 4);
+						append_box(table, uses_long_offsets ? "co64" : "stco", chunk_offsets);
+					}
+					return table;
+				}) };
+				append_box(payload, "trak", track_box);
+			}
+
+			vector<uint8_t> result{};
+			append_box(result, "moov", payload);
+			return result;
+		}
+
+		expected<movie, failure> read_movie(filesystem::path const &path)
+		{
+			ifstream file{};
+			auto layout{ open_layout(path, file) };
+			if (!layout) return unexpected{ layout.error() };
+
+			movie result{ layout->timescale, layout->duration, {} };
+			for (auto &source : layout->tracks) result.tracks.push_back(move(source.entry));
+			return result;
+		}
+
+		auto copy_chunks(ifstream &input, ofstream &output, span<placed_chunk const> chunks, uint64_t const &total, function<bool(uint64_t const &, uint64_t const &)> const &progress, function<void(span<uint8_t const>)> const &on_written) -> expected<statistics, failure>
+		{
+			statistics result{};
+			vector<char> buffer(copy_buffer_size);
+
+			for (size_t i{}; i < chunks.size();)
+			{
+				auto const start{ chunks[i].offset };
+				auto end{ start + chunks[i].size };
+				for (++i; i < chunks.size() && chunks[i].offset == end; ++i) end += chunks[i].size;
+
+				input.seekg(static_cast<streamoff>(start));
+				for (auto remaining{ end - start }; remaining > 0;)
+				{
+					auto const size{ static_cast<streamsize>(min<uint64_t>(remaining, buffer.size())) };
+					if (!input.read(buffer.data(), size)) return unexpected{ failure::unreadable };
+					if (!output.write(buffer.data(), size)) return unexpected{ failure::unwritable };
+					if (on_written) on_written({ reinterpret_cast<uint8_t const *>(buffer.data()), static_cast<size_t>(size) });
+
+					remaining -= static_cast<uint64_t>(size);
+					result.copied_bytes += static_cast<uint64_t>(size);
+					if (progress && !progress(result.copied_bytes, total)) return unexpected{ failure::aborted };
+				}
+
+				++result.runs;
+			}
+
+			result.chunks = chunks.size();
+			return result;
+		}
+
+		expected<statistics, failure> remux_movie(filesystem::path const &source, filesystem::path const &destination, span<uint32_t const> kept_tracks, function<bool(uint64_t const &, uint64_t const &)> const &progress, function<void(span<uint8_t const>)> const &on_written)
+		{
+			ifstream input{};
+			auto const layout{ open_layout(source, input) };
+			if (!layout) return unexpected{ layout.error() };
+
+			vector<bool> is_kept(layout->tracks.size());
+			vector<placed_chunk> chunks{};
+			for (size_t t{}; t < layout->tracks.size(); ++t)
+			{
+				is_kept[t] = ranges::contains(kept_tracks, layout->tracks[t].entry.id);
+				if (!is_kept[t]) continue;
+
+				for (size_t c{}; c < layout->tracks[t].chunks.size(); ++c)
+					chunks.push_back({ t, c, layout->tracks[t].chunks[c].offset, layout->tracks[t].chunks[c].size });
+			}
+			if (ranges::none_of(is_kept, identity{})) return unexpected{ failure::unsupported };
+
+			// The interleaving the source had is kept, which is also the order it can be read in fastest.
+			ranges::stable_sort(chunks, {}, &placed_chunk::offset);
+
+			auto const payload_size{ ranges::fold_left(chunks, uint64_t{}, [](uint64_t const &sum, placed_chunk const &chunk) { return sum + chunk.size; }) };
+			auto const media_header_size{ payload_size + 8 > numeric_limits<uint32_t>::max() ? uint64_t{ 16 } : uint64_t{ 8 } };
+
+			vector<uint8_t> const default_file_type{ 0, 0, 0, 24, 'f', 't', 'y', 'p', 'i', 's', 'o', 'm', 0, 0, 2, 0, 'i', 's', 'o', 'm', 'a', 'v', 'c', '1' };
+			auto const &file_type{ layout->file_type.empty() ? default_file_type : layout->file_type };
+
+			// The offsets take the same room whatever they are, so the header is measured with placeholders before it is filled in.
+			vector<vector<uint64_t>> offsets(layout->tracks.size());
+			for (size_t t{}; t < layout->tracks.size(); ++t) offsets[t].resize(layout->tracks[t].chunks.size());
+
+			auto const long_header_size{ make_movie_header(*layout, is_kept, true, offsets).size() };
+			auto const uses_long_offsets{ file_type.size() + long_header_size + media_header_size + payload_size > numeric_limits<uint32_t>::max() };
+			auto const header_size{ uses_long_offsets ? long_header_size : make_movie_header(*layout, is_kept, false, offsets).size() };
+
+			auto next{ file_type.size() + header_size + media_header_size };
+			for (auto const &chunk : chunks)
+			{
+				offsets[chunk.track_index][chunk.chunk_index] = next;
+				next += chunk.size;
+			}
+
+			auto const movie_header{ make_movie_header(*layout, is_kept, uses_long_offsets, offsets) };
+
+			vector<uint8_t> media_header{};
+			if (media_header_size == 16)
+			{
+				append_big_endian(media_header, 1, 4);
+				media_header.insert(media_header.end(), { 'm', 'd', 'a', 't' });
+				append_big_endian(media_header, payload_size + 16, 8);
+			}
+			else
+			{
+				append_big_endian(media_header, payload_size + 8, 4);
+				media_header.insert(media_header.end(), { 'm', 'd', 'a', 't' });
+			}
+
+			auto result{ [&]() -> expected<statistics, failure>
+			{
+				ofstream output{ destination, ios::binary | ios::trunc };
+				if (!output) return unexpected{ failure::unwritable };
+
+				for (auto const &part : { span<uint8_t const>{ file_type }, span<uint8_t const>{ movie_header }, span<uint8_t const>{ media_header } })
+				{
+					if (!output.write(reinterpret_cast<char const *>(part.data()), static_cast<streamsize>(part.size()))) return unexpected{ failure::unwritable };
+					if (on_written) on_written(part);
+				}
+
+				auto copied{ copy_chunks(input, output, chunks, payload_size, progress, on_written) };
+				if (!copied) return copied;
+
+				if (!output.flush()) return unexpected{ failure::unwritable };
+				copied->movie_header_size = movie_header.size();
+				return copied;
+			}() };
+
+			// Without all of its samples the header up front points at nothing, so there is no partial file worth keeping.
+			if (!result)
+			{
+				error_code ignored{};
+				filesystem::remove(destination, ignored);
+			}
+
+			return result;
+		}
+	}
+}
@@ -0,0 +1,86 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+export module mfop.remux;
+
+import std;
+
+namespace mfop
+{
+	namespace remux
+	{
+		export
+		{
+			struct sample
+			{
+				std::uint64_t offset;
+				std::uint32_t size;
+				std::uint64_t decode_time;
+				std::int64_t composition_offset;
+				bool is_sync;
+			};
+
+			struct track
+			{
+				std::uint32_t id;
+				// The handler type, such as vide or soun.
+				std::string handler;
+				// The first sample entry's type, such as avc1, hvc1 or mp4a.
+				std::string codec;
+				std::uint32_t timescale;
+				std::uint64_t duration;
+				std::uint32_t width;
+				std::uint32_t height;
+				std::vector<sample> samples;
+
+				bool is_video() const noexcept;
+				bool is_audio() const noexcept;
+			};
+
+			struct movie
+			{
+				std::uint32_t timescale;
+				std::uint64_t duration;
+				std::vector<track> tracks;
+			};
+
+			enum struct failure
+			{
+				// The source could not be opened or ends before its boxes do.
+				unreadable,
+				// Fragmented, or laid out in a way whose offsets cannot simply be moved, such as samples in other files.
+				unsupported,
+				unwritable,
+				aborted
+			};
+
+			struct statistics
+			{
+				std::uint64_t copied_bytes;
+				std::uint64_t chunks;
+				// Stretches of chunks that sat next to each other in the source, each copied in one go.
+				std::uint64_t runs;
+				std::uint64_t movie_header_size;
+			};
+
+			// Reads the sample tables of a progressive MP4; samples are listed in decode order.
+			std::expected<movie, failure> read_movie(std::filesystem::path const &path);
+
+			// Writes the kept tracks to destination with the movie header first and every chunk copied as it is, in the order the source had them.
+			// Only the chunk offsets are rewritten, so edit lists, sample descriptions and everything else in the header come through untouched.
+			// progress gets the bytes copied so far and the total, and stops the copy by returning false.
+			// on_written sees every byte of the destination once, in order, as it goes out.
+			std::expected<statistics, failure> remux_movie
+			(
+				std::filesystem::path const &source,
+				std::filesystem::path const &destination,
+				std::span<std::uint32_t const> kept_tracks,
+				std::function<bool(std::uint64_t const &, std::uint64_t const &)> const &progress,
+				std::function<void(std::span<std::uint8_t const>)> const &on_written = {}
+			);
+		}
+	}
+}
@@ -0,0 +1,260 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module mfop.ring;
+
+import std;
+
+using namespace std;
+
+namespace mfop
+{
+	namespace ring
+	{
+		// "MFOR", little-endian.
+		auto const constinit ring_magic{ 0x524f'464du };
+		auto const constinit ring_version{ 2u };
+
+		enum struct ring_state : uint32_t
+		{
+			running,
+			finished,
+			aborted
+		};
+
+		// Every field a consumer or the producer updates sits on its own cache line, so neither side keeps invalidating the other's.
+		struct alignas(64) consumer_seat
+		{
+			uint64_t acknowledged;
+			// When the consumer last read, from the steady clock, which every process on the machine shares.
+			uint64_t heartbeat;
+			// Who holds the seat, or 0 when it is free; a consumer dropped and replaced cannot free its successor's seat by mistake.
+			uint32_t ticket;
+		};
+
+		struct ring_header
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t slot_count;
+			uint32_t reserved;
+			uint64_t slot_capacity;
+			uint64_t slot_stride;
+			int32_t audio_channel_count;
+			int32_t audio_sampling_rate;
+			array<char, 128> y4m_header;
+
+			alignas(64) uint64_t published;
+			uint32_t state;
+			uint32_t tickets;
+
+			array<consumer_seat, max_consumers> seats;
+		};
+
+		struct alignas(64) slot_header
+		{
+			uint64_t sequence;
+			uint32_t type;
+			uint32_t size;
+			int64_t position;
+		};
+
+		auto get_slot_stride(size_t const &slot_capacity) noexcept
+		{
+			return (sizeof(slot_header) + slot_capacity + 63) / 64 * 64;
+		}
+
+		auto get_header(span<uint8_t> const &memory) noexcept
+		{
+			return reinterpret_cast<ring_header *>(memory.data());
+		}
+
+		auto get_slot(span<uint8_t> const &memory, uint64_t const &sequence) noexcept
+		{
+			auto const header{ get_header(memory) };
+			return reinterpret_cast<slot_header *>(memory.data() + sizeof(ring_header) + sequence % header->slot_count * header->slot_stride);
+		}
+
+		auto get_heartbeat() noexcept
+		{
+			return static_cast<uint64_t>(chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+		}
+
+		size_t get_mapping_size(uint32_t const &slot_count, size_t const &slot_capacity) noexcept
+		{
+			return sizeof(ring_header) + slot_count * get_slot_stride(slot_capacity);
+		}
+
+		void backoff::wait() noexcept
+		{
+			if (attempts >= 128)
+				this_thread::sleep_for(100us);
+			else if (attempts >= 64)
+				this_thread::yield();
+
+			++attempts;
+		}
+
+		void backoff::reset() noexcept
+		{
+			attempts = 0;
+		}
+
+		producer::producer(span<uint8_t> memory, uint32_t const &slot_count, size_t const &slot_capacity, stream_format const &format, chrono::milliseconds const &stale_after) noexcept :
+			memory{ memory },
+			stale_after{ stale_after },
+			next{},
+			acquired_size{}
+		{
+			auto const header{ get_header(memory) };
+			*header = {};
+			header->version = ring_version;
+			header->slot_count = slot_count;
+			header->slot_capacity = slot_capacity;
+			header->slot_stride = get_slot_stride(slot_capacity);
+			header->audio_channel_count = format.audio_channel_count;
+			header->audio_sampling_rate = format.audio_sampling_rate;
+			format.y4m_header.copy(header->y4m_header.data(), header->y4m_header.size() - 1);
+
+			// Consumers check the magic before anything else, so it goes in last.
+			atomic_ref{ header->magic }.store(ring_magic, memory_order_release);
+		}
+
+		uint32_t producer::get_consumer_count() const noexcept
+		{
+			auto const header{ get_header(memory) };
+			return static_cast<uint32_t>(ranges::count_if(header->seats, [](consumer_seat &seat) { return atomic_ref{ seat.ticket }.load(memory_order_acquire) != 0; }));
+		}
+
+		size_t producer::get_slot_capacity() const noexcept
+		{
+			return get_header(memory)->slot_capacity;
+		}
+
+		span<uint8_t> producer::try_acquire(size_t const &size) noexcept
+		{
+			auto const header{ get_header(memory) };
+
+			// Cutting the message down to the slot would publish something else than was asked for.
+			if (size > header->slot_capacity) [[unlikely]] return {};
+
+			for (auto &seat : header->seats)
+			{
+				auto ticket{ atomic_ref{ seat.ticket }.load(memory_order_acquire) };
+				if (!ticket || next - atomic_ref{ seat.acknowledged }.load(memory_order_acquire) < header->slot_count) continue;
+
+				// The heartbeat may be a hair newer than our clock reading; that is not stale.
+				auto const now{ get_heartbeat() }, heartbeat{ atomic_ref{ seat.heartbeat }.load(memory_order_acquire) };
+				if (stale_after.count() && now > heartbeat && now - heartbeat > static_cast<uint64_t>(stale_after.count()))
+				{
+					atomic_ref{ seat.ticket }.compare_exchange_strong(ticket, 0u, memory_order_acq_rel);
+					continue;
+				}
+
+				return {};
+			}
+
+			acquired_size = size;
+			return { reinterpret_cast<uint8_t *>(get_slot(memory, next) + 1), acquired_size };
+		}
+
+		void producer::publish(kind const &type, int64_t const &position) noexcept
+		{
+			auto const slot{ get_slot(memory, next) };
+			slot->sequence = next;
+			slot->type = static_cast<uint32_t>(type);
+			slot->size = static_cast<uint32_t>(acquired_size);
+			slot->position = position;
+
+			atomic_ref{ get_header(memory)->published }.store(++next, memory_order_release);
+		}
+
+		void producer::close(bool const &is_complete) noexcept
+		{
+			atomic_ref{ get_header(memory)->state }.store(static_cast<uint32_t>(is_complete ? ring_state::finished : ring_state::aborted), memory_order_release);
+		}
+
+		consumer::consumer(span<uint8_t> memory) noexcept :
+			memory{ memory },
+			seat{},
+			ticket{},
+			next{}
+		{
+			auto const header{ get_header(memory) };
+			if (memory.size() < sizeof(ring_header) || atomic_ref{ header->magic }.load(memory_order_acquire) != ring_magic || header->version != ring_version) return;
+
+			// Never 0, which marks a free seat.
+			ticket = atomic_ref{ header->tickets }.fetch_add(1, memory_order_relaxed) % numeric_limits<uint32_t>::max() + 1;
+
+			for (uint32_t i{}; i < max_consumers; ++i)
+			{
+				auto &taken{ header->seats[i] };
+				auto expected{ 0u };
+				if (!atomic_ref{ taken.ticket }.compare_exchange_strong(expected, ticket, memory_order_acq_rel)) continue;
+
+				next = atomic_ref{ header->published }.load(memory_order_acquire);
+				atomic_ref{ taken.heartbeat }.store(get_heartbeat(), memory_order_release);
+				atomic_ref{ taken.acknowledged }.store(next, memory_order_release);
+
+				// Until both are stored, the producer may still see the last holder's and drop the seat; another one is tried then.
+				if (atomic_ref{ taken.ticket }.load(memory_order_acquire) != ticket) continue;
+
+				seat = i;
+				return;
+			}
+		}
+
+		consumer::~consumer()
+		{
+			auto expected{ ticket };
+			if (seat) atomic_ref{ get_header(memory)->seats[*seat].ticket }.compare_exchange_strong(expected, 0u, memory_order_acq_rel);
+		}
+
+		bool consumer::is_dropped() const noexcept
+		{
+			return !seat || atomic_ref{ get_header(memory)->seats[*seat].ticket }.load(memory_order_acquire) != ticket;
+		}
+
+		stream_format consumer::get_format() const
+		{
+			auto const header{ get_header(memory) };
+			return { header->y4m_header.data(), header->audio_channel_count, header->audio_sampling_rate };
+		}
+
+		optional<message> consumer::try_read() noexcept
+		{
+			// Waiting for the producer counts as reading; only a consumer that stopped asking is stale.
+			atomic_ref{ get_header(memory)->seats[*seat].heartbeat }.store(get_heartbeat(), memory_order_release);
+
+			if (is_dropped() || next >= atomic_ref{ get_header(memory)->published }.load(memory_order_acquire)) return nullopt;
+
+			auto const slot{ get_slot(memory, next) };
+			return message{ static_cast<kind>(slot->type), slot->position, { reinterpret_cast<uint8_t const *>(slot + 1), slot->size } };
+		}
+
+		void consumer::acknowledge() noexcept
+		{
+			atomic_ref{ get_header(memory)->seats[*seat].acknowledged }.store(++next, memory_order_release);
+		}
+
+		bool consumer::is_finished() const noexcept
+		{
+			// The state is read first; once it is set, nothing more gets published.
+			auto const header{ get_header(memory) };
+			return is_dropped() || atomic_ref{ header->state }.load(memory_order_acquire) != static_cast<uint32_t>(ring_state::running) && next >= atomic_ref{ header->published }.load(memory_order_acquire);
+		}
+
+		bool consumer::is_aborted() const noexcept
+		{
+			return is_dropped() || atomic_ref{ get_header(memory)->state }.load(memory_order_acquire) == static_cast<uint32_t>(ring_state::aborted);
+		}
+
+		consumer::operator bool() const noexcept
+		{
+			return seat.has_value();
+		}
+	}
+}
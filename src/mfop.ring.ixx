@@ -0,0 +1,105 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+export module mfop.ring;
+
+import std;
+
+namespace mfop
+{
+	namespace ring
+	{
+		export
+		{
+			std::uint32_t constexpr max_consumers{ 4 };
+
+			enum struct kind : std::uint32_t
+			{
+				// One frame; from the frame server, a Y4M frame with its FRAME line, so appending them to the header gives a playable file.
+				video,
+				// 16-bit interleaved PCM; position is the index of its first sample.
+				audio,
+				// Anything else a protocol built on the ring needs to say; the frame server never sends it.
+				control
+			};
+
+			struct stream_format
+			{
+				std::string y4m_header;
+				std::int32_t audio_channel_count;
+				std::int32_t audio_sampling_rate;
+			};
+
+			struct message
+			{
+				kind type;
+				std::int64_t position;
+				std::span<std::uint8_t const> payload;
+			};
+
+			// Bytes to map for slot_count slots of up to slot_capacity bytes each.
+			std::size_t get_mapping_size(std::uint32_t const &slot_count, std::size_t const &slot_capacity) noexcept;
+
+			// Spins briefly, then yields, then sleeps; neither side can block on the other across processes otherwise.
+			struct backoff
+			{
+				void wait() noexcept;
+				void reset() noexcept;
+
+			private:
+				std::uint32_t attempts{};
+			};
+
+			// Writes into a mapping that nobody else is writing to; a slot is reused only once every attached consumer has acknowledged it.
+			struct producer
+			{
+				// A consumer that has not read for stale_after while holding the ring back is dropped, as one that crashed would be; zero waits for it forever.
+				producer(std::span<std::uint8_t> memory, std::uint32_t const &slot_count, std::size_t const &slot_capacity, stream_format const &format, std::chrono::milliseconds const &stale_after = {}) noexcept;
+
+				std::uint32_t get_consumer_count() const noexcept;
+				std::size_t get_slot_capacity() const noexcept;
+
+				// Empty while the slot to write would still be read by a slow consumer, and always for more than get_slot_capacity() bytes.
+				std::span<std::uint8_t> try_acquire(std::size_t const &size) noexcept;
+				void publish(kind const &type, std::int64_t const &position) noexcept;
+				void close(bool const &is_complete) noexcept;
+
+			private:
+				std::span<std::uint8_t> memory;
+				std::chrono::milliseconds stale_after;
+				std::uint64_t next;
+				std::size_t acquired_size;
+			};
+
+			struct consumer
+			{
+				// Takes a free consumer seat and starts at the next message to be published.
+				explicit consumer(std::span<std::uint8_t> memory) noexcept;
+				consumer(consumer const &) = delete;
+				~consumer();
+
+				stream_format get_format() const;
+
+				std::optional<message> try_read() noexcept;
+				// Hands the slot of the last read message back to the producer.
+				void acknowledge() noexcept;
+
+				// Both also hold once the producer has dropped this consumer for not reading in time.
+				bool is_finished() const noexcept;
+				bool is_aborted() const noexcept;
+				explicit operator bool() const noexcept;
+
+			private:
+				std::span<std::uint8_t> memory;
+				std::optional<std::uint32_t> seat;
+				std::uint32_t ticket;
+				std::uint64_t next;
+
+				bool is_dropped() const noexcept;
+			};
+		}
+	}
+}
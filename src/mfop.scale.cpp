@@ -0,0 +1,216 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#include <immintrin.h>
+
+module mfop.scale;
+
+import std;
+
+using namespace std;
+
+namespace mfop
+{
+	namespace scale
+	{
+		auto constexpr get_support(filter const &kind) noexcept
+		{
+			switch (kind)
+			{
+			case filter::bilinear: return 1.0;
+			case filter::bicubic: return 2.0;
+			default: return 3.0;
+			}
+		}
+
+		auto get_weight(filter const &kind, double const &distance) noexcept
+		{
+			auto const x{ abs(distance) };
+
+			switch (kind)
+			{
+			case filter::bilinear:
+				return max(1.0 - x, 0.0);
+			case filter::bicubic:
+				// Catmull-Rom, the usual choice when sharpness matters more than ringing.
+				if (x < 1.0) return (1.5 * x - 2.5) * x * x + 1.0;
+				if (x < 2.0) return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+				return 0.0;
+			default:
+				if (x < 1e-9) return 1.0;
+				if (x >= 3.0) return 0.0;
+				return 3.0 * sin(numbers::pi * x) * sin(numbers::pi * x / 3.0) / (numbers::pi * numbers::pi * x * x);
+			}
+		}
+
+		auto make_axis(int32_t const &source, int32_t const &destination, int32_t const &channels, filter const &kind)
+		{
+			auto const ratio{ static_cast<double>(source) / destination };
+			// Downscaling stretches the kernel over the source so it also acts as the anti-aliasing filter.
+			auto const stretch{ max(ratio, 1.0) };
+			auto const support{ get_support(kind) * stretch };
+
+			vector<vector<pair<int32_t, float>>> taps(destination);
+			for (auto i{ 0 }; i < destination; ++i)
+			{
+				auto const center{ (i + 0.5) * ratio - 0.5 };
+				auto const first{ static_cast<int32_t>(floor(center - support)) + 1 }, last{ static_cast<int32_t>(floor(center + support)) };
+
+				auto sum{ 0.0 };
+				vector<double> weights{};
+				for (auto j{ first }; j <= last; ++j)
+					sum += weights.emplace_back(get_weight(kind, (j - center) / stretch));
+
+				for (auto j{ first }; j <= last; ++j)
+					taps[i].emplace_back(clamp(j, 0, source - 1), static_cast<float>(weights[j - first] / sum));
+			}
+
+			axis result{};
+			result.tap_count = static_cast<int32_t>(ranges::max(taps | views::transform([](auto const &list) { return list.size(); })));
+			result.length = destination * channels;
+			result.indices.resize(static_cast<size_t>(result.tap_count) * result.length);
+			result.weights.resize(static_cast<size_t>(result.tap_count) * result.length);
+
+			for (auto i{ 0 }; i < destination; ++i)
+				for (auto k{ 0 }; k < result.tap_count; ++k)
+				{
+					// Short tap lists are padded with a zero weight on a valid index so every output runs the same loop.
+					auto const [index, weight] { k < static_cast<int32_t>(taps[i].size()) ? taps[i][k] : pair{ taps[i].back().first, 0.0f } };
+					for (auto c{ 0 }; c < channels; ++c)
+					{
+						auto const position{ static_cast<size_t>(k) * result.length + i * channels + c };
+						result.indices[position] = index * channels + c;
+						result.weights[position] = weight;
+					}
+				}
+
+			return result;
+		}
+
+		auto load_8(uint8_t const source[]) noexcept
+		{
+			return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const *>(source))));
+		}
+
+		auto store_8(uint8_t destination[], __m256 const &value) noexcept
+		{
+			auto const integers{ _mm256_cvtps_epi32(value) };
+			auto const words{ _mm_packus_epi32(_mm256_castsi256_si128(integers), _mm256_extracti128_si256(integers, 1)) };
+			_mm_storel_epi64(reinterpret_cast<__m128i *>(destination), _mm_packus_epi16(words, words));
+		}
+
+		plane_scaler::plane_scaler(pair<int32_t, int32_t> const &source, pair<int32_t, int32_t> const &destination, int32_t const &channels, filter const &kind) :
+			horizontal{ make_axis(source.first, destination.first, channels, kind) },
+			vertical{ make_axis(source.second, destination.second, 1, kind) },
+			source_length{ source.first * channels }
+		{
+		}
+
+		void plane_scaler::scale(uint8_t const source[], ptrdiff_t const &source_stride, uint8_t destination[], ptrdiff_t const &destination_stride, pair<int32_t, int32_t> const &rows) const
+		{
+			vector<float> row(source_length);
+
+			for (auto y{ rows.first }; y < min(rows.second, vertical.length); ++y)
+			{
+				// Vertical first: it runs on contiguous source rows, and leaves half as many outputs for the gathering horizontal pass when shrinking.
+				auto x{ 0 };
+				for (; x + 8 <= source_length; x += 8)
+				{
+					auto sum{ _mm256_setzero_ps() };
+					for (auto k{ 0 }; k < vertical.tap_count; ++k)
+					{
+						auto const position{ static_cast<size_t>(k) * vertical.length + y };
+						auto const line{ source + vertical.indices[position] * source_stride };
+						sum = _mm256_fmadd_ps(load_8(line + x), _mm256_set1_ps(vertical.weights[position]), sum);
+					}
+					_mm256_storeu_ps(row.data() + x, sum);
+				}
+				for (; x < source_length; ++x)
+				{
+					auto sum{ 0.0f };
+					for (auto k{ 0 }; k < vertical.tap_count; ++k)
+					{
+						auto const position{ static_cast<size_t>(k) * vertical.length + y };
+						sum += source[vertical.indices[position] * source_stride + x] * vertical.weights[position];
+					}
+					row[x] = sum;
+				}
+
+				auto const output{ destination + y * destination_stride };
+
+				x = 0;
+				for (; x + 8 <= horizontal.length; x += 8)
+				{
+					auto sum{ _mm256_setzero_ps() };
+					for (auto k{ 0 }; k < horizontal.tap_count; ++k)
+					{
+						auto const position{ static_cast<size_t>(k) * horizontal.length + x };
+						auto const indices{ _mm256_loadu_si256(reinterpret_cast<__m256i const *>(horizontal.indices.data() + position)) };
+						sum = _mm256_fmadd_ps(_mm256_i32gather_ps(row.data(), indices, 4), _mm256_loadu_ps(horizontal.weights.data() + position), sum);
+					}
+					// Saturating packs clamp the overshoot of the negative lobes.
+					store_8(output + x, sum);
+				}
+				for (; x < horizontal.length; ++x)
+				{
+					auto sum{ 0.0f };
+					for (auto k{ 0 }; k < horizontal.tap_count; ++k)
+					{
+						auto const position{ static_cast<size_t>(k) * horizontal.length + x };
+						sum += row[horizontal.indices[position]] * horizontal.weights[position];
+					}
+					output[x] = static_cast<uint8_t>(clamp(nearbyint(sum), 0.0f, 255.0f));
+				}
+			}
+		}
+
+		int32_t plane_scaler::get_height() const noexcept
+		{
+			return vertical.length;
+		}
+
+		frame_scaler::frame_scaler(pair<int32_t, int32_t> const &source, pair<int32_t, int32_t> const &destination, filter const &kind, worker &&run_worker) :
+			source{ source },
+			destination{ destination },
+			luma{ source, destination, 1, kind },
+			chroma{ { source.first / 2, source.second / 2 }, { destination.first / 2, destination.second / 2 }, 2, kind },
+			run_worker{ move(run_worker) }
+		{
+		}
+
+		void frame_scaler::scale(uint8_t const source_image[], ptrdiff_t const &source_stride, uint8_t destination_image[], ptrdiff_t const &destination_stride) const
+		{
+			auto const source_chroma{ source_image + source_stride * source.second };
+			auto const destination_chroma{ destination_image + destination_stride * destination.second };
+			auto const middle{ luma.get_height() / 2 };
+
+			auto const start{ [this](function<void()> &&task)
+			{
+				return async(launch::async, [this, task = move(task)] { run_worker ? run_worker(task) : task(); });
+			} };
+
+			// The gathering horizontal pass is the slow part, so the frame is split into three similar loads for the thread pool.
+			auto upper{ start([&] { luma.scale(source_image, source_stride, destination_image, destination_stride, { 0, middle }); }) };
+			auto planar{ start([&] { chroma.scale(source_chroma, source_stride, destination_chroma, destination_stride, { 0, chroma.get_height() }); }) };
+			luma.scale(source_image, source_stride, destination_image, destination_stride, { middle, luma.get_height() });
+
+			upper.get();
+			planar.get();
+		}
+
+		pair<int32_t, int32_t> frame_scaler::get_source() const noexcept
+		{
+			return source;
+		}
+
+		pair<int32_t, int32_t> frame_scaler::get_destination() const noexcept
+		{
+			return destination;
+		}
+	}
+}
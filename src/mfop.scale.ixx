@@ -0,0 +1,72 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+export module mfop.scale;
+
+import std;
+
+namespace mfop
+{
+	namespace scale
+	{
+		export
+		{
+			enum struct filter : std::int32_t
+			{
+				bilinear,
+				bicubic,
+				lanczos3
+			};
+
+			// Taps for one direction, stored tap-major so a run of outputs reads each tap contiguously.
+			struct axis
+			{
+				std::int32_t tap_count;
+				std::int32_t length;
+				std::vector<std::int32_t> indices;
+				std::vector<float> weights;
+			};
+
+			// Runs a share of a frame on a helper thread, so the caller can give that thread its own priority and affinity first.
+			using worker = std::function<void(std::function<void()> const &)>;
+
+			// Separable resampler for one interleaved 8-bit plane; `channels` is 1 for luma and 2 for NV12 chroma.
+			struct plane_scaler
+			{
+				plane_scaler(std::pair<std::int32_t, std::int32_t> const &source, std::pair<std::int32_t, std::int32_t> const &destination, std::int32_t const &channels, filter const &kind);
+
+				// Only destination rows in [rows.first, rows.second) are written, so disjoint ranges can run concurrently.
+				void scale(std::uint8_t const source[], std::ptrdiff_t const &source_stride, std::uint8_t destination[], std::ptrdiff_t const &destination_stride, std::pair<std::int32_t, std::int32_t> const &rows) const;
+
+				std::int32_t get_height() const noexcept;
+
+			private:
+				axis horizontal;
+				axis vertical;
+				std::int32_t source_length;
+			};
+
+			// Both planes of an NV12 frame; sizes must be even.
+			// Two thirds of each frame go to helper threads, each run through run_worker when there is one.
+			struct frame_scaler
+			{
+				frame_scaler(std::pair<std::int32_t, std::int32_t> const &source, std::pair<std::int32_t, std::int32_t> const &destination, filter const &kind, worker &&run_worker = {});
+
+				void scale(std::uint8_t const source[], std::ptrdiff_t const &source_stride, std::uint8_t destination[], std::ptrdiff_t const &destination_stride) const;
+
+				std::pair<std::int32_t, std::int32_t> get_source() const noexcept;
+				std::pair<std::int32_t, std::int32_t> get_destination() const noexcept;
+
+			private:
+				std::pair<std::int32_t, std::int32_t> source;
+				std::pair<std::int32_t, std::int32_t> destination;
+				plane_scaler luma;
+				plane_scaler chroma;
+				worker run_worker;
+			};
+		}
+	}
+}
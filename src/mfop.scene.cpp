@@ -0,0 +1,163 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#include <immintrin.h>
+
+module mfop.scene;
+
+import std;
+
+using namespace std;
+
+namespace mfop
+{
+	namespace scene
+	{
+		auto const constinit row_step{ 4 };
+		// Cuts closer together than this are flashes or strobing rather than new scenes.
+		auto const constinit min_length{ 4 };
+		// A cut has to stand this far above the recent differences, so fast motion alone does not count.
+		auto const constinit contrast{ 2.5 };
+		auto const constinit min_histogram_distance{ 0.15 };
+
+		// Read from 8 - n on, the first n words keep their Y and the rest are cleared.
+		auto const constinit tail_masks{ to_array<uint16_t>({ 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0, 0, 0, 0, 0, 0, 0, 0 }) };
+
+		thumbnail make_thumbnail(uint8_t const yuy2[], int32_t const &width, int32_t const &height) noexcept
+		{
+			thumbnail result{};
+			array<uint32_t, thumbnail_width * thumbnail_height> sums{};
+			array<uint32_t, thumbnail_width * thumbnail_height> counts{};
+
+			auto const stride{ static_cast<ptrdiff_t>(width) * 2 };
+			// Leaves each Y in the low byte of its word.
+			auto const luma_mask{ _mm_set1_epi16(0x00ff) };
+
+			for (auto y{ 0 }; y < height; y += row_step)
+			{
+				auto const row{ yuy2 + stride * y };
+				auto const cell_row{ static_cast<size_t>(y) * thumbnail_height / height * thumbnail_width };
+
+				// Cells are whole runs of columns, so each one is summed in a single pass over the row.
+				for (auto cell{ 0 }; cell < thumbnail_width; ++cell)
+				{
+					auto const begin{ static_cast<int32_t>(static_cast<int64_t>(cell) * width / thumbnail_width) };
+					auto const end{ static_cast<int32_t>(static_cast<int64_t>(cell + 1) * width / thumbnail_width) };
+
+					// PSADBW against zero adds the eight Y of each block exactly, once the chroma is masked off.
+					auto vector_sum{ _mm_setzero_si128() };
+					auto x{ begin };
+					for (; x + 8 <= end; x += 8)
+						vector_sum = _mm_add_epi64(vector_sum, _mm_sad_epu8(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<__m128i const *>(row + x * 2)), luma_mask), _mm_setzero_si128()));
+
+					// The rest of the cell is one more block, with the next cell's pixels masked off too; only at the end of the row would that read past it.
+					if (x < end && x + 8 <= width)
+					{
+						auto const tail_mask{ _mm_loadu_si128(reinterpret_cast<__m128i const *>(tail_masks.data() + 8 - (end - x))) };
+						vector_sum = _mm_add_epi64(vector_sum, _mm_sad_epu8(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<__m128i const *>(row + x * 2)), tail_mask), _mm_setzero_si128()));
+						x = end;
+					}
+
+					auto sum{ static_cast<uint32_t>(_mm_cvtsi128_si32(vector_sum) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(vector_sum, vector_sum))) };
+					for (; x < end; ++x)
+						sum += row[x * 2];
+
+					sums[cell_row + cell] += sum;
+					counts[cell_row + cell] += static_cast<uint32_t>(end - begin);
+				}
+			}
+
+			for (size_t i{}; i < sums.size(); ++i)
+			{
+				result.luma[i] = static_cast<uint8_t>(counts[i] ? sums[i] / counts[i] : 0);
+				++result.histogram[result.luma[i] * histogram_bins / 256];
+			}
+
+			return result;
+		}
+
+		double get_difference(thumbnail const &a, thumbnail const &b) noexcept
+		{
+			static_assert(thumbnail_width * thumbnail_height % 16 == 0);
+
+			// PSADBW sums 8 absolute differences into each half of the register.
+			auto total{ _mm_setzero_si128() };
+			for (size_t i{}; i < a.luma.size(); i += 16)
+				total = _mm_add_epi64(total, _mm_sad_epu8(_mm_load_si128(reinterpret_cast<__m128i const *>(a.luma.data() + i)), _mm_load_si128(reinterpret_cast<__m128i const *>(b.luma.data() + i))));
+
+			auto const sum{ static_cast<uint64_t>(_mm_cvtsi128_si64(total)) + static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(total, total))) };
+			return static_cast<double>(sum) / a.luma.size();
+		}
+
+		double get_histogram_distance(thumbnail const &a, thumbnail const &b) noexcept
+		{
+			uint32_t distance{};
+			for (auto i{ 0 }; i < histogram_bins; ++i)
+				distance += a.histogram[i] > b.histogram[i] ? a.histogram[i] - b.histogram[i] : b.histogram[i] - a.histogram[i];
+
+			return distance / (2.0 * a.luma.size());
+		}
+
+		gop_planner::gop_planner(int32_t const &max_length, double const &threshold) noexcept :
+			max_length{ max(max_length, 0) },
+			threshold{ threshold },
+			previous{},
+			recent{},
+			frames{},
+			since_boundary{},
+			scene_cuts{},
+			length_cuts{}
+		{
+		}
+
+		boundary gop_planner::next(thumbnail const &frame) noexcept
+		{
+			auto result{ boundary::none };
+
+			// The first frame is a keyframe whatever we say.
+			if (previous)
+			{
+				auto const difference{ get_difference(*previous, frame) };
+				auto const history{ min<size_t>(frames - 1, recent.size()) };
+				auto const recent_mean{ history ? accumulate(recent.begin(), recent.begin() + history, 0.0) / history : 0.0 };
+
+				if (since_boundary >= min_length && difference >= threshold && difference >= recent_mean * contrast && get_histogram_distance(*previous, frame) >= min_histogram_distance)
+					result = boundary::scene_cut;
+				else if (max_length && since_boundary >= max_length)
+					result = boundary::max_length;
+
+				recent[(frames - 1) % recent.size()] = difference;
+			}
+
+			if (result == boundary::scene_cut) ++scene_cuts;
+			if (result == boundary::max_length) ++length_cuts;
+			if (result != boundary::none || !previous) since_boundary = 0;
+
+			previous = frame;
+			++frames;
+			++since_boundary;
+
+			return result;
+		}
+
+		int32_t gop_planner::get_scene_cuts() const noexcept
+		{
+			return scene_cuts;
+		}
+
+		int32_t gop_planner::get_length_cuts() const noexcept
+		{
+			return length_cuts;
+		}
+
+		double gop_planner::get_mean_length() const noexcept
+		{
+			return static_cast<double>(frames) / (1 + scene_cuts + length_cuts);
+		}
+	}
+}
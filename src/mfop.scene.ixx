@@ -0,0 +1,68 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+export module mfop.scene;
+
+import std;
+
+namespace mfop
+{
+	namespace scene
+	{
+		export
+		{
+			std::int32_t constexpr thumbnail_width{ 64 };
+			std::int32_t constexpr thumbnail_height{ 36 };
+			std::int32_t constexpr histogram_bins{ 16 };
+
+			// Luma averaged down to a fixed grid, small enough to compare every frame against the last.
+			struct thumbnail
+			{
+				alignas(16) std::array<std::uint8_t, thumbnail_width * thumbnail_height> luma;
+				std::array<std::uint32_t, histogram_bins> histogram;
+			};
+
+			// From a packed YUY2 frame as the host hands it over; only every fourth row is read.
+			thumbnail make_thumbnail(std::uint8_t const yuy2[], std::int32_t const &width, std::int32_t const &height) noexcept;
+
+			// Mean absolute luma difference, from 0 to 255.
+			double get_difference(thumbnail const &a, thumbnail const &b) noexcept;
+			// Share of the pixels whose brightness bin changed, from 0 to 1; camera motion moves pixels but hardly changes this.
+			double get_histogram_distance(thumbnail const &a, thumbnail const &b) noexcept;
+
+			enum struct boundary : std::uint32_t
+			{
+				none,
+				scene_cut,
+				max_length
+			};
+
+			// Decides, frame by frame and in order, where a new GOP should start.
+			struct gop_planner
+			{
+				// max_length is in frames, and 0 leaves periodic keyframes to the encoder; threshold is a get_difference() value.
+				gop_planner(std::int32_t const &max_length, double const &threshold) noexcept;
+
+				boundary next(thumbnail const &frame) noexcept;
+
+				std::int32_t get_scene_cuts() const noexcept;
+				std::int32_t get_length_cuts() const noexcept;
+				double get_mean_length() const noexcept;
+
+			private:
+				std::int32_t max_length;
+				double threshold;
+				std::optional<thumbnail> previous;
+				// Recent differences, to tell a cut apart from a scene that is simply busy.
+				std::array<double, 8> recent;
+				std::int32_t frames;
+				std::int32_t since_boundary;
+				std::int32_t scene_cuts;
+				std::int32_t length_cuts;
+			};
+		}
+	}
+}
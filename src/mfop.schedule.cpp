@@ -0,0 +1,119 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#define STRICT
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+
+module mfop.schedule;
+
+import std;
+
+using namespace std;
+
+namespace mfop
+{
+	namespace schedule
+	{
+		auto get_thread_priority(priority const &level) noexcept
+		{
+			switch (level)
+			{
+			case priority::below_normal:
+				return THREAD_PRIORITY_BELOW_NORMAL;
+			case priority::lowest:
+				return THREAD_PRIORITY_LOWEST;
+			case priority::idle:
+				return THREAD_PRIORITY_IDLE;
+			default:
+				return THREAD_PRIORITY_NORMAL;
+			}
+		}
+
+		auto get_process_time() noexcept
+		{
+			FILETIME creation{}, exit{}, kernel{}, user{};
+			GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+
+			auto const to_100ns{ [](FILETIME const &time) { return static_cast<uint64_t>(time.dwHighDateTime) << 32 | time.dwLowDateTime; } };
+			return to_100ns(kernel) + to_100ns(user);
+		}
+
+		uint32_t cpu_budget::get_encoder_threads(uint32_t const &conversion_threads, uint32_t const &encoder_count) const noexcept
+		{
+			if (!threads) return 0;
+
+			// An encoder always gets at least one, even when that goes over; stopping altogether is not an option.
+			return max((threads - min(threads, conversion_threads)) / max(encoder_count, 1u), 1u);
+		}
+
+		cpu_budget make_cpu_budget(uint32_t const &cores, uint32_t const &percent, uint32_t const &priority_level, bool const &is_pinned) noexcept
+		{
+			DWORD_PTR process_affinity{}, system_affinity{};
+			GetProcessAffinityMask(GetCurrentProcess(), &process_affinity, &system_affinity);
+
+			auto const available{ static_cast<uint32_t>(popcount(static_cast<uint64_t>(process_affinity))) };
+			auto threads{ available };
+			if (cores) threads = min(threads, cores);
+			if (percent && percent < 100) threads = min(threads, max((available * percent + 99) / 100, 1u));
+
+			cpu_budget budget{ threads < available ? threads : 0, available, static_cast<priority>(min(priority_level, to_underlying(priority::idle))), 0 };
+			if (!is_pinned || !budget.threads) return budget;
+
+			// Highest first, since the host tends to land on the lowest-numbered processors.
+			for (auto bit{ 63 }, left{ static_cast<int32_t>(budget.threads) }; bit >= 0 && left; --bit)
+				if (process_affinity >> bit & 1)
+				{
+					budget.affinity |= uint64_t{ 1 } << bit;
+					--left;
+				}
+
+			return budget;
+		}
+
+		thread_scope::thread_scope(cpu_budget const &budget) noexcept :
+			previous_priority{ GetThreadPriority(GetCurrentThread()) },
+			previous_affinity{}
+		{
+			if (budget.priority != priority::unchanged)
+				SetThreadPriority(GetCurrentThread(), get_thread_priority(budget.priority));
+			if (budget.affinity)
+				previous_affinity = SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(budget.affinity));
+		}
+
+		thread_scope::~thread_scope()
+		{
+			// Pool threads are handed to others afterwards, so they must not keep what this export asked for.
+			SetThreadPriority(GetCurrentThread(), previous_priority);
+			if (previous_affinity)
+				SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(previous_affinity));
+		}
+
+		void apply_to_process(cpu_budget const &budget) noexcept
+		{
+			// Unlike thread_scope, this also reaches the threads the encoder starts on its own.
+			if (budget.priority != priority::unchanged)
+				SetPriorityClass(GetCurrentProcess(), budget.priority == priority::below_normal ? BELOW_NORMAL_PRIORITY_CLASS : IDLE_PRIORITY_CLASS);
+			if (budget.affinity)
+				SetProcessAffinityMask(GetCurrentProcess(), static_cast<DWORD_PTR>(budget.affinity));
+		}
+
+		utilization_meter::utilization_meter() noexcept :
+			begin_time{ get_process_time() },
+			begin{ chrono::steady_clock::now() }
+		{
+		}
+
+		double utilization_meter::get_busy_processors() const noexcept
+		{
+			auto const elapsed{ chrono::duration_cast<chrono::duration<double, ratio<1, 10'000'000>>>(chrono::steady_clock::now() - begin).count() };
+			return elapsed > 0 ? (get_process_time() - begin_time) / elapsed : 0.0;
+		}
+	}
+}
@@ -0,0 +1,71 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+export module mfop.schedule;
+
+import std;
+
+namespace mfop
+{
+	namespace schedule
+	{
+		export
+		{
+			enum struct priority : std::uint32_t
+			{
+				unchanged,
+				below_normal,
+				lowest,
+				idle
+			};
+
+			// What an export may take from the machine, shared by the encoder and the threads we start ourselves.
+			struct cpu_budget
+			{
+				// Logical processors to keep busy at most; 0 when the export is not limited.
+				std::uint32_t threads;
+				std::uint32_t available;
+				schedule::priority priority;
+				// Processors our threads are kept on; 0 when they may run anywhere.
+				std::uint64_t affinity;
+
+				// What is left to each of encoder_count encoders once conversion_threads of ours are counted; 0 lets the encoder decide.
+				std::uint32_t get_encoder_threads(std::uint32_t const &conversion_threads, std::uint32_t const &encoder_count = 1) const noexcept;
+			};
+
+			// cores and percent both cap the budget, whichever is lower; pinning takes the highest-numbered processors and leaves the rest to the host.
+			cpu_budget make_cpu_budget(std::uint32_t const &cores, std::uint32_t const &percent, std::uint32_t const &priority_level, bool const &is_pinned) noexcept;
+
+			// The calling thread takes the priority and affinity of the budget until this goes out of scope.
+			struct thread_scope
+			{
+				explicit thread_scope(cpu_budget const &budget) noexcept;
+				thread_scope(thread_scope const &) = delete;
+				~thread_scope();
+
+			private:
+				std::int32_t previous_priority;
+				std::uint64_t previous_affinity;
+			};
+
+			// Applied to the whole process, which is only right for one that does nothing but encode.
+			void apply_to_process(cpu_budget const &budget) noexcept;
+
+			// Processor time of the whole process, host rendering included, against the wall clock.
+			struct utilization_meter
+			{
+				utilization_meter() noexcept;
+
+				// Logical processors kept busy on average since construction.
+				double get_busy_processors() const noexcept;
+
+			private:
+				std::uint64_t begin_time;
+				std::chrono::steady_clock::time_point begin;
+			};
+		}
+	}
+}
@@ -0,0 +1,135 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module mfop.segment;
+
+import std;
+
+using namespace std;
+
+namespace mfop
+{
+	namespace segment
+	{
+		auto get_now() noexcept
+		{
+			return chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch()).count();
+		}
+
+		cache::cache(filesystem::path &&directory, uint64_t const &size_limit) :
+			directory{ move(directory) },
+			size_limit{ size_limit },
+			entries{},
+			used{},
+			current{}
+		{
+			error_code ignored{};
+			filesystem::create_directories(this->directory, ignored);
+
+			ifstream index{ this->directory / L"index.tsv" };
+			for (string line{}; getline(index, line);)
+			{
+				uint64_t key{};
+				entry value{};
+				istringstream fields{ line };
+				if (!(fields >> hex >> key >> dec >> value.size >> value.last_used)) continue;
+
+				// Entries whose file was deleted behind our back are simply forgotten.
+				if (filesystem::file_size(get_path(key), ignored) == value.size)
+					entries.emplace(key, value);
+			}
+		}
+
+		filesystem::path cache::get_path(uint64_t const &key) const
+		{
+			return directory / format(L"{:016x}.mp4", key);
+		}
+
+		optional<filesystem::path> cache::find(uint64_t const &key)
+		{
+			auto const found{ entries.find(key) };
+			if (found == entries.end())
+			{
+				++current.misses;
+				return nullopt;
+			}
+
+			found->second.last_used = get_now();
+			used.insert(key);
+
+			++current.hits;
+			current.reused_bytes += found->second.size;
+
+			return get_path(key);
+		}
+
+		filesystem::path cache::reserve(uint64_t const &key) const
+		{
+			return directory / format(L"{:016x}.partial.mp4", key);
+		}
+
+		optional<filesystem::path> cache::commit(uint64_t const &key)
+		{
+			error_code error{};
+
+			auto const path{ get_path(key) };
+			filesystem::rename(reserve(key), path, error);
+			if (error) return nullopt;
+
+			auto const size{ filesystem::file_size(path, error) };
+			if (error) return nullopt;
+
+			entries.insert_or_assign(key, entry{ size, get_now() });
+			used.insert(key);
+
+			return path;
+		}
+
+		void cache::save()
+		{
+			auto total_size{ ranges::fold_left(entries | views::values | views::transform(&entry::size), uint64_t{}, plus{}) };
+
+			vector<pair<int64_t, uint64_t>> by_age{};
+			for (auto const &[key, value] : entries)
+				if (!used.contains(key))
+					by_age.emplace_back(value.last_used, key);
+			ranges::sort(by_age);
+
+			// What this export used is never evicted, even when it alone exceeds the limit.
+			for (auto const &[last_used, key] : by_age)
+			{
+				if (total_size <= size_limit) break;
+
+				error_code ignored{};
+				filesystem::remove(get_path(key), ignored);
+
+				auto const size{ entries.at(key).size };
+				total_size -= size;
+				current.evicted_bytes += size;
+				entries.erase(key);
+			}
+
+			auto const index_path{ directory / L"index.tsv" };
+			auto temporary_path{ index_path };
+			temporary_path += L".tmp";
+
+			{
+				ofstream index{ temporary_path, ios::trunc };
+				for (auto const &[key, value] : entries)
+					index << format("{:016x}\t{}\t{}\n", key, value.size, value.last_used);
+				if (!index) return;
+			}
+
+			error_code ignored{};
+			filesystem::rename(temporary_path, index_path, ignored);
+		}
+
+		statistics const &cache::get_statistics() const noexcept
+		{
+			return current;
+		}
+	}
+}
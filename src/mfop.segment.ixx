@@ -0,0 +1,54 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+export module mfop.segment;
+
+import std;
+
+namespace mfop
+{
+	namespace segment
+	{
+		export
+		{
+			struct statistics
+			{
+				std::uint32_t hits;
+				std::uint32_t misses;
+				std::uint64_t reused_bytes;
+				std::uint64_t evicted_bytes;
+			};
+
+			// Encoded segments keyed by the fingerprint of what went into them, with an index.tsv that tracks size and last use.
+			struct cache
+			{
+				cache(std::filesystem::path &&directory, std::uint64_t const &size_limit);
+
+				std::optional<std::filesystem::path> find(std::uint64_t const &key);
+				std::filesystem::path reserve(std::uint64_t const &key) const;
+				std::optional<std::filesystem::path> commit(std::uint64_t const &key);
+				void save();
+
+				statistics const &get_statistics() const noexcept;
+
+			private:
+				struct entry
+				{
+					std::uint64_t size;
+					std::int64_t last_used;
+				};
+
+				std::filesystem::path directory;
+				std::uint64_t size_limit;
+				std::map<std::uint64_t, entry> entries;
+				std::set<std::uint64_t> used;
+				statistics current;
+
+				std::filesystem::path get_path(std::uint64_t const &key) const;
+			};
+		}
+	}
+}
@@ -0,0 +1,156 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#define STRICT
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <wil/com.h>
+#include <d3d11_4.h>
+#include <mfapi.h>
+#include "aviutl2_sdk/logger2.h"
+
+#pragma comment(lib, "Mfplat")
+#pragma comment(lib, "d3d11")
+
+#define UNEXPECT_IF_FAILED(hr) if (HRESULT const __mfop_hr{ hr }) if (FAILED(__mfop_hr)) [[unlikely]] return std::unexpected{ mfop::error{ __mfop_hr, #hr } }
+
+module mfop.session;
+
+import std;
+
+using namespace std;
+using namespace wil;
+
+namespace mfop
+{
+	namespace session
+	{
+		using milliseconds_t = chrono::duration<double, milli>;
+
+		struct cache
+		{
+			mutex lock;
+			bool is_started;
+			com_ptr_nothrow<ID3D11Device> device;
+			com_ptr_nothrow<IMFDXGIDeviceManager> dxgi_device_manager;
+			uint32_t reset_token;
+			milliseconds_t cold_startup_time;
+			milliseconds_t cold_device_time;
+		};
+
+		static cache current{};
+
+		expected<com_ptr_nothrow<ID3D11Device>, error> make_d3d11_device() noexcept
+		{
+			static auto const constinit d3d_feature_levels{ to_array(
+			{
+				D3D_FEATURE_LEVEL_11_1,
+				D3D_FEATURE_LEVEL_11_0,
+				D3D_FEATURE_LEVEL_10_1,
+				D3D_FEATURE_LEVEL_10_0,
+				D3D_FEATURE_LEVEL_9_3,
+				D3D_FEATURE_LEVEL_9_2,
+				D3D_FEATURE_LEVEL_9_1
+			}) };
+
+			com_ptr_nothrow<ID3D11Device> directx_device{};
+
+			UNEXPECT_IF_FAILED(D3D11CreateDevice
+			(
+				nullptr,
+				D3D_DRIVER_TYPE_HARDWARE,
+				nullptr,
+				D3D11_CREATE_DEVICE_VIDEO_SUPPORT,
+				d3d_feature_levels.data(),
+				static_cast<uint32_t>(d3d_feature_levels.size()),
+				D3D11_SDK_VERSION,
+				&directx_device,
+				nullptr,
+				nullptr
+			));
+
+			// The device is shared by every writer of the session, so its immediate context has to be guarded.
+			if (auto const multithread{ directx_device.try_query<ID3D11Multithread>() })
+				multithread->SetMultithreadProtected(true);
+
+			return directx_device;
+		}
+
+		expected<HRESULT, error> startup(LOG_HANDLE &logger) noexcept
+		{
+			scoped_lock const guard{ current.lock };
+
+			if (current.is_started)
+			{
+				logger.verbose(&logger, format(L"Reusing Media Foundation session ({:.2f} ms saved).", current.cold_startup_time.count()).c_str());
+				return S_OK;
+			}
+
+			auto const begin{ chrono::steady_clock::now() };
+			UNEXPECT_IF_FAILED(MFStartup(MF_VERSION, MFSTARTUP_FULL));
+			current.cold_startup_time = chrono::steady_clock::now() - begin;
+			current.is_started = true;
+
+			logger.info(&logger, format(L"Media Foundation started in {:.2f} ms.", current.cold_startup_time.count()).c_str());
+
+			return S_OK;
+		}
+
+		expected<com_ptr_nothrow<IMFDXGIDeviceManager>, error> get_dxgi_device_manager(LOG_HANDLE &logger) noexcept
+		{
+			scoped_lock const guard{ current.lock };
+
+			auto const begin{ chrono::steady_clock::now() };
+
+			if (current.device)
+			{
+				if (auto const reason{ current.device->GetDeviceRemovedReason() }; SUCCEEDED(reason))
+				{
+					milliseconds_t const elapsed{ chrono::steady_clock::now() - begin };
+					logger.info(&logger, format(L"Reusing DirectX Video Acceleration device ({:.2f} ms saved).", (current.cold_device_time - elapsed).count()).c_str());
+					return current.dxgi_device_manager;
+				}
+				else
+				{
+					logger.warn(&logger, format(L"DirectX device was lost (0x{:08x}). Recreating...", static_cast<uint32_t>(reason)).c_str());
+					current.device.reset();
+				}
+			}
+
+			logger.info(&logger, L"Preparing DirectX Video Acceleration...");
+
+			auto directx_device{ make_d3d11_device() };
+			if (!directx_device) [[unlikely]] return unexpected{ directx_device.error() };
+
+			if (!current.dxgi_device_manager)
+				UNEXPECT_IF_FAILED(MFCreateDXGIDeviceManager(&current.reset_token, out_ptr(current.dxgi_device_manager)));
+
+			// Resetting the manager we already handed out keeps it valid for anyone still holding it after a device loss.
+			UNEXPECT_IF_FAILED(current.dxgi_device_manager->ResetDevice(directx_device->get(), current.reset_token));
+
+			current.device = move(*directx_device);
+			current.cold_device_time = chrono::steady_clock::now() - begin;
+
+			logger.info(&logger, format(L"DirectX Video Acceleration prepared in {:.2f} ms.", current.cold_device_time.count()).c_str());
+
+			return current.dxgi_device_manager;
+		}
+
+		void release() noexcept
+		{
+			scoped_lock const guard{ current.lock };
+
+			current.dxgi_device_manager.reset();
+			current.device.reset();
+
+			if (exchange(current.is_started, false))
+				MFShutdown();
+		}
+	}
+}
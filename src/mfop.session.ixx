@@ -0,0 +1,34 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#define STRICT
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <wil/com.h>
+#include <mfobjects.h>
+#include "aviutl2_sdk/logger2.h"
+
+export module mfop.session;
+
+import std;
+import mfop.error;
+
+namespace mfop
+{
+	namespace session
+	{
+		export
+		{
+			// Media Foundation and the D3D11 device outlive a single export; they are torn down in release().
+			std::expected<HRESULT, error> startup(LOG_HANDLE &logger) noexcept;
+			std::expected<wil::com_ptr_nothrow<IMFDXGIDeviceManager>, error> get_dxgi_device_manager(LOG_HANDLE &logger) noexcept;
+			void release() noexcept;
+		}
+	}
+}
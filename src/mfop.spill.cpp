@@ -0,0 +1,216 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module mfop.spill;
+
+import std;
+
+using namespace std;
+
+namespace mfop
+{
+	namespace spill
+	{
+		auto const constinit min_match{ size_t{ 4 } };
+		// The block format leaves the last 5 bytes as literals and starts no match in the last 12.
+		auto const constinit last_literals{ size_t{ 5 } };
+		auto const constinit match_start_limit{ size_t{ 12 } };
+		auto const constinit max_offset{ size_t{ 65535 } };
+		auto const constinit hash_bits{ 14 };
+
+		auto read_32(uint8_t const *bytes) noexcept
+		{
+			uint32_t value{};
+			memcpy(&value, bytes, sizeof(value));
+			return value;
+		}
+
+		auto put_length(vector<uint8_t> &destination, size_t length)
+		{
+			for (; length >= 255; length -= 255)
+				destination.push_back(255);
+			destination.push_back(static_cast<uint8_t>(length));
+		}
+
+		auto put_sequence(vector<uint8_t> &destination, span<uint8_t const> literals, size_t const &offset, size_t const &match_length)
+		{
+			auto const extra_match{ match_length ? match_length - min_match : 0 };
+			destination.push_back(static_cast<uint8_t>(min<size_t>(literals.size(), 15) << 4 | min<size_t>(extra_match, 15)));
+
+			if (literals.size() >= 15) put_length(destination, literals.size() - 15);
+			destination.insert(destination.end(), literals.begin(), literals.end());
+
+			// The last sequence is only literals.
+			if (!match_length) return;
+
+			destination.push_back(static_cast<uint8_t>(offset));
+			destination.push_back(static_cast<uint8_t>(offset >> 8));
+			if (extra_match >= 15) put_length(destination, extra_match - 15);
+		}
+
+		void compress(span<uint8_t const> source, vector<uint8_t> &destination)
+		{
+			destination.clear();
+			destination.reserve(source.size() + source.size() / 255 + 16);
+
+			auto const size{ source.size() };
+			auto const bytes{ source.data() };
+			size_t anchor{};
+
+			if (size > match_start_limit)
+			{
+				vector<uint32_t> table(size_t{ 1 } << hash_bits);
+				auto const hash{ [&](size_t const &position) { return read_32(bytes + position) * 2654435761u >> (32 - hash_bits); } };
+
+				for (size_t position{ 1 }; position < size - match_start_limit;)
+				{
+					auto const slot{ hash(position) };
+					size_t candidate{ table[slot] };
+					table[slot] = static_cast<uint32_t>(position);
+
+					if (position - candidate > max_offset || read_32(bytes + candidate) != read_32(bytes + position))
+					{
+						// Skips ahead faster the longer nothing matches, so incompressible frames cost little.
+						position += 1 + ((position - anchor) >> 6);
+						continue;
+					}
+
+					for (; position > anchor && candidate > 0 && bytes[position - 1] == bytes[candidate - 1]; --position, --candidate);
+
+					auto length{ min_match };
+					for (; position + length < size - last_literals && bytes[position + length] == bytes[candidate + length]; ++length);
+
+					put_sequence(destination, source.subspan(anchor, position - anchor), position - candidate, length);
+					position += length;
+					anchor = position;
+				}
+			}
+
+			put_sequence(destination, source.subspan(anchor), 0, 0);
+		}
+
+		bool decompress(span<uint8_t const> source, span<uint8_t> destination) noexcept
+		{
+			size_t input{}, output{};
+
+			auto const take_length{ [&](size_t &length)
+			{
+				for (uint8_t byte{ 255 }; byte == 255; length += byte)
+				{
+					if (input >= source.size()) return false;
+					byte = source[input++];
+				}
+				return true;
+			} };
+
+			while (input < source.size())
+			{
+				auto const token{ source[input++] };
+
+				size_t literal_length{ static_cast<size_t>(token >> 4) };
+				if (literal_length == 15 && !take_length(literal_length)) return false;
+				if (literal_length > source.size() - input || literal_length > destination.size() - output) return false;
+
+				memcpy(destination.data() + output, source.data() + input, literal_length);
+				input += literal_length;
+				output += literal_length;
+
+				if (input == source.size()) break;
+				if (source.size() - input < 2) return false;
+
+				size_t const offset{ source[input] | static_cast<size_t>(source[input + 1]) << 8 };
+				input += 2;
+				if (!offset || offset > output) return false;
+
+				size_t match_length{ static_cast<size_t>(token & 15) };
+				if (match_length == 15 && !take_length(match_length)) return false;
+				match_length += min_match;
+				if (match_length > destination.size() - output) return false;
+
+				// A match may overlap what it produces; repeating its start a whole number of periods at a time only reads bytes already written.
+				auto const match_begin{ output - offset };
+				for (auto remaining{ match_length }; remaining;)
+				{
+					auto const chunk{ min(remaining, output - match_begin) };
+					memcpy(destination.data() + output, destination.data() + match_begin, chunk);
+					output += chunk;
+					remaining -= chunk;
+				}
+			}
+
+			return output == destination.size();
+		}
+
+		double statistics::get_compression_ratio() const noexcept
+		{
+			return compressed_bytes ? static_cast<double>(uncompressed_bytes) / compressed_bytes : 1.0;
+		}
+
+		double statistics::get_spill_bandwidth() const noexcept
+		{
+			auto const seconds{ chrono::duration<double>{ spill_time }.count() };
+			return seconds > 0 ? spilled_bytes / seconds / (1 << 20) : 0.0;
+		}
+
+		tiers::tiers(size_t const &raw_capacity, size_t const &memory_budget, span<uint8_t> disk) noexcept :
+			raw_capacity{ raw_capacity },
+			memory_budget{ memory_budget },
+			disk{ disk },
+			raw_count{},
+			memory_used{},
+			counters{},
+			head{},
+			tail{},
+			count{},
+			wrap_end{}
+		{
+		}
+
+		optional<size_t> tiers::allocate(size_t const &size) noexcept
+		{
+			if (!count)
+			{
+				head = tail = 0;
+				wrap_end.reset();
+			}
+
+			optional<size_t> offset{};
+
+			// Strictly short of head, so that a full ring never looks the same as an empty one.
+			if (wrap_end)
+			{
+				if (tail + size < head) offset = tail;
+			}
+			else if (tail + size <= disk.size())
+				offset = tail;
+			else if (size < head)
+			{
+				wrap_end = tail;
+				offset = 0;
+			}
+
+			if (!offset) return nullopt;
+
+			tail = *offset + size;
+			++count;
+			return offset;
+		}
+
+		void tiers::release(size_t const &offset, size_t const &size) noexcept
+		{
+			if (!count) return;
+
+			--count;
+			head = offset + size;
+
+			if (wrap_end && head == *wrap_end)
+			{
+				head = 0;
+				wrap_end.reset();
+			}
+		}
+	}
+}
@@ -0,0 +1,266 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+export module mfop.spill;
+
+import std;
+
+namespace mfop
+{
+	namespace spill
+	{
+		export
+		{
+			// LZ4 block format, without the frame around it; fast enough to keep up with rendering rather than to save the most bytes.
+			void compress(std::span<std::uint8_t const> source, std::vector<std::uint8_t> &destination);
+			// False unless the block decodes to exactly destination.size() bytes.
+			bool decompress(std::span<std::uint8_t const> source, std::span<std::uint8_t> destination) noexcept;
+
+			struct statistics
+			{
+				std::uint64_t raw_items;
+				std::uint64_t compressed_items;
+				std::uint64_t spilled_items;
+				// Before and after compression, over everything that left the raw tier.
+				std::uint64_t uncompressed_bytes;
+				std::uint64_t compressed_bytes;
+				std::uint64_t spilled_bytes;
+				std::chrono::nanoseconds spill_time;
+				// Longest single wait of the producer, and how often the disk tier was full too and it had to wait regardless.
+				std::chrono::nanoseconds peak_wait;
+				std::uint64_t overflows;
+
+				double get_compression_ratio() const noexcept;
+				// MiB/s written into the disk tier, counting only the time spent writing.
+				double get_spill_bandwidth() const noexcept;
+			};
+
+			// Bookkeeping of the shared parts of queue<T>; the items themselves stay in queue<T>.
+			struct tiers
+			{
+				tiers(std::size_t const &raw_capacity, std::size_t const &memory_budget, std::span<std::uint8_t> disk) noexcept;
+
+				// Where a packed item of this size goes in the disk tier, if it fits right now.
+				std::optional<std::size_t> allocate(std::size_t const &size) noexcept;
+				void release(std::size_t const &offset, std::size_t const &size) noexcept;
+
+				std::size_t raw_capacity;
+				std::size_t memory_budget;
+				std::span<std::uint8_t> disk;
+				std::size_t raw_count;
+				std::size_t memory_used;
+				statistics counters;
+
+			private:
+				// The disk tier is a byte ring: items are written at tail and leave from head in the same order.
+				std::size_t head;
+				std::size_t tail;
+				std::size_t count;
+				// Once tail has gone back to the start, where the bytes before it ended.
+				std::optional<std::size_t> wrap_end;
+			};
+
+			// Hands items from the thread talking to the host to one writer thread, holding at most raw_capacity of them as they are.
+			// When that is full for longer than max_wait, items are packed, compressed and kept in RAM up to memory_budget bytes,
+			// then written to the disk tier, and read back in order; pack and unpack are only used for those.
+			// With neither a memory budget nor a disk tier, a full queue simply blocks the producer.
+			template<typename T>
+			struct queue
+			{
+				queue
+				(
+					std::size_t const &raw_capacity,
+					std::chrono::milliseconds const &max_wait,
+					std::size_t const &memory_budget,
+					std::span<std::uint8_t> disk,
+					std::function<void(T const &, std::vector<std::uint8_t> &)> &&pack,
+					std::function<std::optional<T>(std::span<std::uint8_t const>)> &&unpack
+				) noexcept :
+					max_wait{ max_wait },
+					pack{ std::move(pack) },
+					unpack{ std::move(unpack) },
+					state{ std::max<std::size_t>(raw_capacity, 1), memory_budget, disk },
+					items{},
+					is_finished{},
+					is_closed{},
+					is_failed{}
+				{
+				}
+
+				bool push(T &&item)
+				{
+					auto const begin{ std::chrono::steady_clock::now() };
+					std::unique_lock guard{ lock };
+
+					auto const has_raw_room{ [this] { return state.raw_count < state.raw_capacity || is_closed; } };
+					auto const can_spill{ state.memory_budget || !state.disk.empty() };
+					if (can_spill ? has_room.wait_for(guard, max_wait, has_raw_room) : (has_room.wait(guard, has_raw_room), true))
+					{
+						if (is_closed) return false;
+
+						++state.raw_count;
+						++state.counters.raw_items;
+						items.push_back({ std::move(item), {}, {}, {}, {} });
+						return notify(begin);
+					}
+
+					// The encoder is behind; packing and compressing happen without the lock, so it can keep draining meanwhile.
+					guard.unlock();
+					std::vector<std::uint8_t> packed{}, compressed{};
+					pack(item, packed);
+					compress(packed, compressed);
+					guard.lock();
+
+					state.counters.uncompressed_bytes += packed.size();
+					state.counters.compressed_bytes += compressed.size();
+
+					if (state.memory_used + compressed.size() <= state.memory_budget)
+					{
+						if (is_closed) return false;
+
+						state.memory_used += compressed.size();
+						++state.counters.compressed_items;
+						items.push_back({ std::nullopt, std::move(compressed), {}, {}, packed.size() });
+						return notify(begin);
+					}
+
+					auto offset{ state.allocate(compressed.size()) };
+					if (!offset)
+					{
+						// Nowhere left to put it: the only case where the encoder is waited on for as long as it takes, until either tier has room.
+						++state.counters.overflows;
+						has_room.wait(guard, [&] { return state.raw_count < state.raw_capacity || (offset = state.allocate(compressed.size())) || is_closed; });
+						if (is_closed) return false;
+
+						if (!offset)
+						{
+							++state.raw_count;
+							++state.counters.raw_items;
+							items.push_back({ std::move(item), {}, {}, {}, {} });
+							return notify(begin);
+						}
+					}
+					if (is_closed) return false;
+
+					auto const spill_begin{ std::chrono::steady_clock::now() };
+					std::ranges::copy(compressed, state.disk.begin() + *offset);
+					state.counters.spill_time += std::chrono::steady_clock::now() - spill_begin;
+					state.counters.spilled_bytes += compressed.size();
+					++state.counters.spilled_items;
+
+					items.push_back({ std::nullopt, {}, *offset, compressed.size(), packed.size() });
+					return notify(begin);
+				}
+
+				std::optional<T> pop()
+				{
+					std::unique_lock guard{ lock };
+					has_item.wait(guard, [this] { return !items.empty() || is_finished || is_closed; });
+					if (items.empty() || is_closed) return std::nullopt;
+
+					auto entry{ std::move(items.front()) };
+					items.pop_front();
+
+					if (entry.item)
+					{
+						--state.raw_count;
+						has_room.notify_all();
+						return std::move(entry.item);
+					}
+
+					std::vector<std::uint8_t> packed(entry.packed_size);
+					auto is_valid{ false };
+
+					if (entry.spilled_size)
+					{
+						// Decoded straight out of the disk tier, whose bytes stay put until they are released.
+						guard.unlock();
+						is_valid = decompress(state.disk.subspan(entry.spilled_offset, entry.spilled_size), packed);
+						guard.lock();
+						state.release(entry.spilled_offset, entry.spilled_size);
+					}
+					else
+					{
+						state.memory_used -= entry.compressed.size();
+						guard.unlock();
+						is_valid = decompress(entry.compressed, packed);
+						guard.lock();
+					}
+					has_room.notify_all();
+					guard.unlock();
+
+					auto item{ is_valid ? unpack(packed) : std::nullopt };
+					if (!item)
+					{
+						// Told apart from the end of the queue by has_failed().
+						is_failed = true;
+						close();
+					}
+
+					return item;
+				}
+
+				bool has_failed() const noexcept
+				{
+					return is_failed;
+				}
+
+				// No more items will be pushed; the consumer drains what is left.
+				void finish()
+				{
+					std::scoped_lock const guard{ lock };
+					is_finished = true;
+					has_item.notify_all();
+				}
+
+				// The consumer gave up; the producer must not wait on it any longer.
+				void close()
+				{
+					std::scoped_lock const guard{ lock };
+					is_closed = true;
+					items.clear();
+					has_room.notify_all();
+					has_item.notify_all();
+				}
+
+				statistics get_statistics()
+				{
+					std::scoped_lock const guard{ lock };
+					return state.counters;
+				}
+
+			private:
+				struct entry
+				{
+					std::optional<T> item;
+					std::vector<std::uint8_t> compressed;
+					std::size_t spilled_offset;
+					std::size_t spilled_size;
+					std::size_t packed_size;
+				};
+
+				std::chrono::milliseconds max_wait;
+				std::function<void(T const &, std::vector<std::uint8_t> &)> pack;
+				std::function<std::optional<T>(std::span<std::uint8_t const>)> unpack;
+				tiers state;
+				std::deque<entry> items;
+				bool is_finished;
+				bool is_closed;
+				std::atomic<bool> is_failed;
+				std::mutex lock;
+				std::condition_variable has_room;
+				std::condition_variable has_item;
+
+				bool notify(std::chrono::steady_clock::time_point const &begin) noexcept
+				{
+					state.counters.peak_wait = std::max(state.counters.peak_wait, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin));
+					has_item.notify_one();
+					return true;
+				}
+			};
+		}
+	}
+}
@@ -0,0 +1,238 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#define STRICT
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <wil/com.h>
+#include <wrl/implements.h>
+#include <mfapi.h>
+#include <mferror.h>
+#include <mfobjects.h>
+
+module mfop.stream;
+
+import std;
+
+using namespace std;
+using namespace wil;
+
+namespace mfop
+{
+	namespace stream
+	{
+		HRESULT byte_sink::read(uint64_t const &, span<uint8_t>, size_t &read_size) noexcept
+		{
+			read_size = 0;
+			return E_NOTIMPL;
+		}
+
+		// Does every request synchronously; the asynchronous ones just report back through the work queue afterwards.
+		struct sink_byte_stream : Microsoft::WRL::RuntimeClass<Microsoft::WRL::RuntimeClassFlags<Microsoft::WRL::ClassicCom>, IMFByteStream>
+		{
+			sink_byte_stream(shared_ptr<byte_sink> sink, bool const &is_seekable, bool const &is_readable) noexcept :
+				sink{ move(sink) },
+				lock{},
+				completed{},
+				position{},
+				length{},
+				is_seekable{ is_seekable },
+				is_readable{ is_readable },
+				is_closed{}
+			{
+			}
+
+			STDMETHODIMP GetCapabilities(DWORD *capabilities) override
+			{
+				if (!capabilities) return E_POINTER;
+				*capabilities = MFBYTESTREAM_IS_WRITABLE | (is_seekable ? MFBYTESTREAM_IS_SEEKABLE : 0) | (is_readable ? MFBYTESTREAM_IS_READABLE : 0);
+				return S_OK;
+			}
+
+			STDMETHODIMP GetLength(QWORD *stream_length) override
+			{
+				if (!stream_length) return E_POINTER;
+
+				lock_guard const guard{ lock };
+				*stream_length = length;
+				return S_OK;
+			}
+
+			STDMETHODIMP SetLength(QWORD stream_length) override
+			{
+				lock_guard const guard{ lock };
+				// Growing is all a media sink asks for; the bytes it reserves arrive as writes later.
+				if (stream_length < length && !is_seekable) return E_NOTIMPL;
+				length = stream_length;
+				return S_OK;
+			}
+
+			STDMETHODIMP GetCurrentPosition(QWORD *current_position) override
+			{
+				if (!current_position) return E_POINTER;
+
+				lock_guard const guard{ lock };
+				*current_position = position;
+				return S_OK;
+			}
+
+			STDMETHODIMP SetCurrentPosition(QWORD new_position) override
+			{
+				lock_guard const guard{ lock };
+				return move_to(new_position);
+			}
+
+			STDMETHODIMP IsEndOfStream(BOOL *is_end) override
+			{
+				if (!is_end) return E_POINTER;
+
+				lock_guard const guard{ lock };
+				*is_end = position >= length;
+				return S_OK;
+			}
+
+			STDMETHODIMP Read(BYTE *buffer, ULONG buffer_length, ULONG *read_length) override
+			{
+				if (!buffer || !read_length) return E_POINTER;
+				if (!is_readable) return E_NOTIMPL;
+
+				lock_guard const guard{ lock };
+				if (is_closed) return MF_E_INVALIDREQUEST;
+
+				size_t read_size{};
+				if (auto const hr{ sink->read(position, { buffer, buffer_length }, read_size) }; FAILED(hr)) return hr;
+
+				position += read_size;
+				*read_length = static_cast<ULONG>(read_size);
+				return S_OK;
+			}
+
+			STDMETHODIMP BeginRead(BYTE *buffer, ULONG buffer_length, IMFAsyncCallback *callback, IUnknown *state) override
+			{
+				ULONG read_length{};
+				auto const hr{ Read(buffer, buffer_length, &read_length) };
+				return complete(read_length, hr, callback, state);
+			}
+
+			STDMETHODIMP EndRead(IMFAsyncResult *result, ULONG *read_length) override
+			{
+				return finish(result, read_length);
+			}
+
+			STDMETHODIMP Write(BYTE const *buffer, ULONG buffer_length, ULONG *written_length) override
+			{
+				if ((!buffer && buffer_length) || !written_length) return E_POINTER;
+
+				lock_guard const guard{ lock };
+				if (is_closed) return MF_E_INVALIDREQUEST;
+
+				if (auto const hr{ sink->write(position, { buffer, buffer_length }) }; FAILED(hr)) return hr;
+
+				position += buffer_length;
+				length = max(length, position);
+				*written_length = buffer_length;
+				return S_OK;
+			}
+
+			STDMETHODIMP BeginWrite(BYTE const *buffer, ULONG buffer_length, IMFAsyncCallback *callback, IUnknown *state) override
+			{
+				ULONG written_length{};
+				auto const hr{ Write(buffer, buffer_length, &written_length) };
+				return complete(written_length, hr, callback, state);
+			}
+
+			STDMETHODIMP EndWrite(IMFAsyncResult *result, ULONG *written_length) override
+			{
+				return finish(result, written_length);
+			}
+
+			STDMETHODIMP Seek(MFBYTESTREAM_SEEK_ORIGIN origin, LONGLONG offset, DWORD, QWORD *current_position) override
+			{
+				lock_guard const guard{ lock };
+
+				auto const base{ origin == msoCurrent ? static_cast<int64_t>(position) : 0 };
+				if (base + offset < 0) return E_INVALIDARG;
+				if (auto const hr{ move_to(static_cast<QWORD>(base + offset)) }; FAILED(hr)) return hr;
+
+				if (current_position) *current_position = position;
+				return S_OK;
+			}
+
+			STDMETHODIMP Flush() override
+			{
+				return S_OK;
+			}
+
+			STDMETHODIMP Close() override
+			{
+				lock_guard const guard{ lock };
+				if (is_closed) return S_OK;
+
+				is_closed = true;
+				return sink->close();
+			}
+
+		private:
+			shared_ptr<byte_sink> sink;
+			mutex lock;
+			// Byte counts of the asynchronous requests done but not yet ended.
+			map<IMFAsyncResult *, ULONG> completed;
+			QWORD position;
+			QWORD length;
+			bool is_seekable;
+			bool is_readable;
+			bool is_closed;
+
+			HRESULT move_to(QWORD const &new_position) noexcept
+			{
+				// A stream that only goes forward can still be told to stay where it is.
+				if (!is_seekable && new_position != position) return E_NOTIMPL;
+				position = new_position;
+				return S_OK;
+			}
+
+			HRESULT complete(ULONG const &count, HRESULT const &status, IMFAsyncCallback *callback, IUnknown *state) noexcept
+			{
+				com_ptr_nothrow<IMFAsyncResult> result{};
+				if (auto const hr{ MFCreateAsyncResult(nullptr, callback, state, result.put()) }; FAILED(hr)) return hr;
+				result->SetStatus(status);
+
+				{
+					lock_guard const guard{ lock };
+					completed[result.get()] = count;
+				}
+
+				return MFInvokeCallback(result.get());
+			}
+
+			HRESULT finish(IMFAsyncResult *result, ULONG *count) noexcept
+			{
+				if (!result || !count) return E_POINTER;
+
+				{
+					lock_guard const guard{ lock };
+					auto const found{ completed.find(result) };
+					*count = found == completed.end() ? 0 : found->second;
+					if (found != completed.end()) completed.erase(found);
+				}
+
+				return result->GetStatus();
+			}
+		};
+
+		HRESULT make_byte_stream(shared_ptr<byte_sink> sink, bool const &is_seekable, bool const &is_readable, com_ptr_nothrow<IMFByteStream> &stream) noexcept
+		{
+			auto const made{ Microsoft::WRL::Make<sink_byte_stream>(move(sink), is_seekable, is_readable) };
+			if (!made) [[unlikely]] return E_OUTOFMEMORY;
+
+			stream = made.Get();
+			return S_OK;
+		}
+	}
+}
@@ -0,0 +1,42 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#define STRICT
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <wil/com.h>
+#include <mfobjects.h>
+
+export module mfop.stream;
+
+import std;
+
+namespace mfop
+{
+	namespace stream
+	{
+		export
+		{
+			// Wherever the bytes a media sink writes are meant to go instead of a file.
+			struct byte_sink
+			{
+				virtual ~byte_sink() = default;
+
+				virtual HRESULT write(std::uint64_t const &position, std::span<std::uint8_t const> bytes) noexcept = 0;
+				// Only streams made readable call this, so sinks that cannot give back what they were handed may leave it as it is.
+				virtual HRESULT read(std::uint64_t const &position, std::span<std::uint8_t> bytes, std::size_t &read_size) noexcept;
+				// Called once the media sink closes the stream, which Finalize does after the last write.
+				virtual HRESULT close() noexcept = 0;
+			};
+
+			// A byte stream a sink writer can be created on; is_seekable and is_readable tell the media sink whether it may go back to patch what it wrote, and read it.
+			HRESULT make_byte_stream(std::shared_ptr<byte_sink> sink, bool const &is_seekable, bool const &is_readable, wil::com_ptr_nothrow<IMFByteStream> &stream) noexcept;
+		}
+	}
+}
@@ -0,0 +1,86 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module mfop.timebase;
+
+import std;
+
+using namespace std;
+
+namespace mfop
+{
+	namespace timebase
+	{
+		struct quotient
+		{
+			uint64_t value;
+			uint64_t remainder;
+		};
+
+		// a * b / c without losing the upper half of the product; the quotient itself has to fit, which it does for any timestamp.
+		auto multiply_divide(uint64_t const &a, uint64_t const &b, uint64_t const &c) noexcept
+		{
+			if (!a || b <= numeric_limits<uint64_t>::max() / a) return quotient{ a * b / c, a * b % c };
+
+			auto const a_low{ a & 0xffffffff }, a_high{ a >> 32 }, b_low{ b & 0xffffffff }, b_high{ b >> 32 };
+			auto const low_low{ a_low * b_low }, low_high{ a_low * b_high }, high_low{ a_high * b_low };
+			auto const middle{ (low_low >> 32) + (low_high & 0xffffffff) + (high_low & 0xffffffff) };
+
+			auto const high{ a_high * b_high + (low_high >> 32) + (high_low >> 32) + (middle >> 32) };
+			auto const low{ middle << 32 | (low_low & 0xffffffff) };
+
+			// Long division, a bit at a time; it only runs past 64-bit products, which the rates AviUtl ExEdit2 offers never reach.
+			quotient result{ 0, high % c };
+			for (auto bit{ 63 }; bit >= 0; --bit)
+			{
+				auto const carry{ result.remainder >> 63 };
+				result.remainder = result.remainder << 1 | (low >> bit & 1);
+				result.value <<= 1;
+				if (carry || result.remainder >= c)
+				{
+					result.remainder -= c;
+					result.value |= 1;
+				}
+			}
+
+			return result;
+		}
+
+		clock::clock(int64_t const &rate, int64_t const &scale) noexcept :
+			rate{ static_cast<uint64_t>(max<int64_t>(rate, 1)) },
+			scale{ static_cast<uint64_t>(max<int64_t>(scale, 1)) },
+			numerator{},
+			denominator{}
+		{
+			auto const divisor{ gcd(this->scale * units_per_second, this->rate) };
+			numerator = this->scale * units_per_second / divisor;
+			denominator = this->rate / divisor;
+		}
+
+		int64_t clock::get_time(int64_t const &index) const noexcept
+		{
+			if (index <= 0) return 0;
+
+			auto const [value, remainder] { multiply_divide(static_cast<uint64_t>(index), numerator, denominator) };
+			// Halves round up, the same way for every index.
+			return static_cast<int64_t>(value + (remainder >= denominator - remainder));
+		}
+
+		int64_t clock::get_duration(int64_t const &index, int64_t const &count) const noexcept
+		{
+			return get_time(index + count) - get_time(index);
+		}
+
+		int64_t clock::count_before(clock const &other, int64_t const &index) const noexcept
+		{
+			if (index <= 0) return 0;
+
+			// Ours start at i * scale / rate and the other's at index * other.scale / other.rate, so this is the ceiling of their ratio.
+			auto const [value, remainder] { multiply_divide(static_cast<uint64_t>(index), other.scale * rate, other.rate * scale) };
+			return static_cast<int64_t>(value + (remainder != 0));
+		}
+	}
+}
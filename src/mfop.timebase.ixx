@@ -0,0 +1,42 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+export module mfop.timebase;
+
+import std;
+
+namespace mfop
+{
+	namespace timebase
+	{
+		export
+		{
+			// Media Foundation counts time in 100 ns units.
+			std::int64_t constexpr units_per_second{ 10'000'000 };
+
+			// Places frames or audio samples on the 100 ns grid from their index alone, so rounding never adds up over an export.
+			struct clock
+			{
+				// rate / scale of them per second; audio is the sampling rate over 1.
+				clock(std::int64_t const &rate, std::int64_t const &scale) noexcept;
+
+				// When the index-th one starts, to the nearest 100 ns.
+				std::int64_t get_time(std::int64_t const &index) const noexcept;
+				// Always the distance to the next timestamp, so that durations and timestamps agree exactly.
+				std::int64_t get_duration(std::int64_t const &index, std::int64_t const &count = 1) const noexcept;
+				// How many of ours start before the index-th of other does, compared without rounding either.
+				std::int64_t count_before(clock const &other, std::int64_t const &index) const noexcept;
+
+			private:
+				std::uint64_t rate;
+				std::uint64_t scale;
+				// scale * units_per_second / rate, reduced.
+				std::uint64_t numerator;
+				std::uint64_t denominator;
+			};
+		}
+	}
+}
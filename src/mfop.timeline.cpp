@@ -0,0 +1,205 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#define STRICT
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include "aviutl2_sdk/plugin2.h"
+
+module mfop.timeline;
+
+import std;
+
+using namespace std;
+
+namespace mfop
+{
+	namespace timeline
+	{
+		struct item_value
+		{
+			wchar_t const *item;
+			double value;
+		};
+
+		// Anything placed, moved, turned, faded or sped up changes what is on screen, so the clip is no longer the file.
+		auto const source_items{ to_array<item_value>(
+		{
+			{ L"再生位置", 0 },
+			{ L"再生速度", 100 },
+			{ L"ループ再生", 0 }
+		}) };
+		auto const drawing_items{ to_array<item_value>(
+		{
+			{ L"X", 0 },
+			{ L"Y", 0 },
+			{ L"Z", 0 },
+			{ L"拡大率", 100 },
+			{ L"透明度", 0 },
+			{ L"縦横比", 0 },
+			{ L"X軸回転", 0 },
+			{ L"Y軸回転", 0 },
+			{ L"Z軸回転", 0 }
+		}) };
+		auto const playback_items{ to_array<item_value>(
+		{
+			{ L"音量", 100 },
+			{ L"左右", 0 }
+		}) };
+
+		struct state
+		{
+			mutex lock;
+			EDIT_HANDLE *handle;
+			optional<clip> snapshot;
+		};
+
+		static state current{};
+
+		auto from_utf8(string_view text)
+		{
+			wstring wide(static_cast<size_t>(MultiByteToWideChar(CP_UTF8, 0, text.data(), static_cast<int32_t>(text.size()), nullptr, 0)), L'\0');
+			MultiByteToWideChar(CP_UTF8, 0, text.data(), static_cast<int32_t>(text.size()), wide.data(), static_cast<int32_t>(wide.size()));
+			return wide;
+		}
+
+		// The effect.name of every [Object.N] section in the alias, in the order they are applied.
+		auto get_effect_names(EDIT_SECTION &section, OBJECT_HANDLE const &object)
+		{
+			vector<wstring> names{};
+			auto const alias{ section.get_object_alias(object) };
+			if (!alias) return names;
+
+			for (auto const line : string_view{ alias } | views::split('\n'))
+			{
+				auto text{ string_view{ line } };
+				if (text.ends_with('\r')) text.remove_suffix(1);
+				if (text.starts_with("effect.name=")) names.push_back(from_utf8(text.substr(12)));
+			}
+
+			return names;
+		}
+
+		// An animated item reads as start,end,motion and fails to parse as a single number, as it should.
+		// An item the host does not have under that name is left to the frame check that comes before a passthrough.
+		auto has_values(EDIT_SECTION &section, OBJECT_HANDLE const &object, wchar_t const effect[], span<item_value const> items)
+		{
+			return ranges::all_of(items, [&](item_value const &expected)
+			{
+				auto const text{ section.get_object_item_value(object, effect, expected.item) };
+				if (!text) return true;
+
+				auto const view{ string_view{ text } };
+				auto value{ 0.0 };
+				auto const [end, code] { from_chars(view.data(), view.data() + view.size(), value) };
+				return code == errc{} && end == view.data() + view.size() && abs(value - expected.value) < 1e-3;
+			});
+		}
+
+		auto get_file(EDIT_SECTION &section, OBJECT_HANDLE const &object, wchar_t const effect[])
+		{
+			auto const text{ section.get_object_item_value(object, effect, L"ファイル") };
+			return text ? from_utf8(text) : wstring{};
+		}
+
+		auto find_single_clip(EDIT_SECTION &section, EDIT_INFO const &info) -> optional<clip>
+		{
+			vector<pair<OBJECT_HANDLE, OBJECT_LAYER_FRAME>> objects{};
+			for (auto layer{ 0 }; layer <= info.layer_max; ++layer)
+				for (auto object{ section.find_object(layer, 0) }; object; )
+				{
+					auto const position{ section.get_object_layer_frame(object) };
+					objects.emplace_back(object, position);
+					if (objects.size() > 2) return nullopt;
+					object = section.find_object(layer, position.end + 1);
+				}
+
+			optional<clip> found{};
+			optional<pair<OBJECT_HANDLE, OBJECT_LAYER_FRAME>> audio{};
+
+			for (auto const &[object, position] : objects)
+			{
+				if (position.start != 0) return nullopt;
+
+				auto const names{ get_effect_names(section, object) };
+				if (names.empty()) return nullopt;
+
+				if (names.front() == L"動画ファイル" && !found)
+				{
+					if (!ranges::all_of(names | views::drop(1), [](wstring const &name) { return name == L"標準描画"; })) return nullopt;
+					if (!has_values(section, object, L"動画ファイル", source_items) || !has_values(section, object, L"標準描画", drawing_items)) return nullopt;
+
+					auto path{ get_file(section, object, L"動画ファイル") };
+					if (path.empty()) return nullopt;
+					found = clip{ move(path), position.end + 1, false, info.select_range_start };
+				}
+				else if (names.front() == L"音声ファイル" && !audio)
+				{
+					if (!ranges::all_of(names | views::drop(1), [](wstring const &name) { return name == L"音声再生"; })) return nullopt;
+					if (!has_values(section, object, L"音声ファイル", source_items) || !has_values(section, object, L"音声再生", playback_items)) return nullopt;
+
+					audio.emplace(object, position);
+				}
+				else
+					return nullopt;
+			}
+
+			if (!found) return nullopt;
+
+			// Audio from anywhere else, or cut to another length, is not what the file carries.
+			if (audio)
+			{
+				if (audio->second.end + 1 != found->length || get_file(section, audio->first, L"音声ファイル") != found->path) return nullopt;
+				found->has_audio = true;
+			}
+
+			return found;
+		}
+
+		void attach(EDIT_HANDLE &handle) noexcept
+		{
+			scoped_lock const guard{ current.lock };
+			current.handle = &handle;
+		}
+
+		void update(EDIT_SECTION &section) noexcept
+		{
+			// section.info is not there for a read-only section, so the edit handle is asked instead.
+			EDIT_INFO info{};
+			{
+				scoped_lock const guard{ current.lock };
+				if (!current.handle) return;
+				current.handle->get_edit_info(&info, sizeof info);
+			}
+
+			auto found{ find_single_clip(section, info) };
+
+			scoped_lock const guard{ current.lock };
+			current.snapshot = move(found);
+		}
+
+		bool refresh() noexcept
+		{
+			EDIT_HANDLE *handle{};
+			{
+				scoped_lock const guard{ current.lock };
+				handle = current.handle;
+			}
+			if (!handle) return false;
+
+			return handle->call_read_section_param(nullptr, [](void *, EDIT_SECTION *section) { update(*section); });
+		}
+
+		optional<clip> get_single_clip() noexcept
+		{
+			scoped_lock const guard{ current.lock };
+			return current.snapshot;
+		}
+	}
+}
@@ -0,0 +1,47 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module;
+
+#define STRICT
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include "aviutl2_sdk/plugin2.h"
+
+export module mfop.timeline;
+
+import std;
+
+namespace mfop
+{
+	namespace timeline
+	{
+		export
+		{
+			// A scene that holds nothing but one video file, played from its start at its own speed, and perhaps the same file's audio beside it.
+			struct clip
+			{
+				std::wstring path;
+				// In frames of the scene, from frame 0.
+				std::int32_t length;
+				bool has_audio;
+				// Where the selected frame range starts, which is where the export does; -1 when nothing is selected.
+				std::int32_t range_start;
+			};
+
+			// The edit handle only comes with RegisterPlugin, so without it there is never a clip to pass through.
+			void attach(EDIT_HANDLE &handle) noexcept;
+			// Takes a new snapshot of the scene; for the scene change handler, and for refresh().
+			void update(EDIT_SECTION &section) noexcept;
+			// Takes a new snapshot if the project can be read now, and returns whether it could; the host may refuse while it is busy.
+			bool refresh() noexcept;
+
+			// The last snapshot, which is older than the scene being exported unless refresh() just succeeded.
+			std::optional<clip> get_single_clip() noexcept;
+		}
+	}
+}
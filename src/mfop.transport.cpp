@@ -0,0 +1,231 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+module mfop.transport;
+
+import std;
+
+using namespace std;
+
+namespace mfop
+{
+	namespace transport
+	{
+		auto const constinit sync_byte{ uint8_t{ 0x47 } };
+		auto const constinit null_pid{ 0x1fff };
+		auto const constinit pcr_clock{ 27'000'000.0 };
+		// The 33-bit base counts at 90 kHz and the extension at 27 MHz under it, so the whole wraps after about 26.5 hours.
+		auto const constinit pcr_range{ (int64_t{ 1 } << 33) * 300 };
+
+		auto read_pcr(span<uint8_t const> packet) noexcept -> optional<int64_t>
+		{
+			// Only an adaptation field long enough to hold one, with its PCR flag set, carries a PCR.
+			if (!(packet[3] & 0x20) || packet[4] < 7 || !(packet[5] & 0x10)) return nullopt;
+
+			auto const base{ static_cast<int64_t>(packet[6]) << 25 | static_cast<int64_t>(packet[7]) << 17 | static_cast<int64_t>(packet[8]) << 9 | static_cast<int64_t>(packet[9]) << 1 | packet[10] >> 7 };
+			auto const extension{ (packet[10] & 1) << 8 | packet[11] };
+			return base * 300 + extension;
+		}
+
+		// The PCR closest to the last one is the one meant, whichever side of a wrap it landed on.
+		auto unwrap(int64_t const &pcr, int64_t const &last) noexcept
+		{
+			return pcr + (last - pcr + pcr_range / 2) / pcr_range * pcr_range;
+		}
+
+		// Hands each whole packet to add, skipping bytes until the next sync byte whenever one is missing.
+		auto split_packets(vector<uint8_t> &partial, span<uint8_t const> bytes, uint64_t &skipped_bytes, auto &&add)
+		{
+			partial.insert(partial.end(), bytes.begin(), bytes.end());
+
+			size_t offset{};
+			while (partial.size() - offset >= packet_size)
+			{
+				if (partial[offset] != sync_byte)
+				{
+					++offset;
+					++skipped_bytes;
+					continue;
+				}
+
+				add(span<uint8_t const>{ partial.data() + offset, packet_size });
+				offset += packet_size;
+			}
+
+			partial.erase(partial.begin(), partial.begin() + static_cast<ptrdiff_t>(offset));
+		}
+
+		scheduler::scheduler() noexcept :
+			partial{},
+			pending{},
+			first_pcr{},
+			last_pcr{},
+			since_pcr{},
+			bytes_per_second{},
+			skipped_bytes{}
+		{
+		}
+
+		void scheduler::push(span<uint8_t const> bytes, vector<datagram> &ready)
+		{
+			split_packets(partial, bytes, skipped_bytes, [&](span<uint8_t const> packet) { add_packet(packet, ready); });
+		}
+
+		void scheduler::flush(vector<datagram> &ready)
+		{
+			skipped_bytes += partial.size();
+			partial.clear();
+
+			if (!pending.bytes.empty()) ready.push_back(exchange(pending, {}));
+		}
+
+		uint64_t scheduler::get_skipped_bytes() const noexcept
+		{
+			return skipped_bytes;
+		}
+
+		void scheduler::add_packet(span<uint8_t const> packet, vector<datagram> &ready)
+		{
+			auto due{ 0.0 };
+
+			if (auto const pcr{ read_pcr(packet) })
+			{
+				auto const value{ first_pcr ? unwrap(*pcr, last_pcr) : *pcr };
+				if (!first_pcr)
+					first_pcr = value;
+				else if (value > last_pcr && since_pcr)
+					bytes_per_second = since_pcr * pcr_clock / static_cast<double>(value - last_pcr);
+
+				last_pcr = value;
+				since_pcr = 0;
+				due = (value - *first_pcr) / pcr_clock;
+			}
+			// Between PCRs the stream is taken to keep the rate it had over the last interval, as the multiplexer meant it to.
+			else if (first_pcr)
+				due = (last_pcr - *first_pcr) / pcr_clock + (bytes_per_second > 0 ? since_pcr / bytes_per_second : 0.0);
+
+			since_pcr += packet_size;
+
+			if (pending.bytes.empty()) pending.due = due;
+			pending.bytes.insert(pending.bytes.end(), packet.begin(), packet.end());
+
+			if (pending.bytes.size() == packet_size * packets_per_datagram) ready.push_back(exchange(pending, {}));
+		}
+
+		pacer::pacer(bool const &is_realtime) noexcept :
+			is_realtime{ is_realtime },
+			start{},
+			first_due{}
+		{
+		}
+
+		chrono::steady_clock::time_point pacer::get_send_time(double const &due) noexcept
+		{
+			auto const now{ chrono::steady_clock::now() };
+			if (!is_realtime) return now;
+
+			if (!start)
+			{
+				start = now;
+				first_due = due;
+			}
+
+			return *start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>{ due - first_due });
+		}
+
+		double statistics::get_bit_rate() const noexcept
+		{
+			return elapsed > 0 ? bytes * 8 / elapsed : 0.0;
+		}
+
+		meter::meter() noexcept :
+			current{},
+			first_time{},
+			first_due{},
+			last_due{},
+			last_time{}
+		{
+		}
+
+		void meter::record(double const &due, chrono::steady_clock::time_point const &time, size_t const &size) noexcept
+		{
+			if (!first_time)
+			{
+				first_time = time;
+				first_due = due;
+			}
+
+			auto const elapsed{ chrono::duration<double>{ time - *first_time }.count() };
+
+			if (current.datagrams)
+			{
+				auto const difference{ (elapsed - last_time) - (due - last_due) };
+				current.jitter += (abs(difference) - current.jitter) / 16;
+			}
+
+			current.max_lateness = max(current.max_lateness, elapsed - (due - first_due));
+			current.elapsed = elapsed;
+			current.bytes += size;
+			++current.datagrams;
+
+			last_due = due;
+			last_time = elapsed;
+		}
+
+		statistics meter::get_statistics() const noexcept
+		{
+			return current;
+		}
+
+		analyzer::analyzer() noexcept :
+			partial{},
+			continuity{},
+			first_pcr{},
+			last_pcr{},
+			current{}
+		{
+			continuity.fill(-1);
+		}
+
+		void analyzer::push(span<uint8_t const> bytes)
+		{
+			split_packets(partial, bytes, current.skipped_bytes, [this](span<uint8_t const> packet) { add_packet(packet); });
+		}
+
+		analysis analyzer::get_analysis() const noexcept
+		{
+			return current;
+		}
+
+		void analyzer::add_packet(span<uint8_t const> packet) noexcept
+		{
+			++current.packets;
+
+			auto const pid{ (packet[1] & 0x1f) << 8 | packet[2] };
+			auto const counter{ static_cast<int8_t>(packet[3] & 0x0f) };
+			auto const has_payload{ (packet[3] & 0x10) != 0 };
+
+			// The counter only moves on packets with a payload, and a multiplexer may send one of them twice.
+			if (pid != null_pid && has_payload)
+			{
+				auto const is_discontinuity{ (packet[3] & 0x20) && packet[4] > 0 && (packet[5] & 0x80) };
+				auto &last{ continuity[pid] };
+				if (last >= 0 && !is_discontinuity && counter != ((last + 1) & 0x0f) && counter != last) ++current.continuity_errors;
+				last = counter;
+			}
+
+			if (auto const pcr{ read_pcr(packet) })
+			{
+				auto const value{ first_pcr ? unwrap(*pcr, last_pcr) : *pcr };
+				if (!first_pcr) first_pcr = value;
+				last_pcr = value;
+
+				++current.pcrs;
+				current.duration = (value - *first_pcr) / pcr_clock;
+			}
+		}
+	}
+}
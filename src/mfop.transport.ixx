@@ -0,0 +1,127 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+export module mfop.transport;
+
+import std;
+
+namespace mfop
+{
+	namespace transport
+	{
+		export
+		{
+			std::size_t constexpr packet_size{ 188 };
+			// Seven packets are the most a datagram holds without going past a 1500-byte Ethernet MTU.
+			std::size_t constexpr packets_per_datagram{ 7 };
+
+			struct datagram
+			{
+				std::vector<std::uint8_t> bytes;
+				// When its first packet is due, in seconds from the first PCR.
+				double due;
+			};
+
+			// Cuts a transport stream into datagrams of whole packets, and times each one from the PCRs around it.
+			struct scheduler
+			{
+				scheduler() noexcept;
+
+				// Takes bytes in any pieces; a datagram is added to ready once all its packets are in.
+				void push(std::span<std::uint8_t const> bytes, std::vector<datagram> &ready);
+				// Adds what is left at the end as a shorter datagram.
+				void flush(std::vector<datagram> &ready);
+
+				// Bytes skipped to find the next sync byte.
+				std::uint64_t get_skipped_bytes() const noexcept;
+
+			private:
+				std::vector<std::uint8_t> partial;
+				datagram pending;
+				std::optional<std::int64_t> first_pcr;
+				std::int64_t last_pcr;
+				// Bytes since the last PCR, and the rate they came at before it.
+				std::uint64_t since_pcr;
+				double bytes_per_second;
+				std::uint64_t skipped_bytes;
+
+				void add_packet(std::span<std::uint8_t const> packet, std::vector<datagram> &ready);
+			};
+
+			// Keeps the datagrams to the stream's own clock, or lets them all go at once.
+			struct pacer
+			{
+				explicit pacer(bool const &is_realtime) noexcept;
+
+				// When a datagram due at due should go out; the first one starts the clock.
+				std::chrono::steady_clock::time_point get_send_time(double const &due) noexcept;
+
+			private:
+				bool is_realtime;
+				std::optional<std::chrono::steady_clock::time_point> start;
+				double first_due;
+			};
+
+			struct statistics
+			{
+				std::uint64_t datagrams;
+				std::uint64_t bytes;
+				double elapsed;
+				// Smoothed as in RFC 3550: how far the gaps between datagrams stray from the gaps between their due times.
+				double jitter;
+				// How far the latest datagram fell behind the schedule the first one set.
+				double max_lateness;
+
+				double get_bit_rate() const noexcept;
+			};
+
+			// Compares when datagrams went out, or came in, with when the stream said they were due.
+			struct meter
+			{
+				meter() noexcept;
+
+				void record(double const &due, std::chrono::steady_clock::time_point const &time, std::size_t const &size) noexcept;
+				statistics get_statistics() const noexcept;
+
+			private:
+				statistics current;
+				std::optional<std::chrono::steady_clock::time_point> first_time;
+				double first_due;
+				double last_due;
+				double last_time;
+			};
+
+			struct analysis
+			{
+				std::uint64_t packets;
+				// Packets whose continuity counter skipped, which means packets were lost or reordered in between.
+				std::uint64_t continuity_errors;
+				std::uint64_t skipped_bytes;
+				std::uint64_t pcrs;
+				// From the first PCR to the last.
+				double duration;
+			};
+
+			// Checks that a transport stream arrived whole.
+			struct analyzer
+			{
+				analyzer() noexcept;
+
+				void push(std::span<std::uint8_t const> bytes);
+				analysis get_analysis() const noexcept;
+
+			private:
+				std::vector<std::uint8_t> partial;
+				std::array<std::int8_t, 8192> continuity;
+				std::optional<std::int64_t> first_pcr;
+				std::int64_t last_pcr;
+				analysis current;
+
+				void add_packet(std::span<std::uint8_t const> packet) noexcept;
+			};
+		}
+	}
+}
@@ -0,0 +1,140 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+// Runs the encoder host protocol between two processes over POSIX shared memory, with the null encoder in the worker.
+// The plugin side is played by protocol::client, exactly as mfop.core drives it on Windows; only Media Foundation is missing.
+//
+//	g++ -std=c++23 -O2 -fmodules -fsearch-include-path bits/std.cc -x c++ ../src/mfop.hash.ixx ../src/mfop.hash.cpp ../src/mfop.ring.ixx ../src/mfop.ring.cpp ../src/mfop.protocol.ixx ../src/mfop.protocol.cpp -x none encoder_host.cpp -o encoder_host
+//
+//	encoder_host [frames] [width] [height]	sends NV12 frames and 48 kHz stereo audio, and checks that the worker saw every byte
+//	encoder_host --crash [frame]	makes the worker die after that frame, and checks that the plugin side survives it
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+import std;
+import mfop.hash;
+import mfop.ring;
+import mfop.protocol;
+
+using namespace std;
+using namespace mfop;
+
+auto map_anonymous(size_t const &size)
+{
+	// Shared with the forked worker; named mappings work the same way, as ring_consumer shows.
+	auto const memory{ mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0) };
+	return memory == MAP_FAILED ? span<uint8_t>{} : span{ static_cast<uint8_t *>(memory), size };
+}
+
+// Stands in for an encoder that brings the whole process down halfway through.
+struct crashing_encoder final : protocol::encoder
+{
+	int64_t crash_frame;
+	protocol::null_encoder inner{};
+
+	explicit crashing_encoder(int64_t const &crash_frame) : crash_frame{ crash_frame } {}
+
+	protocol::status start(protocol::job const &job) override { return inner.start(job); }
+	protocol::status write_video(int64_t const &frame, span<uint8_t const> image) override
+	{
+		if (frame == crash_frame) raise(SIGSEGV);
+		return inner.write_video(frame, image);
+	}
+	protocol::status write_audio(int64_t const &sample, span<uint8_t const> samples) override { return inner.write_audio(sample, samples); }
+	protocol::status finish() override { return inner.finish(); }
+	void abort() noexcept override { inner.abort(); }
+};
+
+int main(int argc, char *argv[])
+{
+	auto const is_crashing{ argc > 1 && argv[1] == "--crash"sv };
+	auto const argument{ [&](int const &index, int32_t const &fallback) { return argc > index ? stoi(argv[index]) : fallback; } };
+
+	auto const frame_count{ is_crashing ? 600 : argument(1, 600) };
+	auto const width{ is_crashing ? 1920 : argument(2, 1920) }, height{ is_crashing ? 1080 : argument(3, 1080) };
+	auto const crash_frame{ is_crashing ? argument(2, 100) : -1 };
+
+	auto const frame_size{ static_cast<size_t>(width) * height * 3 / 2 };
+	auto const samples_per_frame{ 48000 / 60 }, block_alignment{ 4 };
+	auto const slot_count{ 4u };
+	auto const slot_capacity{ max<size_t>(frame_size, static_cast<size_t>(samples_per_frame) * block_alignment) };
+
+	auto const commands{ map_anonymous(ring::get_mapping_size(slot_count, slot_capacity)) };
+	auto const replies{ map_anonymous(ring::get_mapping_size(protocol::reply_slot_count, protocol::reply_slot_capacity)) };
+
+	// The client initializes the command ring, so it has to exist before the worker looks at it.
+	pid_t child{};
+	auto worker_status{ 0 };
+	protocol::client client
+	{
+		commands, replies, slot_count, slot_capacity,
+		[&] { return child && waitpid(child, &worker_status, WNOHANG) == 0; },
+		[] { return false; },
+		[](string_view message) { println("[worker] {}", message); }
+	};
+
+	child = fork();
+	if (!child)
+	{
+		auto const parent{ getppid() };
+		protocol::worker worker{ commands, replies };
+		crashing_encoder encoder{ crash_frame };
+
+		auto const result{ worker.serve(encoder, [parent] { return getppid() != parent; }) };
+		_exit(result.is_failed() ? 1 : 0);
+	}
+
+	auto const begin{ chrono::steady_clock::now() };
+	mfop::hash::xxh64 sent{};
+
+	auto result{ client.start({ u"null.mp4", {}, 0x3231'564eu, false, width, height, 60, 1, frame_count, true, 2, 48000, 70, 192, 0, 0, 0 }) };
+	vector<uint8_t> audio(static_cast<size_t>(samples_per_frame) * block_alignment);
+
+	for (auto f{ 0 }; f < frame_count && !result.is_failed(); ++f)
+	{
+		auto const frame{ client.acquire(frame_size) };
+		if (!frame)
+		{
+			result = frame.error();
+			break;
+		}
+		ranges::fill(*frame, static_cast<uint8_t>(f * 7));
+		sent.update(*frame);
+		client.publish(ring::kind::video, f);
+
+		auto const samples{ client.acquire(audio.size()) };
+		if (!samples)
+		{
+			result = samples.error();
+			break;
+		}
+		ranges::fill(*samples, static_cast<uint8_t>(f));
+		sent.update(*samples);
+		client.publish(ring::kind::audio, static_cast<int64_t>(f) * samples_per_frame);
+	}
+
+	if (!result.is_failed()) result = client.finish();
+	else client.abort();
+
+	chrono::duration<double> const elapsed{ chrono::steady_clock::now() - begin };
+	if (worker_status == 0) waitpid(child, &worker_status, 0);
+
+	println("plugin: {} in {:.2f} s, stalled for {:.2f} s; worker {}", result.is_failed() ? format("failed with 0x{:08x} in {}", static_cast<uint32_t>(result.code), result.detail) : result.detail, elapsed.count(), chrono::duration<double>{ client.get_stalled_time() }.count(), WIFSIGNALED(worker_status) ? format("killed by signal {}", WTERMSIG(worker_status)) : format("exited with {}", WEXITSTATUS(worker_status)));
+
+	if (is_crashing)
+	{
+		auto const is_survived{ result.code == protocol::worker_lost && WIFSIGNALED(worker_status) };
+		println("{}", is_survived ? "OK: the plugin side noticed the crash and carried on." : "NG: the crash was not reported.");
+		return is_survived ? 0 : 1;
+	}
+
+	auto const expected_detail{ format("{} frames and {} bytes of audio, XXH64 {:016x}", frame_count, static_cast<int64_t>(frame_count) * audio.size(), sent.digest()) };
+	println("{}", result.detail == expected_detail ? "OK: the worker received every byte." : "NG: expected " + expected_detail);
+	return result.detail == expected_detail ? 0 : 1;
+}
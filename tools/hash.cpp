@@ -0,0 +1,224 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+// Checks the BLAKE3 in mfop.hash against the official test vectors, and the digest sidecar's file hasher against it
+// under the writes a media sink makes: in order, patched behind, rewritten after a block was hashed, and with gaps.
+//
+//	g++ -std=c++23 -O2 -fmodules -fsearch-include-path bits/std.cc -x c++ ../src/mfop.hash.ixx ../src/mfop.hash.cpp -x none hash.cpp -o hash
+//
+//	hash			runs the checks, then measures both ways of hashing
+//	hash <file...>	prints the BLAKE3 of each file as b3sum does
+
+import std;
+import mfop.hash;
+
+using namespace std;
+
+namespace
+{
+	struct vector_case
+	{
+		size_t length;
+		string_view digest;
+	};
+
+	// The first 32 bytes of "hash" in test_vectors.json of the BLAKE3 repository, for an input of i % 251.
+	// The last four are not in that file; they come from its reference implementation and cross the 1 MiB blocks the file hasher works in.
+	auto const cases{ to_array<vector_case>(
+	{
+		{ 0, "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262" },
+		{ 1, "2d3adedff11b61f14c886e35afa036736dcd87a74d27b5c1510225d0f592e213" },
+		{ 1023, "10108970eeda3eb932baac1428c7a2163b0e924c9a9e25b35bba72b28f70bd11" },
+		{ 1024, "42214739f095a406f3fc83deb889744ac00df831c10daa55189b5d121c855af7" },
+		{ 1025, "d00278ae47eb27b34faecf67b4fe263f82d5412916c1ffd97c8cb7fb814b8444" },
+		{ 2048, "e776b6028c7cd22a4d0ba182a8bf62205d2ef576467e838ed6f2529b85fba24a" },
+		{ 2049, "5f4d72f40d7a5f82b15ca2b2e44b1de3c2ef86c426c95c1af0b6879522563030" },
+		{ 3072, "b98cb0ff3623be03326b373de6b9095218513e64f1ee2edd2525c7ad1e5cffd2" },
+		{ 3073, "7124b49501012f81cc7f11ca069ec9226cecb8a2c850cfe644e327d22d3e1cd3" },
+		{ 4096, "015094013f57a5277b59d8475c0501042c0b642e531b0a1c8f58d2163229e969" },
+		{ 4097, "9b4052b38f1c5fc8b1f9ff7ac7b27cd242487b3d890d15c96a1c25b8aa0fb995" },
+		{ 5120, "9cadc15fed8b5d854562b26a9536d9707cadeda9b143978f319ab34230535833" },
+		{ 5121, "628bd2cb2004694adaab7bbd778a25df25c47b9d4155a55f8fbd79f2fe154cff" },
+		{ 6144, "3e2e5b74e048f3add6d21faab3f83aa44d3b2278afb83b80b3c35164ebeca205" },
+		{ 6145, "f1323a8631446cc50536a9f705ee5cb619424d46887f3c376c695b70e0f0507f" },
+		{ 7168, "61da957ec2499a95d6b8023e2b0e604ec7f6b50e80a9678b89d2628e99ada77a" },
+		{ 7169, "a003fc7a51754a9b3c7fae0367ab3d782dccf28855a03d435f8cfe74605e7817" },
+		{ 8192, "aae792484c8efe4f19e2ca7d371d8c467ffb10748d8a5a1ae579948f718a2a63" },
+		{ 8193, "bab6c09cb8ce8cf459261398d2e7aef35700bf488116ceb94a36d0f5f1b7bc3b" },
+		{ 16384, "f875d6646de28985646f34ee13be9a576fd515f76b5b0a26bb324735041ddde4" },
+		{ 31744, "62b6960e1a44bcc1eb1a611a8d6235b6b4b78f32e7abc4fb4c6cdcce94895c47" },
+		{ 102400, "bc3e3d41a1146b069abffad3c0d44860cf664390afce4d9661f7902e7943e085" },
+		{ 1048576, "74cb441fd087764ca9c3694da742ebe30cbeb3060a17009ca81825c7a8d10343" },
+		{ 1048577, "2f053cd7472cf0cd2f9adaf45c1180255b91b9a865404a63671a0ee5f792ed33" },
+		{ 3145728, "c9e03344ea01f416e5fd2c4aa87b32f2b13e731d034be31898de3ce251926b1c" },
+		{ 5255225, "4f6f706f56439f9ecb9e0347cbe6d68235fac93c2336c68c14222c5b1bf924fb" }
+	}) };
+
+	auto to_hex(mfop::hash::blake3::digest_t const &digest)
+	{
+		string text{};
+		for (auto const &byte : digest) text += format("{:02x}", byte);
+		return text;
+	}
+
+	auto make_input(size_t const &length)
+	{
+		vector<uint8_t> input(length);
+		for (size_t i{}; i < length; ++i) input[i] = static_cast<uint8_t>(i % 251);
+		return input;
+	}
+
+	// A file in memory, written the way it is given and read back the way the sidecar does.
+	struct file
+	{
+		vector<uint8_t> bytes;
+		mfop::hash::blake3_file hasher;
+
+		void write(uint64_t const &position, span<uint8_t const> data)
+		{
+			if (bytes.size() < position + data.size()) bytes.resize(static_cast<size_t>(position + data.size()));
+			ranges::copy(data, bytes.begin() + static_cast<ptrdiff_t>(position));
+			hasher.write(position, data);
+		}
+
+		auto digest()
+		{
+			return hasher.digest([this](uint64_t const &position, span<uint8_t> data)
+			{
+				if (position + data.size() > bytes.size()) return false;
+				ranges::copy_n(bytes.begin() + static_cast<ptrdiff_t>(position), static_cast<ptrdiff_t>(data.size()), data.begin());
+				return true;
+			});
+		}
+	};
+
+	auto check_vectors()
+	{
+		auto failures{ 0 };
+		mt19937 random{ 1 };
+
+		for (auto const &[length, expected] : cases)
+		{
+			auto const input{ make_input(length) };
+
+			mfop::hash::blake3 whole{};
+			whole.update(input);
+
+			mfop::hash::blake3 pieces{};
+			for (size_t position{}; position < length; )
+			{
+				auto const size{ min<size_t>(length - position, random() % 5000 + 1) };
+				pieces.update(span{ input }.subspan(position, size));
+				position += size;
+			}
+
+			// In order and in pieces of the size a media sink writes, which is how a sidecar is made when nothing is patched.
+			file written{};
+			for (size_t position{}; position < length; )
+			{
+				auto const size{ min<size_t>(length - position, random() % 300000 + 1) };
+				written.write(position, span{ input }.subspan(position, size));
+				position += size;
+			}
+			auto const from_file{ written.digest() };
+
+			auto const is_ok{ to_hex(whole.digest()) == expected && to_hex(pieces.digest()) == expected && from_file && to_hex(*from_file) == expected };
+			if (!is_ok) ++failures;
+			println("{:>8} bytes: {}", length, is_ok ? "ok" : "MISMATCH");
+		}
+
+		return failures;
+	}
+
+	auto check_file_writes()
+	{
+		auto failures{ 0 };
+		mt19937_64 random{ 5 };
+
+		for (auto trial{ 0 }; trial < 400; ++trial)
+		{
+			file written{};
+			auto const put{ [&](uint64_t const &position, size_t const &size)
+			{
+				vector<uint8_t> data(size);
+				for (auto &byte : data) byte = static_cast<uint8_t>(random());
+				written.write(position, data);
+			} };
+
+			// A quarter of the sizes stay within the first block, and some land exactly on a block boundary.
+			auto const target{ trial % 7 == 0 ? mfop::hash::blake3_file::block_size * (1 + trial % 3) : random() % 4 ? random() % (6 << 20) : random() % (mfop::hash::blake3_file::block_size + 1) };
+			auto const pattern{ trial % 4 };
+
+			// 0: in order; 1: patches anywhere; 2: patches and gaps; 3: a header written first and patched last, as the MP4 sink does.
+			if (pattern == 3) put(0, 32);
+			while (written.bytes.size() < target)
+			{
+				put(written.bytes.size(), static_cast<size_t>(min<uint64_t>(target - written.bytes.size(), random() % 300000 + 1)));
+				if (pattern >= 1 && random() % 4 == 0) put(random() % written.bytes.size(), 8);
+				if (pattern == 2 && random() % 20 == 0) put(written.bytes.size() + random() % 1000, 100);
+			}
+			if (pattern == 3 && !written.bytes.empty()) put(0, min<size_t>(32, written.bytes.size()));
+
+			mfop::hash::blake3 expected{};
+			expected.update(written.bytes);
+
+			if (auto const digest{ written.digest() }; !digest || *digest != expected.digest() || written.hasher.get_size() != written.bytes.size())
+			{
+				++failures;
+				println("trial {} (pattern {}, {} bytes): MISMATCH", trial, pattern, written.bytes.size());
+			}
+		}
+
+		println("{} write patterns checked, {} failed", 400, failures);
+		return failures;
+	}
+
+	void measure()
+	{
+		vector<uint8_t> const input(size_t{ 256 } << 20, 7);
+
+		auto begin{ chrono::steady_clock::now() };
+		mfop::hash::blake3 streaming{};
+		streaming.update(input);
+		auto const streamed{ streaming.digest() };
+		chrono::duration<double> const streaming_time{ chrono::steady_clock::now() - begin };
+
+		begin = chrono::steady_clock::now();
+		file written{};
+		for (size_t position{}; position < input.size(); position += 65536)
+			written.hasher.write(position, span{ input }.subspan(position, 65536));
+		auto const filed{ written.hasher.digest([](uint64_t const &, span<uint8_t>) { return false; }) };
+		chrono::duration<double> const file_time{ chrono::steady_clock::now() - begin };
+
+		println("streaming: {:.0f} MB/s", 256 / streaming_time.count());
+		println("file, four chunks abreast: {:.0f} MB/s{}", 256 / file_time.count(), filed == streamed ? "" : " (MISMATCH)");
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	auto const arguments{ span{ argv, static_cast<size_t>(argc) }.subspan(1) };
+
+	if (!arguments.empty())
+	{
+		for (auto const &path : arguments)
+		{
+			ifstream input{ path, ios::binary };
+			mfop::hash::blake3 hasher{};
+			vector<char> buffer(size_t{ 1 } << 20);
+			while (input.read(buffer.data(), static_cast<streamsize>(buffer.size())) || input.gcount())
+				hasher.update({ reinterpret_cast<uint8_t const *>(buffer.data()), static_cast<size_t>(input.gcount()) });
+			println("{}  {}", to_hex(hasher.digest()), path);
+		}
+		return 0;
+	}
+
+	auto const failures{ check_vectors() + check_file_writes() };
+	if (failures) return 1;
+
+	measure();
+	return 0;
+}
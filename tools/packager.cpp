@@ -0,0 +1,92 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+// Cuts an existing fragmented MP4 into HLS or DASH segments with the same mfop.package the plugin writes through.
+// The file is fed in pieces the way the writer's byte stream would be, so the segmenter can be checked without Windows.
+//
+//	g++ -std=c++23 -O2 -fmodules -fsearch-include-path bits/std.cc -x c++ ../src/mfop.package.ixx ../src/mfop.package.cpp -x none packager.cpp -o packager
+//
+//	packager <input.mp4> <output.m3u8|output.mpd> [target seconds] [write size]
+//	packager --verify <input.mp4> <output.m3u8|output.mpd> [target seconds] [write size]	also patches the start again and reads the whole stream back
+
+import std;
+import mfop.package;
+
+using namespace std;
+using namespace mfop;
+
+int main(int argc, char *argv[])
+{
+	auto const verifies{ argc > 1 && string_view{ argv[1] } == "--verify" };
+	auto const arguments{ span{ argv, static_cast<size_t>(argc) }.subspan(verifies ? 2 : 1) };
+
+	if (arguments.size() < 2)
+	{
+		println(stderr, "usage: packager [--verify] <input.mp4> <output.m3u8|output.mpd> [target seconds] [write size]");
+		return 2;
+	}
+
+	ifstream input{ arguments[0], ios::binary };
+	vector<uint8_t> const bytes{ istreambuf_iterator<char>{ input }, istreambuf_iterator<char>{} };
+	if (bytes.empty())
+	{
+		println(stderr, "could not read {}", arguments[0]);
+		return 1;
+	}
+
+	auto const target_duration{ arguments.size() > 2 ? stod(arguments[2]) : 6.0 };
+	auto const write_size{ arguments.size() > 3 ? max<size_t>(stoull(arguments[3]), 1) : size_t{ 64 << 10 } };
+
+	package::segmenter segmenter{ arguments[1], target_duration };
+
+	auto const begin{ chrono::steady_clock::now() };
+
+	for (size_t offset{}; offset < bytes.size(); offset += write_size)
+		if (!segmenter.write(offset, span{ bytes }.subspan(offset, min(write_size, bytes.size() - offset))))
+		{
+			println(stderr, "the segmenter rejected the write at {}", offset);
+			return 1;
+		}
+
+	if (verifies)
+	{
+		// The same bytes again over what has been handed to files, as a writer fixing up its headers would.
+		if (!segmenter.write(0, span{ bytes }.first(min<size_t>(bytes.size(), 4096))))
+		{
+			println(stderr, "the segmenter rejected the patch");
+			return 1;
+		}
+
+		vector<uint8_t> read_back(bytes.size());
+		auto const read_size{ segmenter.read(0, read_back) };
+
+		// A trailing mfra is dropped on purpose, so only what was kept has to match.
+		if (read_size == 0 || !ranges::equal(span{ bytes }.first(read_size), span{ read_back }.first(read_size)))
+		{
+			println(stderr, "read back {} bytes that differ from the input", read_size);
+			return 1;
+		}
+
+		println("read back {} of {} bytes unchanged", read_size, bytes.size());
+	}
+
+	if (!segmenter.finish())
+	{
+		println(stderr, "could not finish the segments or the manifest");
+		return 1;
+	}
+
+	chrono::duration<double> const elapsed{ chrono::steady_clock::now() - begin };
+	auto const &media{ segmenter.get_presentation() };
+	auto const statistics{ segmenter.get_statistics() };
+
+	for (auto const &track : media.tracks)
+		println("track {}: {} {} at {} Hz{}", track.id, track.is_video ? "video" : "audio", track.codec, track.timescale, track.is_video ? format(", {}x{}", track.width, track.height) : ""s);
+
+	println("{} segments, the longest {:.3f} s; {:.1f} MiB in {:.3f} s, {} bytes patched", statistics.segments, statistics.longest_duration, static_cast<double>(statistics.written_bytes) / (1 << 20), elapsed.count(), statistics.patched_bytes);
+
+	return 0;
+}
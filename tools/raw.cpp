@@ -0,0 +1,207 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+// Writes Y4M and WAV through mfop.raw as the plugin does, checks what lands on disk, and measures how fast it gets there.
+// The last WAV is made past 4 GiB so that close() has to turn it into RF64.
+//
+//	g++ -std=c++23 -O2 -fmodules -fsearch-include-path bits/std.cc -x c++ ../src/mfop.raw.ixx ../src/mfop.raw.cpp -x none raw.cpp -o raw
+//
+//	raw [directory] [MiB of the large WAV]	writes into directory (the temporary one by default) and removes the files afterwards
+
+import std;
+import mfop.raw;
+
+using namespace std;
+using namespace mfop;
+
+namespace
+{
+	auto const constinit width{ 1920 }, height{ 1080 };
+	auto const constinit frame_count{ 120 };
+	auto const constinit channel_count{ 2 }, sampling_rate{ 48000 };
+
+	struct measurement
+	{
+		uint64_t bytes;
+		chrono::duration<double> elapsed;
+	};
+
+	void report(string_view what, measurement const &result)
+	{
+		println("{}: {:.1f} MiB in {:.2f} s, {:.0f} MB/s", what, static_cast<double>(result.bytes) / (1 << 20), result.elapsed.count(), static_cast<double>(result.bytes) / 1e6 / result.elapsed.count());
+	}
+
+	auto read_file(filesystem::path const &path)
+	{
+		ifstream input{ path, ios::binary };
+		return vector<uint8_t>{ istreambuf_iterator<char>{ input }, istreambuf_iterator<char>{} };
+	}
+
+	auto read_little_endian(span<uint8_t const> bytes, size_t const &offset, size_t const &width)
+	{
+		uint64_t value{};
+		for (auto i{ width }; i--; ) value = value << 8 | bytes[offset + i];
+		return value;
+	}
+
+	auto has_tag(span<uint8_t const> bytes, size_t const &offset, string_view tag)
+	{
+		return ranges::equal(bytes.subspan(offset, tag.size()), tag, {}, {}, [](char const &c) { return static_cast<uint8_t>(c); });
+	}
+
+	// Every sample differs from its neighbours and from the same one a frame later, so a plane out of place does not pass.
+	auto make_yuy2_frame(int32_t const &f)
+	{
+		vector<uint8_t> frame(static_cast<size_t>(width) * height * 2);
+		for (size_t i{}; i < frame.size(); ++i) frame[i] = static_cast<uint8_t>(i * 7 + i / 4099 + f * 13);
+		return frame;
+	}
+
+	auto make_nv12_frame(int32_t const &f)
+	{
+		vector<uint8_t> frame(static_cast<size_t>(width) * height * 3 / 2);
+		for (size_t i{}; i < frame.size(); ++i) frame[i] = static_cast<uint8_t>(i * 5 + i / 4093 + f * 11);
+		return frame;
+	}
+
+	// Planar from packed the plain way, to hold the writer's packing against.
+	auto unpack_yuy2(span<uint8_t const> yuy2)
+	{
+		auto const luma_size{ yuy2.size() / 2 };
+		vector<uint8_t> planes(luma_size * 2);
+		for (size_t i{}; i < luma_size / 2; ++i)
+		{
+			planes[i * 2] = yuy2[i * 4];
+			planes[luma_size + i] = yuy2[i * 4 + 1];
+			planes[i * 2 + 1] = yuy2[i * 4 + 2];
+			planes[luma_size + luma_size / 2 + i] = yuy2[i * 4 + 3];
+		}
+		return planes;
+	}
+
+	auto unpack_nv12(span<uint8_t const> nv12)
+	{
+		auto const luma_size{ nv12.size() * 2 / 3 };
+		vector<uint8_t> planes(nv12.begin(), nv12.begin() + static_cast<ptrdiff_t>(luma_size));
+		planes.resize(nv12.size());
+		for (size_t i{}; i < luma_size / 4; ++i)
+		{
+			planes[luma_size + i] = nv12[luma_size + i * 2];
+			planes[luma_size + luma_size / 4 + i] = nv12[luma_size + i * 2 + 1];
+		}
+		return planes;
+	}
+
+	auto write_y4m(filesystem::path const &path, raw::chroma const &subsampling, measurement &result)
+	{
+		auto const is_yuy2{ subsampling == raw::chroma::yuv422 };
+		raw::y4m_format const format{ { width, height }, { 30000, 1001 }, subsampling };
+
+		// Made up front, so that only the writer is timed.
+		vector<vector<uint8_t>> frames{};
+		for (auto f{ 0 }; f < 4; ++f) frames.push_back(is_yuy2 ? make_yuy2_frame(f) : make_nv12_frame(f));
+
+		auto const begin{ chrono::steady_clock::now() };
+		raw::y4m_writer writer{ path, format };
+		for (auto f{ 0 }; f < frame_count && writer; ++f)
+			is_yuy2 ? writer.write_yuy2(frames[f % frames.size()].data()) : writer.write_nv12(frames[f % frames.size()].data());
+		auto const is_written{ writer.close() };
+		result = { writer.get_size(), chrono::steady_clock::now() - begin };
+
+		if (!is_written) return false;
+
+		auto const bytes{ read_file(path) };
+		auto const &header{ format.get_header() };
+		if (bytes.size() != header.size() + format.get_frame_size() * frame_count || !has_tag(bytes, 0, header)) return false;
+
+		for (auto f{ 0 }; f < frame_count; ++f)
+		{
+			auto const offset{ header.size() + format.get_frame_size() * f };
+			auto const expected{ is_yuy2 ? unpack_yuy2(frames[f % frames.size()]) : unpack_nv12(frames[f % frames.size()]) };
+			if (!has_tag(bytes, offset, "FRAME\n") || !ranges::equal(span{ bytes }.subspan(offset + 6, expected.size()), expected)) return false;
+		}
+
+		return true;
+	}
+
+	auto write_wav(filesystem::path const &path, uint64_t const &data_size, measurement &result)
+	{
+		// A second at a time, as the plugin is handed it.
+		vector<uint8_t> samples(static_cast<size_t>(sampling_rate) * channel_count * 2);
+		for (size_t i{}; i < samples.size(); ++i) samples[i] = static_cast<uint8_t>(i * 3 + i / 997);
+
+		auto const begin{ chrono::steady_clock::now() };
+		raw::wav_writer writer{ path, channel_count, sampling_rate };
+		for (uint64_t written{}; written < data_size && writer; written += samples.size())
+			writer.write(span{ samples }.first(static_cast<size_t>(min<uint64_t>(samples.size(), data_size - written))));
+		auto const is_written{ writer.close() };
+		result = { writer.get_size(), chrono::steady_clock::now() - begin };
+
+		if (!is_written) return false;
+
+		// Only the header and the end are read back; a sample count off by one shows in either.
+		array<uint8_t, 80> header{};
+		ifstream input{ path, ios::binary };
+		input.read(reinterpret_cast<char *>(header.data()), header.size());
+
+		auto const file_size{ filesystem::file_size(path) };
+		auto const is_rf64{ file_size - 8 > 0xffff'ffff };
+		if (file_size != header.size() + data_size) return false;
+
+		auto const is_format_ok{ has_tag(header, 8, "WAVE") && has_tag(header, 48, "fmt ") && read_little_endian(header, 58, 2) == channel_count && read_little_endian(header, 60, 4) == sampling_rate && has_tag(header, 72, "data") };
+		auto const is_size_ok{ is_rf64
+			? has_tag(header, 0, "RF64") && read_little_endian(header, 4, 4) == 0xffff'ffff && has_tag(header, 12, "ds64") && read_little_endian(header, 20, 8) == file_size - 8 && read_little_endian(header, 28, 8) == data_size && read_little_endian(header, 36, 8) == data_size / (channel_count * 2) && read_little_endian(header, 76, 4) == 0xffff'ffff
+			: has_tag(header, 0, "RIFF") && read_little_endian(header, 4, 4) == file_size - 8 && has_tag(header, 12, "JUNK") && read_little_endian(header, 76, 4) == data_size };
+
+		vector<uint8_t> tail(static_cast<size_t>(min<uint64_t>(data_size, 4096)));
+		input.seekg(static_cast<streamoff>(file_size - tail.size()));
+		input.read(reinterpret_cast<char *>(tail.data()), static_cast<streamsize>(tail.size()));
+
+		// Each write starts over from the first sample, so where a byte came from follows from its position alone.
+		auto is_tail_ok{ true };
+		for (size_t i{}; i < tail.size(); ++i)
+			is_tail_ok &= tail[i] == samples[static_cast<size_t>((data_size - tail.size() + i) % samples.size())];
+
+		return is_format_ok && is_size_ok && is_tail_ok;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	auto const arguments{ span{ argv, static_cast<size_t>(argc) }.subspan(1) };
+	auto const directory{ arguments.size() > 0 ? filesystem::path{ arguments[0] } : filesystem::temp_directory_path() };
+	auto const large_wav_size{ (arguments.size() > 1 ? stoull(arguments[1]) : 4200ull) << 20 };
+
+	auto failures{ 0 };
+	auto const check{ [&](string_view what, bool const &is_ok, measurement const &result)
+	{
+		report(what, result);
+		if (!is_ok)
+		{
+			++failures;
+			println("{}: MISMATCH", what);
+		}
+	} };
+
+	measurement result{};
+
+	auto const y4m_422{ directory / "mfop_raw_422.y4m" }, y4m_420{ directory / "mfop_raw_420.y4m" };
+	check("Y4M 4:2:2 from YUY2", write_y4m(y4m_422, raw::chroma::yuv422, result), result);
+	check("Y4M 4:2:0 from NV12", write_y4m(y4m_420, raw::chroma::yuv420, result), result);
+
+	// An odd size ends on a partial second, as the last chunk of an export does.
+	auto const small_wav{ directory / "mfop_raw_riff.wav" }, large_wav{ directory / "mfop_raw_rf64.wav" };
+	check("WAV", write_wav(small_wav, 10 * sampling_rate * channel_count * 2 + 4 * 333, result), result);
+	check(large_wav_size > 0xffff'ffff ? "WAV upgraded to RF64" : "WAV (too small for RF64)", write_wav(large_wav, large_wav_size, result), result);
+
+	for (auto const &path : { y4m_422, y4m_420, small_wav, large_wav })
+	{
+		error_code ignored{};
+		filesystem::remove(path, ignored);
+	}
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,120 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+// Remuxes an MP4 with the same mfop.remux the plugin passes untouched clips through, then reads both files back
+// and checks that every sample of every kept track came through with the same bytes, times and sync flags.
+//
+//	g++ -std=c++23 -O2 -fmodules -fsearch-include-path bits/std.cc -x c++ ../src/mfop.remux.ixx ../src/mfop.remux.cpp -x none remux.cpp -o remux
+//
+//	remux <input.mp4> <output.mp4> [track ID...]	keeps the video and audio tracks unless told which
+
+import std;
+import mfop.remux;
+
+using namespace std;
+using namespace mfop;
+
+namespace
+{
+	auto to_string(remux::failure const &failure)
+	{
+		switch (failure)
+		{
+		case remux::failure::unreadable: return "unreadable"sv;
+		case remux::failure::unsupported: return "unsupported"sv;
+		case remux::failure::unwritable: return "unwritable"sv;
+		case remux::failure::aborted: return "aborted"sv;
+		}
+		return "unknown"sv;
+	}
+
+	auto read_sample(ifstream &file, remux::sample const &sample)
+	{
+		vector<char> bytes(sample.size);
+		file.seekg(static_cast<streamoff>(sample.offset));
+		file.read(bytes.data(), static_cast<streamsize>(bytes.size()));
+		return bytes;
+	}
+
+	auto is_same_sample(remux::sample const &left, remux::sample const &right)
+	{
+		return left.size == right.size && left.decode_time == right.decode_time && left.composition_offset == right.composition_offset && left.is_sync == right.is_sync;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	auto const arguments{ span{ argv, static_cast<size_t>(argc) }.subspan(1) };
+	if (arguments.size() < 2)
+	{
+		println(stderr, "usage: remux <input.mp4> <output.mp4> [track ID...]");
+		return 2;
+	}
+
+	auto const source{ remux::read_movie(arguments[0]) };
+	if (!source)
+	{
+		println(stderr, "could not read {}: {}", arguments[0], to_string(source.error()));
+		return 1;
+	}
+
+	vector<uint32_t> kept_tracks{};
+	for (auto const &argument : arguments.subspan(2)) kept_tracks.push_back(static_cast<uint32_t>(stoul(argument)));
+	if (kept_tracks.empty())
+		for (auto const &track : source->tracks)
+			if (track.is_video() || track.is_audio()) kept_tracks.push_back(track.id);
+
+	for (auto const &track : source->tracks)
+		println("track {}: {} {} at {} Hz, {} samples{}{}", track.id, track.handler, track.codec, track.timescale, track.samples.size(), track.is_video() ? format(", {}x{}", track.width, track.height) : ""s, ranges::contains(kept_tracks, track.id) ? "" : " (dropped)");
+
+	auto const begin{ chrono::steady_clock::now() };
+	auto const statistics{ remux::remux_movie(arguments[0], arguments[1], kept_tracks, {}) };
+	chrono::duration<double> const elapsed{ chrono::steady_clock::now() - begin };
+
+	if (!statistics)
+	{
+		println(stderr, "could not remux: {}", to_string(statistics.error()));
+		return 1;
+	}
+
+	println("copied {:.1f} MiB in {} chunks and {} runs, with a {} byte movie header, in {:.3f} s", static_cast<double>(statistics->copied_bytes) / (1 << 20), statistics->chunks, statistics->runs, statistics->movie_header_size, elapsed.count());
+
+	auto const destination{ remux::read_movie(arguments[1]) };
+	if (!destination)
+	{
+		println(stderr, "could not read the output back: {}", to_string(destination.error()));
+		return 1;
+	}
+
+	ifstream source_file{ arguments[0], ios::binary };
+	ifstream destination_file{ arguments[1], ios::binary };
+
+	if (destination->tracks.size() != kept_tracks.size())
+	{
+		println(stderr, "the output has {} tracks instead of {}", destination->tracks.size(), kept_tracks.size());
+		return 1;
+	}
+
+	for (auto const &track : destination->tracks)
+	{
+		auto const original{ ranges::find(source->tracks, track.id, &remux::track::id) };
+		if (original == source->tracks.end() || original->samples.size() != track.samples.size() || original->codec != track.codec)
+		{
+			println(stderr, "track {} does not match the source's", track.id);
+			return 1;
+		}
+
+		for (size_t i{}; i < track.samples.size(); ++i)
+			if (!is_same_sample(original->samples[i], track.samples[i]) || read_sample(source_file, original->samples[i]) != read_sample(destination_file, track.samples[i]))
+			{
+				println(stderr, "sample {} of track {} differs", i, track.id);
+				return 1;
+			}
+	}
+
+	println("every sample of the {} kept tracks matches the source", destination->tracks.size());
+	return 0;
+}
@@ -0,0 +1,214 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+// Reference consumer of the frame server ring, and a benchmark of it, over POSIX shared memory.
+// The ring is the same mfop.ring the plugin publishes into; only the mapping differs (OpenFileMappingW on Windows).
+//
+//	g++ -std=c++23 -O2 -fmodules -fsearch-include-path bits/std.cc -x c++ ../src/mfop.ring.ixx ../src/mfop.ring.cpp -x none ring_consumer.cpp -o ring_consumer
+//
+//	ring_consumer <name> [output.y4m]	attaches to a running producer and optionally saves the video it receives
+//	ring_consumer --bench [frames] [width] [height] [delay in us]	forks a consumer and measures both sides
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+import std;
+import mfop.ring;
+
+using namespace std;
+using namespace mfop;
+
+auto map_shared_memory(string const &name, size_t const &size, bool const &creates)
+{
+	auto const descriptor{ shm_open(name.c_str(), O_RDWR | (creates ? O_CREAT | O_EXCL : 0), 0600) };
+	if (descriptor < 0) return span<uint8_t>{};
+
+	struct stat status{};
+	if (creates ? ftruncate(descriptor, static_cast<off_t>(size)) : fstat(descriptor, &status))
+	{
+		close(descriptor);
+		return span<uint8_t>{};
+	}
+
+	auto const mapped_size{ creates ? size : static_cast<size_t>(status.st_size) };
+	auto const memory{ mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0) };
+	close(descriptor);
+
+	return memory == MAP_FAILED ? span<uint8_t>{} : span{ static_cast<uint8_t *>(memory), mapped_size };
+}
+
+struct consumption
+{
+	uint64_t video_frames;
+	uint64_t audio_samples;
+	uint64_t bytes;
+	chrono::duration<double> elapsed;
+};
+
+auto consume(span<uint8_t> memory, ofstream *output, chrono::microseconds const &delay)
+{
+	ring::consumer consumer{ memory };
+	if (!consumer) return optional<consumption>{};
+
+	auto const format{ consumer.get_format() };
+	auto const block_alignment{ max(format.audio_channel_count, 1) * 2 };
+	if (output) output->write(format.y4m_header.data(), static_cast<streamsize>(format.y4m_header.size()));
+
+	consumption result{};
+	auto const begin{ chrono::steady_clock::now() };
+
+	// Anything kept past acknowledge() has to be copied out first; the slot belongs to the producer again after that.
+	for (ring::backoff backoff{}; !consumer.is_finished();)
+	{
+		auto const message{ consumer.try_read() };
+		if (!message)
+		{
+			backoff.wait();
+			continue;
+		}
+		backoff.reset();
+
+		if (message->type == ring::kind::video)
+		{
+			++result.video_frames;
+			if (output) output->write(reinterpret_cast<char const *>(message->payload.data()), static_cast<streamsize>(message->payload.size()));
+		}
+		else
+			result.audio_samples += message->payload.size() / block_alignment;
+
+		result.bytes += message->payload.size();
+		if (delay.count()) this_thread::sleep_for(delay);
+
+		consumer.acknowledge();
+	}
+
+	result.elapsed = chrono::steady_clock::now() - begin;
+	if (consumer.is_aborted()) println(stderr, "The producer aborted.");
+
+	return optional{ result };
+}
+
+auto report(string_view side, consumption const &result)
+{
+	println("{}: {} frames, {} samples, {:.1f} MiB in {:.2f} s ({:.1f} fps, {:.0f} MiB/s)", side, result.video_frames, result.audio_samples, result.bytes / 1048576.0, result.elapsed.count(), result.video_frames / max(result.elapsed.count(), 1e-9), result.bytes / 1048576.0 / max(result.elapsed.count(), 1e-9));
+}
+
+auto attach(string const &name, char const *output_path)
+{
+	// The producer only creates the ring once an export starts, so keep looking until it does.
+	auto memory{ map_shared_memory(name, 0, false) };
+	for (; memory.empty(); memory = map_shared_memory(name, 0, false))
+		this_thread::sleep_for(100ms);
+
+	optional<ofstream> output{};
+	if (output_path) output.emplace(output_path, ios::binary);
+
+	auto const result{ consume(memory, output ? &*output : nullptr, {}) };
+	munmap(memory.data(), memory.size());
+
+	if (!result)
+	{
+		println(stderr, "{} is not a frame server ring, or all {} consumer seats are taken.", name, ring::max_consumers);
+		return 1;
+	}
+
+	report("consumer", *result);
+	return 0;
+}
+
+auto benchmark(int32_t const &frame_count, int32_t const &width, int32_t const &height, chrono::microseconds const &delay)
+{
+	auto const name{ format("/mfop-ring-bench-{}", getpid()) };
+	auto const y4m_header{ format("YUV4MPEG2 W{} H{} F60:1 Ip A1:1 C422\n", width, height) };
+	auto const frame_size{ 6 + static_cast<size_t>(width) * height * 2 };
+	auto const audio_block_size{ size_t{ 48000 / 60 * 4 } };
+	auto const slot_count{ 8u };
+
+	auto const memory{ map_shared_memory(name, ring::get_mapping_size(slot_count, frame_size), true) };
+	if (memory.empty())
+	{
+		println(stderr, "Could not create {}.", name);
+		return 1;
+	}
+
+	ring::producer producer{ memory, slot_count, frame_size, { y4m_header, 2, 48000 } };
+
+	auto const child{ fork() };
+	if (!child)
+	{
+		auto const attached{ map_shared_memory(name, 0, false) };
+		auto const result{ consume(attached, nullptr, delay) };
+		if (result) report("consumer", *result);
+		_exit(result ? 0 : 1);
+	}
+
+	ring::backoff backoff{};
+	while (!producer.get_consumer_count())
+		backoff.wait();
+
+	chrono::nanoseconds stalled_time{};
+	consumption result{};
+	auto const begin{ chrono::steady_clock::now() };
+
+	auto const acquire{ [&](size_t const &size)
+	{
+		auto buffer{ producer.try_acquire(size) };
+		if (buffer.empty())
+		{
+			auto const stall_begin{ chrono::steady_clock::now() };
+			for (backoff.reset(); buffer.empty(); buffer = producer.try_acquire(size))
+				backoff.wait();
+			stalled_time += chrono::steady_clock::now() - stall_begin;
+		}
+		return buffer;
+	} };
+
+	// A frame of video and its 1/60 s of audio, the way the plugin interleaves them.
+	for (auto f{ 0 }; f < frame_count; ++f)
+	{
+		auto const frame{ acquire(frame_size) };
+		ranges::fill(frame, static_cast<uint8_t>(f));
+		producer.publish(ring::kind::video, f);
+
+		auto const samples{ acquire(audio_block_size) };
+		ranges::fill(samples, uint8_t{});
+		producer.publish(ring::kind::audio, static_cast<int64_t>(f) * 800);
+
+		++result.video_frames;
+		result.audio_samples += 800;
+		result.bytes += frame.size() + samples.size();
+	}
+
+	producer.close(true);
+	result.elapsed = chrono::steady_clock::now() - begin;
+
+	auto status{ 0 };
+	waitpid(child, &status, 0);
+	munmap(memory.data(), memory.size());
+	shm_unlink(name.c_str());
+
+	report("producer", result);
+	println("producer: stalled for {:.2f} s waiting on the consumer", chrono::duration<double>{ stalled_time }.count());
+
+	return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+int main(int argc, char *argv[])
+{
+	auto const argument{ [&](int const &index, int32_t const &fallback) { return argc > index ? stoi(argv[index]) : fallback; } };
+
+	if (argc > 1 && argv[1] == "--bench"sv)
+		return benchmark(argument(2, 600), argument(3, 1920), argument(4, 1080), chrono::microseconds{ argument(5, 0) });
+
+	if (argc > 1)
+		return attach(format("/{}", argv[1]), argc > 2 ? argv[2] : nullptr);
+
+	println(stderr, "usage: ring_consumer <name> [output.y4m] | ring_consumer --bench [frames] [width] [height] [delay in us]");
+	return 2;
+}
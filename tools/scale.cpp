@@ -0,0 +1,178 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+// Holds mfop.scale against a plain double-precision 2D resampler on both NV12 planes, shrinking and enlarging, then times 4K to 1080p.
+// The reference shares only the kernel formulas with the module, not its taps, passes or rounding.
+//
+//	g++ -std=c++23 -O2 -mavx2 -mfma -fmodules -fsearch-include-path bits/std.cc -x c++ ../src/mfop.scale.ixx ../src/mfop.scale.cpp -x none scale.cpp -o scale
+//
+//	scale [frames to time]
+
+import std;
+import mfop.scale;
+
+using namespace std;
+using namespace mfop;
+
+namespace
+{
+	auto const constinit filter_names{ to_array({ "bilinear", "bicubic", "Lanczos-3" }) };
+
+	auto get_weight(scale::filter const &kind, double const &distance)
+	{
+		auto const x{ abs(distance) };
+		switch (kind)
+		{
+		case scale::filter::bilinear:
+			return max(1.0 - x, 0.0);
+		case scale::filter::bicubic:
+			return x < 1.0 ? (1.5 * x - 2.5) * x * x + 1.0 : x < 2.0 ? ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0 : 0.0;
+		default:
+			return x < 1e-9 ? 1.0 : x >= 3.0 ? 0.0 : 3.0 * sin(numbers::pi * x) * sin(numbers::pi * x / 3.0) / (numbers::pi * numbers::pi * x * x);
+		}
+	}
+
+	// Normalised weights of every source sample for one output position, edges repeated.
+	auto get_taps(int32_t const &source, int32_t const &destination, int32_t const &i, scale::filter const &kind)
+	{
+		auto const ratio{ static_cast<double>(source) / destination };
+		auto const stretch{ max(ratio, 1.0) };
+		auto const support{ (kind == scale::filter::bilinear ? 1.0 : kind == scale::filter::bicubic ? 2.0 : 3.0) * stretch };
+		auto const center{ (i + 0.5) * ratio - 0.5 };
+
+		vector<pair<int32_t, double>> taps{};
+		auto sum{ 0.0 };
+		for (auto j{ static_cast<int32_t>(ceil(center - support)) }; j <= floor(center + support); ++j)
+			if (auto const weight{ get_weight(kind, (j - center) / stretch) }; weight != 0.0)
+			{
+				taps.emplace_back(clamp(j, 0, source - 1), weight);
+				sum += weight;
+			}
+		for (auto &tap : taps) tap.second /= sum;
+		return taps;
+	}
+
+	// One interleaved plane, every output computed on its own from the source.
+	auto scale_reference(span<uint8_t const> source, pair<int32_t, int32_t> const &from, pair<int32_t, int32_t> const &to, int32_t const &channels, scale::filter const &kind)
+	{
+		vector<uint8_t> destination(static_cast<size_t>(to.first) * to.second * channels);
+		for (auto y{ 0 }; y < to.second; ++y)
+		{
+			auto const rows{ get_taps(from.second, to.second, y, kind) };
+			for (auto x{ 0 }; x < to.first; ++x)
+			{
+				auto const columns{ get_taps(from.first, to.first, x, kind) };
+				for (auto c{ 0 }; c < channels; ++c)
+				{
+					auto sum{ 0.0 };
+					for (auto const &[row, row_weight] : rows)
+						for (auto const &[column, column_weight] : columns)
+							sum += source[(static_cast<size_t>(row) * from.first + column) * channels + c] * row_weight * column_weight;
+					destination[(static_cast<size_t>(y) * to.first + x) * channels + c] = static_cast<uint8_t>(clamp(round(sum), 0.0, 255.0));
+				}
+			}
+		}
+		return destination;
+	}
+
+	// Soft gradients with hard-edged boxes and fine stripes, so both the smooth response and the ringing near edges are covered.
+	auto make_nv12_frame(pair<int32_t, int32_t> const &size)
+	{
+		auto const [width, height] { size };
+		vector<uint8_t> frame(static_cast<size_t>(width) * height * 3 / 2);
+		mt19937 noise{ 7 };
+		for (auto y{ 0 }; y < height; ++y)
+			for (auto x{ 0 }; x < width; ++x)
+			{
+				auto const is_box{ x % 97 < 40 && y % 61 < 25 };
+				auto const is_stripe{ y > height / 2 && x % 4 < 2 };
+				frame[static_cast<size_t>(y) * width + x] = static_cast<uint8_t>(is_box ? 235 : is_stripe ? 16 : (x * 3 + y * 2) % 200 + 20 + noise() % 3);
+			}
+		auto const chroma{ span{ frame }.subspan(static_cast<size_t>(width) * height) };
+		for (size_t i{}; i < chroma.size(); ++i)
+			chroma[i] = static_cast<uint8_t>(i % 2 ? 128 + (i / width) % 64 : 255 - (i % width) / 5 % 200);
+		return frame;
+	}
+
+	struct comparison
+	{
+		int32_t max_difference;
+		size_t off_by_one;
+	};
+
+	auto compare(span<uint8_t const> actual, span<uint8_t const> expected)
+	{
+		comparison result{};
+		for (size_t i{}; i < actual.size(); ++i)
+		{
+			auto const difference{ abs(static_cast<int32_t>(actual[i]) - expected[i]) };
+			result.max_difference = max(result.max_difference, difference);
+			result.off_by_one += difference == 1;
+		}
+		return result;
+	}
+
+	auto check_against_reference(pair<int32_t, int32_t> const &from, pair<int32_t, int32_t> const &to, scale::filter const &kind)
+	{
+		auto const source{ make_nv12_frame(from) };
+		vector<uint8_t> scaled(static_cast<size_t>(to.first) * to.second * 3 / 2);
+
+		atomic<int32_t> helpers{};
+		scale::frame_scaler const scaler{ from, to, kind, [&helpers](function<void()> const &task) { ++helpers; task(); } };
+		scaler.scale(source.data(), from.first, scaled.data(), to.first);
+
+		auto const luma_size{ static_cast<size_t>(from.first) * from.second }, scaled_luma_size{ static_cast<size_t>(to.first) * to.second };
+		auto const luma{ compare(span{ scaled }.first(scaled_luma_size), scale_reference(span{ source }.first(luma_size), from, to, 1, kind)) };
+		auto const chroma{ compare(span{ scaled }.subspan(scaled_luma_size), scale_reference(span{ source }.subspan(luma_size), { from.first / 2, from.second / 2 }, { to.first / 2, to.second / 2 }, 2, kind)) };
+
+		println("{}x{} to {}x{} with {}: luma within {} ({:.2f}% off by one), chroma within {} ({:.2f}% off by one)", from.first, from.second, to.first, to.second, filter_names[static_cast<size_t>(kind)],
+			luma.max_difference, luma.off_by_one * 100.0 / scaled_luma_size, chroma.max_difference, chroma.off_by_one * 200.0 / scaled_luma_size);
+
+		// Float taps against double ones round the other way now and then, never by more.
+		return luma.max_difference <= 1 && chroma.max_difference <= 1 && helpers == 2;
+	}
+
+	auto time_frames(scale::filter const &kind, int32_t const &frame_count, bool const &is_split)
+	{
+		pair const from{ 3840, 2160 }, to{ 1920, 1080 };
+		auto const source{ make_nv12_frame(from) };
+		vector<uint8_t> scaled(static_cast<size_t>(to.first) * to.second * 3 / 2);
+
+		scale::frame_scaler const scaler{ from, to, kind };
+		scale::plane_scaler const luma{ from, to, 1, kind }, chroma{ { from.first / 2, from.second / 2 }, { to.first / 2, to.second / 2 }, 2, kind };
+
+		auto const begin{ chrono::steady_clock::now() };
+		for (auto f{ 0 }; f < frame_count; ++f)
+			if (is_split)
+				scaler.scale(source.data(), from.first, scaled.data(), to.first);
+			else
+			{
+				luma.scale(source.data(), from.first, scaled.data(), to.first, { 0, to.second });
+				chroma.scale(source.data() + static_cast<size_t>(from.first) * from.second, from.first, scaled.data() + static_cast<size_t>(to.first) * to.second, to.first, { 0, to.second / 2 });
+			}
+		return chrono::duration<double, milli>{ chrono::steady_clock::now() - begin }.count() / frame_count;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	auto const arguments{ span{ argv, static_cast<size_t>(argc) }.subspan(1) };
+	auto const frame_count{ arguments.size() > 0 ? stoi(arguments[0]) : 30 };
+
+	auto failures{ 0 };
+	for (auto const kind : { scale::filter::bilinear, scale::filter::bicubic, scale::filter::lanczos3 })
+		for (auto const &[from, to] : to_array<pair<pair<int32_t, int32_t>, pair<int32_t, int32_t>>>({ { { 640, 360 }, { 384, 216 } }, { { 640, 360 }, { 212, 120 } }, { { 320, 180 }, { 640, 360 } }, { { 600, 338 }, { 1000, 562 } } }))
+			if (!check_against_reference(from, to, kind))
+			{
+				++failures;
+				println("MISMATCH");
+			}
+
+	for (auto const kind : { scale::filter::bilinear, scale::filter::bicubic, scale::filter::lanczos3 })
+		println("3840x2160 to 1920x1080 with {}: {:.1f} ms per frame on one thread, {:.1f} ms split three ways", filter_names[static_cast<size_t>(kind)], time_frames(kind, frame_count, false), time_frames(kind, frame_count, true));
+
+	return failures ? 1 : 0;
+}
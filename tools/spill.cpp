@@ -0,0 +1,260 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+// Round-trips frames through the LZ4 block codec of mfop.spill, then through a queue small enough that its disk tier wraps many times over.
+// Synthetic frames stand in for rendered ones unless a Y4M file is given, whose frames are then used as they are.
+//
+//	g++ -std=c++23 -O2 -fmodules -fsearch-include-path bits/std.cc -x c++ ../src/mfop.spill.ixx ../src/mfop.spill.cpp -x none spill.cpp -o spill
+//
+//	spill [Y4M file]
+
+import std;
+import mfop.spill;
+
+using namespace std;
+using namespace mfop;
+
+namespace
+{
+	auto const constinit width{ 1920 }, height{ 1080 };
+	auto const constinit frame_size{ static_cast<size_t>(width) * height * 2 };
+
+	// Flat areas, gradients, sharp edges and a little sensor noise, which is roughly what a rendered YUY2 frame holds.
+	auto make_rendered_frame(int32_t const &f)
+	{
+		mt19937 noise{ static_cast<uint32_t>(f) };
+		vector<uint8_t> frame(frame_size);
+		for (auto y{ 0 }; y < height; ++y)
+			for (auto x{ 0 }; x < width; ++x)
+			{
+				auto const i{ (static_cast<size_t>(y) * width + x) * 2 };
+				auto const is_box{ (x + f * 8) % 480 < 240 && y % 360 < 180 };
+				auto const luma{ is_box ? 200 : (x + y + f) / 12 % 220 + 16 };
+				frame[i] = static_cast<uint8_t>(y > height * 3 / 4 ? luma + noise() % 5 : luma);
+				frame[i + 1] = static_cast<uint8_t>(x % 2 ? 128 + y / 16 % 32 : 128 - x / 64 % 32);
+			}
+		return frame;
+	}
+
+	auto make_random_frame(int32_t const &f)
+	{
+		mt19937_64 random{ static_cast<uint64_t>(f) + 1 };
+		vector<uint8_t> frame(frame_size);
+		for (auto &byte : frame) byte = static_cast<uint8_t>(random());
+		return frame;
+	}
+
+	// The frames of a 4:2:2 or 4:2:0 Y4M file, each with its FRAME tag, as many as there are up to count.
+	auto read_y4m_frames(filesystem::path const &path, size_t const &count)
+	{
+		ifstream input{ path, ios::binary };
+		string header{};
+		getline(input, header);
+
+		auto const field{ [&header](char const &tag) -> int64_t
+		{
+			auto const position{ header.find(string{ ' ' } + tag) };
+			return position == string::npos ? 0 : stoll(header.substr(position + 2));
+		} };
+		auto const luma_size{ static_cast<size_t>(field('W') * field('H')) };
+		auto const is_422{ header.find(" C422") != string::npos };
+		auto const size{ 6 + luma_size * (is_422 ? 4 : 3) / 2 };
+
+		vector<vector<uint8_t>> frames{};
+		for (vector<uint8_t> frame(size); luma_size && frames.size() < count && input.read(reinterpret_cast<char *>(frame.data()), static_cast<streamsize>(size));)
+			frames.push_back(frame);
+		return frames;
+	}
+
+	struct codec_result
+	{
+		uint64_t bytes;
+		uint64_t compressed_bytes;
+		chrono::duration<double> compress_time;
+		chrono::duration<double> decompress_time;
+		bool is_ok;
+	};
+
+	auto round_trip(span<vector<uint8_t> const> frames)
+	{
+		codec_result result{ 0, 0, {}, {}, true };
+		vector<uint8_t> compressed{};
+
+		for (auto const &frame : frames)
+		{
+			vector<uint8_t> restored(frame.size());
+
+			auto const begin{ chrono::steady_clock::now() };
+			spill::compress(frame, compressed);
+			auto const middle{ chrono::steady_clock::now() };
+			auto const is_decoded{ spill::decompress(compressed, restored) };
+			auto const end{ chrono::steady_clock::now() };
+
+			result.bytes += frame.size();
+			result.compressed_bytes += compressed.size();
+			result.compress_time += middle - begin;
+			result.decompress_time += end - middle;
+			result.is_ok &= is_decoded && restored == frame;
+
+			// A block cut short, or decoded into the wrong size, has to be refused rather than half used.
+			if (compressed.size() > 1)
+				result.is_ok &= !spill::decompress(span{ compressed }.first(compressed.size() - 1), restored);
+			vector<uint8_t> larger(frame.size() + 1);
+			result.is_ok &= !spill::decompress(compressed, larger);
+		}
+
+		return result;
+	}
+
+	void report(string_view what, codec_result const &result)
+	{
+		auto const mib{ static_cast<double>(result.bytes) / (1 << 20) };
+		println("{}: {:.1f} MiB at {:.2f}:1, compressed at {:.0f} MiB/s and decompressed at {:.0f} MiB/s", what, mib, static_cast<double>(result.bytes) / max<uint64_t>(result.compressed_bytes, 1), mib / result.compress_time.count(), mib / result.decompress_time.count());
+	}
+
+	// Every size and run length around where the block format switches to an extra length byte.
+	auto check_edges()
+	{
+		vector<uint8_t> compressed{};
+		for (size_t size{}; size < 600; ++size)
+			for (auto const period : { 1u, 3u, 7u, 300u, 70000u })
+			{
+				vector<uint8_t> data(size), restored(size);
+				for (size_t i{}; i < size; ++i) data[i] = static_cast<uint8_t>(i % period * 31 + i / 17);
+
+				spill::compress(data, compressed);
+				if (!spill::decompress(compressed, restored) || restored != data) return false;
+			}
+		return true;
+	}
+
+	// Drives the ring bookkeeping alone with random sizes, holding every offset it hands out against the items still in it.
+	auto check_ring(size_t const &disk_size, uint32_t const &seed, uint64_t &wraps)
+	{
+		vector<uint8_t> disk(disk_size);
+		spill::tiers state{ 1, 0, disk };
+		deque<pair<size_t, size_t>> held{};
+		mt19937 random{ seed };
+
+		auto previous_offset{ size_t{} };
+		for (auto step{ 0 }; step < 200000; ++step)
+		{
+			if (held.empty() || random() % 3)
+			{
+				auto const size{ static_cast<size_t>(random() % (disk_size / 3) + 1) };
+				auto const offset{ state.allocate(size) };
+				if (!offset) continue;
+
+				if (*offset + size > disk_size) return false;
+				for (auto const &[other_offset, other_size] : held)
+					if (*offset < other_offset + other_size && other_offset < *offset + size) return false;
+
+				if (*offset < previous_offset) ++wraps;
+				previous_offset = *offset;
+				held.emplace_back(*offset, size);
+			}
+			else
+			{
+				state.release(held.front().first, held.front().second);
+				held.pop_front();
+			}
+		}
+		return true;
+	}
+
+	// A consumer slower than its producer, with nothing in memory, pushes everything past the first frame through the disk tier.
+	auto check_queue(span<vector<uint8_t> const> frames, size_t const &disk_size, size_t const &item_count, spill::statistics &statistics)
+	{
+		vector<uint8_t> disk(disk_size);
+		spill::queue<vector<uint8_t>> queue
+		{
+			1, chrono::milliseconds{ 0 }, 0, disk,
+			[](vector<uint8_t> const &item, vector<uint8_t> &packed) { packed = item; },
+			[](span<uint8_t const> packed) { return optional{ vector<uint8_t>{ packed.begin(), packed.end() } }; }
+		};
+
+		auto producer{ async(launch::async, [&]
+		{
+			for (size_t i{}; i < item_count; ++i)
+				if (!queue.push(vector<uint8_t>{ frames[i % frames.size()] })) return false;
+			queue.finish();
+			return true;
+		}) };
+
+		auto is_ok{ true };
+		size_t popped{};
+		for (; auto const item{ queue.pop() }; ++popped)
+		{
+			is_ok &= *item == frames[popped % frames.size()];
+			// Longer than the producer takes to copy a frame, so the one raw slot is nearly always taken when it pushes.
+			this_thread::sleep_for(chrono::milliseconds{ 5 });
+		}
+
+		statistics = queue.get_statistics();
+		return producer.get() && is_ok && popped == item_count && !queue.has_failed();
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	auto const arguments{ span{ argv, static_cast<size_t>(argc) }.subspan(1) };
+
+	auto failures{ 0 };
+	auto const check{ [&](string_view what, bool const &is_ok)
+	{
+		if (!is_ok)
+		{
+			++failures;
+			println("{}: MISMATCH", what);
+		}
+	} };
+
+	vector<vector<uint8_t>> rendered{}, random{};
+	for (auto f{ 0 }; f < 8; ++f)
+	{
+		rendered.push_back(make_rendered_frame(f));
+		random.push_back(make_random_frame(f));
+	}
+
+	auto const rendered_result{ round_trip(rendered) };
+	report("Rendered frames", rendered_result);
+	check("Rendered frames", rendered_result.is_ok);
+
+	auto const random_result{ round_trip(random) };
+	report("Random frames", random_result);
+	check("Random frames", random_result.is_ok);
+
+	if (!arguments.empty())
+	{
+		auto const frames{ read_y4m_frames(arguments[0], 60) };
+		auto const result{ round_trip(frames) };
+		report(format("{} frames of {}", frames.size(), arguments[0]), result);
+		check("Y4M frames", !frames.empty() && result.is_ok);
+	}
+
+	check("Short and repetitive blocks", check_edges());
+
+	uint64_t wraps{};
+	for (auto const disk_size : { size_t{ 97 }, size_t{ 4096 }, size_t{ 1 << 20 } })
+		for (auto seed{ 1u }; seed <= 4; ++seed)
+			check(format("Ring of {} bytes, seed {}", disk_size, seed), check_ring(disk_size, seed, wraps));
+	println("Ring bookkeeping: wrapped {} times without handing out a byte still in use", wraps);
+	check("Ring wraparound", wraps > 0);
+
+	// Room for about three compressed frames of each kind, so the ring is full and wraps all through.
+	for (auto const &[what, frames, compressed_bytes] : { tuple{ "rendered"sv, span<vector<uint8_t> const>{ rendered }, rendered_result.compressed_bytes }, tuple{ "random"sv, span<vector<uint8_t> const>{ random }, random_result.compressed_bytes } })
+	{
+		auto const disk_size{ static_cast<size_t>(compressed_bytes / frames.size() * 3 + compressed_bytes / frames.size() / 2) };
+		auto const item_count{ frames.size() * 12 };
+
+		spill::statistics statistics{};
+		auto const is_ok{ check_queue(frames, disk_size, item_count, statistics) };
+		println("Queue of {} frames through {:.1f} MiB on disk: {} spilled ({:.1f} MiB, {:.1f}x the ring), {} overflows", what, static_cast<double>(disk_size) / (1 << 20), statistics.spilled_items, static_cast<double>(statistics.spilled_bytes) / (1 << 20), static_cast<double>(statistics.spilled_bytes) / disk_size, statistics.overflows);
+		check(format("Queue of {} frames", what), is_ok && statistics.spilled_bytes > disk_size);
+	}
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,159 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+// Checks the clock in mfop.timebase against 128-bit reference arithmetic, over random rates and the ones AviUtl ExEdit2 offers,
+// for indices up to 10^9, which is past the 64-bit product its multiply-divide has to go around.
+//
+//	g++ -std=c++23 -O2 -fmodules -fsearch-include-path bits/std.cc -x c++ ../src/mfop.timebase.ixx ../src/mfop.timebase.cpp -x none timebase.cpp -o timebase
+//
+//	timebase [pairs] [indices per pair]
+
+import std;
+import mfop.timebase;
+
+using namespace std;
+
+namespace
+{
+	using wide = unsigned __int128;
+
+	struct rate_t
+	{
+		int64_t rate;
+		int64_t scale;
+	};
+
+	// NTSC and the common film, video and audio rates, then the edges of what the host can hand over.
+	auto const fixed_rates{ to_array<rate_t>(
+	{
+		{ 24000, 1001 }, { 30000, 1001 }, { 60000, 1001 }, { 120000, 1001 },
+		{ 24, 1 }, { 25, 1 }, { 30, 1 }, { 50, 1 }, { 60, 1 }, { 240, 1 },
+		{ 8000, 1 }, { 44100, 1 }, { 48000, 1 }, { 96000, 1 }, { 192000, 1 },
+		{ 1, 1 }, { 1, numeric_limits<int32_t>::max() }, { numeric_limits<int32_t>::max(), 1 }, { numeric_limits<int32_t>::max(), numeric_limits<int32_t>::max() - 1 },
+		{ 9'999'991, 3 }, { 10'000'000, 1 }, { 20'000'001, 2 }
+	}) };
+
+	auto const constinit max_index{ int64_t{ 1'000'000'000 } };
+
+	// The clock only promises results that fit a timestamp; past that, there is nothing to compare.
+	auto to_timestamp(wide const &value) -> optional<int64_t>
+	{
+		if (value > static_cast<wide>(numeric_limits<int64_t>::max())) return nullopt;
+		return static_cast<int64_t>(value);
+	}
+
+	// round(index * scale * 10^7 / rate), with halves up.
+	auto reference_time(rate_t const &clock, int64_t const &index)
+	{
+		if (index <= 0) return optional{ int64_t{} };
+
+		auto const numerator{ static_cast<wide>(index) * static_cast<uint64_t>(clock.scale) * mfop::timebase::units_per_second };
+		auto const denominator{ static_cast<wide>(clock.rate) };
+		return to_timestamp((numerator * 2 + denominator) / (denominator * 2));
+	}
+
+	// How many of ours start strictly before the index-th of other, counted from exact fractions.
+	auto reference_count_before(rate_t const &ours, rate_t const &other, int64_t const &index)
+	{
+		if (index <= 0) return optional{ int64_t{} };
+
+		auto const numerator{ static_cast<wide>(index) * static_cast<uint64_t>(other.scale) * static_cast<uint64_t>(ours.rate) };
+		auto const denominator{ static_cast<wide>(other.rate) * static_cast<uint64_t>(ours.scale) };
+		return to_timestamp((numerator + denominator - 1) / denominator);
+	}
+
+	struct checker
+	{
+		mt19937_64 random{ 46 };
+		uint64_t checks{};
+		uint64_t skipped{};
+		uint64_t failures{};
+
+		void expect(bool const &is_ok, string_view what, rate_t const &clock, int64_t const &index)
+		{
+			++checks;
+			if (is_ok) return;
+
+			// The first few are enough to go on; the count says how bad it is.
+			if (++failures <= 20) println("{} at {}/{}, index {}: MISMATCH", what, clock.rate, clock.scale, index);
+		}
+
+		auto pick_index()
+		{
+			// Mostly anywhere, but also near the start and near the top, where rounding and overflow are decided.
+			switch (random() % 4)
+			{
+			case 0: return static_cast<int64_t>(random() % 1000);
+			case 1: return max_index - static_cast<int64_t>(random() % 1000);
+			default: return static_cast<int64_t>(random() % (max_index + 1));
+			}
+		}
+
+		auto pick_rate() -> rate_t
+		{
+			auto const pick{ [this] { return static_cast<int64_t>(random() % (random() % 2 ? 240'000 : numeric_limits<int32_t>::max()) + 1); } };
+			return { pick(), pick() };
+		}
+
+		void check_clock(rate_t const &clock, rate_t const &other, uint32_t const &indices)
+		{
+			mfop::timebase::clock const ours{ clock.rate, clock.scale }, theirs{ other.rate, other.scale };
+
+			// A step of the clock is within the one unit rounding can move it from the exact one.
+			auto const exact_step{ static_cast<double>(clock.scale) * mfop::timebase::units_per_second / static_cast<double>(clock.rate) };
+
+			for (auto n{ 0u }; n < indices; ++n)
+			{
+				auto const index{ pick_index() };
+				auto const count{ static_cast<int64_t>(random() % 100'000 + 1) };
+
+				if (auto const expected{ reference_time(clock, index + count) }; !expected)
+					++skipped;
+				else
+				{
+					auto const time{ ours.get_time(index) };
+
+					expect(time == *reference_time(clock, index), "get_time", clock, index);
+					expect(ours.get_time(index + 1) >= time, "monotonic get_time", clock, index);
+					// A duration is the step to the next timestamp, so a run of them always adds up to where the run ends.
+					expect(ours.get_duration(index, count) == *expected - time, "get_duration", clock, index);
+					expect(abs(static_cast<double>(ours.get_duration(index)) - exact_step) <= 1.0, "get_duration(index)", clock, index);
+				}
+
+				if (auto const expected{ reference_count_before(clock, other, index) }; !expected)
+					++skipped;
+				else
+					expect(ours.count_before(theirs, index) == *expected, "count_before", clock, index);
+			}
+		}
+	};
+}
+
+int main(int argc, char *argv[])
+{
+	auto const arguments{ span{ argv, static_cast<size_t>(argc) }.subspan(1) };
+	auto const pairs{ arguments.size() > 0 ? static_cast<uint32_t>(stoul(arguments[0])) : 2048u };
+	auto const indices{ arguments.size() > 1 ? static_cast<uint32_t>(stoul(arguments[1])) : 512u };
+
+	checker checks{};
+	auto const begin{ chrono::steady_clock::now() };
+
+	// Every fixed rate against every other, as the audio loops ask the video clock and the other way around.
+	for (auto const &clock : fixed_rates)
+		for (auto const &other : fixed_rates)
+			checks.check_clock(clock, other, indices / 8 + 1);
+
+	for (auto pair{ 0u }; pair < pairs; ++pair)
+	{
+		auto const clock{ checks.pick_rate() };
+		checks.check_clock(clock, checks.random() % 2 ? checks.pick_rate() : fixed_rates[checks.random() % fixed_rates.size()], indices);
+	}
+
+	chrono::duration<double> const elapsed{ chrono::steady_clock::now() - begin };
+	println("{} checks over {} fixed and {} random rates in {:.1f} s ({} past a 64-bit timestamp skipped), {} failed", checks.checks, fixed_rates.size(), pairs, elapsed.count(), checks.skipped, checks.failures);
+
+	return checks.failures ? 1 : 0;
+}
@@ -0,0 +1,243 @@
+/**
+ * \copyright	SPDX-License-Identifier: MIT
+ * \year		2025-2026
+ * \author		Shion Yorigami <62567343+MonogoiNoobs@users.noreply.github.com>
+ */
+
+// Receives the MPEG-TS the plugin streams and checks it with the same mfop.transport the sender paces it with.
+// With --loopback it also plays the sender itself, over 127.0.0.1, from a synthetic stream of a known rate.
+//
+//	g++ -std=c++23 -O2 -fmodules -fsearch-include-path bits/std.cc -x c++ ../src/mfop.transport.ixx ../src/mfop.transport.cpp -x none ts_receiver.cpp -o ts_receiver
+//
+//	ts_receiver udp|tcp <port>									prints what arrived once the sender stops
+//	ts_receiver --loopback [seconds] [Mbit/s] [udp|tcp] [fast]	sends a stream to itself and fails if it did not arrive whole and on time
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+import std;
+import mfop.transport;
+
+using namespace std;
+using namespace mfop;
+
+namespace
+{
+	// Packets on a single PID with a PCR every 20 ms, laid out as a multiplexer would for a constant rate.
+	auto make_stream(double const &seconds, double const &bit_rate)
+	{
+		auto const packets_per_second{ bit_rate / 8 / transport::packet_size };
+		auto const count{ static_cast<size_t>(seconds * packets_per_second) };
+		auto const pcr_interval{ max<size_t>(static_cast<size_t>(packets_per_second / 50), 1) };
+
+		vector<uint8_t> bytes(count * transport::packet_size, 0xff);
+		for (size_t i{}; i < count; ++i)
+		{
+			auto const packet{ span{ bytes }.subspan(i * transport::packet_size, transport::packet_size) };
+			auto const has_pcr{ i % pcr_interval == 0 };
+
+			packet[0] = 0x47;
+			packet[1] = 0x01;
+			packet[2] = 0x00;
+			packet[3] = static_cast<uint8_t>((has_pcr ? 0x30 : 0x10) | (i & 0x0f));
+
+			if (has_pcr)
+			{
+				auto const pcr{ static_cast<int64_t>(i / packets_per_second * 27'000'000) };
+				auto const base{ pcr / 300 };
+				auto const extension{ pcr % 300 };
+
+				packet[4] = 7;
+				packet[5] = 0x10;
+				packet[6] = static_cast<uint8_t>(base >> 25);
+				packet[7] = static_cast<uint8_t>(base >> 17);
+				packet[8] = static_cast<uint8_t>(base >> 9);
+				packet[9] = static_cast<uint8_t>(base >> 1);
+				packet[10] = static_cast<uint8_t>((base & 1) << 7 | 0x7e | extension >> 8);
+				packet[11] = static_cast<uint8_t>(extension);
+			}
+		}
+
+		return bytes;
+	}
+
+	auto print(string_view const &side, transport::statistics const &statistics)
+	{
+		println("{}: {} datagrams, {:.1f} MiB in {:.3f} s, {:.2f} Mbit/s, jitter {:.3f} ms, max lateness {:.3f} ms", side, statistics.datagrams, static_cast<double>(statistics.bytes) / (1 << 20), statistics.elapsed, statistics.get_bit_rate() / 1e6, statistics.jitter * 1e3, statistics.max_lateness * 1e3);
+	}
+
+	auto open_listener(bool const &is_tcp, uint16_t const &port)
+	{
+		auto const socket_handle{ socket(AF_INET, is_tcp ? SOCK_STREAM : SOCK_DGRAM, 0) };
+		if (socket_handle < 0) return -1;
+
+		auto const enabled{ 1 };
+		setsockopt(socket_handle, SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof enabled);
+		// Enough for a burst from a sender that is not pacing.
+		auto const buffer_size{ 32 << 20 };
+		setsockopt(socket_handle, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof buffer_size);
+
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_port = htons(port);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		if (bind(socket_handle, reinterpret_cast<sockaddr *>(&address), sizeof address) < 0 || (is_tcp && listen(socket_handle, 1) < 0))
+		{
+			close(socket_handle);
+			return -1;
+		}
+
+		return socket_handle;
+	}
+
+	auto receive(int const &listener, bool const &is_tcp)
+	{
+		auto const socket_handle{ is_tcp ? accept(listener, nullptr, nullptr) : listener };
+
+		transport::analyzer analyzer{};
+		transport::scheduler scheduler{};
+		transport::meter meter{};
+		vector<uint8_t> buffer(64 << 10);
+		vector<transport::datagram> ready{};
+		auto is_started{ false };
+
+		for (;;)
+		{
+			// A UDP sender gives no end, so a second of silence after the first datagram stands for one.
+			pollfd descriptor{ socket_handle, POLLIN, 0 };
+			if (!is_tcp && is_started && poll(&descriptor, 1, 1000) == 0) break;
+
+			auto const received{ recv(socket_handle, buffer.data(), buffer.size(), 0) };
+			if (received <= 0) break;
+
+			auto const now{ chrono::steady_clock::now() };
+			auto const bytes{ span<uint8_t const>{ buffer }.first(static_cast<size_t>(received)) };
+			is_started = true;
+
+			analyzer.push(bytes);
+			scheduler.push(bytes, ready);
+			for (auto const &datagram : ready) meter.record(datagram.due, now, datagram.bytes.size());
+			ready.clear();
+		}
+
+		if (is_tcp) close(socket_handle);
+		return pair{ analyzer.get_analysis(), meter.get_statistics() };
+	}
+
+	auto send(uint16_t const &port, bool const &is_tcp, bool const &is_realtime, vector<uint8_t> const &stream)
+	{
+		auto const socket_handle{ socket(AF_INET, is_tcp ? SOCK_STREAM : SOCK_DGRAM, 0) };
+
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_port = htons(port);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		if (connect(socket_handle, reinterpret_cast<sockaddr *>(&address), sizeof address) < 0) return 1;
+
+		transport::scheduler scheduler{};
+		transport::pacer pacer{ is_realtime };
+		transport::meter meter{};
+		vector<transport::datagram> datagrams{};
+
+		// Handed over in the pieces a media sink writes in.
+		for (size_t offset{}; offset < stream.size(); offset += 64 << 10)
+			scheduler.push(span{ stream }.subspan(offset, min<size_t>(64 << 10, stream.size() - offset)), datagrams);
+		scheduler.flush(datagrams);
+
+		for (auto const &datagram : datagrams)
+		{
+			this_thread::sleep_until(pacer.get_send_time(datagram.due));
+
+			for (size_t sent{}; sent < datagram.bytes.size();)
+			{
+				auto const result{ ::send(socket_handle, datagram.bytes.data() + sent, datagram.bytes.size() - sent, 0) };
+				if (result < 0) return 1;
+				sent += static_cast<size_t>(result);
+			}
+
+			meter.record(datagram.due, chrono::steady_clock::now(), datagram.bytes.size());
+		}
+
+		close(socket_handle);
+		print("sent", meter.get_statistics());
+		return 0;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	auto const arguments{ span{ argv, static_cast<size_t>(argc) }.subspan(1) };
+
+	if (!arguments.empty() && string_view{ arguments[0] } == "--loopback")
+	{
+		auto const seconds{ arguments.size() > 1 ? stod(arguments[1]) : 3.0 };
+		auto const bit_rate{ (arguments.size() > 2 ? stod(arguments[2]) : 20.0) * 1e6 };
+		auto const is_tcp{ arguments.size() > 3 && string_view{ arguments[3] } == "tcp" };
+		auto const is_realtime{ !(arguments.size() > 4 && string_view{ arguments[4] } == "fast") };
+
+		auto const stream{ make_stream(seconds, bit_rate) };
+		auto const expected_packets{ stream.size() / transport::packet_size };
+
+		// Any free port; the listener is up before the sender starts, so nothing is sent into the void.
+		uint16_t port{ 0 };
+		int listener{ -1 };
+		for (uint16_t candidate{ 23000 }; candidate < 23100 && listener < 0; ++candidate)
+			if ((listener = open_listener(is_tcp, candidate)) >= 0) port = candidate;
+
+		if (listener < 0)
+		{
+			println(stderr, "could not open a port on 127.0.0.1");
+			return 1;
+		}
+
+		auto const child{ fork() };
+		if (child == 0)
+		{
+			close(listener);
+			return send(port, is_tcp, is_realtime, stream);
+		}
+
+		auto const [analysis, statistics]{ receive(listener, is_tcp) };
+		close(listener);
+
+		int status{};
+		waitpid(child, &status, 0);
+
+		print("received", statistics);
+		println("{} of {} packets, {} continuity errors, {} PCRs over {:.3f} s", analysis.packets, expected_packets, analysis.continuity_errors, analysis.pcrs, analysis.duration);
+
+		auto is_passed{ WIFEXITED(status) && WEXITSTATUS(status) == 0 && analysis.packets == expected_packets && analysis.continuity_errors == 0 };
+		// Paced to the stream's clock, it should take as long as the stream lasts and keep close to its rate.
+		if (is_realtime) is_passed = is_passed && abs(statistics.get_bit_rate() / bit_rate - 1) < 0.05 && statistics.jitter < 0.005;
+
+		println("{}", is_passed ? "passed" : "failed");
+		return is_passed ? 0 : 1;
+	}
+
+	if (arguments.size() < 2 || (string_view{ arguments[0] } != "udp" && string_view{ arguments[0] } != "tcp"))
+	{
+		println(stderr, "usage: ts_receiver udp|tcp <port> | ts_receiver --loopback [seconds] [Mbit/s] [udp|tcp] [fast]");
+		return 2;
+	}
+
+	auto const is_tcp{ string_view{ arguments[0] } == "tcp" };
+	auto const listener{ open_listener(is_tcp, static_cast<uint16_t>(stoul(arguments[1]))) };
+	if (listener < 0)
+	{
+		println(stderr, "could not listen on 127.0.0.1:{}", arguments[1]);
+		return 1;
+	}
+
+	auto const [analysis, statistics]{ receive(listener, is_tcp) };
+	close(listener);
+
+	print("received", statistics);
+	println("{} packets, {} continuity errors, {} bytes skipped, {} PCRs over {:.3f} s", analysis.packets, analysis.continuity_errors, analysis.skipped_bytes, analysis.pcrs, analysis.duration);
+
+	return analysis.continuity_errors == 0 ? 0 : 1;
+}